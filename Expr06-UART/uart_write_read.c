@@ -10,6 +10,9 @@
 #include <sys/prctl.h>
 #include <signal.h>
 
+//ڽջСÿread()ȡѵȫַַȡ
+#define READ_BUFFER_SIZE 256
+
 //ڽյַz
 #define EXIT_CHAR 'z'
 
@@ -30,7 +33,7 @@ int main(int argc,char **argv)
 	int fd,ret,nread,count=0;
 	char *uart_innode;
 	char *buffer = "hello world!\n";
-	char buff[8];
+	char buff[READ_BUFFER_SIZE];
 	struct pollfd fds[1];
 	child_signal = 0;
 	
@@ -92,11 +95,11 @@ int main(int argc,char **argv)
 			}
 			else if(fds[0].revents & POLLIN){
 				//ڽպ
-				while((nread = read(fd,buff,1))>0){
+				while((nread = read(fd,buff,sizeof(buff)))>0){
 					count+=nread;
 					printf("get data count = %d!\n",count);
 					//յַz˳
-					if(EXIT_CHAR==buff[0]){
+					if(memchr(buff,EXIT_CHAR,nread)!=NULL){
 						printf("parent fork exit ...!\n");					
 						close(fd);
 						return 0;
@@ -0,0 +1,88 @@
+#include "NetworkBenchmark.h"
+#include <QApplication>
+#include <QCoreApplication>
+#include <QScopedPointer>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <cstdio>
+
+/* Debug Output */
+//Networking interface writes debug messages for every connection event, they are suppressed so that only results are written to standard output
+static bool bIsVerbose = false;
+
+static void BenchmarkMessageHandler(QtMsgType iMessageType, const char * chrMessage) {
+    if (iMessageType == QtDebugMsg && !bIsVerbose) {
+        return;
+    }
+    fprintf(stderr, "%s\n", chrMessage);
+    return;
+}
+
+static void PrintUsage(const char * chrProgramName) {
+    printf("Usage: %s [--port Port] [--duration Time] [--sizes Size,Size,...] [--rate Rate] [--log-view] [--verbose]\n", chrProgramName);
+    printf("  --port Port           Loopback port used by the benchmark, default is %d\n", BENCH_DEFVAL_PORT);
+    printf("  --duration Time       Duration of each throughput and latency run in ms, default is %d\n", BENCH_DEFVAL_DURATION_MS);
+    printf("  --sizes Size,...      Data frame sizes in bytes of throughput runs, default is 32,128,512,2048,8192\n");
+    printf("  --rate Rate           Data frames per second in latency runs, default is %d\n", BENCH_DEFVAL_LATENCY_RATE);
+    printf("  --log-view            Also run log history benchmark, needs a display\n");
+    printf("  --verbose             Write debug messages of networking interface to standard error\n");
+    return;
+}
+
+int main(int argc, char * argv[]) {
+    //Log history benchmark needs widgets, other benchmarks also run on boards without a display
+    bool bIsLogViewRequested = false;
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--log-view") == 0) {
+            bIsLogViewRequested = true;
+        }
+    }
+    QScopedPointer<QCoreApplication> a(bIsLogViewRequested ? new QApplication(argc, argv) : new QCoreApplication(argc, argv));
+
+    /* Parse command */
+    quint16 iPortParam = BENCH_DEFVAL_PORT;
+    int iDurationParam = BENCH_DEFVAL_DURATION_MS;
+    int iLatencyRateParam = BENCH_DEFVAL_LATENCY_RATE;
+    QList<int> lstFrameSizesParam;
+    QStringList lstArguments = QCoreApplication::arguments();
+    for (int i = 1; i < lstArguments.size(); ++i) {
+        const QString & sArgument = lstArguments.at(i);
+        if (sArgument == "--port" && i + 1 < lstArguments.size()) {
+            iPortParam = lstArguments.at(++i).toUShort();
+        }
+        else if (sArgument == "--duration" && i + 1 < lstArguments.size()) {
+            iDurationParam = lstArguments.at(++i).toInt();
+        }
+        else if (sArgument == "--sizes" && i + 1 < lstArguments.size()) {
+            QStringList lstFrameSizes = lstArguments.at(++i).split(',', QString::SkipEmptyParts);
+            for (int j = 0; j < lstFrameSizes.size(); ++j) {
+                int iFrameSize = lstFrameSizes.at(j).toInt();
+                if (iFrameSize >= 32) { //Room for sequence number and sending time
+                    lstFrameSizesParam.append(iFrameSize);
+                }
+            }
+        }
+        else if (sArgument == "--rate" && i + 1 < lstArguments.size()) {
+            iLatencyRateParam = lstArguments.at(++i).toInt();
+        }
+        else if (sArgument == "--log-view") {
+            //Handled above
+        }
+        else if (sArgument == "--verbose") {
+            bIsVerbose = true;
+        }
+        else {
+            PrintUsage(argv[0]);
+            return (sArgument == "--help" || sArgument == "-h") ? 0 : 1;
+        }
+    }
+    if (iPortParam == 0 || iDurationParam <= 0) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    qInstallMsgHandler(BenchmarkMessageHandler);
+    NetworkBenchmark b(NULL, iPortParam, iDurationParam, lstFrameSizesParam, iLatencyRateParam);
+    return b.Run();
+}
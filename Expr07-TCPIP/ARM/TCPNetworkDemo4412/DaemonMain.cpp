@@ -0,0 +1,109 @@
+#include "NetworkDaemon.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSocketNotifier>
+#include <QString>
+#include <QStringList>
+#include <cstdio>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/* Termination Signal Handling */
+//Signal handlers may only call async-signal-safe functions, thus the event loop is informed through a socket pair
+static int iTerminationSignalSockets[2] = {-1, -1};
+
+static void TerminationSignalHandler(int iSignal) {
+    char chrSignal = static_cast<char>(iSignal);
+    ssize_t iBytesWritten = ::write(iTerminationSignalSockets[0], &chrSignal, 1);
+    (void)iBytesWritten;
+    return;
+}
+
+/* Resource Usage */
+static QString GetResidentMemorySize() {
+    QFile fileStatus("/proc/self/status");
+    if (!fileStatus.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return "unknown";
+    }
+    while (!fileStatus.atEnd()) {
+        QString sLine = QString::fromAscii(fileStatus.readLine());
+        if (sLine.startsWith("VmRSS:")) {
+            return sLine.mid(6).trimmed();
+        }
+    }
+    return "unknown";
+}
+
+static void PrintUsage(const char * chrProgramName) {
+    printf("Usage: %s [HostIP [Port]] [--no-client] [--no-server] [--listen-port Port] [--heartbeat Interval]\n", chrProgramName);
+    printf("  HostIP, Port          Server to connect to, values saved in Network.ini are used if not given\n");
+    printf("  --no-client           Do not run TCP Client\n");
+    printf("  --no-server           Do not run TCP Server\n");
+    printf("  --listen-port Port    Port TCP Server listens on, saved to Network.ini\n");
+    printf("  --heartbeat Interval  Heart beat interval in ms, 0 to disable, default is %d\n", DAEMON_DEFVAL_HEARTBEAT_INTERVAL_MS);
+    return;
+}
+
+int main(int argc, char * argv[]) {
+    QElapsedTimer tmrStartup;
+    tmrStartup.start();
+    QCoreApplication a(argc, argv);
+
+    /* Parse command */
+    QString sHostIPParam = "";
+    quint16 iHostPortParam = 0;
+    quint16 iListeningPortParam = 0;
+    bool bIsClientEnabled = true;
+    bool bIsServerEnabled = true;
+    unsigned int iHeartBeatInterval = DAEMON_DEFVAL_HEARTBEAT_INTERVAL_MS;
+    QStringList lstArguments = a.arguments();
+    int iPositionalArgumentCount = 0;
+    for (int i = 1; i < lstArguments.size(); ++i) {
+        const QString & sArgument = lstArguments.at(i);
+        if (sArgument == "--no-client") {
+            bIsClientEnabled = false;
+        }
+        else if (sArgument == "--no-server") {
+            bIsServerEnabled = false;
+        }
+        else if (sArgument == "--listen-port" && i + 1 < lstArguments.size()) {
+            iListeningPortParam = lstArguments.at(++i).toUShort();
+        }
+        else if (sArgument == "--heartbeat" && i + 1 < lstArguments.size()) {
+            iHeartBeatInterval = lstArguments.at(++i).toUInt();
+        }
+        else if (sArgument.startsWith("-")) {
+            PrintUsage(argv[0]);
+            return (sArgument == "--help" || sArgument == "-h") ? 0 : 1;
+        }
+        else if (iPositionalArgumentCount == 0) {
+            sHostIPParam = sArgument;
+            ++iPositionalArgumentCount;
+        }
+        else if (iPositionalArgumentCount == 1) {
+            iHostPortParam = sArgument.toUShort();
+            ++iPositionalArgumentCount;
+        }
+    }
+
+    /* Save listening port given, TCP Server loads it from ini file */
+    if (iListeningPortParam != 0) {
+        SettingsContainer.SetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_LISTENING_PORT, iListeningPortParam);
+    }
+
+    /* Quit event loop on SIGINT and SIGTERM */
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, iTerminationSignalSockets) == 0) {
+        QSocketNotifier * sntTerminationSignal = new QSocketNotifier(iTerminationSignalSockets[1], QSocketNotifier::Read, &a);
+        QObject::connect(sntTerminationSignal, SIGNAL(activated(int)), &a, SLOT(quit()));
+        signal(SIGINT, TerminationSignalHandler);
+        signal(SIGTERM, TerminationSignalHandler);
+    }
+
+    NetworkDaemon d(NULL, sHostIPParam, iHostPortParam, bIsClientEnabled, bIsServerEnabled, iHeartBeatInterval);
+    printf("Daemon started in %lld ms, resident memory %s\n", static_cast<long long>(tmrStartup.elapsed()), GetResidentMemorySize().toAscii().constData());
+    fflush(stdout);
+
+    return a.exec();
+}
@@ -0,0 +1,111 @@
+#include "LogHistory.h"
+#include <QDateTime>
+#include <QPlainTextEdit>
+
+LogHistory::LogHistory(QPlainTextEdit * txtViewInit, int iMaxEntriesInit, int iRefreshIntervalInit, QObject * parent) : QObject(parent) {
+    txtView = txtViewInit;
+    iMaxEntries = (iMaxEntriesInit > 0) ? iMaxEntriesInit : LOG_DEFVAL_MAX_ENTRIES;
+    arrEntries.resize(iMaxEntries);
+    iFirstEntry = 0;
+    iEntryCount = 0;
+    iPendingEntryCount = 0;
+    iSkippedEntryCount = 0;
+    iTimestampSecond = 0;
+
+    //Oldest lines are removed by the view itself once it holds as many entries as the ring buffer
+    txtView->setMaximumBlockCount(iMaxEntries * LOG_VIEW_BLOCKS_PER_ENTRY);
+
+    tmrRefresh = new QTimer(this);
+    tmrRefresh->setSingleShot(true);
+    tmrRefresh->setInterval(iRefreshIntervalInit);
+    connect(tmrRefresh, SIGNAL(timeout()), this, SLOT(Refresh()));
+}
+
+LogHistory::~LogHistory() {
+    tmrRefresh->stop();
+}
+
+void LogHistory::Append(const QString & sSource, const QString & sLog) {
+    //Overwrite the oldest entry when full
+    int iIndex = (iFirstEntry + iEntryCount) % iMaxEntries;
+    if (iEntryCount == iMaxEntries) {
+        iFirstEntry = (iFirstEntry + 1) % iMaxEntries;
+    }
+    else {
+        ++iEntryCount;
+    }
+    arrEntries[iIndex] = sSource + " @ " + GetTimestamp() + ":\n" + sLog;
+
+    if (iPendingEntryCount == iMaxEntries) {
+        ++iSkippedEntryCount;
+    }
+    else {
+        ++iPendingEntryCount;
+    }
+
+    //Coalesce refresh requests, the timer is not restarted so that a continuous flood still refreshes once per interval
+    if (!tmrRefresh->isActive()) {
+        tmrRefresh->start();
+    }
+    return;
+}
+
+void LogHistory::Clear() {
+    for (int i = 0; i < iMaxEntries; ++i) {
+        arrEntries[i].clear();
+    }
+    iFirstEntry = 0;
+    iEntryCount = 0;
+    iPendingEntryCount = 0;
+    iSkippedEntryCount = 0;
+    tmrRefresh->stop();
+    txtView->clear();
+    return;
+}
+
+int LogHistory::GetEntryCount() const {
+    return iEntryCount;
+}
+
+int LogHistory::GetMaxEntries() const {
+    return iMaxEntries;
+}
+
+QString LogHistory::GetEntry(int iIndex) const {
+    if (iIndex < 0 || iIndex >= iEntryCount) {
+        return QString();
+    }
+    return arrEntries.at((iFirstEntry + iIndex) % iMaxEntries);
+}
+
+const QString & LogHistory::GetTimestamp() {
+    time_t iCurrentSecond = time(NULL);
+    if (iCurrentSecond != iTimestampSecond) {
+        iTimestampSecond = iCurrentSecond;
+        sTimestamp = QDateTime::fromTime_t(static_cast<uint>(iCurrentSecond)).toString("yyyy-MM-dd hh:mm:ss");
+    }
+    return sTimestamp;
+}
+
+void LogHistory::Refresh() {
+    if (iPendingEntryCount == 0) {
+        return;
+    }
+
+    //Join pending entries, each one is followed by a separator line
+    QString sPendingText;
+    if (iSkippedEntryCount > 0) {
+        sPendingText = "System @ " + GetTimestamp() + ":\n" + QString::number(iSkippedEntryCount) + " log entries skipped\n\n";
+    }
+    int iFirstPendingEntry = iEntryCount - iPendingEntryCount;
+    for (int i = iFirstPendingEntry; i < iEntryCount; ++i) {
+        sPendingText += arrEntries.at((iFirstEntry + i) % iMaxEntries);
+        sPendingText += "\n\n";
+    }
+    sPendingText.chop(1);
+    iPendingEntryCount = 0;
+    iSkippedEntryCount = 0;
+
+    txtView->appendPlainText(sPendingText);
+    return;
+}
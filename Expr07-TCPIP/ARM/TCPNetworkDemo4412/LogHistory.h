@@ -0,0 +1,61 @@
+/*
+ * LOG HISTORY
+ *
+ * This file is the bounded log model behind MainWindow's history view.
+ * Log entries are kept in a fixed-capacity ring buffer, once it is full the oldest entry is overwritten.
+ * The view is not updated for each entry, entries appended between two refreshes are written to the view with a single call,
+ * and at most one refresh is done in each refresh interval. If more entries than the capacity arrive in one interval, only the newest ones are shown.
+ * The view is limited to the same number of entries, so memory usage does not grow when a remote floods us with messages.
+ * Timestamps are formatted at most once per second.
+ *
+ */
+
+#ifndef LOGHISTORY_H
+#define LOGHISTORY_H
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+#include <ctime>
+
+class QPlainTextEdit;
+
+/* Log History Options */
+#define LOG_DEFVAL_MAX_ENTRIES         500 //Entries kept in ring buffer and view
+#define LOG_DEFVAL_REFRESH_INTERVAL_MS 40 //Max view refresh rate, 25 frames per second
+#define LOG_VIEW_BLOCKS_PER_ENTRY      3 //Header, text and separator line
+
+class LogHistory : public QObject {
+    Q_OBJECT
+
+public:
+    explicit LogHistory(QPlainTextEdit * txtViewInit, int iMaxEntriesInit = LOG_DEFVAL_MAX_ENTRIES,
+                        int iRefreshIntervalInit = LOG_DEFVAL_REFRESH_INTERVAL_MS, QObject * parent = 0);
+    ~LogHistory();
+
+    void Append(const QString & sSource, const QString & sLog); //Append an entry "<sSource> @ <time>:" followed by sLog, the view is refreshed later
+    void Clear();
+    int GetEntryCount() const;
+    int GetMaxEntries() const;
+    QString GetEntry(int iIndex) const; //0 is the oldest entry kept
+    const QString & GetTimestamp(); //Current time formatted as "yyyy-MM-dd hh:mm:ss", cached for one second
+
+public slots:
+    void Refresh(); //Write pending entries to the view
+
+private:
+    QPlainTextEdit * txtView; //INTERNAL: View, not owned
+    QVector<QString> arrEntries; //INTERNAL: Ring buffer of entries
+    int iMaxEntries; //INTERNAL: Capacity of ring buffer
+    int iFirstEntry; //INTERNAL: Index of the oldest entry in ring buffer
+    int iEntryCount; //INTERNAL: Number of entries in ring buffer
+    int iPendingEntryCount; //INTERNAL: Number of newest entries not written to the view yet
+    int iSkippedEntryCount; //INTERNAL: Number of entries overwritten before they were written to the view
+    QTimer * tmrRefresh; //INTERNAL: Single-shot timer coalescing refresh requests
+
+    time_t iTimestampSecond; //INTERNAL: Second of cached timestamp
+    QString sTimestamp; //INTERNAL: Cached timestamp
+};
+
+#endif // LOGHISTORY_H
@@ -1,19 +1,25 @@
 #include "MainWindow.h"
+#include "LogHistory.h"
 #include "NetworkingControlInterface.h"
 #include "ui_MainWindow.h"
-#include <QDateTime>
 #include <QDebug>
 
 MainWindow::MainWindow(QWidget * parent, QString sHostIP, quint16 iHostPort) : QMainWindow(parent),
                                                                                ui(new Ui::MainWindow) {
     ui->setupUi(this);
 
+    /* Log History */
+    logHistory = new LogHistory(ui->txtHistory, LOG_DEFVAL_MAX_ENTRIES, LOG_DEFVAL_REFRESH_INTERVAL_MS, this);
+
     /* TCP Client Object */
     tcpDataClient = new TCPClient;
     connect(tcpDataClient, SIGNAL(ResponseReceivedFromServerEvent(QString, QString, QString, quint16)), this, SLOT(ResponseReceivedEventHandler(QString, QString, QString, quint16)));
     connect(tcpDataClient, SIGNAL(ConnectedToServerEvent(QString, QString, quint16)), this, SLOT(ConnectedToServerEventHandler(QString, QString, quint16)));
     connect(tcpDataClient, SIGNAL(DisconnectedFromServerEvent(QString, QString, quint16)), this, SLOT(DisconnectedFromServerEventHandler(QString, QString, quint16)));
     connect(tcpDataClient, SIGNAL(NetworkingErrorOccurredEvent(QAbstractSocket::SocketError, QString, QString, quint16)), this, SLOT(NetworkingErrorOccurredEventHandler(QAbstractSocket::SocketError, QString, QString, quint16)));
+    connect(tcpDataClient, SIGNAL(DataQueueHighWatermarkReachedEvent()), this, SLOT(DataQueueHighWatermarkReachedEventHandler()));
+    connect(tcpDataClient, SIGNAL(DataQueueLowWatermarkReachedEvent()), this, SLOT(DataQueueLowWatermarkReachedEventHandler()));
+    bIsDataQueueCongested = false;
 
     /* TCP Server Object */
     tcpCommandServer = new TCPServer;
@@ -55,69 +61,69 @@ MainWindow::~MainWindow() {
     delete ui;
 }
 
-void MainWindow::WriteLog(const QString & sLog, bool bIsSeparatorRequired) {
-    ui->txtHistory->appendPlainText(sLog);
-    if (bIsSeparatorRequired) {
-        ui->txtHistory->appendPlainText("");
-    }
+void MainWindow::WriteLog(const QString & sSource, const QString & sLog) {
+    logHistory->Append(sSource, sLog);
 }
 
 /* Networking Events Handler */
 void MainWindow::ConnectedToServerEventHandler(QString sServerName, QString sServerIPAddress, quint16 iServerPort) {
-    WriteLog("System @ " + QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss") + ":");
-    WriteLog("Connected to server \"" + sServerName + "\" (" + sServerIPAddress + ":" + QString::number(iServerPort) + ")", true);
+    WriteLog("System", "Connected to server \"" + sServerName + "\" (" + sServerIPAddress + ":" + QString::number(iServerPort) + ")");
     return;
 }
 
 void MainWindow::DisconnectedFromServerEventHandler(QString sServerName, QString sServerIPAddress, quint16 iServerPort) {
-    WriteLog("System @ " + QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss") + ":");
-    WriteLog("Disconnected from server \"" + sServerName + "\" (" + sServerIPAddress + ":" + QString::number(iServerPort) + ")", true);
+    WriteLog("System", "Disconnected from server \"" + sServerName + "\" (" + sServerIPAddress + ":" + QString::number(iServerPort) + ")");
     return;
 }
 
 void MainWindow::NetworkingErrorOccurredEventHandler(QAbstractSocket::SocketError errErrorInfo, QString sServerName, QString sServerIPAddress, quint16 iServerPort) {
-    WriteLog("System @ " + QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss") + ":");
-    WriteLog("Network error with server \"" + sServerName + "\" (" + sServerIPAddress + ":" + QString::number(iServerPort) + "): " + QString::number(errErrorInfo), true);
+    WriteLog("System", "Network error with server \"" + sServerName + "\" (" + sServerIPAddress + ":" + QString::number(iServerPort) + "): " + QString::number(errErrorInfo));
     return;
 }
 
 void MainWindow::ResponseReceivedEventHandler(QString sResponse, QString sServerName, QString sServerIPAddress, quint16 iServerPort) {
-    WriteLog("Server \"" + sServerName + "\" (" + sServerIPAddress + ":" + QString::number(iServerPort) + ") @ " + QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss") + ":");
-    WriteLog(sResponse, true);
+    WriteLog("Server \"" + sServerName + "\" (" + sServerIPAddress + ":" + QString::number(iServerPort) + ")", sResponse);
     return;
 }
 
 void MainWindow::ClientConnectedEventHandler(QString sClientName, QString sClientIPAddress, quint16 iClientPort) {
-    WriteLog("System @ " + QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss") + ":");
-    WriteLog("Client \"" + sClientName + "\" (" + sClientIPAddress + ":" + QString::number(iClientPort) + ") connected", true);
+    WriteLog("System", "Client \"" + sClientName + "\" (" + sClientIPAddress + ":" + QString::number(iClientPort) + ") connected");
     return;
 }
 
 void MainWindow::ClientDisconnectedEventHandler(QString sClientName, QString sClientIPAddress, quint16 iClientPort) {
-    WriteLog("System @ " + QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss") + ":");
-    WriteLog("Client \"" + sClientName + "\" (" + sClientIPAddress + ":" + QString::number(iClientPort) + ") disconnected", true);
+    WriteLog("System", "Client \"" + sClientName + "\" (" + sClientIPAddress + ":" + QString::number(iClientPort) + ") disconnected");
     return;
 }
 
 void MainWindow::ClientNetworkingErrorOccurredEventHandler(QAbstractSocket::SocketError errErrorInfo, QString sClientName, QString sClientIPAddress, quint16 iClientPort) {
-    WriteLog("System @ " + QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss") + ":");
-    WriteLog("Network error with client \"" + sClientName + "\" (" + sClientIPAddress + ":" + QString::number(iClientPort) + "): " + QString::number(errErrorInfo), true);
+    WriteLog("System", "Network error with client \"" + sClientName + "\" (" + sClientIPAddress + ":" + QString::number(iClientPort) + "): " + QString::number(errErrorInfo));
     return;
 }
 
 void MainWindow::DataReceivedFromClientEventHandler(QString sData, QString sClientName, QString sClientIPAddress, quint16 iClientPort) {
-    WriteLog("Client \"" + sClientName + "\" (" + sClientIPAddress + ":" + QString::number(iClientPort) + ") @ " + QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss") + ":");
-    WriteLog(sData, true);
+    WriteLog("Client \"" + sClientName + "\" (" + sClientIPAddress + ":" + QString::number(iClientPort) + ")", sData);
+    return;
+}
+
+void MainWindow::DataQueueHighWatermarkReachedEventHandler() {
+    bIsDataQueueCongested = true;
+    WriteLog("System", "Data queue is congested, heart beats to server are paused");
+    return;
+}
+
+void MainWindow::DataQueueLowWatermarkReachedEventHandler() {
+    bIsDataQueueCongested = false;
+    WriteLog("System", "Data queue has drained, heart beats to server are resumed");
     return;
 }
 
 /* Heart Beat Timer Slot */
 void MainWindow::tmrHeartBeat_Tick() {
-    tcpDataClient->QueueDataFrame("<HEART BEAT MESSAGE>");
-    WriteLog("Me @ " + QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss") + ":");
-    WriteLog("<HEART BEAT MESSAGE>", true);
-    if (tcpDataClient->IsConnected()) {
-        tcpDataClient->SendDataToServer();
+    //Throttle ourselves when data queue is congested
+    if (!bIsDataQueueCongested) {
+        tcpDataClient->QueueDataFrame("<HEART BEAT MESSAGE>");
+        WriteLog("Me", "<HEART BEAT MESSAGE>");
     }
     tcpCommandServer->SendDataToClient("<HEART BEAT MESSAGE>");
 }
@@ -126,20 +132,12 @@ void MainWindow::tmrHeartBeat_Tick() {
 void MainWindow::on_btnSend_clicked() {
     if (ui->txtInput->document()->toPlainText() != "") {
         tcpDataClient->QueueDataFrame(ui->txtInput->document()->toPlainText());
-        WriteLog("Me @ " + QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss") + ":");
-        WriteLog(ui->txtInput->document()->toPlainText(), true);
-        if (tcpDataClient->IsConnected()) {
-            tcpDataClient->SendDataToServer();
-        }
+        WriteLog("Me", ui->txtInput->document()->toPlainText());
         tcpCommandServer->SendDataToClient(ui->txtInput->document()->toPlainText());
     }
     else {
         tcpDataClient->QueueDataFrame("<EMPTY TEXT>");
-        WriteLog("Me @ " + QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss") + ":");
-        WriteLog("<EMPTY TEXT>", true);
-        if (tcpDataClient->IsConnected()) {
-            tcpDataClient->SendDataToServer();
-        }
+        WriteLog("Me", "<EMPTY TEXT>");
         tcpCommandServer->SendDataToClient("<EMPTY TEXT>");
     }
     return;
@@ -1,6 +1,7 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include "LogHistory.h"
 #include "NetworkingControlInterface.h"
 #include <QMainWindow>
 #include <QTimer>
@@ -18,9 +19,11 @@ public:
 
 private:
     Ui::MainWindow * ui;
-    void WriteLog(const QString & sLog, bool bIsSeparatorRequired = false);
+    LogHistory * logHistory; //Bounded history view model, refreshes txtHistory in batches
+    void WriteLog(const QString & sSource, const QString & sLog);
 
     QTimer * tmrHeartBeat;
+    bool bIsDataQueueCongested; //Marks if client's data queue has reached its high watermark, heart beats are not queued meanwhile
 
 private slots:
     /* Networking Events Handler */
@@ -32,6 +35,8 @@ private slots:
     void ClientDisconnectedEventHandler(QString sClientName, QString sClientIPAddress, quint16 iClientPort);
     void ClientNetworkingErrorOccurredEventHandler(QAbstractSocket::SocketError errErrorInfo, QString sClientName, QString sClientIPAddress, quint16 iClientPort);
     void DataReceivedFromClientEventHandler(QString sData, QString sClientName, QString sClientIPAddress, quint16 iClientPort);
+    void DataQueueHighWatermarkReachedEventHandler();
+    void DataQueueLowWatermarkReachedEventHandler();
 
     /* Heart Beat Timer Slot */
     void tmrHeartBeat_Tick();
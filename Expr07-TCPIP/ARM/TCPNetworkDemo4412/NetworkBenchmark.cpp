@@ -0,0 +1,1240 @@
+#include "NetworkBenchmark.h"
+#include "LogHistory.h"
+#include "SettingsProvider.h"
+#include <QApplication>
+#include <QAtomicInt>
+#include <QCoreApplication>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPlainTextEdit>
+#include <QQueue>
+#include <QStringList>
+#include <QThread>
+#include <QtAlgorithms>
+#include <cstdio>
+#include <cstring>
+
+/* Benchmark Parameters */
+#define BENCH_QUEUE_MAX_BYTES        4194304 //Data queue budget of throughput and latency runs
+#define BENCH_OVERFLOW_MAX_BYTES     65536 //Data queue budget of overflow runs
+#define BENCH_OVERFLOW_FRAME_SIZE    256
+#define BENCH_OVERFLOW_FRAME_COUNT   4096 //Data frames offered in each overflow run, 16 times the budget
+#define BENCH_OVERFLOW_BLOCK_TIMEOUT 2 //In ms, the producer is blocked once per frame over the budget since nothing drains the queue
+#define BENCH_OVERFLOW_BLOCK_COUNT   512 //Data frames offered in the block producer run
+#define BENCH_OVERFLOW_DECIMATION    4
+#define BENCH_RECONNECT_DELAY_MS     50 //Auto reconnect retry interval in reconnect benchmark
+#define BENCH_FALLBACK_FRAME_COUNT   8 //Data frames held back in a partially filled batch in framing fallback run
+#define BENCH_FALLBACK_FRAME_SIZE    64
+#define BENCH_FALLBACK_LATENCY_US    60000000 //Max latency of a batch in framing fallback run, much longer than the reconnect
+#define BENCH_EVENT_POLL_INTERVAL    256 //Data frames queued between two event processing in throughput benchmark
+#define BENCH_COMPRESSION_BATCH_SIZE 4096 //Same as the default send batch size
+#define BENCH_QUEUE_CAPACITY         4095 //Data frames each queue of queue runs holds, a ring buffer of 4096 slots
+#define BENCH_QUEUE_FRAME_COUNT      200000 //Data frames passed from producer thread to consumer thread in each queue run
+#define BENCH_ALLOCATION_FRAME_COUNT 2000 //Data frames sent in each allocation run
+#define BENCH_BROADCAST_COUNT        200 //Messages broadcast in each broadcast run, they fit in loopback socket buffers of every client
+#define BENCH_BROADCAST_MESSAGE_SIZE 128 //Without line break, so that the server has to add it
+#define BENCH_COMMAND_VERB           "BENCHCPU" //Verb of the CPU-heavy command, "BENCHCPU <rounds>"
+#define BENCH_COMMAND_CLIENT_COUNT   16 //Clients sending commands in each command run, more than CPU cores so that every command thread has work
+#define BENCH_COMMAND_COUNT          64 //Commands sent by each client in each command run, all of them fit in the client's execution queue
+#define BENCH_COMMAND_ROUNDS         20000 //Hash rounds over the command, a fraction of a millisecond on a desktop CPU
+#define BENCH_WORKER_CLIENT_COUNT    64 //Clients sending lines in each worker thread run
+#define BENCH_WORKER_LINE_COUNT      2000 //Lines sent by each client in each worker thread run, passed to upper layers as commands
+#define BENCH_BACKEND_CLIENT_COUNT   500 //Clients connected in each backend run
+#define BENCH_BACKEND_COMMAND_COUNT  2000 //Commands sent one after another in each backend run, for round-trip latency
+#define BENCH_LOG_EVENT_RATE         10000 //Log entries per second in log history run, a client flooding commands
+#define BENCH_TELEMETRY_PADDING      "T=23.5;H=41.2;P=1013.2;ADC0=0512;ADC1=0733;ADC2=0098;STATE=RUN;" //Repeated as padding of data frames
+
+/* Allocation Counting */
+//malloc() family of glibc is replaced for the whole process, Qt libraries included, so that heap allocations on the data path can be counted
+//Replacements forward to the implementation of glibc, the cost is an atomic increment per allocation in every benchmark
+#ifdef __GLIBC__
+static QBasicAtomicInt iAllocationCount = Q_BASIC_ATOMIC_INITIALIZER(0);
+
+extern "C" {
+void * __libc_malloc(size_t iSize);
+void * __libc_calloc(size_t iCount, size_t iSize);
+void * __libc_realloc(void * ptrMemory, size_t iSize);
+
+void * malloc(size_t iSize) {
+    iAllocationCount.fetchAndAddRelaxed(1);
+    return __libc_malloc(iSize);
+}
+
+void * calloc(size_t iCount, size_t iSize) {
+    iAllocationCount.fetchAndAddRelaxed(1);
+    return __libc_calloc(iCount, iSize);
+}
+
+void * realloc(void * ptrMemory, size_t iSize) {
+    iAllocationCount.fetchAndAddRelaxed(1);
+    return __libc_realloc(ptrMemory, iSize);
+}
+}
+
+static bool IsAllocationCounted() {
+    return true;
+}
+
+static int GetAllocationCount() {
+    return iAllocationCount.fetchAndAddRelaxed(0); //Wraps around, use differences
+}
+#else
+static bool IsAllocationCounted() {
+    return false;
+}
+
+static int GetAllocationCount() {
+    return 0;
+}
+#endif
+
+/* Benchmark Command Handler */
+//Answers "BENCHCPU <hash>", the hash takes the given number of FNV-1a rounds over the command
+class BenchmarkCpuCommandHandler : public NetworkingCommandHandler {
+public:
+    void ExecuteCommand(const NetworkingCommandArguments & argCommand, NetworkingCommandReply & rplCommand) {
+        const QByteArray & baCommand = argCommand.GetCommand();
+        int iRounds = argCommand.ToInt(0);
+        quint32 iHash = 2166136261U;
+        for (int i = 0; i < iRounds; ++i) {
+            for (int j = 0; j < baCommand.size(); ++j) {
+                iHash = (iHash ^ static_cast<quint8>(baCommand.at(j))) * 16777619U;
+            }
+        }
+        rplCommand.Append(QByteArray(BENCH_COMMAND_VERB " ") + QByteArray::number(iHash));
+        return;
+    }
+};
+
+/* Benchmark Queues */
+//Queues compared by queue benchmark, one producer thread and one consumer thread, both bounded to the same number of data frames
+class BenchmarkQueue {
+public:
+    virtual ~BenchmarkQueue() {}
+    virtual bool Push(const QByteArray & baData) = 0; //Returns false if the queue is full
+    virtual bool Pop(QByteArray & baData) = 0; //Returns false if the queue is empty
+};
+
+//QQueue protected by a mutex, as the client's data queue was before the ring buffer
+class BenchmarkMutexQueue : public BenchmarkQueue {
+public:
+    explicit BenchmarkMutexQueue(int iCapacityInit) {
+        iCapacity = iCapacityInit;
+    }
+
+    bool Push(const QByteArray & baData) {
+        QMutexLocker lckQueue(&mtxQueue);
+        if (queData.size() >= iCapacity) {
+            return false;
+        }
+        queData.enqueue(baData);
+        return true;
+    }
+
+    bool Pop(QByteArray & baData) {
+        QMutexLocker lckQueue(&mtxQueue);
+        if (queData.isEmpty()) {
+            return false;
+        }
+        baData = queData.dequeue();
+        return true;
+    }
+
+private:
+    int iCapacity;
+    QMutex mtxQueue;
+    QQueue<QByteArray> queData;
+};
+
+//Lock-free ring buffer of the client, without byte budget
+class BenchmarkRingQueue : public BenchmarkQueue {
+public:
+    explicit BenchmarkRingQueue(int iCapacityInit) : queData(iCapacityInit) {
+    }
+
+    bool Push(const QByteArray & baData) {
+        //A full ring would count the data frame as dropped, the producer retries instead
+        if (queData.Size() >= queData.Capacity()) {
+            return false;
+        }
+        return queData.Enqueue(baData);
+    }
+
+    bool Pop(QByteArray & baData) {
+        return queData.Dequeue(baData);
+    }
+
+private:
+    DataFrameQueue queData;
+};
+
+//Pushes data frames carrying their pushing time (ns of the common clock, in the first 8 bytes) as fast as the queue accepts them
+class BenchmarkQueueProducer : public QThread {
+public:
+    BenchmarkQueueProducer(BenchmarkQueue * queBenchInit, const QElapsedTimer * tmrClockInit, int iFrameCountInit, int iFrameSizeInit) {
+        queBench = queBenchInit;
+        tmrClock = tmrClockInit;
+        iFrameCount = iFrameCountInit;
+        iFrameSize = iFrameSizeInit;
+    }
+
+protected:
+    void run() {
+        for (int i = 0; i < iFrameCount; ++i) {
+            QByteArray baFrame(iFrameSize, 'T');
+            qint64 iPushingTime = tmrClock->nsecsElapsed();
+            memcpy(baFrame.data(), &iPushingTime, sizeof(iPushingTime));
+            while (!queBench->Push(baFrame)) {
+                QThread::yieldCurrentThread();
+            }
+        }
+        return;
+    }
+
+private:
+    BenchmarkQueue * queBench;
+    const QElapsedTimer * tmrClock;
+    int iFrameCount;
+    int iFrameSize;
+};
+
+NetworkBenchmark::NetworkBenchmark(QObject * parent, quint16 iPortInit, int iDurationInit,
+                                   const QList<int> & lstFrameSizesInit, int iLatencyRateInit) : QObject(parent),
+                                                                                                stmResult(stdout) {
+    iPort = iPortInit;
+    iDuration = iDurationInit;
+    lstFrameSizes = lstFrameSizesInit;
+    if (lstFrameSizes.isEmpty()) {
+        lstFrameSizes << 32 << 128 << 512 << 2048 << 8192;
+    }
+    iLatencyRate = (iLatencyRateInit > 0) ? iLatencyRateInit : BENCH_DEFVAL_LATENCY_RATE;
+
+    tcpBenchClient = NULL;
+    tcpBenchServer = NULL;
+    bIsBinaryFraming = false;
+    bIsCompressed = false;
+    bIsLocalTransport = false;
+    iConnectionCount = 1;
+    iFramesReceived = 0;
+    iBytesReceived = 0;
+    bIsRecordingLatency = false;
+    bIsRecordingFrames = false;
+    bIsClientConnected = false;
+    tmrClock.start();
+}
+
+NetworkBenchmark::~NetworkBenchmark() {
+    StopPair();
+}
+
+int NetworkBenchmark::Run() {
+    int iExitCode = 0;
+    SaveOriginalSettings();
+
+    //Throughput and latency, a new client/server pair is used for each framing mode since framing is negotiated when connected
+    //Modes are text, binary and binary with compression
+    for (int iFraming = 0; iFraming < 3; ++iFraming) {
+        if (!StartPair(iFraming >= 1, iFraming == 2)) {
+            WriteResult("error", "\"framing\":\"" + GetFramingName() + "\",\"message\":\"client could not connect to server\"");
+            iExitCode = 1;
+            StopPair();
+            continue;
+        }
+        for (int i = 0; i < lstFrameSizes.size(); ++i) {
+            RunThroughputBenchmark(lstFrameSizes.at(i));
+        }
+        RunLatencyBenchmark(lstFrameSizes.first());
+        StopPair();
+    }
+
+    //Same runs over a Unix domain socket, in text framing
+    if (StartPair(false, false, true)) {
+        for (int i = 0; i < lstFrameSizes.size(); ++i) {
+            RunThroughputBenchmark(lstFrameSizes.at(i));
+        }
+        RunLatencyBenchmark(lstFrameSizes.first());
+    }
+    else {
+        WriteResult("error", "\"framing\":\"text\",\"transport\":\"unix\",\"message\":\"client could not connect to server\"");
+        iExitCode = 1;
+    }
+    StopPair();
+
+    //Data frames striped across parallel connections, in text framing
+    //Loopback does not lose packets, run the benchmark on a shaped interface (e.g. "tc qdisc add dev lo root netem loss 1%") for a lossy link
+    static const int arrStripedConnectionCounts[] = {2, 4};
+    for (unsigned int i = 0; i < sizeof(arrStripedConnectionCounts) / sizeof(arrStripedConnectionCounts[0]); ++i) {
+        if (!StartPair(false, false, false, arrStripedConnectionCounts[i])) {
+            WriteResult("error", QString("\"framing\":\"text\",\"connections\":%1,\"message\":\"client could not connect to server\"").arg(arrStripedConnectionCounts[i]));
+            iExitCode = 1;
+            StopPair();
+            continue;
+        }
+        for (int j = 0; j < lstFrameSizes.size(); ++j) {
+            RunThroughputBenchmark(lstFrameSizes.at(j));
+        }
+        StopPair();
+    }
+
+    //Heap allocations per data frame, through the QString API and the QByteArray API, in text framing
+    if (StartPair(false)) {
+        RunAllocationBenchmark(false);
+        RunAllocationBenchmark(true);
+    }
+    else {
+        WriteResult("error", "\"framing\":\"text\",\"message\":\"client could not connect to server\"");
+        iExitCode = 1;
+    }
+    StopPair();
+
+    //Compression cost, in memory
+    for (int i = 0; i < lstFrameSizes.size(); ++i) {
+        RunCompressionBenchmark(lstFrameSizes.at(i));
+    }
+
+    //Data queue alone, in memory
+    RunQueueBenchmark(false);
+    RunQueueBenchmark(true);
+
+    //Overflow policies, the client is not connected so that nothing drains the queue
+    RunOverflowBenchmark(DataFrameQueue::DropOldest);
+    RunOverflowBenchmark(DataFrameQueue::DropNewest);
+    RunOverflowBenchmark(DataFrameQueue::BlockProducer);
+    RunOverflowBenchmark(DataFrameQueue::Decimate);
+
+    //Broadcast, client counts grow up to 500
+    static const int arrBroadcastClientCounts[] = {1, 10, 100, 500};
+    for (unsigned int i = 0; i < sizeof(arrBroadcastClientCounts) / sizeof(arrBroadcastClientCounts[0]); ++i) {
+        RunBroadcastBenchmark(arrBroadcastClientCounts[i], false);
+        RunBroadcastBenchmark(arrBroadcastClientCounts[i], true);
+    }
+
+    //Command execution, thread counts double up to one per CPU core
+    int iIdealThreadCount = qMax(QThread::idealThreadCount(), 1);
+    for (int iCommandThreadCount = 1; iCommandThreadCount < iIdealThreadCount; iCommandThreadCount *= 2) {
+        RunCommandBenchmark(iCommandThreadCount);
+    }
+    RunCommandBenchmark(iIdealThreadCount);
+
+    //Worker threads, thread counts double up to one per CPU core
+    for (int iWorkerThreadCount = 1; iWorkerThreadCount < iIdealThreadCount; iWorkerThreadCount *= 2) {
+        RunWorkerThreadBenchmark(iWorkerThreadCount);
+    }
+    RunWorkerThreadBenchmark(iIdealThreadCount);
+
+    //Server backends
+    RunBackendBenchmark(TCPServer::QtBackend);
+    RunBackendBenchmark(TCPServer::EpollBackend);
+
+    //Log view of MainWindow, only when the benchmark has a display
+    if (qobject_cast<QApplication *>(QCoreApplication::instance())) {
+        RunLogHistoryBenchmark();
+    }
+
+    //Reconnect
+    if (StartPair(false)) {
+        RunReconnectBenchmark();
+    }
+    else {
+        WriteResult("error", "\"framing\":\"text\",\"message\":\"client could not connect to server\"");
+        iExitCode = 1;
+    }
+    StopPair();
+
+    //Reconnect from binary to text framing with a partially filled batch pending, data frames must arrive intact
+    if (StartPair(true)) {
+        if (!RunFramingFallbackBenchmark()) {
+            iExitCode = 1;
+        }
+    }
+    else {
+        WriteResult("error", "\"framing\":\"binary\",\"message\":\"client could not connect to server\"");
+        iExitCode = 1;
+    }
+    StopPair();
+
+    RestoreOriginalSettings();
+    return iExitCode;
+}
+
+/* Networking Events Handler */
+void NetworkBenchmark::CommandDataReceivedEventHandler(int iClientID, QByteArray baCommand) {
+    (void)iClientID;
+    ++iFramesReceived;
+    iBytesReceived += baCommand.size();
+    if (bIsRecordingFrames) {
+        lstFramesRecorded.append(baCommand);
+    }
+    if (!bIsRecordingLatency) {
+        return;
+    }
+
+    //Sending time is the second field of the data frame
+    int iTimeStart = baCommand.indexOf(' ');
+    if (iTimeStart < 0) {
+        return;
+    }
+    int iTimeEnd = baCommand.indexOf(' ', iTimeStart + 1);
+    if (iTimeEnd < 0) {
+        iTimeEnd = baCommand.size();
+    }
+    bool bIsValidTime = false;
+    qint64 iSendingTime = baCommand.mid(iTimeStart + 1, iTimeEnd - iTimeStart - 1).toLongLong(&bIsValidTime);
+    if (bIsValidTime) {
+        arrLatencies.append(tmrClock.nsecsElapsed() - iSendingTime);
+    }
+    return;
+}
+
+void NetworkBenchmark::CommandReceivedEventHandler(QString sCommand, QString sClientName, QString sClientIPAddress, quint16 iClientPort) {
+    //Only connected so that the server decodes commands as text, data frames are counted by CommandDataReceivedEventHandler()
+    (void)sCommand;
+    (void)sClientName;
+    (void)sClientIPAddress;
+    (void)iClientPort;
+    return;
+}
+
+void NetworkBenchmark::ConnectedToServerEventHandler(QString sServerName, QString sServerIPAddress, quint16 iServerPort) {
+    (void)sServerName;
+    (void)sServerIPAddress;
+    (void)iServerPort;
+    bIsClientConnected = true;
+    return;
+}
+
+void NetworkBenchmark::DisconnectedFromServerEventHandler(QString sServerName, QString sServerIPAddress, quint16 iServerPort) {
+    (void)sServerName;
+    (void)sServerIPAddress;
+    (void)iServerPort;
+    bIsClientConnected = false;
+    return;
+}
+
+void NetworkBenchmark::BroadcastClientReadyReadEventHandler() {
+    QTcpSocket * tcpBroadcastClient = qobject_cast<QTcpSocket *>(sender());
+    if (tcpBroadcastClient) {
+        QByteArray baReceivedData = tcpBroadcastClient->readAll();
+        iFramesReceived += baReceivedData.count('\n');
+        iBytesReceived += baReceivedData.size();
+    }
+    return;
+}
+
+/* Saved Settings */
+//Client and server save every option changed to ini file, options of the board are put back when the benchmark finishes
+void NetworkBenchmark::SaveOriginalSettings() {
+    mapSavedSettings.clear();
+    QStringList lstKeys = SettingsContainer.GetChildKeys(ST_KEY_NETWORKING_PREFIX);
+    for (int i = 0; i < lstKeys.size(); ++i) {
+        mapSavedSettings.insert(lstKeys.at(i), SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, lstKeys.at(i)));
+    }
+    return;
+}
+
+void NetworkBenchmark::RestoreOriginalSettings() {
+    SettingsContainer.Remove(ST_KEY_NETWORKING_PREFIX);
+    SettingsContainer.SetValues(ST_KEY_NETWORKING_PREFIX, mapSavedSettings);
+    SettingsContainer.Flush();
+    return;
+}
+
+/* Client/Server Pair */
+bool NetworkBenchmark::StartServer() {
+    tcpBenchServer = new TCPServer(iPort);
+    tcpBenchServer->SetBinaryFramingEnabled(bIsBinaryFraming);
+    tcpBenchServer->SetCompressionEnabled(bIsCompressed);
+    tcpBenchServer->SetLocalEndpoint(bIsLocalTransport ? BENCH_LOCAL_ENDPOINT : "");
+    connect(tcpBenchServer, SIGNAL(CommandDataReceivedEvent(int, QByteArray)), this, SLOT(CommandDataReceivedEventHandler(int, QByteArray)));
+    return (tcpBenchServer->StartListening() && (!bIsLocalTransport || tcpBenchServer->IsLocalEndpointListening()));
+}
+
+void NetworkBenchmark::StopServer() {
+    if (tcpBenchServer) {
+        tcpBenchServer->StopListening();
+        delete tcpBenchServer;
+        tcpBenchServer = NULL;
+    }
+    return;
+}
+
+bool NetworkBenchmark::StartPair(bool bIsBinaryFramingNew, bool bIsCompressedNew, bool bIsLocalTransportNew, int iConnectionCountNew) {
+    bIsBinaryFraming = bIsBinaryFramingNew;
+    bIsCompressed = bIsCompressedNew;
+    bIsLocalTransport = bIsLocalTransportNew;
+    iConnectionCount = iConnectionCountNew;
+    if (!StartServer()) {
+        return false;
+    }
+
+    //Number of parallel connections is read from ini file when the client is created
+    SettingsContainer.SetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_CLIENT_CONNECTIONS, iConnectionCount);
+    tcpBenchClient = new TCPClient;
+    connect(tcpBenchClient, SIGNAL(ConnectedToServerEvent(QString, QString, quint16)), this, SLOT(ConnectedToServerEventHandler(QString, QString, quint16)));
+    connect(tcpBenchClient, SIGNAL(DisconnectedFromServerEvent(QString, QString, quint16)), this, SLOT(DisconnectedFromServerEventHandler(QString, QString, quint16)));
+    tcpBenchClient->SetBinaryFramingMode(bIsBinaryFraming);
+    tcpBenchClient->SetCompressionMode(bIsCompressed);
+    tcpBenchClient->SetDataQueueOptions(BENCH_QUEUE_MAX_BYTES, DataFrameQueue::DropNewest, 0, 1); //Queue rejects frames when full, the producer then yields to the event loop
+    bIsClientConnected = false;
+    tcpBenchClient->ConnectToServer(bIsLocalTransport ? BENCH_LOCAL_ENDPOINT : "127.0.0.1", iPort, true, BENCH_RECONNECT_DELAY_MS);
+    if (!WaitForConnection(true)) {
+        return false;
+    }
+
+    //Data frames are only striped across connected connections, wait for all of them
+    QElapsedTimer tmrWait;
+    tmrWait.start();
+    while (tcpBenchClient->GetConnectedConnectionCount() < iConnectionCount) {
+        if (tmrWait.elapsed() > BENCH_WAIT_TIMEOUT_MS) {
+            return false;
+        }
+        QCoreApplication::processEvents();
+    }
+
+    //Warm up, also waits for framing negotiation to finish
+    iFramesReceived = 0;
+    tcpBenchClient->QueueDataFrame(BuildFrame(0, lstFrameSizes.first()));
+    return WaitForFrames(1);
+}
+
+void NetworkBenchmark::StopPair() {
+    if (tcpBenchClient) {
+        tcpBenchClient->DisconnectFromServer(true);
+        delete tcpBenchClient;
+        tcpBenchClient = NULL;
+    }
+    StopServer();
+    bIsClientConnected = false;
+    bIsLocalTransport = false;
+    iConnectionCount = 1;
+    return;
+}
+
+/* Benchmarks */
+void NetworkBenchmark::RunThroughputBenchmark(int iFrameSize) {
+    iFramesReceived = 0;
+    iBytesReceived = 0;
+    qint64 iFramesQueued = 0;
+    qint64 iFramesRejected = 0;
+
+    //Queue data frames as fast as the queue accepts them
+    QElapsedTimer tmrRun;
+    tmrRun.start();
+    while (tmrRun.elapsed() < iDuration) {
+        if (tcpBenchClient->QueueDataFrame(BuildFrame(iFramesQueued + 1, iFrameSize))) {
+            ++iFramesQueued;
+            if (iFramesQueued % BENCH_EVENT_POLL_INTERVAL == 0) {
+                QCoreApplication::processEvents(); //Receiver runs in this thread
+            }
+        }
+        else {
+            ++iFramesRejected;
+            QCoreApplication::processEvents();
+        }
+    }
+    bool bIsCompleted = WaitForFrames(iFramesQueued);
+    qint64 iElapsedTime = tmrRun.nsecsElapsed();
+
+    double dSeconds = static_cast<double>(iElapsedTime) / 1e9;
+    WriteResult("throughput", QString("\"framing\":\"%1\",\"transport\":\"%10\",\"connections\":%11,\"frame_size\":%2,\"frames_queued\":%3,\"frames_received\":%4,\"frames_rejected\":%5,"
+                                      "\"seconds\":%6,\"frames_per_s\":%7,\"mb_per_s\":%8,\"completed\":%9")
+                              .arg(GetFramingName()).arg(iFrameSize).arg(iFramesQueued).arg(iFramesReceived).arg(iFramesRejected)
+                              .arg(dSeconds, 0, 'f', 3)
+                              .arg(static_cast<double>(iFramesReceived) / dSeconds, 0, 'f', 1)
+                              .arg(static_cast<double>(iFramesReceived) * iFrameSize / dSeconds / 1048576.0, 0, 'f', 3)
+                              .arg(bIsCompleted ? "true" : "false")
+                              .arg(GetTransportName()).arg(iConnectionCount));
+    return;
+}
+
+void NetworkBenchmark::RunLatencyBenchmark(int iFrameSize) {
+    iFramesReceived = 0;
+    iBytesReceived = 0;
+    arrLatencies.clear();
+    arrLatencies.reserve(static_cast<int>(static_cast<qint64>(iLatencyRate) * iDuration / 1000) + 1);
+    bIsRecordingLatency = true;
+
+    //Queue data frames at a fixed rate, the receiver is serviced while waiting for the next sending time
+    qint64 iInterval = 1000000000LL / iLatencyRate;
+    qint64 iFrameCount = static_cast<qint64>(iLatencyRate) * iDuration / 1000;
+    qint64 iNextSendingTime = tmrClock.nsecsElapsed();
+    for (qint64 i = 1; i <= iFrameCount; ++i) {
+        while (tmrClock.nsecsElapsed() < iNextSendingTime) {
+            QCoreApplication::processEvents();
+        }
+        tcpBenchClient->QueueDataFrame(BuildFrame(i, iFrameSize));
+        iNextSendingTime += iInterval;
+    }
+    bool bIsCompleted = WaitForFrames(iFrameCount);
+    bIsRecordingLatency = false;
+
+    qSort(arrLatencies);
+    WriteResult("latency", QString("\"framing\":\"%1\",\"transport\":\"%13\",\"frame_size\":%2,\"rate\":%3,\"samples\":%4,\"batch_size\":%5,\"batch_max_latency_us\":%6,"
+                                   "\"min_ns\":%7,\"p50_ns\":%8,\"p99_ns\":%9,\"p999_ns\":%10,\"max_ns\":%11,\"completed\":%12")
+                           .arg(GetFramingName()).arg(iFrameSize).arg(iLatencyRate).arg(arrLatencies.size())
+                           .arg(tcpBenchClient->GetSendBatchSize()).arg(tcpBenchClient->GetSendBatchMaxLatency())
+                           .arg(arrLatencies.isEmpty() ? 0 : arrLatencies.first())
+                           .arg(GetPercentile(arrLatencies, 0.50)).arg(GetPercentile(arrLatencies, 0.99)).arg(GetPercentile(arrLatencies, 0.999))
+                           .arg(arrLatencies.isEmpty() ? 0 : arrLatencies.last())
+                           .arg(bIsCompleted ? "true" : "false")
+                           .arg(GetTransportName()));
+    arrLatencies.clear();
+    return;
+}
+
+void NetworkBenchmark::RunAllocationBenchmark(bool bIsByteApi) {
+    if (!IsAllocationCounted()) {
+        WriteResult("error", "\"api\":\"" + QString(bIsByteApi ? "qbytearray" : "qstring") + "\",\"message\":\"allocations are only counted with glibc\"");
+        return;
+    }
+
+    //Data frames are built before counting, so that only the path from the producer to the upper layers of the server is counted
+    int iFrameSize = lstFrameSizes.first();
+    QList<QByteArray> lstFrames;
+    QStringList lstTextFrames;
+    for (int i = 0; i < BENCH_ALLOCATION_FRAME_COUNT; ++i) {
+        if (bIsByteApi) {
+            lstFrames.append(BuildFrame(i + 1, iFrameSize));
+        }
+        else {
+            lstTextFrames.append(QString::fromLatin1(BuildFrame(i + 1, iFrameSize)));
+        }
+    }
+
+    //The QString API is used end to end, commands are also decoded as text by the server
+    if (!bIsByteApi) {
+        connect(tcpBenchServer, SIGNAL(CommandReceivedEvent(QString, QString, QString, quint16)), this, SLOT(CommandReceivedEventHandler(QString, QString, QString, quint16)));
+    }
+    iFramesReceived = 0;
+    int iAllocationCountStart = GetAllocationCount();
+    for (int i = 0; i < BENCH_ALLOCATION_FRAME_COUNT; ++i) {
+        while (!(bIsByteApi ? tcpBenchClient->QueueDataFrame(lstFrames.at(i)) : tcpBenchClient->QueueDataFrame(lstTextFrames.at(i)))) {
+            QCoreApplication::processEvents();
+        }
+        if ((i + 1) % BENCH_EVENT_POLL_INTERVAL == 0) {
+            QCoreApplication::processEvents(); //Receiver runs in this thread
+        }
+    }
+    bool bIsCompleted = WaitForFrames(BENCH_ALLOCATION_FRAME_COUNT);
+    int iAllocations = GetAllocationCount() - iAllocationCountStart;
+    if (!bIsByteApi) {
+        disconnect(tcpBenchServer, SIGNAL(CommandReceivedEvent(QString, QString, QString, quint16)), this, SLOT(CommandReceivedEventHandler(QString, QString, QString, quint16)));
+    }
+
+    //Allocations of every thread are counted, including event processing of sockets and timers
+    WriteResult("allocation", QString("\"api\":\"%1\",\"framing\":\"%2\",\"frame_size\":%3,\"frames\":%4,\"allocations\":%5,\"allocations_per_frame\":%6,\"completed\":%7")
+                              .arg(bIsByteApi ? "qbytearray" : "qstring").arg(GetFramingName()).arg(iFrameSize).arg(BENCH_ALLOCATION_FRAME_COUNT).arg(iAllocations)
+                              .arg(static_cast<double>(iAllocations) / BENCH_ALLOCATION_FRAME_COUNT, 0, 'f', 2)
+                              .arg(bIsCompleted ? "true" : "false"));
+    return;
+}
+
+void NetworkBenchmark::RunQueueBenchmark(bool bIsLockFree) {
+    //Data frames are as large as the smallest ones of other runs, but hold at least the pushing time
+    int iFrameSize = qMax(lstFrameSizes.first(), static_cast<int>(sizeof(qint64)));
+    BenchmarkQueue * queBench = NULL;
+    if (bIsLockFree) {
+        queBench = new BenchmarkRingQueue(BENCH_QUEUE_CAPACITY);
+    }
+    else {
+        queBench = new BenchmarkMutexQueue(BENCH_QUEUE_CAPACITY);
+    }
+
+    //This thread is the consumer, like the sender thread it spins (yielding) while the queue is empty
+    QVector<qint64> arrQueueLatencies(BENCH_QUEUE_FRAME_COUNT);
+    BenchmarkQueueProducer trdProducer(queBench, &tmrClock, BENCH_QUEUE_FRAME_COUNT, iFrameSize);
+    QElapsedTimer tmrRun;
+    tmrRun.start();
+    trdProducer.start();
+    QByteArray baFrame;
+    for (int i = 0; i < BENCH_QUEUE_FRAME_COUNT; ) {
+        if (!queBench->Pop(baFrame)) {
+            QThread::yieldCurrentThread();
+            continue;
+        }
+        qint64 iPushingTime = 0;
+        memcpy(&iPushingTime, baFrame.constData(), sizeof(iPushingTime));
+        arrQueueLatencies[i++] = tmrClock.nsecsElapsed() - iPushingTime;
+    }
+    qint64 iRunTime = qMax(tmrRun.nsecsElapsed(), Q_INT64_C(1));
+    trdProducer.wait();
+    delete queBench;
+
+    //Latency includes the time a data frame waits for room, as a producer outrunning the sender would see
+    qSort(arrQueueLatencies);
+    WriteResult("queue", QString("\"queue\":\"%1\",\"frame_size\":%2,\"frames\":%3,\"capacity\":%4,\"frames_per_s\":%5,"
+                                 "\"p50_ns\":%6,\"p99_ns\":%7,\"max_ns\":%8")
+                         .arg(bIsLockFree ? "spsc" : "mutex").arg(iFrameSize).arg(BENCH_QUEUE_FRAME_COUNT).arg(BENCH_QUEUE_CAPACITY)
+                         .arg(static_cast<double>(BENCH_QUEUE_FRAME_COUNT) * 1e9 / iRunTime, 0, 'f', 1)
+                         .arg(GetPercentile(arrQueueLatencies, 0.50)).arg(GetPercentile(arrQueueLatencies, 0.99))
+                         .arg(arrQueueLatencies.last()));
+    return;
+}
+
+void NetworkBenchmark::RunOverflowBenchmark(DataFrameQueue::OverflowPolicy iOverflowPolicy) {
+    TCPClient * tcpOverflowClient = new TCPClient;
+    tcpOverflowClient->SetDataQueueOptions(BENCH_OVERFLOW_MAX_BYTES, iOverflowPolicy, BENCH_OVERFLOW_BLOCK_TIMEOUT, BENCH_OVERFLOW_DECIMATION);
+    QByteArray baFrame = BuildFrame(1, BENCH_OVERFLOW_FRAME_SIZE);
+    int iFrameCount = (iOverflowPolicy == DataFrameQueue::BlockProducer) ? BENCH_OVERFLOW_BLOCK_COUNT : BENCH_OVERFLOW_FRAME_COUNT;
+
+    //Offer data frames while disconnected
+    int iFramesAccepted = 0;
+    QElapsedTimer tmrRun;
+    tmrRun.start();
+    for (int i = 0; i < iFrameCount; ++i) {
+        if (tcpOverflowClient->QueueDataFrame(baFrame)) {
+            ++iFramesAccepted;
+        }
+    }
+    qint64 iElapsedTime = tmrRun.nsecsElapsed();
+
+    //Let the worker object trim the queue (drop oldest policy)
+    ProcessEventsFor(100);
+
+    WriteResult("overflow", QString("\"policy\":\"%1\",\"frame_size\":%2,\"max_bytes\":%3,\"frames_offered\":%4,\"frames_accepted\":%5,"
+                                    "\"frames_dropped\":%6,\"bytes_queued\":%7,\"ns_per_offer\":%8")
+                            .arg(DataFrameQueue::GetOverflowPolicyName(iOverflowPolicy)).arg(BENCH_OVERFLOW_FRAME_SIZE).arg(BENCH_OVERFLOW_MAX_BYTES)
+                            .arg(iFrameCount).arg(iFramesAccepted).arg(tcpOverflowClient->GetDroppedDataFrameCount())
+                            .arg(tcpOverflowClient->GetDataQueueBytes()).arg(iElapsedTime / iFrameCount));
+
+    tcpOverflowClient->PurgeDataFrameQueue();
+    delete tcpOverflowClient;
+    return;
+}
+
+void NetworkBenchmark::RunReconnectBenchmark() {
+    QVector<qint64> arrReconnectTimes;
+    for (int i = 0; i < BENCH_DEFVAL_RECONNECT_COUNT; ++i) {
+        //Stop server and wait for client to notice it
+        StopServer();
+        if (!WaitForConnection(false)) {
+            break;
+        }
+
+        //Restart server and measure time until client is connected again
+        QElapsedTimer tmrRun;
+        tmrRun.start();
+        if (!StartServer() || !WaitForConnection(true)) {
+            break;
+        }
+        arrReconnectTimes.append(tmrRun.nsecsElapsed());
+    }
+
+    qSort(arrReconnectTimes);
+    WriteResult("reconnect", QString("\"reconnect_delay_ms\":%1,\"attempts\":%2,\"succeeded\":%3,\"min_ns\":%4,\"p50_ns\":%5,\"max_ns\":%6,\"last_outage_ms\":%7")
+                             .arg(BENCH_RECONNECT_DELAY_MS).arg(BENCH_DEFVAL_RECONNECT_COUNT).arg(arrReconnectTimes.size())
+                             .arg(arrReconnectTimes.isEmpty() ? 0 : arrReconnectTimes.first())
+                             .arg(GetPercentile(arrReconnectTimes, 0.50))
+                             .arg(arrReconnectTimes.isEmpty() ? 0 : arrReconnectTimes.last())
+                             .arg(tcpBenchClient->GetLastReconnectTime())); //Measured by client, from losing the connection to being connected again
+    return;
+}
+
+bool NetworkBenchmark::RunFramingFallbackBenchmark() {
+    //Hold data frames back in a partially filled batch, encoded for binary framing
+    //Data frames end with a line break (built as in text mode), so that they are valid in both framing modes
+    int iSendBatchSizeSaved = tcpBenchClient->GetSendBatchSize();
+    unsigned int iSendBatchMaxLatencySaved = tcpBenchClient->GetSendBatchMaxLatency();
+    tcpBenchClient->SetSendBatchOptions(iSendBatchSizeSaved, BENCH_FALLBACK_LATENCY_US);
+    bIsBinaryFraming = false;
+    QList<QByteArray> lstFramesSent;
+    for (int i = 0; i < BENCH_FALLBACK_FRAME_COUNT; ++i) {
+        lstFramesSent.append(BuildFrame(i + 1, BENCH_FALLBACK_FRAME_SIZE));
+        tcpBenchClient->QueueDataFrame(lstFramesSent.last());
+    }
+    iFramesReceived = 0;
+    lstFramesRecorded.clear();
+    bIsRecordingFrames = true;
+    ProcessEventsFor(100);
+    bool bIsBatchPending = (iFramesReceived == 0);
+
+    //Restart server without binary framing, client falls back to text framing when it reconnects
+    bool bIsReconnected = false;
+    StopServer();
+    if (WaitForConnection(false) && StartServer() && WaitForConnection(true)) {
+        bIsReconnected = true;
+        tcpBenchClient->Flush(BENCH_WAIT_TIMEOUT_MS);
+        WaitForFrames(BENCH_FALLBACK_FRAME_COUNT);
+        ProcessEventsFor(100); //Extra data frames would come from a corrupted stream
+    }
+    bIsRecordingFrames = false;
+
+    //Every data frame must be received once, without header bytes of the old framing, lines are received without line break
+    int iFramesIntact = 0;
+    for (int i = 0; i < lstFramesSent.size() && i < lstFramesRecorded.size(); ++i) {
+        if (lstFramesRecorded.at(i) + '\n' == lstFramesSent.at(i)) {
+            ++iFramesIntact;
+        }
+    }
+    bool bIsCompleted = (bIsReconnected && iFramesIntact == BENCH_FALLBACK_FRAME_COUNT && lstFramesRecorded.size() == BENCH_FALLBACK_FRAME_COUNT);
+    WriteResult("framing_fallback", QString("\"frames\":%1,\"pending_before_reconnect\":%2,\"reconnected\":%3,\"received\":%4,\"intact\":%5,\"completed\":%6")
+                                    .arg(BENCH_FALLBACK_FRAME_COUNT).arg(bIsBatchPending ? "true" : "false").arg(bIsReconnected ? "true" : "false")
+                                    .arg(lstFramesRecorded.size()).arg(iFramesIntact).arg(bIsCompleted ? "true" : "false"));
+    lstFramesRecorded.clear();
+    tcpBenchClient->SetSendBatchOptions(iSendBatchSizeSaved, iSendBatchMaxLatencySaved);
+    return bIsCompleted;
+}
+
+void NetworkBenchmark::RunCompressionBenchmark(int iFrameSize) {
+    //Fill a batch with binary framed data frames, as the client does
+    bool bIsBinaryFramingSaved = bIsBinaryFraming;
+    bIsBinaryFraming = true;
+    QByteArray baBatch;
+    qint64 iSequence = 0;
+    while (baBatch.size() < BENCH_COMPRESSION_BATCH_SIZE) {
+        BinaryFrameEncoder::AppendFrame(baBatch, NET_FRAME_TYPE_DATA, BuildFrame(++iSequence, iFrameSize));
+    }
+    bIsBinaryFraming = bIsBinaryFramingSaved;
+
+    //Compress the batch repeatedly
+    QByteArray baCompressedBatch;
+    qint64 iBytesCompressed = 0;
+    QElapsedTimer tmrRun;
+    tmrRun.start();
+    while (tmrRun.elapsed() < iDuration / 2) {
+        baCompressedBatch.clear();
+        if (!BinaryFrameEncoder::AppendCompressedBatch(baCompressedBatch, baBatch.constData(), baBatch.size(), ST_DEFVAL_COMPRESSION_LEVEL)) {
+            break; //Batch does not shrink
+        }
+        iBytesCompressed += baBatch.size();
+    }
+    qint64 iCompressionTime = tmrRun.nsecsElapsed();
+    if (iBytesCompressed == 0) {
+        WriteResult("compression", QString("\"frame_size\":%1,\"batch_size\":%2,\"compressible\":false").arg(iFrameSize).arg(baBatch.size()));
+        return;
+    }
+
+    //Decompress it repeatedly
+    BinaryFrameDecoder decBatchDecoder;
+    decBatchDecoder.SetCompressionEnabled(true);
+    quint8 iMessageType = 0;
+    QByteArray baPayload;
+    qint64 iBytesDecompressed = 0;
+    tmrRun.restart();
+    while (tmrRun.elapsed() < iDuration / 2) {
+        decBatchDecoder.Append(baCompressedBatch);
+        while (decBatchDecoder.NextFrame(iMessageType, baPayload)) {
+            ;
+        }
+        if (decBatchDecoder.IsCorrupted()) {
+            break;
+        }
+        iBytesDecompressed += baBatch.size();
+    }
+    qint64 iDecompressionTime = tmrRun.nsecsElapsed();
+
+    //Compression runs in sender thread while the link carries the previous batch, so the slower one of them bounds throughput
+    double dRatio = static_cast<double>(baCompressedBatch.size()) / baBatch.size();
+    double dCompressionSecondsPerMB = static_cast<double>(iCompressionTime) / 1e9 / (static_cast<double>(iBytesCompressed) / 1048576.0);
+    double dDecompressionSecondsPerMB = (iBytesDecompressed > 0) ? static_cast<double>(iDecompressionTime) / 1e9 / (static_cast<double>(iBytesDecompressed) / 1048576.0) : 0;
+    double dCompressedThroughput = qMin(1.0 / dCompressionSecondsPerMB, BENCH_LINK_MB_PER_S / dRatio);
+    WriteResult("compression", QString("\"frame_size\":%1,\"batch_size\":%2,\"compressed_size\":%3,\"ratio\":%4,\"level\":%5,"
+                                       "\"compress_ms_per_mb\":%6,\"decompress_ms_per_mb\":%7,\"link_mb_per_s\":%8,\"est_mb_per_s\":%9,\"est_gain\":%10")
+                               .arg(iFrameSize).arg(baBatch.size()).arg(baCompressedBatch.size()).arg(dRatio, 0, 'f', 3).arg(ST_DEFVAL_COMPRESSION_LEVEL)
+                               .arg(dCompressionSecondsPerMB * 1000.0, 0, 'f', 3).arg(dDecompressionSecondsPerMB * 1000.0, 0, 'f', 3)
+                               .arg(BENCH_LINK_MB_PER_S, 0, 'f', 1).arg(dCompressedThroughput, 0, 'f', 3)
+                               .arg(dCompressedThroughput / BENCH_LINK_MB_PER_S, 0, 'f', 3));
+    return;
+}
+
+void NetworkBenchmark::RunBroadcastBenchmark(int iClientCount, bool bIsEncodedOnce) {
+    //Plain sockets act as clients in text mode, like network debugging tools do
+    bIsBinaryFraming = false;
+    bIsCompressed = false;
+    if (!StartServer()) {
+        WriteResult("error", QString("\"framing\":\"text\",\"clients\":%1,\"message\":\"server could not listen\"").arg(iClientCount));
+        StopServer();
+        return;
+    }
+    QList<QTcpSocket *> lstBroadcastClients;
+    for (int i = 0; i < iClientCount; ++i) {
+        QTcpSocket * tcpBroadcastClient = new QTcpSocket(this);
+        connect(tcpBroadcastClient, SIGNAL(readyRead()), this, SLOT(BroadcastClientReadyReadEventHandler()));
+        tcpBroadcastClient->connectToHost("127.0.0.1", iPort);
+        lstBroadcastClients.append(tcpBroadcastClient);
+    }
+
+    //Wait until every session is registered, a broadcast only reaches registered sessions
+    QElapsedTimer tmrWait;
+    tmrWait.start();
+    while (tcpBenchServer->GetConnectedClientCount() < iClientCount && tmrWait.elapsed() < BENCH_WAIT_TIMEOUT_MS) {
+        QCoreApplication::processEvents();
+    }
+    int iClientsConnected = tcpBenchServer->GetConnectedClientCount();
+    if (iClientsConnected == iClientCount) {
+        //Broadcast without servicing the receivers, so that only the sender's cost is measured first
+        //Baseline is the per-socket path broadcasts used before, the text is transcoded and every session encodes its own copy
+        QByteArray baMessage = BuildFrame(1, BENCH_BROADCAST_MESSAGE_SIZE + 1);
+        baMessage.chop(1);
+        QString sMessage = QString::fromLatin1(baMessage);
+        QList<int> lstClientIDs = tcpBenchServer->GetConnectedClientIDs();
+        iFramesReceived = 0;
+        iBytesReceived = 0;
+        QElapsedTimer tmrRun;
+        tmrRun.start();
+        for (int i = 0; i < BENCH_BROADCAST_COUNT; ++i) {
+            if (bIsEncodedOnce) {
+                tcpBenchServer->SendDataToClient(baMessage);
+                continue;
+            }
+            for (int j = 0; j < lstClientIDs.size(); ++j) {
+                tcpBenchServer->SendDataToClient(lstClientIDs.at(j), sMessage.toUtf8());
+            }
+        }
+        qint64 iSendingTime = tmrRun.nsecsElapsed();
+        bool bIsCompleted = WaitForFrames(static_cast<qint64>(iClientCount) * BENCH_BROADCAST_COUNT);
+        qint64 iDeliveryTime = tmrRun.nsecsElapsed();
+
+        qint64 iMessagesExpected = static_cast<qint64>(iClientCount) * BENCH_BROADCAST_COUNT;
+        WriteResult("broadcast", QString("\"path\":\"%9\",\"clients\":%1,\"messages\":%2,\"message_size\":%3,\"lines_received\":%4,\"send_ns_per_message\":%5,"
+                                         "\"send_ns_per_client\":%6,\"delivery_ns_per_client\":%7,\"completed\":%8")
+                                 .arg(iClientCount).arg(BENCH_BROADCAST_COUNT).arg(BENCH_BROADCAST_MESSAGE_SIZE).arg(iFramesReceived)
+                                 .arg(iSendingTime / BENCH_BROADCAST_COUNT).arg(iSendingTime / iMessagesExpected).arg(iDeliveryTime / iMessagesExpected)
+                                 .arg(bIsCompleted ? "true" : "false")
+                                 .arg(bIsEncodedOnce ? "encode_once" : "per_socket"));
+    }
+    else {
+        WriteResult("error", QString("\"framing\":\"text\",\"clients\":%1,\"clients_connected\":%2,\"message\":\"not all clients could connect, check the open files limit\"")
+                             .arg(iClientCount).arg(iClientsConnected));
+    }
+
+    //Close clients before the server, so that the server does not wait for them
+    for (int i = 0; i < lstBroadcastClients.size(); ++i) {
+        lstBroadcastClients.at(i)->abort();
+    }
+    qDeleteAll(lstBroadcastClients);
+    StopServer();
+    return;
+}
+
+void NetworkBenchmark::RunCommandBenchmark(int iCommandThreadCount) {
+    //Plain sockets act as clients in text mode, every command is answered with one line
+    bIsBinaryFraming = false;
+    bIsCompressed = false;
+    if (!StartServer()) {
+        WriteResult("error", QString("\"framing\":\"text\",\"threads\":%1,\"message\":\"server could not listen\"").arg(iCommandThreadCount));
+        StopServer();
+        return;
+    }
+    BenchmarkCpuCommandHandler hdlCpuCommand; //Outlives the server object, which waits for running commands when deleted
+    tcpBenchServer->RegisterCommandHandler(BENCH_COMMAND_VERB, &hdlCpuCommand);
+    tcpBenchServer->SetCommandExecutionOptions(iCommandThreadCount, BENCH_COMMAND_COUNT, BENCH_COMMAND_CLIENT_COUNT * BENCH_COMMAND_COUNT);
+    QList<QTcpSocket *> lstCommandClients;
+    for (int i = 0; i < BENCH_COMMAND_CLIENT_COUNT; ++i) {
+        QTcpSocket * tcpCommandClient = new QTcpSocket(this);
+        connect(tcpCommandClient, SIGNAL(readyRead()), this, SLOT(BroadcastClientReadyReadEventHandler()));
+        tcpCommandClient->connectToHost("127.0.0.1", iPort);
+        lstCommandClients.append(tcpCommandClient);
+    }
+
+    //Wait until every session is registered, commands of a client are only read once it is
+    QElapsedTimer tmrWait;
+    tmrWait.start();
+    while (tcpBenchServer->GetConnectedClientCount() < BENCH_COMMAND_CLIENT_COUNT && tmrWait.elapsed() < BENCH_WAIT_TIMEOUT_MS) {
+        QCoreApplication::processEvents();
+    }
+    int iClientsConnected = tcpBenchServer->GetConnectedClientCount();
+    if (iClientsConnected == BENCH_COMMAND_CLIENT_COUNT) {
+        //Every client sends all of its commands at once, so that the executor is never starved
+        QByteArray baCommands = (QByteArray(BENCH_COMMAND_VERB " ") + QByteArray::number(BENCH_COMMAND_ROUNDS) + '\n').repeated(BENCH_COMMAND_COUNT);
+        qint64 iCommandsExpected = static_cast<qint64>(BENCH_COMMAND_CLIENT_COUNT) * BENCH_COMMAND_COUNT;
+        iFramesReceived = 0;
+        iBytesReceived = 0;
+        QElapsedTimer tmrRun;
+        tmrRun.start();
+        for (int i = 0; i < lstCommandClients.size(); ++i) {
+            lstCommandClients.at(i)->write(baCommands);
+        }
+        bool bIsCompleted = WaitForFrames(iCommandsExpected);
+        qint64 iRunTime = qMax(tmrRun.nsecsElapsed(), Q_INT64_C(1));
+
+        WriteResult("command", QString("\"threads\":%1,\"clients\":%2,\"commands\":%3,\"rounds\":%4,\"replies_received\":%5,\"commands_per_s\":%6,"
+                                       "\"ns_per_command\":%7,\"completed\":%8")
+                               .arg(iCommandThreadCount).arg(BENCH_COMMAND_CLIENT_COUNT).arg(iCommandsExpected).arg(BENCH_COMMAND_ROUNDS).arg(iFramesReceived)
+                               .arg(iFramesReceived * 1e9 / iRunTime, 0, 'f', 1).arg(iRunTime / iCommandsExpected)
+                               .arg(bIsCompleted ? "true" : "false"));
+    }
+    else {
+        WriteResult("error", QString("\"framing\":\"text\",\"threads\":%1,\"clients_connected\":%2,\"message\":\"not all clients could connect\"")
+                             .arg(iCommandThreadCount).arg(iClientsConnected));
+    }
+
+    //Close clients before the server, so that the server does not wait for them
+    for (int i = 0; i < lstCommandClients.size(); ++i) {
+        lstCommandClients.at(i)->abort();
+    }
+    qDeleteAll(lstCommandClients);
+    StopServer();
+    return;
+}
+
+void NetworkBenchmark::RunWorkerThreadBenchmark(int iWorkerThreadCount) {
+    //Worker threads are created with the server object
+    SettingsContainer.SetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_SERVER_WORKER_THREADS, iWorkerThreadCount);
+    bIsBinaryFraming = false;
+    bIsCompressed = false;
+    if (!StartServer()) {
+        WriteResult("error", QString("\"framing\":\"text\",\"worker_threads\":%1,\"message\":\"server could not listen\"").arg(iWorkerThreadCount));
+        StopServer();
+        SettingsContainer.SetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_SERVER_WORKER_THREADS, ST_DEFVAL_SERVER_WORKER_THREADS);
+        return;
+    }
+    QList<QTcpSocket *> lstWorkerClients;
+    for (int i = 0; i < BENCH_WORKER_CLIENT_COUNT; ++i) {
+        QTcpSocket * tcpWorkerClient = new QTcpSocket(this);
+        tcpWorkerClient->connectToHost("127.0.0.1", iPort);
+        lstWorkerClients.append(tcpWorkerClient);
+    }
+
+    //Wait until every session is registered, lines of a client are only read once it is
+    QElapsedTimer tmrWait;
+    tmrWait.start();
+    while (tcpBenchServer->GetConnectedClientCount() < BENCH_WORKER_CLIENT_COUNT && tmrWait.elapsed() < BENCH_WAIT_TIMEOUT_MS) {
+        QCoreApplication::processEvents();
+    }
+    int iClientsConnected = tcpBenchServer->GetConnectedClientCount();
+    if (iClientsConnected == BENCH_WORKER_CLIENT_COUNT) {
+        //Every client sends all of its lines at once, they are read and split by worker threads and passed to this thread
+        QByteArray baLines;
+        for (int i = 0; i < BENCH_WORKER_LINE_COUNT; ++i) {
+            baLines.append(BuildFrame(i + 1, lstFrameSizes.first()));
+        }
+        qint64 iLinesExpected = static_cast<qint64>(BENCH_WORKER_CLIENT_COUNT) * BENCH_WORKER_LINE_COUNT;
+        iFramesReceived = 0;
+        iBytesReceived = 0;
+        QElapsedTimer tmrRun;
+        tmrRun.start();
+        for (int i = 0; i < lstWorkerClients.size(); ++i) {
+            lstWorkerClients.at(i)->write(baLines);
+        }
+        bool bIsCompleted = WaitForFrames(iLinesExpected);
+        qint64 iRunTime = qMax(tmrRun.nsecsElapsed(), Q_INT64_C(1));
+
+        WriteResult("worker_threads", QString("\"worker_threads\":%1,\"clients\":%2,\"lines\":%3,\"line_size\":%4,\"lines_received\":%5,\"lines_per_s\":%6,"
+                                              "\"mb_per_s\":%7,\"completed\":%8")
+                                      .arg(iWorkerThreadCount).arg(BENCH_WORKER_CLIENT_COUNT).arg(iLinesExpected).arg(lstFrameSizes.first()).arg(iFramesReceived)
+                                      .arg(iFramesReceived * 1e9 / iRunTime, 0, 'f', 1)
+                                      .arg(static_cast<double>(iBytesReceived) * 1e9 / iRunTime / 1048576.0, 0, 'f', 3)
+                                      .arg(bIsCompleted ? "true" : "false"));
+    }
+    else {
+        WriteResult("error", QString("\"framing\":\"text\",\"worker_threads\":%1,\"clients_connected\":%2,\"message\":\"not all clients could connect\"")
+                             .arg(iWorkerThreadCount).arg(iClientsConnected));
+    }
+
+    //Close clients before the server, so that the server does not wait for them
+    for (int i = 0; i < lstWorkerClients.size(); ++i) {
+        lstWorkerClients.at(i)->abort();
+    }
+    qDeleteAll(lstWorkerClients);
+    StopServer();
+    SettingsContainer.SetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_SERVER_WORKER_THREADS, ST_DEFVAL_SERVER_WORKER_THREADS);
+    return;
+}
+
+void NetworkBenchmark::RunBackendBenchmark(TCPServer::ServerBackend iServerBackend) {
+    //The backend is chosen when the server object is created
+    QString sServerBackendName = TCPServer::GetServerBackendName(iServerBackend);
+    SettingsContainer.SetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_SERVER_BACKEND, sServerBackendName);
+    bIsBinaryFraming = false;
+    bIsCompressed = false;
+    if (!StartServer()) {
+        WriteResult("error", QString("\"backend\":\"%1\",\"message\":\"server could not listen\"").arg(sServerBackendName));
+        StopServer();
+        SettingsContainer.SetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_SERVER_BACKEND, ST_DEFVAL_SERVER_BACKEND);
+        return;
+    }
+    BenchmarkCpuCommandHandler hdlCpuCommand; //Outlives the server object, which waits for running commands when deleted
+    tcpBenchServer->RegisterCommandHandler(BENCH_COMMAND_VERB, &hdlCpuCommand);
+
+    //Connect all clients at once, and wait until every session is registered
+    qint64 iResidentMemoryBefore = GetResidentMemory();
+    QList<QTcpSocket *> lstBackendClients;
+    QElapsedTimer tmrRun;
+    tmrRun.start();
+    for (int i = 0; i < BENCH_BACKEND_CLIENT_COUNT; ++i) {
+        QTcpSocket * tcpBackendClient = new QTcpSocket(this);
+        connect(tcpBackendClient, SIGNAL(readyRead()), this, SLOT(BroadcastClientReadyReadEventHandler()));
+        tcpBackendClient->connectToHost("127.0.0.1", iPort);
+        lstBackendClients.append(tcpBackendClient);
+    }
+    while (tcpBenchServer->GetConnectedClientCount() < BENCH_BACKEND_CLIENT_COUNT && tmrRun.elapsed() < BENCH_WAIT_TIMEOUT_MS) {
+        QCoreApplication::processEvents();
+    }
+    qint64 iConnectingTime = qMax(tmrRun.nsecsElapsed(), Q_INT64_C(1));
+    int iClientsConnected = tcpBenchServer->GetConnectedClientCount();
+    qint64 iResidentMemoryAfter = GetResidentMemory();
+
+    if (iClientsConnected == BENCH_BACKEND_CLIENT_COUNT) {
+        //Commands are sent one after another on the first client, while all other clients stay connected
+        QByteArray baCommand = QByteArray(BENCH_COMMAND_VERB " 0\n");
+        QVector<qint64> arrRoundTripTimes;
+        arrRoundTripTimes.reserve(BENCH_BACKEND_COMMAND_COUNT);
+        iFramesReceived = 0;
+        bool bIsCompleted = true;
+        for (int i = 0; i < BENCH_BACKEND_COMMAND_COUNT && bIsCompleted; ++i) {
+            qint64 iSendingTime = tmrClock.nsecsElapsed();
+            lstBackendClients.first()->write(baCommand);
+            bIsCompleted = WaitForFrames(i + 1);
+            arrRoundTripTimes.append(tmrClock.nsecsElapsed() - iSendingTime);
+        }
+        qSort(arrRoundTripTimes);
+
+        WriteResult("backend", QString("\"backend\":\"%1\",\"clients\":%2,\"connections_per_s\":%3,\"rss_bytes_per_connection\":%4,\"commands\":%5,"
+                                       "\"latency_p50_us\":%6,\"latency_p99_us\":%7,\"completed\":%8")
+                               .arg(sServerBackendName).arg(BENCH_BACKEND_CLIENT_COUNT).arg(BENCH_BACKEND_CLIENT_COUNT * 1e9 / iConnectingTime, 0, 'f', 1)
+                               .arg((iResidentMemoryAfter - iResidentMemoryBefore) / BENCH_BACKEND_CLIENT_COUNT).arg(arrRoundTripTimes.size())
+                               .arg(GetPercentile(arrRoundTripTimes, 0.50) / 1000.0, 0, 'f', 1).arg(GetPercentile(arrRoundTripTimes, 0.99) / 1000.0, 0, 'f', 1)
+                               .arg(bIsCompleted ? "true" : "false"));
+    }
+    else {
+        WriteResult("error", QString("\"backend\":\"%1\",\"clients\":%2,\"clients_connected\":%3,\"message\":\"not all clients could connect, check the open files limit\"")
+                             .arg(sServerBackendName).arg(BENCH_BACKEND_CLIENT_COUNT).arg(iClientsConnected));
+    }
+
+    //Close clients before the server, so that the server does not wait for them
+    for (int i = 0; i < lstBackendClients.size(); ++i) {
+        lstBackendClients.at(i)->abort();
+    }
+    qDeleteAll(lstBackendClients);
+    StopServer();
+    SettingsContainer.SetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_SERVER_BACKEND, ST_DEFVAL_SERVER_BACKEND);
+    return;
+}
+
+void NetworkBenchmark::RunLogHistoryBenchmark() {
+    QPlainTextEdit txtView;
+    txtView.show();
+    LogHistory logHistory(&txtView);
+    ProcessEventsFor(LOG_DEFVAL_REFRESH_INTERVAL_MS); //Let the view be shown before timing
+    qint64 iResidentMemoryStart = GetResidentMemory();
+
+    //Append entries at a fixed rate from the GUI thread, as MainWindow does for received commands
+    //Lag is how late each entry is appended, it grows without bound if refreshing the view can not keep up
+    qint64 iInterval = 1000000000LL / BENCH_LOG_EVENT_RATE;
+    int iEventCount = static_cast<int>(static_cast<qint64>(BENCH_LOG_EVENT_RATE) * iDuration / 1000);
+    QVector<qint64> arrLags;
+    arrLags.reserve(iEventCount);
+    QString sSource = "Client \"BenchmarkClient\" (127.0.0.1:40000)";
+    QString sLog = QString::fromLatin1(BuildFrame(0, lstFrameSizes.first()).trimmed());
+    QElapsedTimer tmrRun;
+    tmrRun.start();
+    qint64 iNextAppendingTime = 0;
+    for (int i = 0; i < iEventCount; ++i) {
+        while (tmrRun.nsecsElapsed() < iNextAppendingTime) {
+            QCoreApplication::processEvents();
+        }
+        arrLags.append(tmrRun.nsecsElapsed() - iNextAppendingTime);
+        logHistory.Append(sSource, sLog);
+        iNextAppendingTime += iInterval;
+    }
+    qint64 iRunTime = qMax(tmrRun.nsecsElapsed(), Q_INT64_C(1));
+    ProcessEventsFor(LOG_DEFVAL_REFRESH_INTERVAL_MS * 2); //Last refresh
+    qint64 iResidentMemoryEnd = GetResidentMemory();
+
+    //Kept up if entries were appended at the requested rate, the view must stay bounded whatever the rate
+    double dEventsPerSecond = static_cast<double>(iEventCount) * 1e9 / iRunTime;
+    qSort(arrLags);
+    WriteResult("log_history", QString("\"rate\":%1,\"events\":%2,\"events_per_s\":%3,\"lag_p50_ns\":%4,\"lag_p99_ns\":%5,\"lag_max_ns\":%6,"
+                                       "\"entries\":%7,\"view_blocks\":%8,\"memory_growth_kb\":%9,\"kept_up\":%10")
+                               .arg(BENCH_LOG_EVENT_RATE).arg(iEventCount).arg(dEventsPerSecond, 0, 'f', 1)
+                               .arg(GetPercentile(arrLags, 0.50)).arg(GetPercentile(arrLags, 0.99)).arg(arrLags.isEmpty() ? 0 : arrLags.last())
+                               .arg(logHistory.GetEntryCount()).arg(txtView.blockCount())
+                               .arg((iResidentMemoryEnd - iResidentMemoryStart) / 1024)
+                               .arg(dEventsPerSecond >= BENCH_LOG_EVENT_RATE * 0.99 ? "true" : "false"));
+    return;
+}
+
+/* Helpers */
+QByteArray NetworkBenchmark::BuildFrame(qint64 iSequence, int iFrameSize) const {
+    QByteArray baFrame;
+    baFrame.reserve(iFrameSize);
+    baFrame.append(QByteArray::number(iSequence));
+    baFrame.append(' ');
+    baFrame.append(QByteArray::number(tmrClock.nsecsElapsed()));
+    baFrame.append(' ');
+
+    //Line break counts in frame size in text mode
+    int iPayloadSize = bIsBinaryFraming ? iFrameSize : iFrameSize - 1;
+    while (baFrame.size() < iPayloadSize) {
+        baFrame.append(BENCH_TELEMETRY_PADDING, qMin(iPayloadSize - baFrame.size(), static_cast<int>(sizeof(BENCH_TELEMETRY_PADDING)) - 1));
+    }
+    if (!bIsBinaryFraming) {
+        baFrame.append('\n');
+    }
+    return baFrame;
+}
+
+bool NetworkBenchmark::WaitForConnection(bool bIsConnectedExpected, int iTimeout) {
+    QElapsedTimer tmrWait;
+    tmrWait.start();
+    while (bIsClientConnected != bIsConnectedExpected) {
+        if (tmrWait.elapsed() > iTimeout) {
+            return false;
+        }
+        QCoreApplication::processEvents();
+    }
+    return true;
+}
+
+bool NetworkBenchmark::WaitForFrames(qint64 iFramesExpected, int iTimeout) {
+    QElapsedTimer tmrWait;
+    tmrWait.start();
+    while (iFramesReceived < iFramesExpected) {
+        if (tmrWait.elapsed() > iTimeout) {
+            return false;
+        }
+        QCoreApplication::processEvents();
+    }
+    return true;
+}
+
+void NetworkBenchmark::ProcessEventsFor(int iTime) {
+    QElapsedTimer tmrWait;
+    tmrWait.start();
+    while (tmrWait.elapsed() < iTime) {
+        QCoreApplication::processEvents();
+    }
+    return;
+}
+
+qint64 NetworkBenchmark::GetPercentile(const QVector<qint64> & arrSortedValues, double dPercentile) const {
+    if (arrSortedValues.isEmpty()) {
+        return 0;
+    }
+    int iIndex = static_cast<int>(dPercentile * (arrSortedValues.size() - 1) + 0.5);
+    return arrSortedValues.at(iIndex);
+}
+
+qint64 NetworkBenchmark::GetResidentMemory() const {
+    //"VmRSS:    12345 kB" line of the process status
+    QFile fileStatus("/proc/self/status");
+    if (!fileStatus.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    QList<QByteArray> lstLines = fileStatus.readAll().split('\n');
+    for (int i = 0; i < lstLines.size(); ++i) {
+        if (lstLines.at(i).startsWith("VmRSS:")) {
+            return lstLines.at(i).mid(6).simplified().split(' ').first().toLongLong() * 1024;
+        }
+    }
+    return 0;
+}
+
+/* Result Output */
+void NetworkBenchmark::WriteResult(const QString & sBenchmark, const QString & sFields) {
+    stmResult << "{\"benchmark\":\"" << sBenchmark << "\"," << sFields << "}" << endl;
+    return;
+}
+
+QString NetworkBenchmark::GetFramingName() const {
+    if (bIsCompressed) {
+        return "compressed";
+    }
+    return bIsBinaryFraming ? "binary" : "text";
+}
+
+QString NetworkBenchmark::GetTransportName() const {
+    return bIsLocalTransport ? "unix" : "tcp";
+}
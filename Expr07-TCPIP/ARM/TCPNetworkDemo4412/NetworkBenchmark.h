@@ -0,0 +1,145 @@
+/*
+ * NETWORK BENCHMARK
+ *
+ * This file is a loopback benchmark of networking interface, TCP Client and TCP Server run in one process and talk over 127.0.0.1.
+ * It is built instead of MainWindow when qmake is called with "CONFIG+=benchmark".
+ * Following benchmarks are run, for text framing, binary framing and binary framing with compression:
+ *   Throughput: Data frames are queued as fast as the queue accepts them, for a sweep of frame sizes.
+ *   Latency: Data frames carrying their sending time are queued at a fixed rate, percentiles of end-to-end latency are reported.
+ * Throughput and latency are run again in text framing over a Unix domain socket, so that local IPC can be compared with loopback TCP.
+ * Throughput is run again in text framing with data frames striped across 2 and 4 parallel connections of the client. Loopback does not lose
+ * packets, the benchmark should be run with the loopback interface shaped by netem to compare them on a lossy link.
+ * Besides:
+ *   Compression: Batches of data frames are compressed and decompressed in memory, ratio and CPU cost are reported with the estimated gain on a 100 Mbit link.
+ *   Allocation: Data frames are sent through the QString API and through the QByteArray API, heap allocations per data frame are reported
+ *               (counted by replacing malloc() of glibc in the benchmark program).
+ *   Queue: A producer thread passes data frames to a consumer thread through the client's lock-free ring buffer, and through a QQueue protected
+ *          by a mutex, throughput and percentiles of the time spent in the queue are reported.
+ *   Overflow: Data frames are queued while disconnected, for each overflow policy.
+ *   Reconnect: Server is restarted, time until client is connected again is reported.
+ *   Framing fallback: Data frames wait in a partially filled batch of a binary framed connection, server is restarted without binary framing,
+ *                     every data frame must be received intact once client has reconnected in text framing. The exit code is 1 otherwise.
+ *   Broadcast: Server broadcasts messages to 1 to 500 plain text clients, cost per message and per client is reported. Each client count is run
+ *              once through the per-socket path (text transcoded and encoded by every session) as a baseline, and once encoded once for all sessions.
+ *   Command: Plain text clients send CPU-heavy commands executed by a registered handler, command throughput is reported for command thread counts
+ *            from 1 to one per CPU core.
+ *   Worker threads: Plain text clients send bursts of lines which are passed to upper layers, line throughput is reported for worker thread
+ *                   counts from 1 to one per CPU core.
+ *   Backend: Qt and Epoll server backends accept 500 plain text clients, connections per second, resident memory per connection and
+ *            round-trip latency of a trivial command are reported. Memory includes the client sockets, which are the same for both backends.
+ *   Log history: With "--log-view", 10000 log entries per second are appended to MainWindow's log model and view, the rate achieved, how late
+ *                entries are appended and the size of the view are reported.
+ * Results are written to standard output as JSON lines, one result per line, so that they can be compared between builds.
+ * Options changed by the benchmark are restored in ini file when it finishes.
+ *
+ */
+
+#ifndef NETWORKBENCHMARK_H
+#define NETWORKBENCHMARK_H
+
+#include "NetworkingControlInterface.h"
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QString>
+#include <QTcpSocket>
+#include <QTextStream>
+#include <QVariant>
+#include <QVector>
+
+/* Benchmark Options */
+#define BENCH_DEFVAL_PORT            16245
+#define BENCH_DEFVAL_DURATION_MS     2000
+#define BENCH_DEFVAL_LATENCY_RATE    1000 //Data frames per second in latency benchmark
+#define BENCH_DEFVAL_RECONNECT_COUNT 5
+#define BENCH_WAIT_TIMEOUT_MS        10000 //Max time to wait for connection or pending data frames
+#define BENCH_LINK_MB_PER_S          12.5 //Link speed the compression gain is estimated for, 100 Mbit/s
+#define BENCH_LOCAL_ENDPOINT         "unix:@TCPNetworkBenchmark4412" //Abstract name, nothing is left in the file system
+
+class NetworkBenchmark : public QObject {
+    Q_OBJECT
+
+public:
+    explicit NetworkBenchmark(QObject * parent = 0, quint16 iPortInit = BENCH_DEFVAL_PORT, int iDurationInit = BENCH_DEFVAL_DURATION_MS,
+                              const QList<int> & lstFrameSizesInit = QList<int>(), int iLatencyRateInit = BENCH_DEFVAL_LATENCY_RATE);
+    ~NetworkBenchmark();
+
+    int Run(); //Run all benchmarks, returns process exit code
+
+private slots:
+    /* Networking Events Handler */
+    void CommandDataReceivedEventHandler(int iClientID, QByteArray baCommand);
+    void ConnectedToServerEventHandler(QString sServerName, QString sServerIPAddress, quint16 iServerPort);
+    void DisconnectedFromServerEventHandler(QString sServerName, QString sServerIPAddress, quint16 iServerPort);
+    void CommandReceivedEventHandler(QString sCommand, QString sClientName, QString sClientIPAddress, quint16 iClientPort); //Makes the server decode commands as text, in allocation benchmark
+    void BroadcastClientReadyReadEventHandler(); //Counts lines received by plain clients of broadcast and command benchmarks
+
+private:
+    /* Options */
+    quint16 iPort;
+    int iDuration; //Duration of each throughput and latency run, in ms
+    QList<int> lstFrameSizes; //Data frame sizes in bytes, including line break in text mode
+    int iLatencyRate;
+
+    /* Objects under Test */
+    TCPClient * tcpBenchClient;
+    TCPServer * tcpBenchServer;
+    bool bIsBinaryFraming; //Framing mode of current client/server pair
+    bool bIsCompressed; //Marks if current client/server pair has negotiated compression
+    bool bIsLocalTransport; //Marks if current client/server pair talks over BENCH_LOCAL_ENDPOINT instead of 127.0.0.1
+    int iConnectionCount; //Parallel connections of current client, data frames are striped across them
+
+    /* Receiver State */
+    QElapsedTimer tmrClock; //Common clock of sender and receiver, they run in the same process
+    qint64 iFramesReceived;
+    qint64 iBytesReceived;
+    bool bIsRecordingLatency;
+    QVector<qint64> arrLatencies; //In ns
+    bool bIsRecordingFrames;
+    QList<QByteArray> lstFramesRecorded; //Data frames received in framing fallback benchmark
+    bool bIsClientConnected;
+
+    /* Saved Settings */
+    QMap<QString, QVariant> mapSavedSettings;
+    void SaveOriginalSettings();
+    void RestoreOriginalSettings();
+
+    /* Client/Server Pair */
+    bool StartServer();
+    void StopServer();
+    bool StartPair(bool bIsBinaryFramingNew, bool bIsCompressedNew = false, bool bIsLocalTransportNew = false, int iConnectionCountNew = 1);
+    void StopPair();
+
+    /* Benchmarks */
+    void RunThroughputBenchmark(int iFrameSize);
+    void RunLatencyBenchmark(int iFrameSize);
+    void RunAllocationBenchmark(bool bIsByteApi); //QByteArray API of client and server if bIsByteApi is true, QString API otherwise
+    void RunQueueBenchmark(bool bIsLockFree); //Lock-free ring buffer of the client if bIsLockFree is true, a QQueue protected by a mutex otherwise
+    void RunOverflowBenchmark(DataFrameQueue::OverflowPolicy iOverflowPolicy);
+    void RunReconnectBenchmark();
+    bool RunFramingFallbackBenchmark(); //Returns false if a data frame pending across the reconnect was lost or corrupted
+    void RunCompressionBenchmark(int iFrameSize);
+    void RunBroadcastBenchmark(int iClientCount, bool bIsEncodedOnce); //Broadcast encoded once for all sessions if bIsEncodedOnce is true, sent to each session on its own otherwise
+    void RunCommandBenchmark(int iCommandThreadCount);
+    void RunWorkerThreadBenchmark(int iWorkerThreadCount);
+    void RunBackendBenchmark(TCPServer::ServerBackend iServerBackend);
+    void RunLogHistoryBenchmark(); //Needs a QApplication with a display
+
+    /* Helpers */
+    QByteArray BuildFrame(qint64 iSequence, int iFrameSize) const; //"<sequence> <sending time in ns> <padding>", terminated by a line break in text mode, padding looks like telemetry
+    bool WaitForConnection(bool bIsConnectedExpected, int iTimeout = BENCH_WAIT_TIMEOUT_MS);
+    bool WaitForFrames(qint64 iFramesExpected, int iTimeout = BENCH_WAIT_TIMEOUT_MS);
+    void ProcessEventsFor(int iTime);
+    qint64 GetPercentile(const QVector<qint64> & arrSortedValues, double dPercentile) const;
+    qint64 GetResidentMemory() const; //Resident set size of the process in bytes, 0 if unknown
+
+    /* Result Output */
+    QTextStream stmResult;
+    void WriteResult(const QString & sBenchmark, const QString & sFields); //sFields is a list of JSON members without braces
+    QString GetFramingName() const;
+    QString GetTransportName() const;
+};
+
+#endif // NETWORKBENCHMARK_H
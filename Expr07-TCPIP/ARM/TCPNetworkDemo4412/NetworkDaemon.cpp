@@ -0,0 +1,146 @@
+#include "NetworkDaemon.h"
+#include "NetworkingControlInterface.h"
+#include <QDateTime>
+#include <cstdio>
+
+NetworkDaemon::NetworkDaemon(QObject * parent, QString sHostIP, quint16 iHostPort,
+                             bool bIsClientEnabled, bool bIsServerEnabled, unsigned int iHeartBeatInterval) : QObject(parent),
+                                                                                                              stmLog(stdout) {
+    tcpDataClient = NULL;
+    tcpCommandServer = NULL;
+    tmrHeartBeat = NULL;
+    bIsDataQueueCongested = false;
+
+    /* TCP Client Object */
+    if (bIsClientEnabled) {
+        tcpDataClient = new TCPClient;
+        connect(tcpDataClient, SIGNAL(ResponseReceivedFromServerEvent(QString, QString, QString, quint16)), this, SLOT(ResponseReceivedEventHandler(QString, QString, QString, quint16)));
+        connect(tcpDataClient, SIGNAL(ConnectedToServerEvent(QString, QString, quint16)), this, SLOT(ConnectedToServerEventHandler(QString, QString, quint16)));
+        connect(tcpDataClient, SIGNAL(DisconnectedFromServerEvent(QString, QString, quint16)), this, SLOT(DisconnectedFromServerEventHandler(QString, QString, quint16)));
+        connect(tcpDataClient, SIGNAL(NetworkingErrorOccurredEvent(QAbstractSocket::SocketError, QString, QString, quint16)), this, SLOT(NetworkingErrorOccurredEventHandler(QAbstractSocket::SocketError, QString, QString, quint16)));
+        connect(tcpDataClient, SIGNAL(DataQueueHighWatermarkReachedEvent()), this, SLOT(DataQueueHighWatermarkReachedEventHandler()));
+        connect(tcpDataClient, SIGNAL(DataQueueLowWatermarkReachedEvent()), this, SLOT(DataQueueLowWatermarkReachedEventHandler()));
+    }
+
+    /* TCP Server Object */
+    if (bIsServerEnabled) {
+        tcpCommandServer = new TCPServer;
+        connect(tcpCommandServer, SIGNAL(ClientConnectedEvent(QString, QString, quint16)), this, SLOT(ClientConnectedEventHandler(QString, QString, quint16)));
+        connect(tcpCommandServer, SIGNAL(ClientDisconnectedEvent(QString, QString, quint16)), this, SLOT(ClientDisconnectedEventHandler(QString, QString, quint16)));
+        connect(tcpCommandServer, SIGNAL(ClientNetworkingErrorOccurredEvent(QAbstractSocket::SocketError, QString, QString, quint16)), this, SLOT(ClientNetworkingErrorOccurredEventHandler(QAbstractSocket::SocketError, QString, QString, quint16)));
+        connect(tcpCommandServer, SIGNAL(CommandReceivedEvent(QString, QString, QString, quint16)), this, SLOT(DataReceivedFromClientEventHandler(QString, QString, QString, quint16)));
+        if (tcpCommandServer->StartListening()) {
+            WriteLog("Listening on port " + QString::number(tcpCommandServer->serverPort()));
+        }
+        else {
+            WriteLog("Couldnot start listening: " + tcpCommandServer->errorString());
+        }
+    }
+
+    /* Heart Beat Timer */
+    if (iHeartBeatInterval > 0) {
+        tmrHeartBeat = new QTimer(this);
+        connect(tmrHeartBeat, SIGNAL(timeout()), this, SLOT(tmrHeartBeat_Tick()));
+        tmrHeartBeat->start(iHeartBeatInterval);
+    }
+
+    /* Establish connection */
+    if (tcpDataClient) {
+        if (sHostIP == "") {
+            sHostIP = tcpDataClient->GetServerIP();
+        }
+        if (iHostPort == 0) {
+            iHostPort = tcpDataClient->GetServerPort();
+        }
+        WriteLog("Connecting to server " + sHostIP + ":" + QString::number(iHostPort));
+        tcpDataClient->ConnectToServer(sHostIP, iHostPort, true, 2000);
+    }
+}
+
+NetworkDaemon::~NetworkDaemon() {
+    if (tmrHeartBeat) {
+        tmrHeartBeat->stop();
+    }
+
+    /* Close Networking */
+    if (tcpDataClient) {
+        tcpDataClient->DisconnectFromServer();
+        delete tcpDataClient;
+        tcpDataClient = NULL;
+    }
+    if (tcpCommandServer) {
+        tcpCommandServer->StopListening();
+        delete tcpCommandServer;
+        tcpCommandServer = NULL;
+    }
+    WriteLog("Stopped");
+}
+
+void NetworkDaemon::WriteLog(const QString & sLog) {
+    stmLog << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss") << " " << sLog << endl;
+}
+
+/* Networking Events Handler */
+void NetworkDaemon::ConnectedToServerEventHandler(QString sServerName, QString sServerIPAddress, quint16 iServerPort) {
+    WriteLog("Connected to server \"" + sServerName + "\" (" + sServerIPAddress + ":" + QString::number(iServerPort) + ")");
+    return;
+}
+
+void NetworkDaemon::DisconnectedFromServerEventHandler(QString sServerName, QString sServerIPAddress, quint16 iServerPort) {
+    WriteLog("Disconnected from server \"" + sServerName + "\" (" + sServerIPAddress + ":" + QString::number(iServerPort) + ")");
+    return;
+}
+
+void NetworkDaemon::NetworkingErrorOccurredEventHandler(QAbstractSocket::SocketError errErrorInfo, QString sServerName, QString sServerIPAddress, quint16 iServerPort) {
+    WriteLog("Network error with server \"" + sServerName + "\" (" + sServerIPAddress + ":" + QString::number(iServerPort) + "): " + QString::number(errErrorInfo));
+    return;
+}
+
+void NetworkDaemon::ResponseReceivedEventHandler(QString sResponse, QString sServerName, QString sServerIPAddress, quint16 iServerPort) {
+    WriteLog("Server \"" + sServerName + "\" (" + sServerIPAddress + ":" + QString::number(iServerPort) + "): " + sResponse);
+    return;
+}
+
+void NetworkDaemon::ClientConnectedEventHandler(QString sClientName, QString sClientIPAddress, quint16 iClientPort) {
+    WriteLog("Client \"" + sClientName + "\" (" + sClientIPAddress + ":" + QString::number(iClientPort) + ") connected");
+    return;
+}
+
+void NetworkDaemon::ClientDisconnectedEventHandler(QString sClientName, QString sClientIPAddress, quint16 iClientPort) {
+    WriteLog("Client \"" + sClientName + "\" (" + sClientIPAddress + ":" + QString::number(iClientPort) + ") disconnected");
+    return;
+}
+
+void NetworkDaemon::ClientNetworkingErrorOccurredEventHandler(QAbstractSocket::SocketError errErrorInfo, QString sClientName, QString sClientIPAddress, quint16 iClientPort) {
+    WriteLog("Network error with client \"" + sClientName + "\" (" + sClientIPAddress + ":" + QString::number(iClientPort) + "): " + QString::number(errErrorInfo));
+    return;
+}
+
+void NetworkDaemon::DataReceivedFromClientEventHandler(QString sData, QString sClientName, QString sClientIPAddress, quint16 iClientPort) {
+    WriteLog("Client \"" + sClientName + "\" (" + sClientIPAddress + ":" + QString::number(iClientPort) + "): " + sData);
+    return;
+}
+
+void NetworkDaemon::DataQueueHighWatermarkReachedEventHandler() {
+    bIsDataQueueCongested = true;
+    WriteLog("Data queue is congested, heart beats to server are paused");
+    return;
+}
+
+void NetworkDaemon::DataQueueLowWatermarkReachedEventHandler() {
+    bIsDataQueueCongested = false;
+    WriteLog("Data queue has drained, heart beats to server are resumed");
+    return;
+}
+
+/* Heart Beat Timer Slot */
+void NetworkDaemon::tmrHeartBeat_Tick() {
+    //Throttle ourselves when data queue is congested
+    if (tcpDataClient && !bIsDataQueueCongested) {
+        tcpDataClient->QueueDataFrame("<HEART BEAT MESSAGE>");
+    }
+    if (tcpCommandServer) {
+        tcpCommandServer->SendDataToClient("<HEART BEAT MESSAGE>");
+    }
+    return;
+}
@@ -0,0 +1,54 @@
+/*
+ * NETWORK DAEMON
+ *
+ * This file is the headless counterpart of MainWindow, which runs TCP Client and TCP Server under a QCoreApplication.
+ * It is built instead of MainWindow when qmake is called with "CONFIG+=headless", for boards without a display.
+ * Events are written to standard output as log lines.
+ *
+ */
+
+#ifndef NETWORKDAEMON_H
+#define NETWORKDAEMON_H
+
+#include "NetworkingControlInterface.h"
+#include <QObject>
+#include <QTextStream>
+#include <QTimer>
+
+/* Daemon Options */
+#define DAEMON_DEFVAL_HEARTBEAT_INTERVAL_MS 5000
+
+class NetworkDaemon : public QObject {
+    Q_OBJECT
+
+public:
+    //Empty sHostIP and zero iHostPort use values saved in ini file, zero iHeartBeatInterval disables heart beats
+    explicit NetworkDaemon(QObject * parent = 0, QString sHostIP = "", quint16 iHostPort = 0,
+                           bool bIsClientEnabled = true, bool bIsServerEnabled = true, unsigned int iHeartBeatInterval = DAEMON_DEFVAL_HEARTBEAT_INTERVAL_MS);
+    ~NetworkDaemon();
+
+private:
+    QTextStream stmLog; //INTERNAL: Log output, standard output
+    void WriteLog(const QString & sLog);
+
+    QTimer * tmrHeartBeat;
+    bool bIsDataQueueCongested; //Marks if client's data queue has reached its high watermark, heart beats are not queued meanwhile
+
+private slots:
+    /* Networking Events Handler */
+    void ConnectedToServerEventHandler(QString sServerName, QString sServerIPAddress, quint16 iServerPort);
+    void DisconnectedFromServerEventHandler(QString sServerName, QString sServerIPAddress, quint16 iServerPort);
+    void NetworkingErrorOccurredEventHandler(QAbstractSocket::SocketError errErrorInfo, QString sServerName, QString sServerIPAddress, quint16 iServerPort);
+    void ResponseReceivedEventHandler(QString sResponse, QString sServerName, QString sServerIPAddress, quint16 iServerPort);
+    void ClientConnectedEventHandler(QString sClientName, QString sClientIPAddress, quint16 iClientPort);
+    void ClientDisconnectedEventHandler(QString sClientName, QString sClientIPAddress, quint16 iClientPort);
+    void ClientNetworkingErrorOccurredEventHandler(QAbstractSocket::SocketError errErrorInfo, QString sClientName, QString sClientIPAddress, quint16 iClientPort);
+    void DataReceivedFromClientEventHandler(QString sData, QString sClientName, QString sClientIPAddress, quint16 iClientPort);
+    void DataQueueHighWatermarkReachedEventHandler();
+    void DataQueueLowWatermarkReachedEventHandler();
+
+    /* Heart Beat Timer Slot */
+    void tmrHeartBeat_Tick();
+};
+
+#endif // NETWORKDAEMON_H
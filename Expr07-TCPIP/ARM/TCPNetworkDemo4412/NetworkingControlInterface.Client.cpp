@@ -1,66 +1,177 @@
 #include "NetworkingControlInterface.Client.h"
 #include "SettingsProvider.h"
+#include <QDateTime>
+#include <QEventLoop>
+#include <unistd.h>
 
-/* Data Queue */
-#define NET_DATA_QUEUE_MAX_ITEM_COUNT 40960 //Max size of data buffer, to avoid huge memory consumption
-static QQueue<QString *> queDataFramesPendingSending; //Queue of data frames pending sending
+/* Batched Sending */
+#define NET_SEND_BATCHES_PER_EVENT_LOOP_PASS 16 //Max number of batches sent before returning to event loop, so that control requests and socket events are processed
+#define NET_SEND_BATCH_FRAMES_RESERVED 256 //Data frame lengths recorded per batch without reallocation, the list grows beyond if small data frames are coalesced
 
-/* Intenral Variables */
-
-/* Internal Locks */
-static QMutex mtxDataFramesPendingSendingLock; //For internal buffers, Initialize the lock recursivly
+/* Shutdown */
+#define NET_CLIENT_SHUTDOWN_FLUSH_TIMEOUT_MS 1000 //Max time spent writing queued data frames when TCPClient is destroyed
 
 /* TCP Client */
 TCPClient * tcpDataClient;
 
 /* TCP Networking Data Sending Thread Worker Object */
-TCPClientDataSender::TCPClientDataSender() {
+TCPClientDataSender::TCPClientDataSender(DataFrameQueue * queDataFramesPendingSendingInit, int iConnectionIDInit) {
     //Initialize internal variables
+    queDataFramesPendingSending = queDataFramesPendingSendingInit;
+    iConnectionID = iConnectionIDInit;
     bIsDataSending = false;
     bIsDataSendingStopRequested = false;
+    bIsFlushRequested = false;
+    bIsDrainReported = true;
+    bIsSocketOutputPending = false;
     bIsUserInitiatedDisconnection = false;
-    bIsReconnecting = false;
+    bIsAutoReconnectEnabled = false;
+    iAutoReconnectDelay = ST_DEFVAL_AUTORECONN_DELAY_MS;
+    iPort = 0;
+    iConnectionState = Disconnected;
+    iPrimaryPort = 0;
+    iCurrentServer = 0;
+    iReconnectRound = 0;
+    iAutoReconnectMaxDelay = ST_DEFVAL_AUTORECONN_MAX_DELAY_MS;
+    iAutoReconnectJitter = ST_DEFVAL_AUTORECONN_JITTER;
+    iConnectTimeout = ST_DEFVAL_CONNECT_TIMEOUT_MS;
+    bIsRandomSeeded = false;
+    bIsConnectionLost = false;
+    iLastReconnectTime = -1;
+    iSendBatchSize = ST_DEFVAL_SEND_BATCH_SIZE;
+    iSendBatchMaxLatency = ST_DEFVAL_SEND_BATCH_LATENCY_US;
+    baSendBatchBuffer.resize(iSendBatchSize);
+    iSendBatchBufferUsed = 0;
+    arrSendBatchFrameLengths.reserve(NET_SEND_BATCH_FRAMES_RESERVED);
+    iSendBatchFramingMode = NetworkingFramingText;
+    bIsBinaryFramingRequested = false;
+    iFramingMode = NetworkingFramingText;
+    bIsFramingNegotiating = false;
+    bIsFramingNegotiationTimedOut = false;
+    bIsCompressionRequested = false;
+    bIsCompressionEnabled = false;
+    iCompressionThreshold = ST_DEFVAL_COMPRESSION_THRESHOLD;
+    iCompressionLevel = ST_DEFVAL_COMPRESSION_LEVEL;
+    iIsConnectedMetric = 0;
+
+    //Create connection timers, as child objects they are moved to worker thread together with this object
+    tmrConnectTimeout = new QTimer(this);
+    tmrConnectTimeout->setSingleShot(true);
+    connect(tmrConnectTimeout, SIGNAL(timeout()), this, SLOT(ConnectTimeoutEventHandler()));
+    tmrReconnect = new QTimer(this);
+    tmrReconnect->setSingleShot(true);
+    connect(tmrReconnect, SIGNAL(timeout()), this, SLOT(TryReconnect()));
+
+    //Create framing negotiation timer
+    tmrFramingNegotiation = new QTimer(this);
+    tmrFramingNegotiation->setSingleShot(true);
+    connect(tmrFramingNegotiation, SIGNAL(timeout()), this, SLOT(FramingNegotiationTimeoutEventHandler()));
+
+    //Create heartbeat timer
+    tmrHeartbeat = new QTimer(this);
+    connect(tmrHeartbeat, SIGNAL(timeout()), this, SLOT(HeartbeatTimerEventHandler()));
+
+    //Create batch latency timer, as a child object it is moved to worker thread together with this object
+    tmrSendBatchLatency = new QTimer(this);
+    tmrSendBatchLatency->setSingleShot(true);
+    connect(tmrSendBatchLatency, SIGNAL(timeout()), this, SLOT(SendDataToServerRequestedEventHandler()));
 
     //Create TCP socket object and connect events
     connect(this, SIGNAL(connected()), this, SLOT(TCPClientDataSender_Connected()));
     connect(this, SIGNAL(disconnected()), this, SLOT(TCPClientDataSender_Disconnected()));
     qRegisterMetaType<QAbstractSocket::SocketError>("QAbstractSocket::SocketError"); //Register QAbstractSocket::SocketError type for QueuedConnection
+    qRegisterMetaType<QList<QByteArray> >("QList<QByteArray>"); //Register QList<QByteArray> type for QueuedConnection
     connect(this, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(TCPClientDataSender_Error(QAbstractSocket::SocketError)));
     connect(this, SIGNAL(readyRead()), this, SLOT(TCPClientDataSender_ReadyRead()));
+    connect(this, SIGNAL(bytesWritten(qint64)), this, SLOT(TCPClientDataSender_BytesWritten(qint64)));
 }
 
 TCPClientDataSender::~TCPClientDataSender() {
 }
 
+int TCPClientDataSender::GetConnectionID() const {
+    return iConnectionID;
+}
+
 /* Data Sending Status Indicator */
 bool TCPClientDataSender::IsDataSending() const {
     return bIsDataSending;
 }
 
+/* Reconnect Statistics */
+int TCPClientDataSender::GetLastReconnectTime() const {
+    return iLastReconnectTime;
+}
+
+/* Metrics */
+void TCPClientDataSender::GetMetrics(TCPClientConnectionMetrics & mtrConnection) const {
+    mtrConnection.bIsConnected = (iIsConnectedMetric.fetchAndAddAcquire(0) != 0);
+    mtrConnection.iFramesSent = cntFramesSent.Get();
+    mtrConnection.iBytesSent = cntBytesSent.Get();
+    mtrConnection.iFramesReceived = cntFramesReceived.Get();
+    mtrConnection.iBytesReceived = cntBytesReceived.Get();
+    mtrConnection.iFramesPurged = cntFramesPurged.Get();
+    mtrConnection.iFramesLost = cntFramesLost.Get();
+    mtrConnection.iPurgeCount = cntPurges.Get();
+    mtrConnection.iConnectCount = cntConnects.Get();
+    mtrConnection.iReconnectCount = cntReconnects.Get();
+    mtrConnection.iErrorCount = cntErrors.Get();
+    mtrConnection.iSendCallCount = cntSendCalls.Get();
+    mtrConnection.iSendTimeTotal = cntSendTimeTotal.Get();
+    mtrConnection.iSendTimeMax = cntSendTimeMax.Get();
+    const NetworkingLatencyHistogram & histRoundTripTimes = hbmHeartbeat.GetRoundTripTimes();
+    mtrConnection.iRoundTripTimeCount = histRoundTripTimes.GetCount();
+    mtrConnection.iRoundTripTimeLast = histRoundTripTimes.GetLast();
+    mtrConnection.iRoundTripTimeMax = histRoundTripTimes.GetMax();
+    mtrConnection.arrRoundTripTimeBuckets.resize(NET_HISTOGRAM_BUCKET_COUNT);
+    for (int i = 0; i < NET_HISTOGRAM_BUCKET_COUNT; ++i) {
+        mtrConnection.arrRoundTripTimeBuckets[i] = histRoundTripTimes.GetBucketCount(i);
+    }
+    mtrConnection.iPongsMissed = hbmHeartbeat.GetMissedPongCount();
+    mtrConnection.iDeadPeerCount = hbmHeartbeat.GetDeadPeerCount();
+    return;
+}
+
+const HeartbeatMonitor & TCPClientDataSender::GetHeartbeatMonitor() const {
+    return hbmHeartbeat;
+}
+
 /* Connection Management Command Handlers */
 void TCPClientDataSender::ConnectToServerRequestedEventHandler(const QString sServerIPNew, quint16 iPortNew,
-                                                               bool bIsAutoReconnectEnabledNew, unsigned int iAutoReconnectDelayNew, bool bWairForOperationToComplete) {
-    sServerIP = sServerIPNew;
-    iPort = iPortNew;
+                                                               bool bIsAutoReconnectEnabledNew, unsigned int iAutoReconnectDelayNew) {
+    sPrimaryServerIP = sServerIPNew;
+    iPrimaryPort = iPortNew;
     bIsAutoReconnectEnabled = bIsAutoReconnectEnabledNew;
     iAutoReconnectDelay = iAutoReconnectDelayNew;
     bIsUserInitiatedDisconnection = false;
+    bIsConnectionLost = false;
 
-    connectToHost(sServerIPNew, iPortNew);
-    if (bWairForOperationToComplete) {
-        waitForConnected();
+    //qrand() is seeded per thread
+    if (!bIsRandomSeeded) {
+        qsrand(QDateTime::currentDateTime().toTime_t() ^ static_cast<uint>(reinterpret_cast<quintptr>(this)));
+        bIsRandomSeeded = true;
     }
 
+    //Start a new round with primary server
+    tmrReconnect->stop();
+    iCurrentServer = 0;
+    iReconnectRound = 0;
+    StartConnectionAttempt();
     return;
 }
 
-void TCPClientDataSender::DisconnectFromServerRequestedEventHandler(bool bWairForOperationToComplete) {
-    disconnectFromHost();
+void TCPClientDataSender::DisconnectFromServerRequestedEventHandler() {
     bIsUserInitiatedDisconnection = true;
-    bIsReconnecting = false;
-    if (bWairForOperationToComplete) {
-        waitForDisconnected();
+    bIsConnectionLost = false;
+    tmrReconnect->stop();
+    tmrConnectTimeout->stop();
+    if (state() == QTcpSocket::ConnectedState) {
+        disconnectFromHost(); //Reported by TCPClientDataSender_Disconnected(), callers wait for the health change instead of blocking this thread
+    }
+    else {
+        abort(); //Cancel a pending connection attempt
     }
+    iConnectionState = Disconnected;
     return;
 }
 
@@ -70,6 +181,71 @@ void TCPClientDataSender::SetAutoReconnectOptionsRequestedEventHandler(bool bIsA
     return;
 }
 
+void TCPClientDataSender::SetReconnectPolicyRequestedEventHandler(unsigned int iAutoReconnectMaxDelayNew, int iAutoReconnectJitterNew,
+                                                                  unsigned int iConnectTimeoutNew, QStringList lstFallbackServersNew) {
+    iAutoReconnectMaxDelay = iAutoReconnectMaxDelayNew;
+    iAutoReconnectJitter = qBound(0, iAutoReconnectJitterNew, 100);
+    iConnectTimeout = (iConnectTimeoutNew > 0) ? iConnectTimeoutNew : ST_DEFVAL_CONNECT_TIMEOUT_MS;
+
+    //Parse "IP:Port" entries, local endpoints have no port, takes effect from next connection attempt
+    lstFallbackServers.clear();
+    for (int i = 0; i < lstFallbackServersNew.size(); ++i) {
+        const QString & sFallbackServer = lstFallbackServersNew.at(i);
+        if (LocalSocketEndpoint::IsLocalEndpoint(sFallbackServer.trimmed())) {
+            lstFallbackServers.append(qMakePair(sFallbackServer.trimmed(), static_cast<quint16>(0)));
+            continue;
+        }
+        int iSeparator = sFallbackServer.lastIndexOf(':');
+        quint16 iFallbackPort = sFallbackServer.mid(iSeparator + 1).toUShort();
+        if (iSeparator > 0 && iFallbackPort != 0) {
+            lstFallbackServers.append(qMakePair(sFallbackServer.left(iSeparator).trimmed(), iFallbackPort));
+        }
+    }
+    if (iCurrentServer > lstFallbackServers.size()) {
+        iCurrentServer = 0;
+    }
+    return;
+}
+
+void TCPClientDataSender::SetSendBatchOptionsRequestedEventHandler(int iSendBatchSizeNew, unsigned int iSendBatchMaxLatencyNew) {
+    if (iSendBatchSizeNew < 1) {
+        iSendBatchSizeNew = 1;
+    }
+    iSendBatchSize = iSendBatchSizeNew;
+    iSendBatchMaxLatency = iSendBatchMaxLatencyNew;
+
+    //Grow the buffer if required, data frames already coalesced are kept
+    if (baSendBatchBuffer.size() < iSendBatchSize) {
+        baSendBatchBuffer.resize(iSendBatchSize);
+    }
+    return;
+}
+
+void TCPClientDataSender::SetFramingOptionsRequestedEventHandler(bool bIsBinaryFramingRequestedNew) {
+    bIsBinaryFramingRequested = bIsBinaryFramingRequestedNew; //Takes effect on next connection
+    return;
+}
+
+void TCPClientDataSender::SetCompressionOptionsRequestedEventHandler(bool bIsCompressionRequestedNew, int iCompressionThresholdNew, int iCompressionLevelNew) {
+    bIsCompressionRequested = bIsCompressionRequestedNew; //Takes effect on next connection
+    iCompressionThreshold = iCompressionThresholdNew; //Threshold and level take effect immediately
+    iCompressionLevel = iCompressionLevelNew;
+    return;
+}
+
+void TCPClientDataSender::SetHeartbeatOptionsRequestedEventHandler(unsigned int iHeartbeatIntervalNew, int iHeartbeatMaxMissedNew) {
+    hbmHeartbeat.SetOptions(iHeartbeatIntervalNew, iHeartbeatMaxMissedNew);
+
+    //Takes effect immediately if connected
+    if (iConnectionState == Connected && iHeartbeatIntervalNew > 0) {
+        tmrHeartbeat->start(iHeartbeatIntervalNew);
+    }
+    else {
+        tmrHeartbeat->stop();
+    }
+    return;
+}
+
 void TCPClientDataSender::SendDataToServerRequestedEventHandler() {
     //Check if SendDataToServerRequestedEventHandler() is running, avoid recursive calling of SendDataToServerRequestedEventHandler() and segmentation faults
     if (bIsDataSending) {
@@ -80,147 +256,626 @@ void TCPClientDataSender::SendDataToServerRequestedEventHandler() {
         //Marks SendDataToServerRequestedEventHandler() is running
         bIsDataSending = true;
     }
+    QElapsedTimer tmrSendCall;
+    tmrSendCall.start();
 
-    //Send all queued data frames to remote
-    //Data sending load may be very high, thus we use a while(){} loop
-    while (!queDataFramesPendingSending.empty() && state() == QTcpSocket::ConnectedState) {
-        QString * frmCurrentSendingDataFrame = NULL;
+    //Clear the wake-up mark before reading the queue, a data frame queued after that will post a new wake-up
+    queDataFramesPendingSending->ClearWakeUpPending();
+    if (!queDataFramesPendingSending->IsEmpty()) {
+        bIsDrainReported = false; //A new burst of data frames, report when it has been written
+    }
+
+    //Drop oldest data frames if the queue has exceeded its byte budget, even if we are not connected
+    int iFramesDropped = queDataFramesPendingSending->TrimToByteBudget();
+    if (iFramesDropped > 0) {
+        qDebug() << "TCPClient:" << iFramesDropped << "oldest data frame(s) dropped because the data queue has exceeded the size limit.";
+    }
 
-        if (mtxDataFramesPendingSendingLock.tryLock()) { //Begin reading internal buffer
-            frmCurrentSendingDataFrame = queDataFramesPendingSending.dequeue();
-            mtxDataFramesPendingSendingLock.unlock(); //Don't forget to unlock me!
+    //Send all queued data frames to remote
+    //Data sending load may be very high, thus queued data frames are coalesced into batches, and each batch is sent with a single write() call
+    QByteArray baCurrentSendingDataFrame;
+    int iBatchesSent = 0;
+    if (!bIsFramingNegotiating && state() == QTcpSocket::ConnectedState) {
+        ReencodeSendBatch(); //Framing of current connection is settled, frames are appended to a pending batch with the same framing
+    }
+    while (!bIsDataSendingStopRequested && !bIsFramingNegotiating && state() == QTcpSocket::ConnectedState) {
+        //Encode as many queued data frames as fit in the byte budget
+        while (iSendBatchBufferUsed < iSendBatchSize && queDataFramesPendingSending->Dequeue(baCurrentSendingDataFrame)) {
+            int iFrameLength = baCurrentSendingDataFrame.size();
+            int iHeaderLength = (iFramingMode == NetworkingFramingBinary) ? BinaryFrameEncoder::GetHeaderLength(iFrameLength) : 0;
+            int iEncodedLength = iHeaderLength + iFrameLength;
+            if (iSendBatchBufferUsed + iEncodedLength > iSendBatchSize) {
+                FlushSendBatch();
+            }
+            if (iEncodedLength > iSendBatchSize) { //Oversized data frame is sent on its own with a single write() call
+                if (iHeaderLength) { //Header and payload are joined in a copy, which is compressed if worthwhile
+                    QByteArray baOversizedFrame;
+                    BinaryFrameEncoder::AppendFrame(baOversizedFrame, NET_FRAME_TYPE_DATA, baCurrentSendingDataFrame);
+                    WriteFrames(baOversizedFrame.constData(), baOversizedFrame.size());
+                }
+                else { //Text frames have no header, the producer's buffer is written without copying
+                    write(baCurrentSendingDataFrame);
+                    cntBytesSent.Add(iEncodedLength);
+                    bIsSocketOutputPending = true;
+                }
+                cntFramesSent.Add();
+                continue;
+            }
+            if (iSendBatchBufferUsed == 0) {
+                tmrSendBatchAge.start();
+                iSendBatchFramingMode = iFramingMode;
+            }
+
+            //Copy data frame directly into the batch buffer
+            char * chrBatchData = baSendBatchBuffer.data() + iSendBatchBufferUsed;
+            if (iHeaderLength) {
+                chrBatchData += BinaryFrameEncoder::WriteHeader(chrBatchData, NET_FRAME_TYPE_DATA, iFrameLength);
+            }
+            memcpy(chrBatchData, baCurrentSendingDataFrame.constData(), iFrameLength);
+            iSendBatchBufferUsed += iEncodedLength;
+            arrSendBatchFrameLengths.append(iFrameLength);
+            cntFramesSent.Add();
         }
-        else {
-            break; //If we can't lock internal buffer, just stop this try
+        if (iSendBatchBufferUsed == 0) { //Queue is empty
+            break;
         }
 
-        if (!frmCurrentSendingDataFrame) { //Check if we got null
-            continue;
+        //A partially filled batch may wait for more data frames, until its oldest data frame reaches the max latency
+        if (iSendBatchBufferUsed < iSendBatchSize && iSendBatchMaxLatency > 0 && !bIsFlushRequested) {
+            qint64 iBatchAge = tmrSendBatchAge.nsecsElapsed() / 1000;
+            if (iBatchAge < iSendBatchMaxLatency) {
+                if (!tmrSendBatchLatency->isActive()) {
+                    tmrSendBatchLatency->start((iSendBatchMaxLatency - iBatchAge + 999) / 1000);
+                }
+                break;
+            }
         }
 
         //Send data
-        write(frmCurrentSendingDataFrame->toLatin1()); //Convert QString to ASCII sequence
-        //flush();
-
-        //Free memory space
-        delete frmCurrentSendingDataFrame;
-        frmCurrentSendingDataFrame = NULL;
+        FlushSendBatch();
 
-        //Process all events
-        QApplication::processEvents();
-
-        //Check if we need to stop data sending
-        if (bIsDataSendingStopRequested) {
+        //Return to event loop from time to time, and continue later
+        if (++iBatchesSent >= NET_SEND_BATCHES_PER_EVENT_LOOP_PASS) {
+            if (!queDataFramesPendingSending->IsEmpty()) {
+                QMetaObject::invokeMethod(this, "SendDataToServerRequestedEventHandler", Qt::QueuedConnection);
+            }
             break;
         }
     }
+    baCurrentSendingDataFrame.clear();
+
+    //Inform producers that they may resume
+    if (queDataFramesPendingSending->TryMarkLowWatermarkReached()) {
+        emit SocketDataQueueLowWatermarkReachedEvent(iConnectionID);
+    }
+    UpdateDrainState();
+
+    //Account time spent in this call
+    int iSendCallTime = static_cast<int>(tmrSendCall.nsecsElapsed() / 1000);
+    cntSendCalls.Add();
+    cntSendTimeTotal.Add(iSendCallTime);
+    cntSendTimeMax.SetMax(iSendCallTime);
 
+    bIsDataSendingStopRequested = false;
     bIsDataSending = false;
     return;
 }
 
+void TCPClientDataSender::FlushRequestedEventHandler() {
+    //Partially filled batches are sent at once until the data queue is drained, then batching works as usual again
+    bIsFlushRequested = true;
+    SendDataToServerRequestedEventHandler();
+    return;
+}
+
 void TCPClientDataSender::StopDataSendingRequestedEventHandler() {
     bIsDataSendingStopRequested = true;
     return;
 }
 
+void TCPClientDataSender::PurgeDataFrameQueueRequestedEventHandler() {
+    //Only the consumer may remove data frames from the queue, thus purging is done in worker thread
+    cntFramesPurged.Add(queDataFramesPendingSending->Clear());
+    cntPurges.Add();
+    iSendBatchBufferUsed = 0; //Data frames coalesced but not sent yet are purged too
+    arrSendBatchFrameLengths.resize(0);
+    tmrSendBatchLatency->stop();
+    bIsDataSendingStopRequested = false; //The stop request issued before purging has been fulfilled
+    if (queDataFramesPendingSending->TryMarkLowWatermarkReached()) {
+        emit SocketDataQueueLowWatermarkReachedEvent(iConnectionID);
+    }
+    UpdateDrainState();
+    return;
+}
+
+void TCPClientDataSender::UpdateDrainState() {
+    //Data frames in the socket's write buffer are written once bytesWritten() has confirmed every byte, and lost if the connection drops before
+    //Data frames still in the batch buffer are kept for the next connection
+    if (bIsSocketOutputPending && state() == QTcpSocket::UnconnectedState) {
+        bIsSocketOutputPending = false;
+        int iFramesLost = queDataFramesPendingSending->MarkDequeuedFramesLost(arrSendBatchFrameLengths.size());
+        if (iFramesLost > 0) {
+            cntFramesLost.Add(iFramesLost);
+            bIsDrainReported = true; //This burst has not been written
+            qDebug() << "TCPClient:" << iFramesLost << "data frame(s) lost with the connection before they were written.";
+        }
+        if (queDataFramesPendingSending->IsDrained()) {
+            bIsFlushRequested = false;
+        }
+        return;
+    }
+    if (iSendBatchBufferUsed > 0 || (bIsSocketOutputPending && bytesToWrite() > 0)) {
+        return;
+    }
+    bIsSocketOutputPending = false;
+    queDataFramesPendingSending->MarkDequeuedFramesWritten();
+    if (queDataFramesPendingSending->IsDrained()) {
+        bIsFlushRequested = false;
+        if (!bIsDrainReported) {
+            bIsDrainReported = true;
+            emit SocketDataQueueDrainedEvent(iConnectionID);
+        }
+    }
+    return;
+}
+
+void TCPClientDataSender::FlushSendBatch() {
+    if (iSendBatchBufferUsed > 0) {
+        WriteFrames(baSendBatchBuffer.constData(), iSendBatchBufferUsed);
+        iSendBatchBufferUsed = 0;
+        arrSendBatchFrameLengths.resize(0);
+    }
+    tmrSendBatchLatency->stop();
+    return;
+}
+
+void TCPClientDataSender::ReencodeSendBatch() {
+    //A batch kept across a disconnect has been encoded for the old connection, which may have negotiated another framing mode
+    if (iSendBatchBufferUsed == 0 || iSendBatchFramingMode == iFramingMode) {
+        iSendBatchFramingMode = iFramingMode;
+        return;
+    }
+
+    //Re-frame every data frame from its recorded payload length
+    int iEncodedLength = 0;
+    for (int i = 0; i < arrSendBatchFrameLengths.size(); ++i) {
+        iEncodedLength += arrSendBatchFrameLengths.at(i);
+        if (iFramingMode == NetworkingFramingBinary) {
+            iEncodedLength += BinaryFrameEncoder::GetHeaderLength(arrSendBatchFrameLengths.at(i));
+        }
+    }
+    QByteArray baReencodedBatch(qMax(iEncodedLength, iSendBatchSize), '\0');
+    const char * chrSource = baSendBatchBuffer.constData();
+    char * chrDestination = baReencodedBatch.data();
+    for (int i = 0; i < arrSendBatchFrameLengths.size(); ++i) {
+        int iFrameLength = arrSendBatchFrameLengths.at(i);
+        if (iSendBatchFramingMode == NetworkingFramingBinary) {
+            chrSource += BinaryFrameEncoder::GetHeaderLength(iFrameLength);
+        }
+        if (iFramingMode == NetworkingFramingBinary) {
+            chrDestination += BinaryFrameEncoder::WriteHeader(chrDestination, NET_FRAME_TYPE_DATA, iFrameLength);
+        }
+        memcpy(chrDestination, chrSource, iFrameLength);
+        chrSource += iFrameLength;
+        chrDestination += iFrameLength;
+    }
+    qDebug() << "TCPClient: Re-framed" << arrSendBatchFrameLengths.size() << "pending data frame(s) for" << (iFramingMode == NetworkingFramingBinary ? "binary" : "text") << "framing";
+    baSendBatchBuffer = baReencodedBatch;
+    iSendBatchBufferUsed = iEncodedLength;
+    iSendBatchFramingMode = iFramingMode;
+    return;
+}
+
+void TCPClientDataSender::WriteFrames(const char * chrFrames, int iFramesLength) {
+    //A batch large enough is sent as a single compressed frame, unless it does not shrink (e.g. data already compressed)
+    if (bIsCompressionEnabled && iFramesLength >= iCompressionThreshold) {
+        baCompressedBatch.clear();
+        if (BinaryFrameEncoder::AppendCompressedBatch(baCompressedBatch, chrFrames, iFramesLength, iCompressionLevel)) {
+            write(baCompressedBatch);
+            cntBytesSent.Add(baCompressedBatch.size());
+            bIsSocketOutputPending = true;
+            return;
+        }
+    }
+    write(chrFrames, iFramesLength);
+    cntBytesSent.Add(iFramesLength);
+    bIsSocketOutputPending = true;
+    return;
+}
+
 /* TCP Socket Event Handler Slots */
 void TCPClientDataSender::TCPClientDataSender_Connected() {
     qDebug() << "TCPClient: Connected to" << sServerIP << ":" << iPort;
-    bIsReconnecting = false;
+    tmrConnectTimeout->stop();
+    iConnectionState = Connected;
+    iReconnectRound = 0;
+    iIsConnectedMetric.fetchAndStoreRelease(1);
+    cntConnects.Add();
+    if (bIsConnectionLost) {
+        iLastReconnectTime = static_cast<int>(tmrConnectionLost.elapsed());
+        bIsConnectionLost = false;
+        cntReconnects.Add();
+        qDebug() << "TCPClient: Reconnected after" << static_cast<int>(iLastReconnectTime) << "ms";
+    }
+    emit SocketConnectionHealthChangedEvent(iConnectionID, true, false);
     emit SocketConnectedToServerEvent(peerName(), sServerIP, iPort);
+
+    //Start heartbeats, the first ping is sent after one interval, when framing negotiation is normally done
+    hbmHeartbeat.Reset();
+    if (hbmHeartbeat.GetInterval() > 0) {
+        tmrHeartbeat->start(hbmHeartbeat.GetInterval());
+    }
+
+    //Every connection starts in text mode without compression, request binary mode (and compression) if required
+    iFramingMode = NetworkingFramingText;
+    bIsCompressionEnabled = false;
+    bIsFramingNegotiationTimedOut = false;
+    decResponseLineDecoder.Clear();
+    decResponseDecoder.Clear();
+    decResponseDecoder.SetCompressionEnabled(false);
+    if (bIsBinaryFramingRequested || bIsCompressionRequested) {
+        if (bIsCompressionRequested) {
+            write(NET_FRAMING_REQUEST_COMPRESSED "\n");
+        }
+        else {
+            write(NET_FRAMING_REQUEST_BINARY "\n");
+        }
+        bIsFramingNegotiating = true; //Data sending is resumed when server answers
+        tmrFramingNegotiation->start(NET_FRAMING_NEGOTIATION_TIMEOUT_MS);
+        return;
+    }
+
+    //Send data frames queued while we were disconnected
+    SendDataToServerRequestedEventHandler();
     return;
 }
 
 void TCPClientDataSender::TCPClientDataSender_Disconnected() {
     qDebug() << "TCPClient: Disconnected from" << sServerIP << ":" << iPort;
+    bIsFramingNegotiating = false;
+    tmrFramingNegotiation->stop();
+    tmrHeartbeat->stop();
+    iIsConnectedMetric.fetchAndStoreRelease(0);
+    UpdateDrainState(); //Data frames left in the socket's write buffer are lost, waiters are told so
     emit SocketDisconnectedFromServerEvent(peerName(), sServerIP, iPort);
+    emit SocketConnectionHealthChangedEvent(iConnectionID, false, false);
+
+    //Connection closed without an error, e.g. aborted on a protocol error
+    if (iConnectionState == Connected) {
+        iConnectionState = Disconnected;
+        HandleConnectionLost();
+    }
     return;
 }
 
 void TCPClientDataSender::TCPClientDataSender_Error(QAbstractSocket::SocketError errErrorInfo) {
     qDebug() << "TCPClient: Error" << errErrorInfo << ": " << errorString();
+    iIsConnectedMetric.fetchAndStoreRelease(0);
+    cntErrors.Add();
+    tmrHeartbeat->stop();
+    emit SocketErrorOccurredEvent(errErrorInfo, peerName(), sServerIP, iPort);
+    emit SocketConnectionHealthChangedEvent(iConnectionID, false, true);
+
+    //Close the socket without waiting, queued data frames stay in data queue until we are connected again
+    ConnectionState iPreviousConnectionState = iConnectionState;
+    iConnectionState = Disconnected; //Keeps TCPClientDataSender_Disconnected() from handling the same loss
+    tmrConnectTimeout->stop();
     if (state() != QTcpSocket::UnconnectedState) {
-        disconnectFromHost();
-        waitForDisconnected(245000);
+        abort();
     }
-    if (bIsAutoReconnectEnabled && !bIsReconnecting && !bIsUserInitiatedDisconnection) { //Check if we need to reconnect
-        qDebug() << "TCPClient: Will retry connect after" << iAutoReconnectDelay << "ms";
-        QTimer::singleShot(iAutoReconnectDelay, this, SLOT(TryReconnect()));
-        bIsReconnecting = true;
+    UpdateDrainState();
+    if (iPreviousConnectionState == Connected) {
+        HandleConnectionLost();
+    }
+    else if (iPreviousConnectionState == Connecting) {
+        ScheduleReconnect(true);
     }
-    emit SocketErrorOccurredEvent(errErrorInfo, peerName(), sServerIP, iPort);
     return;
 }
 
 void TCPClientDataSender::TCPClientDataSender_ReadyRead() {
-    while (bytesAvailable()) {
-        //Read a command line and emit a signal
-        QString sData = readLine();
-        if (sData.endsWith('\n')) {
-            sData.remove(sData.length() - 1, 1);
+    //All responses received in this call are delivered with a single signal
+    QList<QByteArray> lstResponses;
+    QByteArray baReceivedData = readAll();
+    cntBytesReceived.Add(baReceivedData.size());
+
+    if (iFramingMode == NetworkingFramingText) {
+        //Take complete response lines out, a partial line is kept until the rest of it is received
+        QByteArray baData;
+        decResponseLineDecoder.Append(baReceivedData);
+        while (iFramingMode == NetworkingFramingText && decResponseLineDecoder.NextLine(baData)) {
+            //Handle server's answer to framing request, bytes following a binary mode answer are binary framed
+            if (bIsFramingNegotiating) {
+                if (baData == NET_FRAMING_REPLY_BINARY || baData == NET_FRAMING_REPLY_COMPRESSED) {
+                    baReceivedData = decResponseLineDecoder.TakeRemainingData();
+                    decResponseDecoder.Clear();
+                    FinishFramingNegotiation(NetworkingFramingBinary, baData == NET_FRAMING_REPLY_COMPRESSED);
+                    continue;
+                }
+                else if (baData == NET_FRAMING_REPLY_TEXT) {
+                    FinishFramingNegotiation(NetworkingFramingText);
+                    continue;
+                }
+            }
+            else if (bIsFramingNegotiationTimedOut) {
+                //A late answer accepting binary mode means the server has switched and reads our text as binary frames, both sides can only
+                //agree again on a new connection. A late rejection changes nothing
+                if (baData == NET_FRAMING_REPLY_BINARY || baData == NET_FRAMING_REPLY_COMPRESSED) {
+                    qDebug() << "TCPClient: Server accepted binary framing after text mode was chosen, connection aborted.";
+                    decResponseLineDecoder.Clear();
+                    abort(); //Responses received before the answer are still delivered below
+                    break;
+                }
+                if (baData == NET_FRAMING_REPLY_TEXT) {
+                    bIsFramingNegotiationTimedOut = false;
+                    continue;
+                }
+            }
+
+            //Heartbeats are handled here, they are not responses
+            QByteArray baHeartbeatPayload;
+            HeartbeatMonitor::MessageKind iHeartbeatKind = HeartbeatMonitor::ParseLine(baData, baHeartbeatPayload);
+            if (iHeartbeatKind != HeartbeatMonitor::NotHeartbeat) {
+                HandleHeartbeat(iHeartbeatKind, baHeartbeatPayload);
+                continue;
+            }
+            lstResponses.append(baData);
+        }
+        if (decResponseLineDecoder.IsCorrupted()) {
+            qDebug() << "TCPClient: Too long response line received, connection aborted.";
+            abort();
         }
-        if (sData.endsWith('\r')) {
-            sData.remove(sData.length() - 1, 1);
+    }
+
+    if (iFramingMode == NetworkingFramingBinary) {
+        //Take whole frames out
+        quint8 iMessageType = 0;
+        QByteArray baPayload;
+        decResponseDecoder.Append(baReceivedData);
+        while (decResponseDecoder.NextFrame(iMessageType, baPayload)) {
+            if (iMessageType == NET_FRAME_TYPE_DATA) {
+                lstResponses.append(baPayload);
+            }
+            else if (HeartbeatMonitor::GetFrameKind(iMessageType) != HeartbeatMonitor::NotHeartbeat) {
+                HandleHeartbeat(HeartbeatMonitor::GetFrameKind(iMessageType), baPayload);
+            }
         }
-        emit SocketResponseReceivedFromServerEvent(sData, peerName(), sServerIP, iPort);
+        if (decResponseDecoder.IsCorrupted()) {
+            qDebug() << "TCPClient: Corrupted binary frame received, connection aborted.";
+            abort();
+        }
+    }
 
-        //Process events
-        //QApplication::processEvents();
+    if (!lstResponses.isEmpty()) {
+        cntFramesReceived.Add(lstResponses.size());
+        emit SocketResponsesReceivedFromServerEvent(lstResponses, peerName(), sServerIP, iPort);
     }
     return;
 }
 
+void TCPClientDataSender::TCPClientDataSender_BytesWritten(qint64 iBytesWritten) {
+    Q_UNUSED(iBytesWritten);
+
+    //Data frames are written once the socket's write buffer is empty
+    UpdateDrainState();
+    return;
+}
+
 /* Functional Slots */
 void TCPClientDataSender::TryReconnect() {
-    if (bIsUserInitiatedDisconnection) {
+    if (bIsUserInitiatedDisconnection || iConnectionState == Connected) {
         return;
     }
-    if (state() != QTcpSocket::ConnectingState && state() != QTcpSocket::ConnectedState) {
-        qDebug() << "TCPClient: Retrying to connect to" << sServerIP << ":" << iPort;
-        connectToHost(sServerIP, iPort);
-        waitForConnected(245000);
+    qDebug() << "TCPClient: Retrying to connect";
+    StartConnectionAttempt();
+    return;
+}
+
+void TCPClientDataSender::ConnectTimeoutEventHandler() {
+    if (iConnectionState != Connecting) {
+        return;
     }
-    if (state() != QTcpSocket::ConnectedState) {
-        qDebug() << "TCPClient: Will retry connect after" << iAutoReconnectDelay << "ms";
-        if (state() != QTcpSocket::UnconnectedState) {
-            disconnectFromHost();
-            waitForDisconnected(245000);
+    qDebug() << "TCPClient: Connection attempt to" << sServerIP << ":" << iPort << "timed out after" << iConnectTimeout << "ms";
+    abort();
+    cntErrors.Add();
+    emit SocketErrorOccurredEvent(QAbstractSocket::SocketTimeoutError, peerName(), sServerIP, iPort);
+    emit SocketConnectionHealthChangedEvent(iConnectionID, false, true);
+    ScheduleReconnect(true);
+    return;
+}
+
+/* Connection State Machine */
+void TCPClientDataSender::StartConnectionAttempt() {
+    //Select server of this attempt
+    if (iCurrentServer == 0 || iCurrentServer > lstFallbackServers.size()) {
+        iCurrentServer = 0;
+        sServerIP = sPrimaryServerIP;
+        iPort = iPrimaryPort;
+    }
+    else {
+        sServerIP = lstFallbackServers.at(iCurrentServer - 1).first;
+        iPort = lstFallbackServers.at(iCurrentServer - 1).second;
+    }
+
+    //Mark the state first, aborting a connected socket must not be handled as a lost connection
+    iConnectionState = Connecting;
+    if (state() != QTcpSocket::UnconnectedState) {
+        abort();
+    }
+    tmrReconnect->stop();
+    tmrConnectTimeout->start(iConnectTimeout);
+    if (LocalSocketEndpoint::IsLocalEndpoint(sServerIP)) {
+        TCPClientDataSender::ConnectToLocalEndpoint();
+        return;
+    }
+    connectToHost(sServerIP, iPort);
+    return;
+}
+
+void TCPClientDataSender::ConnectToLocalEndpoint() {
+    //The connected descriptor is handed to QTcpSocket, which then works as if connectToHost() had succeeded, but connected() is not emitted
+    QAbstractSocket::SocketError errErrorInfo = QAbstractSocket::UnknownSocketError;
+    int iSocketID = LocalSocketEndpoint::Connect(sServerIP, errErrorInfo);
+    if (iSocketID >= 0) {
+        if (setSocketDescriptor(iSocketID)) {
+            TCPClientDataSender_Connected();
+            return;
         }
-        QTimer::singleShot(iAutoReconnectDelay, this, SLOT(TryReconnect()));
+        ::close(iSocketID);
+        errErrorInfo = QAbstractSocket::SocketResourceError;
+    }
+
+    //Handled like a connection attempt which timed out
+    qDebug() << "TCPClient: Couldnot connect to" << sServerIP << ", error" << errErrorInfo;
+    tmrConnectTimeout->stop();
+    cntErrors.Add();
+    emit SocketErrorOccurredEvent(errErrorInfo, QString(), sServerIP, iPort);
+    emit SocketConnectionHealthChangedEvent(iConnectionID, false, true);
+    ScheduleReconnect(true);
+    return;
+}
+
+void TCPClientDataSender::HandleConnectionLost() {
+    if (bIsUserInitiatedDisconnection) {
+        iConnectionState = Disconnected;
+        return;
+    }
+
+    //Start a new round with primary server
+    tmrConnectionLost.start();
+    bIsConnectionLost = true;
+    iCurrentServer = 0;
+    iReconnectRound = 0;
+    ScheduleReconnect(false);
+    return;
+}
+
+void TCPClientDataSender::ScheduleReconnect(bool bIsAttemptFailed) {
+    if (!bIsAutoReconnectEnabled || bIsUserInitiatedDisconnection) {
+        iConnectionState = Disconnected;
+        return;
+    }
+
+    //Fail over to next server without delay, the timer avoids re-entering the socket from its own error signal
+    if (bIsAttemptFailed && iCurrentServer < lstFallbackServers.size()) {
+        ++iCurrentServer;
+        iConnectionState = WaitingToReconnect;
+        tmrReconnect->start(0);
+        return;
+    }
+
+    //All servers have failed, wait for backoff delay before next round
+    if (bIsAttemptFailed) {
+        ++iReconnectRound;
+    }
+    unsigned int iDelay = GetReconnectDelay(iReconnectRound > 0 ? iReconnectRound - 1 : 0);
+    iCurrentServer = 0;
+    iConnectionState = WaitingToReconnect;
+    qDebug() << "TCPClient: Will retry connect after" << iDelay << "ms";
+    tmrReconnect->start(iDelay);
+    return;
+}
+
+unsigned int TCPClientDataSender::GetReconnectDelay(int iRound) {
+    //Double the delay each round until the upper bound is reached
+    qint64 iDelay = iAutoReconnectDelay;
+    for (int i = 0; i < iRound && iDelay < iAutoReconnectMaxDelay; ++i) {
+        iDelay *= 2;
+    }
+    if (iAutoReconnectMaxDelay > 0 && iDelay > iAutoReconnectMaxDelay) {
+        iDelay = iAutoReconnectMaxDelay;
+    }
+
+    //Spread retries of many clients, so that a restarted server is not hit by all of them at once
+    if (iAutoReconnectJitter > 0 && iDelay > 0) {
+        int iDeviation = (qrand() % (2 * iAutoReconnectJitter + 1)) - iAutoReconnectJitter;
+        iDelay += iDelay * iDeviation / 100;
+    }
+    return static_cast<unsigned int>(qMax(iDelay, static_cast<qint64>(0)));
+}
+
+void TCPClientDataSender::HeartbeatTimerEventHandler() {
+    if (iConnectionState != Connected) {
+        tmrHeartbeat->stop();
+        return;
+    }
+
+    //Close the connection if the server has stopped answering, it is handled as a lost connection and reconnected
+    if (hbmHeartbeat.IsPeerDead()) {
+        qDebug() << "TCPClient: Server" << sServerIP << ":" << iPort << "did not answer heartbeats, connection aborted.";
+        hbmHeartbeat.MarkPeerDead();
+        tmrHeartbeat->stop();
+        iIsConnectedMetric.fetchAndStoreRelease(0);
+        cntErrors.Add();
+        emit SocketErrorOccurredEvent(QAbstractSocket::SocketTimeoutError, peerName(), sServerIP, iPort);
+        emit SocketConnectionHealthChangedEvent(iConnectionID, false, true);
+        iConnectionState = Disconnected; //Keeps TCPClientDataSender_Disconnected() from handling the same loss
+        abort();
+        HandleConnectionLost();
+        return;
+    }
+
+    //Pings are written directly to the socket, they never wait behind queued data frames
+    //No ping is sent while framing is being negotiated, the server would decode it in the wrong mode
+    if (!bIsFramingNegotiating) {
+        QByteArray baPing;
+        hbmHeartbeat.AppendPing(baPing, iFramingMode);
+        write(baPing);
+        cntBytesSent.Add(baPing.size());
     }
     return;
 }
 
+void TCPClientDataSender::HandleHeartbeat(HeartbeatMonitor::MessageKind iMessageKind, const QByteArray & baPayload) {
+    if (iMessageKind == HeartbeatMonitor::Ping) {
+        QByteArray baPong;
+        HeartbeatMonitor::AppendPong(baPong, iFramingMode, baPayload);
+        write(baPong);
+        cntBytesSent.Add(baPong.size());
+        hbmHeartbeat.HandlePing();
+    }
+    else if (iMessageKind == HeartbeatMonitor::Pong) {
+        hbmHeartbeat.HandlePong(baPayload);
+    }
+    return;
+}
+
+void TCPClientDataSender::FramingNegotiationTimeoutEventHandler() {
+    if (bIsFramingNegotiating) {
+        qDebug() << "TCPClient: Server did not answer framing request, falling back to text mode";
+        FinishFramingNegotiation(NetworkingFramingText);
+        bIsFramingNegotiationTimedOut = true;
+    }
+    return;
+}
+
+void TCPClientDataSender::FinishFramingNegotiation(NetworkingFramingMode iFramingModeNew, bool bIsCompressionEnabledNew) {
+    qDebug() << "TCPClient: Using" << (iFramingModeNew == NetworkingFramingBinary ? "binary" : "text") << "framing" << (bIsCompressionEnabledNew ? "with compression" : "") << "with" << sServerIP << ":" << iPort;
+    iFramingMode = iFramingModeNew;
+    bIsCompressionEnabled = bIsCompressionEnabledNew;
+    decResponseDecoder.SetCompressionEnabled(bIsCompressionEnabled);
+    bIsFramingNegotiating = false;
+    tmrFramingNegotiation->stop();
+
+    //Resume data sending
+    SendDataToServerRequestedEventHandler();
+    return;
+}
+
 /* TCP Networking Client Wrapper */
 TCPClient::TCPClient() {
     //Load settings
     TCPClient::LoadSettings();
 
-    //Create worker object
-    tcpDataSender = new TCPClientDataSender;
-
-    //Creat thread object and move worker object (and all it's child objects) to this thread
-    trdTCPDataSenderThread = new QThread;
-    tcpDataSender->moveToThread(trdTCPDataSenderThread);
-
-    //Connect events and handlers
-    connect(this, SIGNAL(ConnectToServerRequestedEvent(QString, quint16, bool, unsigned int, bool)), tcpDataSender, SLOT(ConnectToServerRequestedEventHandler(QString, quint16, bool, unsigned int, bool)));
-    connect(this, SIGNAL(DisconnectFromServerRequestedEvent(bool)), tcpDataSender, SLOT(DisconnectFromServerRequestedEventHandler(bool)));
-    connect(this, SIGNAL(SetAutoReconnectOptionsRequestedEvent(bool, uint)), tcpDataSender, SLOT(SetAutoReconnectOptionsRequestedEventHandler(bool, uint)));
-    connect(this, SIGNAL(SendDataToServerRequestedEvent()), tcpDataSender, SLOT(SendDataToServerRequestedEventHandler()));
-    connect(this, SIGNAL(StopDataSendingRequestedEvent()), tcpDataSender, SLOT(StopDataSendingRequestedEventHandler()));
-    connect(tcpDataSender, SIGNAL(SocketResponseReceivedFromServerEvent(QString, QString, QString, quint16)), this, SLOT(SocketResponseReceivedFromServerEventHandler(QString, QString, QString, quint16)));
-    connect(tcpDataSender, SIGNAL(SocketConnectedToServerEvent(QString, QString, quint16)), this, SIGNAL(ConnectedToServerEvent(QString, QString, quint16)));
-    connect(tcpDataSender, SIGNAL(SocketDisconnectedFromServerEvent(QString, QString, quint16)), this, SIGNAL(DisconnectedFromServerEvent(QString, QString, quint16)));
-    connect(tcpDataSender, SIGNAL(SocketErrorOccurredEvent(QAbstractSocket::SocketError, QString, QString, quint16)), this, SIGNAL(NetworkingErrorOccurredEvent(QAbstractSocket::SocketError, QString, QString, quint16)));
-
-    //Start child thread's own event loop
-    trdTCPDataSenderThread->start();
+    //Create data queues, worker objects and threads
+    TCPClient::CreateConnections();
 }
 
 TCPClient::TCPClient(const QString sServerIPNew, quint16 iPortNew,
                      bool bIsAutoReconnectEnabledNew, unsigned int iAutoReconnectDelayNew) {
+    //Load settings which are not given
+    TCPClient::LoadSettings();
+
     //Save settings
     sServerIP = sServerIPNew;
     iPort = iPortNew;
@@ -228,83 +883,202 @@ TCPClient::TCPClient(const QString sServerIPNew, quint16 iPortNew,
     iAutoReconnectDelay = iAutoReconnectDelayNew;
     TCPClient::SaveSettings();
 
-    //Create worker object
-    tcpDataSender = new TCPClientDataSender;
-
-    //Creat thread object
-    trdTCPDataSenderThread = new QThread;
-    tcpDataSender->moveToThread(trdTCPDataSenderThread);
-
-    //Connect events and handlers
-    connect(this, SIGNAL(ConnectToServerRequestedEvent(QString, quint16, bool, unsigned int, bool)), tcpDataSender, SLOT(ConnectToServerRequestedEventHandler(QString, quint16, bool, unsigned int, bool)));
-    connect(this, SIGNAL(DisconnectFromServerRequestedEvent(bool)), tcpDataSender, SLOT(DisconnectFromServerRequestedEventHandler(bool)));
-    connect(this, SIGNAL(SetAutoReconnectOptionsRequestedEvent(bool, uint)), tcpDataSender, SLOT(SetAutoReconnectOptionsRequestedEventHandler(bool, uint)));
-    connect(this, SIGNAL(SendDataToServerRequestedEvent()), tcpDataSender, SLOT(SendDataToServerRequestedEventHandler()));
-    connect(this, SIGNAL(StopDataSendingRequestedEvent()), tcpDataSender, SLOT(StopDataSendingRequestedEventHandler()));
-    connect(tcpDataSender, SIGNAL(SocketResponseReceivedFromServerEvent(QString, QString, QString, quint16)), this, SLOT(SocketResponseReceivedFromServerEventHandler(QString, QString, QString, quint16)));
-    connect(tcpDataSender, SIGNAL(SocketConnectedToServerEvent(QString, QString, quint16)), this, SIGNAL(ConnectedToServerEvent(QString, QString, quint16)));
-    connect(tcpDataSender, SIGNAL(SocketDisconnectedFromServerEvent(QString, QString, quint16)), this, SIGNAL(DisconnectedFromServerEvent(QString, QString, quint16)));
-    connect(tcpDataSender, SIGNAL(SocketErrorOccurredEvent(QAbstractSocket::SocketError, QString, QString, quint16)), this, SIGNAL(NetworkingErrorOccurredEvent(QAbstractSocket::SocketError, QString, QString, quint16)));
-
-    //Start child thread's own event loop
-    trdTCPDataSenderThread->start();
+    //Create data queues, worker objects and threads
+    TCPClient::CreateConnections();
 }
 
 TCPClient::~TCPClient() {
-    //Save settings
+    //Write data frames queued so far, then disconnect and wait for it, so that nothing is left in sockets when threads quit
     if (TCPClient::IsConnected()) {
-        TCPClient::DisconnectFromServer();
+        if (!TCPClient::Flush(NET_CLIENT_SHUTDOWN_FLUSH_TIMEOUT_MS)) {
+            qDebug() << "TCPClient: Data queue was not drained before shutdown, remaining data frames are dropped.";
+        }
+        TCPClient::DisconnectFromServer(true);
     }
+
+    //Save settings
     TCPClient::SaveSettings();
 
-    //Quit child thread
-    trdTCPDataSenderThread->quit();
-    if (!trdTCPDataSenderThread->wait(1000)) {
-        emit StopDataSendingRequestedEvent();
-        if (!trdTCPDataSenderThread->wait(100)) {
-            trdTCPDataSenderThread->terminate();
-        }
+    //Quit child threads and delete worker objects
+    TCPClient::DestroyConnections();
+}
+
+void TCPClient::CreateConnections() {
+    //Initialize internal variables
+    iActiveConnectionCount = qMax(iConnectionCount, 1);
+    iConnectedConnectionCount = 0;
+    iNextConnection = 0;
+    iCongestedQueueCount = 0;
+    arrIsConnectionConnected.fill(false, iActiveConnectionCount);
+    arrConnectionConnectCounts.fill(0, iActiveConnectionCount);
+    arrConnectionErrorCounts.fill(0, iActiveConnectionCount);
+
+    for (int i = 0; i < iActiveConnectionCount; ++i) {
+        //Create data queue and worker object
+        DataFrameQueue * queDataFrames = new DataFrameQueue;
+        TCPClientDataSender * tcpDataSender = new TCPClientDataSender(queDataFrames, i);
+
+        //Creat thread object and move worker object (and all it's child objects) to this thread
+        QThread * trdTCPDataSenderThread = new QThread;
+        tcpDataSender->moveToThread(trdTCPDataSenderThread);
+
+        //Connect events and handlers
+        connect(this, SIGNAL(DisconnectFromServerRequestedEvent()), tcpDataSender, SLOT(DisconnectFromServerRequestedEventHandler()));
+        connect(this, SIGNAL(SetAutoReconnectOptionsRequestedEvent(bool, uint)), tcpDataSender, SLOT(SetAutoReconnectOptionsRequestedEventHandler(bool, uint)));
+        connect(this, SIGNAL(SetSendBatchOptionsRequestedEvent(int, uint)), tcpDataSender, SLOT(SetSendBatchOptionsRequestedEventHandler(int, uint)));
+        connect(this, SIGNAL(SetFramingOptionsRequestedEvent(bool)), tcpDataSender, SLOT(SetFramingOptionsRequestedEventHandler(bool)));
+        connect(this, SIGNAL(SetCompressionOptionsRequestedEvent(bool, int, int)), tcpDataSender, SLOT(SetCompressionOptionsRequestedEventHandler(bool, int, int)));
+        connect(this, SIGNAL(SetHeartbeatOptionsRequestedEvent(uint, int)), tcpDataSender, SLOT(SetHeartbeatOptionsRequestedEventHandler(uint, int)));
+        connect(this, SIGNAL(SendDataToServerRequestedEvent()), tcpDataSender, SLOT(SendDataToServerRequestedEventHandler()));
+        connect(this, SIGNAL(StopDataSendingRequestedEvent()), tcpDataSender, SLOT(StopDataSendingRequestedEventHandler()));
+        connect(this, SIGNAL(PurgeDataFrameQueueRequestedEvent()), tcpDataSender, SLOT(PurgeDataFrameQueueRequestedEventHandler()), Qt::BlockingQueuedConnection);
+        connect(tcpDataSender, SIGNAL(SocketResponsesReceivedFromServerEvent(QList<QByteArray>, QString, QString, quint16)), this, SLOT(SocketResponsesReceivedFromServerEventHandler(QList<QByteArray>, QString, QString, quint16)));
+        connect(tcpDataSender, SIGNAL(SocketConnectedToServerEvent(QString, QString, quint16)), this, SIGNAL(ConnectedToServerEvent(QString, QString, quint16)));
+        connect(tcpDataSender, SIGNAL(SocketDisconnectedFromServerEvent(QString, QString, quint16)), this, SIGNAL(DisconnectedFromServerEvent(QString, QString, quint16)));
+        connect(tcpDataSender, SIGNAL(SocketErrorOccurredEvent(QAbstractSocket::SocketError, QString, QString, quint16)), this, SIGNAL(NetworkingErrorOccurredEvent(QAbstractSocket::SocketError, QString, QString, quint16)));
+        connect(tcpDataSender, SIGNAL(SocketConnectionHealthChangedEvent(int, bool, bool)), this, SLOT(SocketConnectionHealthChangedEventHandler(int, bool, bool)));
+        connect(tcpDataSender, SIGNAL(SocketDataQueueLowWatermarkReachedEvent(int)), this, SLOT(SocketDataQueueLowWatermarkReachedEventHandler(int)));
+        connect(tcpDataSender, SIGNAL(SocketDataQueueDrainedEvent(int)), this, SLOT(SocketDataQueueDrainedEventHandler(int)));
+
+        queDataFramesPendingSending.append(queDataFrames);
+        tcpDataSenders.append(tcpDataSender);
+        trdTCPDataSenderThreads.append(trdTCPDataSenderThread);
+
+        //Start child thread's own event loop
+        trdTCPDataSenderThread->start();
     }
 
-    //Delete worker object
-    tcpDataSender->deleteLater();
-    tcpDataSender = NULL;
+    //Pass options to worker objects
+    TCPClient::ApplyDataQueueOptions();
+    TCPClient::ApplyReconnectPolicy();
+    emit SetSendBatchOptionsRequestedEvent(iSendBatchSize, iSendBatchMaxLatency);
+    emit SetFramingOptionsRequestedEvent(bIsBinaryFramingRequested);
+    emit SetCompressionOptionsRequestedEvent(bIsCompressionRequested, iCompressionThreshold, iCompressionLevel);
+    emit SetHeartbeatOptionsRequestedEvent(iHeartbeatInterval, iHeartbeatMaxMissed);
 
-    //Delete child thread
-    trdTCPDataSenderThread->deleteLater();
-    trdTCPDataSenderThread = NULL;
+    //Metrics can be scraped once all connections exist
+    NetworkingMetrics::RegisterSource(this);
+    return;
+}
+
+void TCPClient::DestroyConnections() {
+    //Wait until running scrapes have finished, before connections are deleted
+    NetworkingMetrics::UnregisterSource(this);
+
+    //Stop data sending before quitting, a sender busy with a long queue finishes its current pass (NET_SEND_BATCHES_PER_EVENT_LOOP_PASS batches at most) and does not start another
+    TCPClient::StopDataSending();
+    for (int i = 0; i < iActiveConnectionCount; ++i) {
+        trdTCPDataSenderThreads[i]->quit();
+    }
+
+    for (int i = 0; i < iActiveConnectionCount; ++i) {
+        //Wait for child thread, threads are never terminated, a thread killed while holding a lock would leave it locked forever
+        trdTCPDataSenderThreads[i]->wait();
+
+        //Delete worker object
+        tcpDataSenders[i]->deleteLater();
+        tcpDataSenders[i] = NULL;
+
+        //Delete child thread
+        trdTCPDataSenderThreads[i]->deleteLater();
+        trdTCPDataSenderThreads[i] = NULL;
+    }
+
+    //Data queues are deleted last, worker objects do not touch them once their threads have finished
+    for (int i = 0; i < iActiveConnectionCount; ++i) {
+        delete queDataFramesPendingSending[i];
+        queDataFramesPendingSending[i] = NULL;
+    }
+    return;
 }
 
 /* Options Management */
 void TCPClient::LoadSettings() {
-    SettingsContainer.beginGroup(ST_KEY_NETWORKING_PREFIX);
-    sServerIP = SettingsContainer.value(ST_KEY_SERVER_IP, ST_DEFVAL_SERVER_IP).toString();
-    iPort = SettingsContainer.value(ST_KEY_SERVER_PORT, ST_DEFVAL_SERVER_PORT).toUInt();
-    bIsAutoReconnectEnabled = SettingsContainer.value(ST_KEY_IS_AUTORECONN_ON, ST_DEFVAL_IS_AUTORECONN_ON).toBool();
-    iAutoReconnectDelay = SettingsContainer.value(ST_KEY_AUTORECONN_DELAY_MS, ST_DEFVAL_AUTORECONN_DELAY_MS).toUInt();
-    SettingsContainer.endGroup();
+    sServerIP = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_SERVER_IP, ST_DEFVAL_SERVER_IP).toString();
+    iPort = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_SERVER_PORT, ST_DEFVAL_SERVER_PORT).toUInt();
+    bIsAutoReconnectEnabled = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_IS_AUTORECONN_ON, ST_DEFVAL_IS_AUTORECONN_ON).toBool();
+    iAutoReconnectDelay = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_AUTORECONN_DELAY_MS, ST_DEFVAL_AUTORECONN_DELAY_MS).toUInt();
+    iAutoReconnectMaxDelay = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_AUTORECONN_MAX_DELAY_MS, ST_DEFVAL_AUTORECONN_MAX_DELAY_MS).toUInt();
+    iAutoReconnectJitter = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_AUTORECONN_JITTER, ST_DEFVAL_AUTORECONN_JITTER).toInt();
+    iConnectTimeout = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_CONNECT_TIMEOUT_MS, ST_DEFVAL_CONNECT_TIMEOUT_MS).toUInt();
+    QVariant varFallbackServers = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_FALLBACK_SERVERS, ST_DEFVAL_FALLBACK_SERVERS);
+    if (varFallbackServers.type() == QVariant::StringList) { //An unquoted comma separated value is read as a list
+        lstFallbackServers = varFallbackServers.toStringList();
+    }
+    else {
+        lstFallbackServers = varFallbackServers.toString().split(',', QString::SkipEmptyParts);
+    }
+    iSendBatchSize = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_SEND_BATCH_SIZE, ST_DEFVAL_SEND_BATCH_SIZE).toInt();
+    iSendBatchMaxLatency = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_SEND_BATCH_LATENCY_US, ST_DEFVAL_SEND_BATCH_LATENCY_US).toUInt();
+    bIsBinaryFramingRequested = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_CLIENT_BINARY_FRAMING, ST_DEFVAL_CLIENT_BINARY_FRAMING).toBool();
+    bIsCompressionRequested = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_CLIENT_COMPRESSION, ST_DEFVAL_CLIENT_COMPRESSION).toBool();
+    iCompressionThreshold = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_COMPRESSION_THRESHOLD, ST_DEFVAL_COMPRESSION_THRESHOLD).toInt();
+    iCompressionLevel = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_COMPRESSION_LEVEL, ST_DEFVAL_COMPRESSION_LEVEL).toInt();
+    iHeartbeatInterval = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_HEARTBEAT_INTERVAL_MS, ST_DEFVAL_HEARTBEAT_INTERVAL_MS).toUInt();
+    iHeartbeatMaxMissed = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_HEARTBEAT_MAX_MISSED, ST_DEFVAL_HEARTBEAT_MAX_MISSED).toInt();
+    iConnectionCount = qMax(SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_CLIENT_CONNECTIONS, ST_DEFVAL_CLIENT_CONNECTIONS).toInt(), 1);
+    bIsConnectionSpreadingEnabled = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_CLIENT_SPREAD_CONNECTIONS, ST_DEFVAL_CLIENT_SPREAD_CONNECTIONS).toBool();
+    iDataQueueMaxBytes = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_QUEUE_MAX_BYTES, ST_DEFVAL_QUEUE_MAX_BYTES).toInt();
+    iDataQueueOverflowPolicy = DataFrameQueue::GetOverflowPolicyByName(SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_QUEUE_OVERFLOW_POLICY, ST_DEFVAL_QUEUE_OVERFLOW_POLICY).toString());
+    iDataQueueBlockTimeout = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_QUEUE_BLOCK_TIMEOUT_MS, ST_DEFVAL_QUEUE_BLOCK_TIMEOUT_MS).toInt();
+    iDataQueueDecimationFactor = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_QUEUE_DECIMATION, ST_DEFVAL_QUEUE_DECIMATION).toInt();
+    iDataQueueHighWatermark = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_QUEUE_HIGH_WATERMARK, ST_DEFVAL_QUEUE_HIGH_WATERMARK).toInt();
+    iDataQueueLowWatermark = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_QUEUE_LOW_WATERMARK, ST_DEFVAL_QUEUE_LOW_WATERMARK).toInt();
     return;
 }
 
 void TCPClient::SaveSettings() const {
-    SettingsContainer.beginGroup(ST_KEY_NETWORKING_PREFIX);
-    SettingsContainer.setValue(ST_KEY_SERVER_IP, sServerIP);
-    SettingsContainer.setValue(ST_KEY_SERVER_PORT, iPort);
-    SettingsContainer.setValue(ST_KEY_IS_AUTORECONN_ON, bIsAutoReconnectEnabled);
-    SettingsContainer.setValue(ST_KEY_AUTORECONN_DELAY_MS, iAutoReconnectDelay);
-    SettingsContainer.sync();
-    SettingsContainer.endGroup();
+    //Only the in-memory settings are updated, the ini file is written later by the setting container
+    QMap<QString, QVariant> mapSettings;
+    mapSettings.insert(ST_KEY_SERVER_IP, sServerIP);
+    mapSettings.insert(ST_KEY_SERVER_PORT, iPort);
+    mapSettings.insert(ST_KEY_IS_AUTORECONN_ON, bIsAutoReconnectEnabled);
+    mapSettings.insert(ST_KEY_AUTORECONN_DELAY_MS, iAutoReconnectDelay);
+    mapSettings.insert(ST_KEY_AUTORECONN_MAX_DELAY_MS, iAutoReconnectMaxDelay);
+    mapSettings.insert(ST_KEY_AUTORECONN_JITTER, iAutoReconnectJitter);
+    mapSettings.insert(ST_KEY_CONNECT_TIMEOUT_MS, iConnectTimeout);
+    mapSettings.insert(ST_KEY_FALLBACK_SERVERS, lstFallbackServers.join(","));
+    mapSettings.insert(ST_KEY_SEND_BATCH_SIZE, iSendBatchSize);
+    mapSettings.insert(ST_KEY_SEND_BATCH_LATENCY_US, iSendBatchMaxLatency);
+    mapSettings.insert(ST_KEY_CLIENT_BINARY_FRAMING, bIsBinaryFramingRequested);
+    mapSettings.insert(ST_KEY_CLIENT_COMPRESSION, bIsCompressionRequested);
+    mapSettings.insert(ST_KEY_COMPRESSION_THRESHOLD, iCompressionThreshold);
+    mapSettings.insert(ST_KEY_COMPRESSION_LEVEL, iCompressionLevel);
+    mapSettings.insert(ST_KEY_HEARTBEAT_INTERVAL_MS, iHeartbeatInterval);
+    mapSettings.insert(ST_KEY_HEARTBEAT_MAX_MISSED, iHeartbeatMaxMissed);
+    mapSettings.insert(ST_KEY_CLIENT_CONNECTIONS, iConnectionCount);
+    mapSettings.insert(ST_KEY_CLIENT_SPREAD_CONNECTIONS, bIsConnectionSpreadingEnabled);
+    mapSettings.insert(ST_KEY_QUEUE_MAX_BYTES, iDataQueueMaxBytes);
+    mapSettings.insert(ST_KEY_QUEUE_OVERFLOW_POLICY, DataFrameQueue::GetOverflowPolicyName(iDataQueueOverflowPolicy));
+    mapSettings.insert(ST_KEY_QUEUE_BLOCK_TIMEOUT_MS, iDataQueueBlockTimeout);
+    mapSettings.insert(ST_KEY_QUEUE_DECIMATION, iDataQueueDecimationFactor);
+    mapSettings.insert(ST_KEY_QUEUE_HIGH_WATERMARK, iDataQueueHighWatermark);
+    mapSettings.insert(ST_KEY_QUEUE_LOW_WATERMARK, iDataQueueLowWatermark);
+    SettingsContainer.SetValues(ST_KEY_NETWORKING_PREFIX, mapSettings);
     return;
 }
 
 /* TCP Socket Object Management */
 bool TCPClient::IsConnected() const {
-    return (tcpDataSender->state() == QTcpSocket::ConnectedState);
+    for (int i = 0; i < iActiveConnectionCount; ++i) {
+        if (tcpDataSenders.at(i)->state() == QTcpSocket::ConnectedState) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int TCPClient::GetLastReconnectTime() const {
+    int iLastReconnectTime = -1;
+    for (int i = 0; i < iActiveConnectionCount; ++i) {
+        iLastReconnectTime = qMax(iLastReconnectTime, tcpDataSenders.at(i)->GetLastReconnectTime());
+    }
+    return iLastReconnectTime;
 }
 
 /* Connection Management */
 void TCPClient::SetServerParameters(const QString sServerIPNew, quint16 iPortNew) {
-    if (TCPClient::IsValidIPAddress(sServerIPNew) && TCPClient::IsValidTCPPort(iPortNew)) {
+    if (TCPClient::IsValidServer(sServerIPNew, iPortNew)) {
         //Save settings
         sServerIP = sServerIPNew;
         iPort = iPortNew;
@@ -322,35 +1096,90 @@ quint16 TCPClient::GetServerPort() const {
 }
 
 void TCPClient::ConnectToServer(bool bWairForOperationToComplete) {
-    emit ConnectToServerRequestedEvent(sServerIP, iPort, bIsAutoReconnectEnabled, iAutoReconnectDelay, bWairForOperationToComplete);
+    //Worker objects are never blocked by waiting, their state machines keep running attempts, timeouts and fallbacks meanwhile
+    //The calling thread waits in a local event loop instead, woken up by every connection health change reported by worker objects
+    QEventLoop evlWaiting;
+    QTimer tmrWaiting;
+    if (bWairForOperationToComplete) {
+        tmrWaiting.setSingleShot(true);
+        connect(&tmrWaiting, SIGNAL(timeout()), &evlWaiting, SLOT(quit()));
+        for (int i = 0; i < iActiveConnectionCount; ++i) {
+            connect(tcpDataSenders.at(i), SIGNAL(SocketConnectionHealthChangedEvent(int, bool, bool)), &evlWaiting, SLOT(quit()), Qt::QueuedConnection);
+        }
+    }
+
+    //Each connection is given its own server and fallback servers
+    TCPClient::ApplyReconnectPolicy();
+    for (int i = 0; i < iActiveConnectionCount; ++i) {
+        QString sConnectionServerIP;
+        quint16 iConnectionPort;
+        QStringList lstConnectionFallbackServers;
+        TCPClient::GetConnectionServers(i, sConnectionServerIP, iConnectionPort, lstConnectionFallbackServers);
+        QMetaObject::invokeMethod(tcpDataSenders.at(i), "ConnectToServerRequestedEventHandler", Qt::QueuedConnection,
+                                  Q_ARG(QString, sConnectionServerIP), Q_ARG(quint16, iConnectionPort),
+                                  Q_ARG(bool, bIsAutoReconnectEnabled), Q_ARG(uint, iAutoReconnectDelay));
+    }
+
+    //Wait until a connection is established, or a connection attempt has had its time
+    if (bWairForOperationToComplete) {
+        tmrWaiting.start(iConnectTimeout);
+        while (!TCPClient::IsConnected() && tmrWaiting.isActive()) {
+            evlWaiting.exec();
+        }
+    }
     return;
 }
 
 void TCPClient::ConnectToServer(const QString sServerIPNew, quint16 iPortNew,
                                 bool bIsAutoReconnectEnabledNew, unsigned int iAutoReconnectDelayNew, bool bWairForOperationToComplete) {
-    //Save settings
-    sServerIP = sServerIPNew;
-    iPort = iPortNew;
+    //Save settings, an invalid server is ignored and the saved one is connected to
+    if (TCPClient::IsValidServer(sServerIPNew, iPortNew, false)) {
+        sServerIP = sServerIPNew;
+        iPort = iPortNew;
+    }
+    else {
+        qDebug() << "TCPClient: Invalid server" << sServerIPNew << ":" << iPortNew << "ignored.";
+    }
     bIsAutoReconnectEnabled = bIsAutoReconnectEnabledNew;
     iAutoReconnectDelay = iAutoReconnectDelayNew;
     TCPClient::SaveSettings();
 
     //Connect
-    emit ConnectToServerRequestedEvent(sServerIP, iPort, bIsAutoReconnectEnabled, iAutoReconnectDelay, bWairForOperationToComplete);
+    TCPClient::ConnectToServer(bWairForOperationToComplete);
     return;
 }
 
 void TCPClient::DisconnectFromServer(bool bWairForOperationToComplete) {
-    emit DisconnectFromServerRequestedEvent(bWairForOperationToComplete);
+    //Worker objects close their sockets without blocking, the calling thread waits in a local event loop as ConnectToServer() does
+    QEventLoop evlWaiting;
+    QTimer tmrWaiting;
+    if (bWairForOperationToComplete) {
+        tmrWaiting.setSingleShot(true);
+        connect(&tmrWaiting, SIGNAL(timeout()), &evlWaiting, SLOT(quit()));
+        for (int i = 0; i < iActiveConnectionCount; ++i) {
+            connect(tcpDataSenders.at(i), SIGNAL(SocketConnectionHealthChangedEvent(int, bool, bool)), &evlWaiting, SLOT(quit()), Qt::QueuedConnection);
+        }
+    }
+    emit DisconnectFromServerRequestedEvent();
+
+    //Wait until every connection has been closed, or the connect timeout has passed
+    if (bWairForOperationToComplete) {
+        tmrWaiting.start(iConnectTimeout);
+        while (TCPClient::GetConnectedConnectionCount() > 0 && tmrWaiting.isActive()) {
+            evlWaiting.exec();
+        }
+    }
     return;
 }
 
 void TCPClient::SendDataToServer() {
     //In high frame rate mode, avoid SendDataToServerRequestedEvent() signal flooding
-    if (tcpDataSender->IsDataSending()) {
-        return;
+    for (int i = 0; i < iActiveConnectionCount; ++i) {
+        if (!tcpDataSenders.at(i)->IsDataSending()) {
+            emit SendDataToServerRequestedEvent();
+            break;
+        }
     }
-    emit SendDataToServerRequestedEvent();
     return;
 }
 
@@ -360,40 +1189,200 @@ void TCPClient::StopDataSending() {
 }
 
 /* Data Frame Queue Management */
-void TCPClient::QueueDataFrame(const QString & sData) {
-    mtxDataFramesPendingSendingLock.lock(); //Begin writing internal buffer
+bool TCPClient::QueueDataFrame(const QString & sData) {
+    return TCPClient::QueueDataFrame(sData.toLatin1()); //Convert QString to ASCII sequence
+}
+
+bool TCPClient::QueueDataFrame(const char * chrData) {
+    return TCPClient::QueueDataFrame(QByteArray(chrData));
+}
+
+bool TCPClient::QueueDataFrame(const QByteArray & baData) {
+    if (iActiveConnectionCount == 1) {
+        return TCPClient::QueueDataFrameToConnection(0, baData);
+    }
 
-    if (queDataFramesPendingSending.size() > NET_DATA_QUEUE_MAX_ITEM_COUNT) {
-        while (!queDataFramesPendingSending.empty()) {
-            delete queDataFramesPendingSending.dequeue();
+    //Round-robin over connected connections, a connection which is down is skipped so that its data frames do not wait for reconnection
+    //If none is connected, data frames are striped over all of them and wait in data queues
+    int iConnectionID = iNextConnection;
+    if (iConnectedConnectionCount > 0) {
+        for (int i = 0; i < iActiveConnectionCount; ++i) {
+            int iCandidateConnectionID = (iNextConnection + i) % iActiveConnectionCount;
+            if (arrIsConnectionConnected.at(iCandidateConnectionID)) {
+                iConnectionID = iCandidateConnectionID;
+                break;
+            }
         }
-        qDebug() << "TCPClient: Data queue has been purged because it has exceeded the size limit.";
     }
+    iNextConnection = (iConnectionID + 1) % iActiveConnectionCount;
+    return TCPClient::QueueDataFrameToConnection(iConnectionID, baData);
+}
+
+bool TCPClient::QueueDataFrame(const QByteArray & baData, uint iStripeKey) {
+    return TCPClient::QueueDataFrameToConnection(static_cast<int>(iStripeKey % static_cast<uint>(iActiveConnectionCount)), baData);
+}
+
+bool TCPClient::QueueDataFrameToConnection(int iConnectionID, const QByteArray & baData) {
+    DataFrameQueue * queDataFrames = queDataFramesPendingSending.at(iConnectionID);
+    if (!queDataFrames->Enqueue(baData)) {
+        if (!bIsDroppingDataFrames) {
+            qDebug() << "TCPClient: Data frame(s) dropped because the data queue has exceeded the size limit.";
+            bIsDroppingDataFrames = true;
+        }
+        return false;
+    }
+    bIsDroppingDataFrames = false;
+
+    //Inform producers that they should throttle themselves, when the first data queue gets congested
+    if (queDataFrames->TryMarkHighWatermarkReached()) {
+        if (iCongestedQueueCount++ == 0) {
+            emit DataQueueHighWatermarkReachedEvent();
+        }
+    }
+
+    //Wake up worker object if it is not woken up yet, avoid SendDataToServerRequestedEventHandler() flooding
+    if (queDataFrames->TryMarkWakeUpPending()) {
+        QMetaObject::invokeMethod(tcpDataSenders.at(iConnectionID), "SendDataToServerRequestedEventHandler", Qt::QueuedConnection);
+    }
+    return true;
+}
+
+int TCPClient::GetDataQueueBytes() const {
+    int iDataQueueBytes = 0;
+    for (int i = 0; i < iActiveConnectionCount; ++i) {
+        iDataQueueBytes += queDataFramesPendingSending.at(i)->BytesQueued();
+    }
+    return iDataQueueBytes;
+}
+
+int TCPClient::GetDroppedDataFrameCount() const {
+    int iDroppedDataFrameCount = 0;
+    for (int i = 0; i < iActiveConnectionCount; ++i) {
+        iDroppedDataFrameCount += queDataFramesPendingSending.at(i)->DroppedCount();
+    }
+    return iDroppedDataFrameCount;
+}
 
-    queDataFramesPendingSending.enqueue(new QString(sData));
+/* Parallel Connections */
+int TCPClient::GetConnectionCount() const {
+    return iActiveConnectionCount;
+}
 
-    mtxDataFramesPendingSendingLock.unlock(); //Don't forget to unlock me!
+int TCPClient::GetConnectedConnectionCount() const {
+    return iConnectedConnectionCount;
+}
 
+bool TCPClient::GetConnectionHealth(int iConnectionID, bool & bIsConnected, int & iConnectCount, int & iErrorCount, int & iDataQueueBytes) const {
+    if (iConnectionID < 0 || iConnectionID >= iActiveConnectionCount) {
+        return false;
+    }
+    bIsConnected = arrIsConnectionConnected.at(iConnectionID);
+    iConnectCount = arrConnectionConnectCounts.at(iConnectionID);
+    iErrorCount = arrConnectionErrorCounts.at(iConnectionID);
+    iDataQueueBytes = queDataFramesPendingSending.at(iConnectionID)->BytesQueued();
+    return true;
+}
+
+/* Metrics */
+QVector<TCPClientConnectionMetrics> TCPClient::GetMetricsSnapshot() const {
+    //Connections are fixed for the lifetime of this object, and every value read here is atomic
+    QVector<TCPClientConnectionMetrics> arrConnectionMetrics(iActiveConnectionCount);
+    for (int i = 0; i < iActiveConnectionCount; ++i) {
+        TCPClientConnectionMetrics & mtrConnection = arrConnectionMetrics[i];
+        const DataFrameQueue * queDataFrames = queDataFramesPendingSending.at(i);
+        mtrConnection.iConnectionID = i;
+        mtrConnection.iDataQueueFrames = queDataFrames->Size();
+        mtrConnection.iDataQueueBytes = queDataFrames->BytesQueued();
+        mtrConnection.iDataQueueHighWaterBytes = queDataFrames->BytesQueuedHighWater();
+        mtrConnection.iFramesDropped = static_cast<quint32>(queDataFrames->DroppedCount());
+        tcpDataSenders.at(i)->GetMetrics(mtrConnection);
+    }
+    return arrConnectionMetrics;
+}
+
+void TCPClient::WriteMetrics(NetworkingMetricsWriter & wrtMetrics) const {
+    QVector<TCPClientConnectionMetrics> arrConnectionMetrics = TCPClient::GetMetricsSnapshot();
+    for (int i = 0; i < arrConnectionMetrics.size(); ++i) {
+        const TCPClientConnectionMetrics & mtrConnection = arrConnectionMetrics.at(i);
+        wrtMetrics.SetLabels(QString("connection=\"%1\"").arg(mtrConnection.iConnectionID));
+        wrtMetrics.WriteValue("net_client_connected", mtrConnection.bIsConnected ? 1 : 0);
+        wrtMetrics.WriteValue("net_client_queue_frames", mtrConnection.iDataQueueFrames);
+        wrtMetrics.WriteValue("net_client_queue_bytes", mtrConnection.iDataQueueBytes);
+        wrtMetrics.WriteValue("net_client_queue_high_water_bytes", mtrConnection.iDataQueueHighWaterBytes);
+        wrtMetrics.WriteValue("net_client_frames_sent_total", mtrConnection.iFramesSent);
+        wrtMetrics.WriteValue("net_client_bytes_sent_total", mtrConnection.iBytesSent);
+        wrtMetrics.WriteValue("net_client_frames_received_total", mtrConnection.iFramesReceived);
+        wrtMetrics.WriteValue("net_client_bytes_received_total", mtrConnection.iBytesReceived);
+        wrtMetrics.WriteValue("net_client_frames_dropped_total", mtrConnection.iFramesDropped);
+        wrtMetrics.WriteValue("net_client_frames_purged_total", mtrConnection.iFramesPurged);
+        wrtMetrics.WriteValue("net_client_frames_lost_total", mtrConnection.iFramesLost);
+        wrtMetrics.WriteValue("net_client_purges_total", mtrConnection.iPurgeCount);
+        wrtMetrics.WriteValue("net_client_connects_total", mtrConnection.iConnectCount);
+        wrtMetrics.WriteValue("net_client_reconnects_total", mtrConnection.iReconnectCount);
+        wrtMetrics.WriteValue("net_client_errors_total", mtrConnection.iErrorCount);
+        wrtMetrics.WriteValue("net_client_send_calls_total", mtrConnection.iSendCallCount);
+        wrtMetrics.WriteValue("net_client_send_time_us_total", mtrConnection.iSendTimeTotal);
+        wrtMetrics.WriteValue("net_client_send_time_us_max", mtrConnection.iSendTimeMax);
+        wrtMetrics.WriteValue("net_client_rtt_us_last", mtrConnection.iRoundTripTimeLast);
+        wrtMetrics.WriteHistogram("net_client_rtt_us", tcpDataSenders.at(i)->GetHeartbeatMonitor().GetRoundTripTimes());
+        wrtMetrics.WriteValue("net_client_pongs_missed_total", mtrConnection.iPongsMissed);
+        wrtMetrics.WriteValue("net_client_dead_peers_total", mtrConnection.iDeadPeerCount);
+    }
     return;
 }
 
 void TCPClient::PurgeDataFrameQueue() {
-    //Wait until all current sending operation is finished
+    //Ask worker objects to stop current sending operations, a running one returns to event loop at its next batch
     emit StopDataSendingRequestedEvent();
-    while (tcpDataSender->IsDataSending()) {
-        ;
-        //QApplication::processEvents();
-    }
 
-    mtxDataFramesPendingSendingLock.lockInline(); //Begin writing internal buffer
+    //Ask worker objects to purge the queue, and wait for them
+    //Queued events are handled in order, thus the purge runs after the stop request, and never in the middle of a sending operation
+    emit PurgeDataFrameQueueRequestedEvent();
+    qDebug() << "TCPClient: Data queue has been purged by user.";
+    return;
+}
 
-    while (!queDataFramesPendingSending.empty()){
-        delete queDataFramesPendingSending.dequeue();
+/* Drain Management */
+bool TCPClient::Flush(int iTimeout) {
+    return TCPClient::WaitForFramesWritten(iTimeout, true);
+}
+
+bool TCPClient::WaitForDrained(int iTimeout) {
+    return TCPClient::WaitForFramesWritten(iTimeout, false);
+}
+
+bool TCPClient::IsDrained() const {
+    for (int i = 0; i < iActiveConnectionCount; ++i) {
+        if (!queDataFramesPendingSending.at(i)->IsDrained()) {
+            return false;
+        }
     }
-    qDebug()<<"TCPClient: Data queue has been purged by user.";
+    return true;
+}
 
-    mtxDataFramesPendingSendingLock.unlockInline(); //Don't forget to unlock me!
-    return;
+bool TCPClient::WaitForFramesWritten(int iTimeout, bool bIsFlushRequired) {
+    //Data frames queued after this point are not waited for
+    QVector<quint32> arrEnqueuedCountTargets(iActiveConnectionCount);
+    for (int i = 0; i < iActiveConnectionCount; ++i) {
+        arrEnqueuedCountTargets[i] = queDataFramesPendingSending.at(i)->EnqueuedCount();
+        if (bIsFlushRequired) {
+            QMetaObject::invokeMethod(tcpDataSenders.at(i), "FlushRequestedEventHandler", Qt::QueuedConnection);
+        }
+    }
+
+    //Worker objects wake us up through the queues' wait conditions, connections share the same timeout
+    QElapsedTimer tmrWaiting;
+    tmrWaiting.start();
+    for (int i = 0; i < iActiveConnectionCount; ++i) {
+        int iTimeRemaining = -1;
+        if (iTimeout >= 0) {
+            iTimeRemaining = qMax(iTimeout - static_cast<int>(tmrWaiting.elapsed()), 0);
+        }
+        if (!queDataFramesPendingSending.at(i)->WaitForFramesWritten(arrEnqueuedCountTargets.at(i), iTimeRemaining)) {
+            return false;
+        }
+    }
+    return true;
 }
 
 /* Options */
@@ -419,15 +1408,293 @@ unsigned int TCPClient::GetAutoReconnectDelay() const {
     return iAutoReconnectDelay;
 }
 
+void TCPClient::SetAutoReconnectBackoff(unsigned int iAutoReconnectMaxDelayNew, int iAutoReconnectJitterNew) {
+    iAutoReconnectMaxDelay = iAutoReconnectMaxDelayNew;
+    iAutoReconnectJitter = qBound(0, iAutoReconnectJitterNew, 100);
+    TCPClient::SaveSettings();
+    TCPClient::ApplyReconnectPolicy();
+    return;
+}
+
+unsigned int TCPClient::GetAutoReconnectMaxDelay() const {
+    return iAutoReconnectMaxDelay;
+}
+
+int TCPClient::GetAutoReconnectJitter() const {
+    return iAutoReconnectJitter;
+}
+
+void TCPClient::SetConnectTimeout(unsigned int iConnectTimeoutNew) {
+    if (iConnectTimeoutNew > 0) {
+        iConnectTimeout = iConnectTimeoutNew;
+        TCPClient::SaveSettings();
+        TCPClient::ApplyReconnectPolicy();
+    }
+    return;
+}
+
+unsigned int TCPClient::GetConnectTimeout() const {
+    return iConnectTimeout;
+}
+
+void TCPClient::SetFallbackServers(const QStringList & lstFallbackServersNew) {
+    lstFallbackServers.clear();
+    for (int i = 0; i < lstFallbackServersNew.size(); ++i) {
+        QString sFallbackServer = lstFallbackServersNew.at(i).trimmed();
+        if (LocalSocketEndpoint::IsLocalEndpoint(sFallbackServer)) {
+            if (TCPClient::IsValidIPAddress(sFallbackServer)) {
+                lstFallbackServers.append(sFallbackServer);
+            }
+            continue;
+        }
+        int iSeparator = sFallbackServer.lastIndexOf(':');
+        if (iSeparator > 0 && TCPClient::IsValidIPAddress(sFallbackServer.left(iSeparator)) && TCPClient::IsValidTCPPort(sFallbackServer.mid(iSeparator + 1).toUShort(), false)) {
+            lstFallbackServers.append(sFallbackServer);
+        }
+    }
+    TCPClient::SaveSettings();
+    TCPClient::ApplyReconnectPolicy();
+    return;
+}
+
+const QStringList & TCPClient::GetFallbackServers() const {
+    return lstFallbackServers;
+}
+
+void TCPClient::SetSendBatchOptions(int iSendBatchSizeNew, unsigned int iSendBatchMaxLatencyNew) {
+    iSendBatchSize = iSendBatchSizeNew;
+    iSendBatchMaxLatency = iSendBatchMaxLatencyNew;
+    TCPClient::SaveSettings();
+    emit SetSendBatchOptionsRequestedEvent(iSendBatchSize, iSendBatchMaxLatency);
+    return;
+}
+
+int TCPClient::GetSendBatchSize() const {
+    return iSendBatchSize;
+}
+
+unsigned int TCPClient::GetSendBatchMaxLatency() const {
+    return iSendBatchMaxLatency;
+}
+
+void TCPClient::SetBinaryFramingMode(bool bIsBinaryFramingRequestedNew) {
+    bIsBinaryFramingRequested = bIsBinaryFramingRequestedNew;
+    TCPClient::SaveSettings();
+    emit SetFramingOptionsRequestedEvent(bIsBinaryFramingRequested);
+    return;
+}
+
+bool TCPClient::GetIsBinaryFramingRequested() const {
+    return bIsBinaryFramingRequested;
+}
+
+void TCPClient::SetCompressionMode(bool bIsCompressionRequestedNew) {
+    bIsCompressionRequested = bIsCompressionRequestedNew;
+    TCPClient::SaveSettings();
+    emit SetCompressionOptionsRequestedEvent(bIsCompressionRequested, iCompressionThreshold, iCompressionLevel);
+    return;
+}
+
+bool TCPClient::GetIsCompressionRequested() const {
+    return bIsCompressionRequested;
+}
+
+void TCPClient::SetCompressionOptions(int iCompressionThresholdNew, int iCompressionLevelNew) {
+    iCompressionThreshold = qMax(iCompressionThresholdNew, 0);
+    iCompressionLevel = qBound(1, iCompressionLevelNew, 9);
+    TCPClient::SaveSettings();
+    emit SetCompressionOptionsRequestedEvent(bIsCompressionRequested, iCompressionThreshold, iCompressionLevel);
+    return;
+}
+
+int TCPClient::GetCompressionThreshold() const {
+    return iCompressionThreshold;
+}
+
+int TCPClient::GetCompressionLevel() const {
+    return iCompressionLevel;
+}
+
+void TCPClient::SetHeartbeatOptions(unsigned int iHeartbeatIntervalNew, int iHeartbeatMaxMissedNew) {
+    iHeartbeatInterval = iHeartbeatIntervalNew;
+    iHeartbeatMaxMissed = qMax(iHeartbeatMaxMissedNew, 1);
+    TCPClient::SaveSettings();
+    emit SetHeartbeatOptionsRequestedEvent(iHeartbeatInterval, iHeartbeatMaxMissed);
+    return;
+}
+
+unsigned int TCPClient::GetHeartbeatInterval() const {
+    return iHeartbeatInterval;
+}
+
+int TCPClient::GetHeartbeatMaxMissed() const {
+    return iHeartbeatMaxMissed;
+}
+
+void TCPClient::SetConnectionCount(int iConnectionCountNew) {
+    if (iConnectionCountNew > 0) {
+        iConnectionCount = iConnectionCountNew;
+        TCPClient::SaveSettings();
+    }
+    return;
+}
+
+int TCPClient::GetConfiguredConnectionCount() const {
+    return iConnectionCount;
+}
+
+void TCPClient::SetConnectionSpreading(bool bIsConnectionSpreadingEnabledNew) {
+    bIsConnectionSpreadingEnabled = bIsConnectionSpreadingEnabledNew;
+    TCPClient::SaveSettings();
+    return;
+}
+
+bool TCPClient::GetIsConnectionSpreadingEnabled() const {
+    return bIsConnectionSpreadingEnabled;
+}
+
+void TCPClient::SetDataQueueOptions(int iDataQueueMaxBytesNew, DataFrameQueue::OverflowPolicy iDataQueueOverflowPolicyNew,
+                                    int iDataQueueBlockTimeoutNew, int iDataQueueDecimationFactorNew) {
+    iDataQueueMaxBytes = iDataQueueMaxBytesNew;
+    iDataQueueOverflowPolicy = iDataQueueOverflowPolicyNew;
+    iDataQueueBlockTimeout = iDataQueueBlockTimeoutNew;
+    iDataQueueDecimationFactor = iDataQueueDecimationFactorNew;
+    TCPClient::SaveSettings();
+    TCPClient::ApplyDataQueueOptions();
+    return;
+}
+
+int TCPClient::GetDataQueueMaxBytes() const {
+    return iDataQueueMaxBytes;
+}
+
+DataFrameQueue::OverflowPolicy TCPClient::GetDataQueueOverflowPolicy() const {
+    return iDataQueueOverflowPolicy;
+}
+
+int TCPClient::GetDataQueueBlockTimeout() const {
+    return iDataQueueBlockTimeout;
+}
+
+int TCPClient::GetDataQueueDecimationFactor() const {
+    return iDataQueueDecimationFactor;
+}
+
+void TCPClient::SetDataQueueWatermarks(int iDataQueueHighWatermarkNew, int iDataQueueLowWatermarkNew) {
+    iDataQueueHighWatermark = iDataQueueHighWatermarkNew;
+    iDataQueueLowWatermark = iDataQueueLowWatermarkNew;
+    TCPClient::SaveSettings();
+    TCPClient::ApplyDataQueueOptions();
+    return;
+}
+
+int TCPClient::GetDataQueueHighWatermark() const {
+    return iDataQueueHighWatermark;
+}
+
+int TCPClient::GetDataQueueLowWatermark() const {
+    return iDataQueueLowWatermark;
+}
+
+void TCPClient::ApplyDataQueueOptions() {
+    //The byte budget is shared by all data queues, so that memory consumption does not grow with the number of connections
+    bIsDroppingDataFrames = false;
+    int iQueueMaxBytes = iDataQueueMaxBytes / iActiveConnectionCount;
+    for (int i = 0; i < iActiveConnectionCount; ++i) {
+        queDataFramesPendingSending.at(i)->SetOverflowOptions(iQueueMaxBytes, iDataQueueOverflowPolicy, iDataQueueBlockTimeout, iDataQueueDecimationFactor,
+                                                              static_cast<int>(static_cast<qint64>(iQueueMaxBytes) * iDataQueueHighWatermark / 100),
+                                                              static_cast<int>(static_cast<qint64>(iQueueMaxBytes) * iDataQueueLowWatermark / 100));
+    }
+    return;
+}
+
+void TCPClient::ApplyReconnectPolicy() {
+    for (int i = 0; i < iActiveConnectionCount; ++i) {
+        QString sConnectionServerIP;
+        quint16 iConnectionPort;
+        QStringList lstConnectionFallbackServers;
+        TCPClient::GetConnectionServers(i, sConnectionServerIP, iConnectionPort, lstConnectionFallbackServers);
+        QMetaObject::invokeMethod(tcpDataSenders.at(i), "SetReconnectPolicyRequestedEventHandler", Qt::QueuedConnection,
+                                  Q_ARG(uint, iAutoReconnectMaxDelay), Q_ARG(int, iAutoReconnectJitter),
+                                  Q_ARG(uint, iConnectTimeout), Q_ARG(QStringList, lstConnectionFallbackServers));
+    }
+    return;
+}
+
+void TCPClient::GetConnectionServers(int iConnectionID, QString & sConnectionServerIP, quint16 & iConnectionPort, QStringList & lstConnectionFallbackServers) const {
+    //Without spreading, all connections use the server and fail over to fallback servers in order
+    //With spreading, connection i starts at server list entry (i mod N), and fails over to the entries after it
+    QStringList lstServers;
+    lstServers.append(LocalSocketEndpoint::IsLocalEndpoint(sServerIP) ? sServerIP : (sServerIP + ":" + QString::number(iPort)));
+    lstServers.append(lstFallbackServers);
+    int iFirstServer = bIsConnectionSpreadingEnabled ? (iConnectionID % lstServers.size()) : 0;
+
+    //Local endpoints have no port
+    const QString & sFirstServer = lstServers.at(iFirstServer);
+    int iSeparator = LocalSocketEndpoint::IsLocalEndpoint(sFirstServer) ? sFirstServer.size() : sFirstServer.lastIndexOf(':');
+    sConnectionServerIP = sFirstServer.left(iSeparator);
+    iConnectionPort = sFirstServer.mid(iSeparator + 1).toUShort();
+    lstConnectionFallbackServers.clear();
+    for (int i = 1; i < lstServers.size(); ++i) {
+        lstConnectionFallbackServers.append(lstServers.at((iFirstServer + i) % lstServers.size()));
+    }
+    return;
+}
+
 /* Worker Object Event Handler */
-void TCPClient::SocketResponseReceivedFromServerEventHandler(QString sResponse, QString sServerName, QString sServerIPAddress, quint16 iServerPort) {
-    qDebug() << "TCPClient: Response" << sResponse << "received from the remote";
-    emit ResponseReceivedFromServerEvent(sResponse, sServerName, sServerIPAddress, iServerPort);
+void TCPClient::SocketResponsesReceivedFromServerEventHandler(QList<QByteArray> lstResponses, QString sServerName, QString sServerIPAddress, quint16 iServerPort) {
+    //Inform upper layers of each response, the QString signal is only decoded if someone is listening to it
+    bool bIsStringResponseRequired = (receivers(SIGNAL(ResponseReceivedFromServerEvent(QString, QString, QString, quint16))) > 0);
+    for (int i = 0; i < lstResponses.size(); ++i) {
+        const QByteArray & baResponse = lstResponses.at(i);
+        qDebug() << "TCPClient: Response" << baResponse << "received from the remote";
+        emit ResponseDataReceivedFromServerEvent(baResponse, sServerName, sServerIPAddress, iServerPort);
+        if (bIsStringResponseRequired) {
+            emit ResponseReceivedFromServerEvent(QString::fromUtf8(baResponse.constData(), baResponse.size()), sServerName, sServerIPAddress, iServerPort);
+        }
+    }
+    return;
+}
+
+void TCPClient::SocketConnectionHealthChangedEventHandler(int iConnectionID, bool bIsConnected, bool bIsErrorOccurred) {
+    if (bIsConnected && !arrIsConnectionConnected.at(iConnectionID)) {
+        arrIsConnectionConnected[iConnectionID] = true;
+        ++arrConnectionConnectCounts[iConnectionID];
+        ++iConnectedConnectionCount;
+    }
+    else if (!bIsConnected && arrIsConnectionConnected.at(iConnectionID)) {
+        arrIsConnectionConnected[iConnectionID] = false;
+        --iConnectedConnectionCount;
+    }
+    if (bIsErrorOccurred) {
+        ++arrConnectionErrorCounts[iConnectionID];
+    }
+    return;
+}
+
+void TCPClient::SocketDataQueueLowWatermarkReachedEventHandler(int iConnectionID) {
+    //Inform producers when the last congested data queue has drained
+    Q_UNUSED(iConnectionID);
+    if (iCongestedQueueCount > 0 && --iCongestedQueueCount == 0) {
+        emit DataQueueLowWatermarkReachedEvent();
+    }
+    return;
+}
+
+void TCPClient::SocketDataQueueDrainedEventHandler(int iConnectionID) {
+    //Inform the upper layer when every data queue has drained, a data frame may have been queued since the worker object reported
+    Q_UNUSED(iConnectionID);
+    if (TCPClient::IsDrained()) {
+        emit DataQueueDrainedEvent();
+    }
     return;
 }
 
 /* Validators */
 bool TCPClient::IsValidIPAddress(const QString sIPAddress) const {
+    if (LocalSocketEndpoint::IsLocalEndpoint(sIPAddress)) {
+        return (sIPAddress.size() > static_cast<int>(sizeof(NET_LOCAL_ENDPOINT_PREFIX) - 1));
+    }
     QHostAddress hstTestAddr;
     return hstTestAddr.setAddress(sIPAddress);
 }
@@ -440,3 +1707,10 @@ bool TCPClient::IsValidTCPPort(quint16 iPort, bool bUseRegisteredPortsOnly) cons
     }
     return ((iPort >= iPortIDMin) && (iPort <= iPortIDMax));
 }
+
+bool TCPClient::IsValidServer(const QString sServerIP, quint16 iPort, bool bUseRegisteredPortsOnly) const {
+    if (LocalSocketEndpoint::IsLocalEndpoint(sServerIP)) {
+        return TCPClient::IsValidIPAddress(sServerIP);
+    }
+    return (TCPClient::IsValidIPAddress(sServerIP) && TCPClient::IsValidTCPPort(iPort, bUseRegisteredPortsOnly));
+}
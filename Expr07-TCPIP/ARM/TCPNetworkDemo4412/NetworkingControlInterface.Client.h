@@ -3,6 +3,10 @@
  *
  * This file is the interface of networking interface (client side).
  * Working as a TCP client, and transfers data to the remote.
+ * The client may open several parallel connections, each one has its own data queue and sender thread. Data frames are striped across them,
+ * round-robin over connected ones by default, or by a key to keep data frames of the same key in order.
+ * A server on the same board may be given as a local endpoint ("unix:/path" or "unix:@name") instead of an IP address, the port is then
+ * ignored and the connection is made over a Unix domain socket, see NetworkingControlInterface.Local.h.
  *
  * This file is a part of DataSourceProvider, but was separated for easier maintainance.
  * For DataFrames' definitions and stream operators, please refer to DataSourceProvider.
@@ -12,70 +16,228 @@
 #ifndef NETWORKINGCONTROLINTERFACE_CLIENT_H
 #define NETWORKINGCONTROLINTERFACE_CLIENT_H
 
-#include <QApplication>
+#include "NetworkingControlInterface.FrameQueue.h"
+#include "NetworkingControlInterface.Framing.h"
+#include "NetworkingControlInterface.Heartbeat.h"
+#include "NetworkingControlInterface.Local.h"
+#include "NetworkingControlInterface.Metrics.h"
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QElapsedTimer>
 #include <QHostAddress>
+#include <QList>
 #include <QMap>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QPair>
 #include <QQueue>
 #include <QReadWriteLock>
 #include <QString>
+#include <QStringList>
 #include <QTcpSocket>
 #include <QThread>
 #include <QTimer>
 #include <QVector>
 
+/* Connection Metrics Snapshot */
+//Counters wrap around at 2^32, see NetworkingControlInterface.Metrics.h
+struct TCPClientConnectionMetrics {
+    int iConnectionID;
+    bool bIsConnected;
+    int iDataQueueFrames; //Gauge, data frames queued
+    int iDataQueueBytes; //Gauge, bytes queued
+    int iDataQueueHighWaterBytes; //Max bytes queued since the connection object was created
+    quint32 iFramesSent; //Data frames taken out of the data queue and written to the socket
+    quint32 iBytesSent; //Bytes written to the socket, after framing and compression
+    quint32 iFramesReceived; //Responses received
+    quint32 iBytesReceived; //Bytes read from the socket
+    quint32 iFramesDropped; //Data frames dropped by the overflow policy
+    quint32 iFramesPurged; //Data frames dropped by PurgeDataFrameQueue()
+    quint32 iFramesLost; //Data frames written to the socket but not confirmed by bytesWritten() when the connection was lost
+    quint32 iPurgeCount; //Number of PurgeDataFrameQueue() calls
+    quint32 iConnectCount; //Number of times the connection has been established
+    quint32 iReconnectCount; //Number of times the connection has been established again after it was lost
+    quint32 iErrorCount; //Socket errors and connection attempt timeouts
+    quint32 iSendCallCount; //Calls of SendDataToServerRequestedEventHandler()
+    quint32 iSendTimeTotal; //Time spent in SendDataToServerRequestedEventHandler(), in microseconds
+    quint32 iSendTimeMax; //Longest single call of SendDataToServerRequestedEventHandler(), in microseconds
+    quint32 iRoundTripTimeCount; //Heartbeats answered
+    quint32 iRoundTripTimeLast; //Heartbeat round-trip times, in microseconds
+    quint32 iRoundTripTimeMax;
+    QVector<quint32> arrRoundTripTimeBuckets; //Heartbeat round-trip time histogram, not cumulative, see NetworkingLatencyHistogram
+    quint32 iPongsMissed; //Heartbeats never answered
+    quint32 iDeadPeerCount; //Number of times the server has been declared dead
+};
+
 /* TCP Networking Data Sending Thread Worker Object */
 //This object is moved to a child thread to have its own event loop
 class TCPClientDataSender : public QTcpSocket {
     Q_OBJECT
 
 public:
-    explicit TCPClientDataSender();
+    /* Connection States */
+    enum ConnectionState {
+        Disconnected = 0, //Not connected and no retry is scheduled
+        Connecting = 1, //A connection attempt is in progress, bounded by the connect timeout
+        Connected = 2,
+        WaitingToReconnect = 3 //Waiting for the backoff delay before next round of connection attempts
+    };
+
+    explicit TCPClientDataSender(DataFrameQueue * queDataFramesPendingSendingInit, int iConnectionIDInit = 0);
     ~TCPClientDataSender();
+    int GetConnectionID() const;
 
     /* Data Sending Status Indicator */
     bool IsDataSending() const;
 
+    /* Reconnect Statistics */
+    int GetLastReconnectTime() const; //Time (in ms) from losing the connection to being connected again, -1 if never reconnected
+
+    /* Metrics */
+    void GetMetrics(TCPClientConnectionMetrics & mtrConnection) const; //Fill in counters owned by this object, thread-safe
+    const HeartbeatMonitor & GetHeartbeatMonitor() const; //Only histogram and counters may be read from other threads
+
 public slots:
     /* Connection Management Command Handlers */
     void ConnectToServerRequestedEventHandler(const QString sServerIPNew, quint16 iPortNew,
-                                              bool bIsAutoReconnectEnabledNew, unsigned int iAutoReconnectDelayNew, bool bWairForOperationToComplete);
-    void DisconnectFromServerRequestedEventHandler(bool bWairForOperationToComplete);
+                                              bool bIsAutoReconnectEnabledNew, unsigned int iAutoReconnectDelayNew);
+    void DisconnectFromServerRequestedEventHandler(); //Never blocks, the socket is closed once its write buffer has been written
     void SetAutoReconnectOptionsRequestedEventHandler(bool bIsAutoReconnectEnabledNew, unsigned int iAutoReconnectDelayNew);
+    void SetReconnectPolicyRequestedEventHandler(unsigned int iAutoReconnectMaxDelayNew, int iAutoReconnectJitterNew,
+                                                 unsigned int iConnectTimeoutNew, QStringList lstFallbackServersNew);
+    void SetSendBatchOptionsRequestedEventHandler(int iSendBatchSizeNew, unsigned int iSendBatchMaxLatencyNew);
+    void SetFramingOptionsRequestedEventHandler(bool bIsBinaryFramingRequestedNew);
+    void SetCompressionOptionsRequestedEventHandler(bool bIsCompressionRequestedNew, int iCompressionThresholdNew, int iCompressionLevelNew);
+    void SetHeartbeatOptionsRequestedEventHandler(unsigned int iHeartbeatIntervalNew, int iHeartbeatMaxMissedNew);
     void SendDataToServerRequestedEventHandler();
+    void FlushRequestedEventHandler(); //Send queued data frames at once, without waiting for batches to fill up
     void StopDataSendingRequestedEventHandler();
+    void PurgeDataFrameQueueRequestedEventHandler();
 
 signals:
     /* Signals to Communicate with Controller */
     void SocketConnectedToServerEvent(QString sServerName, QString sServerIPAddress, quint16 iServerPort);
     void SocketDisconnectedFromServerEvent(QString sServerName, QString sServerIPAddress, quint16 iServerPort);
     void SocketErrorOccurredEvent(QAbstractSocket::SocketError errErrorInfo, QString sServerName, QString sServerIPAddress, quint16 iServerPort);
-    void SocketResponseReceivedFromServerEvent(QString sResponse, QString sServerName, QString sServerIPAddress, quint16 iServerPort);
+    void SocketResponsesReceivedFromServerEvent(QList<QByteArray> lstResponses, QString sServerName, QString sServerIPAddress, quint16 iServerPort);
+    void SocketDataQueueLowWatermarkReachedEvent(int iConnectionID);
+    void SocketDataQueueDrainedEvent(int iConnectionID); //Every data frame queued has been written to the socket, emitted once per burst, not emitted for a burst partly lost with the connection
+    void SocketConnectionHealthChangedEvent(int iConnectionID, bool bIsConnected, bool bIsErrorOccurred); //Informs the controller of connection state changes and errors, for health tracking
 
 private:
-    QString sServerIP; //INTERNAL: Remote IP Address
-    quint16 iPort; //INTERNAL: Remote port
+    DataFrameQueue * queDataFramesPendingSending; //INTERNAL: Queue of data frames pending sending, this object is the only consumer
+    int iConnectionID; //INTERNAL: Index of this connection among TCPClient's parallel connections
+    QString sServerIP; //INTERNAL: Remote IP Address (or local endpoint) of current connection attempt
+    quint16 iPort; //INTERNAL: Remote port of current connection attempt
     bool bIsAutoReconnectEnabled; //INTERNAL: Is auto reconnect function on
     unsigned int iAutoReconnectDelay; //INTERNAL: Auto reconnect retry interval
     bool bIsUserInitiatedDisconnection; //INTERNAL: Marks if user has initiated a disconnection, to avoid unexpected TryReconnect() flooding
-    bool bIsReconnecting; //INTERNAL: Marks if we are alreading waiting a reconnection, to avoid unexpected TryReconnect() flooding
+
+    /* Connection State Machine */
+    //No call blocks the thread, connection attempts are bounded by a timer, and retries are scheduled with a timer
+    ConnectionState iConnectionState; //INTERNAL: Current state
+    QString sPrimaryServerIP; //INTERNAL: Server given by controller, tried first in every round
+    quint16 iPrimaryPort; //INTERNAL: Port of primary server
+    QList<QPair<QString, quint16> > lstFallbackServers; //INTERNAL: Fallback servers, tried in order when the previous one is unreachable
+    int iCurrentServer; //INTERNAL: Index of the server tried in current round, 0 for primary server
+    int iReconnectRound; //INTERNAL: Number of rounds failed since connection lost, the backoff delay is doubled each round
+    unsigned int iAutoReconnectMaxDelay; //INTERNAL: Upper bound of the backoff delay
+    int iAutoReconnectJitter; //INTERNAL: Random deviation of the backoff delay, in percent
+    unsigned int iConnectTimeout; //INTERNAL: Max time (in ms) of a connection attempt
+    QTimer * tmrConnectTimeout; //INTERNAL: Aborts a connection attempt that takes too long
+    QTimer * tmrReconnect; //INTERNAL: Starts next round of connection attempts after the backoff delay
+    bool bIsRandomSeeded; //INTERNAL: Marks if qrand() has been seeded in worker thread
+    bool bIsConnectionLost; //INTERNAL: Marks if we are reconnecting after losing a connection, tmrConnectionLost is valid meanwhile
+    QElapsedTimer tmrConnectionLost; //INTERNAL: Measures time to reconnect
+    QAtomicInt iLastReconnectTime; //INTERNAL: Last time to reconnect in ms, read by controller
+
+    void StartConnectionAttempt(); //INTERNAL: Connect to the server selected by iCurrentServer
+    void ConnectToLocalEndpoint(); //INTERNAL: Connect to the local endpoint in sServerIP, which succeeds or fails at once
+    void HandleConnectionLost(); //INTERNAL: Schedule reconnection after a connection established has been lost
+    void ScheduleReconnect(bool bIsAttemptFailed); //INTERNAL: Try next server immediately, or wait for backoff delay when all servers have failed
+    unsigned int GetReconnectDelay(int iRound); //INTERNAL: Backoff delay of a round, with jitter
     volatile bool bIsDataSending; //INTERNAL: Marks if we are sending data, avoid recursive calling of SendDataToServerRequestedEventHandler() and segmentation faults
     bool bIsDataSendingStopRequested; //INTERNAL: Marks if controller has requested to stop data sending
 
+    /* Drain Tracking */
+    bool bIsFlushRequested; //INTERNAL: Marks if partially filled batches should be sent without waiting, until the data queue is drained
+    bool bIsDrainReported; //INTERNAL: Marks if current drained state has been reported, avoid SocketDataQueueDrainedEvent() flooding
+    bool bIsSocketOutputPending; //INTERNAL: Marks if data frames have been written to the socket and bytesWritten() has not confirmed all of them yet
+
+    void UpdateDrainState(); //INTERNAL: Report data frames written once the batch buffer and the socket's write buffer are empty, or lost if the connection has dropped meanwhile
+
+    /* Send Batch */
+    int iSendBatchSize; //INTERNAL: Byte budget of a batch, queued data frames are coalesced until the budget is reached
+    unsigned int iSendBatchMaxLatency; //INTERNAL: Max time (in microseconds) a data frame may wait for its batch to fill up
+    QByteArray baSendBatchBuffer; //INTERNAL: Preallocated buffer which data frames are encoded into
+    int iSendBatchBufferUsed; //INTERNAL: Bytes used in baSendBatchBuffer
+    QVector<int> arrSendBatchFrameLengths; //INTERNAL: Payload length of each data frame in baSendBatchBuffer
+    NetworkingFramingMode iSendBatchFramingMode; //INTERNAL: Framing mode baSendBatchBuffer has been encoded with
+    QElapsedTimer tmrSendBatchAge; //INTERNAL: Measures how long the oldest data frame of current batch has been waiting
+    QTimer * tmrSendBatchLatency; //INTERNAL: Sends a partially filled batch when its max latency is reached
+
+    void FlushSendBatch(); //INTERNAL: Write current batch to the socket with a single write() call
+    void ReencodeSendBatch(); //INTERNAL: Re-frame a batch kept across a reconnect if the new connection uses another framing mode
+    void WriteFrames(const char * chrFrames, int iFramesLength); //INTERNAL: Write encoded frames to the socket, compressed if negotiated and worthwhile
+
+    /* Framing */
+    bool bIsBinaryFramingRequested; //INTERNAL: Marks if binary framing should be negotiated when connected
+    NetworkingFramingMode iFramingMode; //INTERNAL: Framing mode of current connection
+    bool bIsFramingNegotiating; //INTERNAL: Marks if we are waiting for server's answer to framing request, data sending is paused meanwhile
+    QTimer * tmrFramingNegotiation; //INTERNAL: Falls back to text mode if server does not answer
+    bool bIsFramingNegotiationTimedOut; //INTERNAL: Marks if text mode was chosen without server's answer, a late answer accepting binary mode aborts the connection
+    TextLineDecoder decResponseLineDecoder; //INTERNAL: Reassembles server's response lines in text mode
+    BinaryFrameDecoder decResponseDecoder; //INTERNAL: Decodes server's responses in binary mode
+
+    /* Compression */
+    bool bIsCompressionRequested; //INTERNAL: Marks if compression should be negotiated when connected
+    bool bIsCompressionEnabled; //INTERNAL: Marks if compression has been accepted by server for current connection
+    int iCompressionThreshold; //INTERNAL: Batches smaller than this (in bytes) are sent uncompressed
+    int iCompressionLevel; //INTERNAL: zlib compression level
+    QByteArray baCompressedBatch; //INTERNAL: Reused buffer of compressed batch frame
+
+    void FinishFramingNegotiation(NetworkingFramingMode iFramingModeNew, bool bIsCompressionEnabledNew = false); //INTERNAL: Switch to negotiated framing mode and resume data sending
+
+    /* Heartbeat */
+    HeartbeatMonitor hbmHeartbeat; //INTERNAL: Pings in flight and round-trip times of current connection
+    QTimer * tmrHeartbeat; //INTERNAL: Sends pings and checks for a dead server while connected
+
+    void HandleHeartbeat(HeartbeatMonitor::MessageKind iMessageKind, const QByteArray & baPayload); //INTERNAL: Answer a ping or record a pong
+
+    /* Metrics */
+    //Written by the worker thread only, read by any thread
+    QAtomicInt iIsConnectedMetric; //INTERNAL: 1 while connected
+    NetworkingCounter cntFramesSent; //INTERNAL: Data frames written
+    NetworkingCounter cntBytesSent; //INTERNAL: Bytes written
+    NetworkingCounter cntFramesReceived; //INTERNAL: Responses received
+    NetworkingCounter cntBytesReceived; //INTERNAL: Bytes read
+    NetworkingCounter cntFramesPurged; //INTERNAL: Data frames dropped by purging
+    NetworkingCounter cntFramesLost; //INTERNAL: Data frames lost with the connection
+    NetworkingCounter cntPurges; //INTERNAL: Purge requests handled
+    NetworkingCounter cntConnects; //INTERNAL: Connections established
+    NetworkingCounter cntReconnects; //INTERNAL: Connections established after losing one
+    NetworkingCounter cntErrors; //INTERNAL: Errors and connect timeouts
+    NetworkingCounter cntSendCalls; //INTERNAL: Calls of SendDataToServerRequestedEventHandler()
+    NetworkingCounter cntSendTimeTotal; //INTERNAL: Time spent in SendDataToServerRequestedEventHandler(), in microseconds
+    NetworkingCounter cntSendTimeMax; //INTERNAL: Longest call of SendDataToServerRequestedEventHandler(), in microseconds
+
 private slots:
     /* TCP Socket Event Handler Slots */
     void TCPClientDataSender_Connected();
     void TCPClientDataSender_Disconnected();
     void TCPClientDataSender_Error(QAbstractSocket::SocketError errErrorInfo);
     void TCPClientDataSender_ReadyRead();
+    void TCPClientDataSender_BytesWritten(qint64 iBytesWritten);
 
     /* Functional Slots */
     void TryReconnect();
+    void ConnectTimeoutEventHandler();
+    void FramingNegotiationTimeoutEventHandler();
+    void HeartbeatTimerEventHandler();
 };
 
 /* TCP Networking Client Wrapper */
-class TCPClient : public QObject {
+class TCPClient : public QObject, public NetworkingMetricsSource {
     Q_OBJECT
 
 public:
@@ -89,62 +251,175 @@ public:
     void SaveSettings() const; //Save settings to external ini file
 
     /* TCP Socket Object Management */
-    bool IsConnected() const; //Get if we have connected to a remote server
+    bool IsConnected() const; //Get if we have connected to a remote server, with at least one connection
+    int GetLastReconnectTime() const; //Time (in ms) the last automatic reconnection took, from losing the connection to being connected again, -1 if never reconnected
 
     /* Connection Management */
     void SetServerParameters(const QString sServerIPNew, quint16 iPortNew); //Host information (IP & Port)
     const QString & GetServerIP() const;
     quint16 GetServerPort() const;
-    void ConnectToServer(bool bWairForOperationToComplete = false); //Connect to remote server with saved values
+    void ConnectToServer(bool bWairForOperationToComplete = false); //Connect to remote server with saved values. When waiting, events of the calling thread are processed until a connection is established or the connect timeout has passed
     void ConnectToServer(const QString sServerIPNew, quint16 iPortNew,
                          bool bIsAutoReconnectEnabledNew = false, unsigned int iAutoReconnectDelayNew = 0, bool bWairForOperationToComplete = false); //Connect to remote server with given address and port. Will update options saved in ini file
-    void DisconnectFromServer(bool bWairForOperationToComplete = false); //Disconnect
+    void DisconnectFromServer(bool bWairForOperationToComplete = false); //Disconnect. When waiting, events of the calling thread are processed until every connection is closed or the connect timeout has passed
     void SendDataToServer();
     void StopDataSending();
-    void PurgeDataFrameQueue(); //Force to purge DataFrameQueue
+    void PurgeDataFrameQueue(); //Force to purge DataFrameQueue, waits until worker objects have done it
+
+    /* Drain Management */
+    //Both functions block the calling thread on a wait condition, and must not be called from worker threads
+    //Data frames which are dropped or purged count as written, data frames waiting for a connection do not
+    bool Flush(int iTimeout = -1); //Send partially filled batches at once, and wait until every data frame queued so far has been written to the socket. Timeout in ms, -1 for none. Returns false on timeout, or if a connection dropped with data frames unsent meanwhile
+    bool WaitForDrained(int iTimeout = -1); //Same as above, but batches are sent as usual (with their max latency)
+    bool IsDrained() const; //Returns true if every data frame queued has been written to the socket
 
     /* Data Frame Queue Management */
-    void QueueDataFrame(const QString & sData); //Queue a data frame
+    //Data frames are sent automatically, the sender thread is woken up when the queue becomes non-empty
+    //QueueDataFrame() must always be called from the same thread (normally the thread owns this object)
+    bool QueueDataFrame(const QString & sData); //Queue a data frame, returns false if the frame is dropped by the overflow policy
+    bool QueueDataFrame(const QByteArray & baData); //Same as above, the buffer is implicitly shared with the socket without transcoding or copying
+    bool QueueDataFrame(const char * chrData); //Same as above, for string literals
+    bool QueueDataFrame(const QByteArray & baData, uint iStripeKey); //Same as above, data frames with the same key are sent in order over the same connection
+    int GetDataQueueBytes() const; //Bytes currently queued
+    int GetDroppedDataFrameCount() const; //Number of data frames dropped by the overflow policy
+
+    /* Parallel Connections */
+    int GetConnectionCount() const; //Number of parallel connections of this object
+    int GetConnectedConnectionCount() const;
+    bool GetConnectionHealth(int iConnectionID, bool & bIsConnected, int & iConnectCount, int & iErrorCount, int & iDataQueueBytes) const; //Returns false if there is no such connection
+
+    /* Metrics */
+    //Snapshots may be taken from any thread, they are also written as text by the stats command of TCPServer
+    QVector<TCPClientConnectionMetrics> GetMetricsSnapshot() const; //Metrics of each connection, indexed by connection ID
+    void WriteMetrics(NetworkingMetricsWriter & wrtMetrics) const; //Reimplemented from NetworkingMetricsSource
 
     /* Options */
     void SetAutoReconnectMode(bool bIsAutoReconnectEnabledNew); //Set & Get auto reconnect function (handles error events)
     bool GetIsAutoReconnectEnabled() const;
     void SetAutoReconnectDelay(unsigned int iAutoReconnectDelayNew); //Set & Get auto reconnect retry interval
     unsigned int GetAutoReconnectDelay() const;
+    void SetAutoReconnectBackoff(unsigned int iAutoReconnectMaxDelayNew, int iAutoReconnectJitterNew); //Set & Get upper bound of the doubled retry interval and its random deviation (in percent)
+    unsigned int GetAutoReconnectMaxDelay() const;
+    int GetAutoReconnectJitter() const;
+    void SetConnectTimeout(unsigned int iConnectTimeoutNew); //Set & Get max time (in ms) of a connection attempt
+    unsigned int GetConnectTimeout() const;
+    void SetFallbackServers(const QStringList & lstFallbackServersNew); //Set & Get ordered list of "IP:Port" (or local endpoint) fallback servers, tried when the server is unreachable. Invalid entries are ignored
+    const QStringList & GetFallbackServers() const;
+    void SetConnectionCount(int iConnectionCountNew); //Set & Get number of parallel connections, takes effect when the client object is created next time
+    int GetConfiguredConnectionCount() const;
+    void SetConnectionSpreading(bool bIsConnectionSpreadingEnabledNew); //Set & Get if parallel connections are spread across server and fallback servers instead of all connecting to the server, takes effect on next ConnectToServer()
+    bool GetIsConnectionSpreadingEnabled() const;
+    void SetSendBatchOptions(int iSendBatchSizeNew, unsigned int iSendBatchMaxLatencyNew); //Set & Get batched sending options, byte budget of a batch and max latency (in microseconds) of a data frame
+    int GetSendBatchSize() const;
+    unsigned int GetSendBatchMaxLatency() const;
+    void SetBinaryFramingMode(bool bIsBinaryFramingRequestedNew); //Set & Get if binary framing is requested when connected, server may reject it and text framing will be used
+    bool GetIsBinaryFramingRequested() const;
+    void SetCompressionMode(bool bIsCompressionRequestedNew); //Set & Get if compression (and binary framing) is requested when connected, takes effect on next connection
+    bool GetIsCompressionRequested() const;
+    void SetCompressionOptions(int iCompressionThresholdNew, int iCompressionLevelNew); //Set & Get smallest batch (in bytes) which is compressed, and zlib level (1-9)
+    int GetCompressionThreshold() const;
+    int GetCompressionLevel() const;
+    void SetHeartbeatOptions(unsigned int iHeartbeatIntervalNew, int iHeartbeatMaxMissedNew); //Set & Get heartbeat ping interval (in ms, 0 to disable) and number of unanswered pings after which the server is declared dead and the connection is closed
+    unsigned int GetHeartbeatInterval() const;
+    int GetHeartbeatMaxMissed() const;
+    void SetDataQueueOptions(int iDataQueueMaxBytesNew, DataFrameQueue::OverflowPolicy iDataQueueOverflowPolicyNew,
+                             int iDataQueueBlockTimeoutNew, int iDataQueueDecimationFactorNew); //Set & Get data queue's byte budget, overflow policy, producer block timeout (in ms) and decimation factor
+    int GetDataQueueMaxBytes() const;
+    DataFrameQueue::OverflowPolicy GetDataQueueOverflowPolicy() const;
+    int GetDataQueueBlockTimeout() const;
+    int GetDataQueueDecimationFactor() const;
+    void SetDataQueueWatermarks(int iDataQueueHighWatermarkNew, int iDataQueueLowWatermarkNew); //Set & Get data queue's high/low watermarks, in percent of the byte budget
+    int GetDataQueueHighWatermark() const;
+    int GetDataQueueLowWatermark() const;
 
     /* Validators */
-    bool IsValidIPAddress(const QString sIPAddress) const; //Check if the given address is valid
+    bool IsValidIPAddress(const QString sIPAddress) const; //Check if the given address is valid, local endpoints are accepted too
     bool IsValidTCPPort(quint16 iPort, bool bUseRegisteredPortsOnly = true) const; //Check if the given port ID is valid (typically in the range of [1,65535], or [1024,32767] if bUseRegisteredPortsOnly is true)
+    bool IsValidServer(const QString sServerIP, quint16 iPort, bool bUseRegisteredPortsOnly = true) const; //Check if the given server is valid, the port of a local endpoint is ignored
 
 public slots:
     /* Worker Object Event Handler */
-    void SocketResponseReceivedFromServerEventHandler(QString sResponse, QString sServerName, QString sServerIPAddress, quint16 iServerPort);
+    void SocketResponsesReceivedFromServerEventHandler(QList<QByteArray> lstResponses, QString sServerName, QString sServerIPAddress, quint16 iServerPort);
+    void SocketConnectionHealthChangedEventHandler(int iConnectionID, bool bIsConnected, bool bIsErrorOccurred);
+    void SocketDataQueueLowWatermarkReachedEventHandler(int iConnectionID);
+    void SocketDataQueueDrainedEventHandler(int iConnectionID);
 
 signals:
-    /* Signals to Communicate with Worker Object */
-    void ConnectToServerRequestedEvent(const QString sServerIPNew, quint16 iPortNew,
-                                       bool bIsAutoReconnectEnabledNew, unsigned int iAutoReconnectDelayNew, bool bWairForOperationToComplete);
-    void DisconnectFromServerRequestedEvent(bool bWairForOperationToComplete);
+    /* Signals to Communicate with Worker Objects */
+    //Requests that differ between connections (server, fallback servers, wake-ups) are posted to each worker object with QMetaObject::invokeMethod()
+    void DisconnectFromServerRequestedEvent();
     void SetAutoReconnectOptionsRequestedEvent(bool bIsAutoReconnectEnabledNew, unsigned int iAutoReconnectDelayNew);
+    void SetSendBatchOptionsRequestedEvent(int iSendBatchSizeNew, unsigned int iSendBatchMaxLatencyNew);
+    void SetFramingOptionsRequestedEvent(bool bIsBinaryFramingRequestedNew);
+    void SetCompressionOptionsRequestedEvent(bool bIsCompressionRequestedNew, int iCompressionThresholdNew, int iCompressionLevelNew);
+    void SetHeartbeatOptionsRequestedEvent(unsigned int iHeartbeatIntervalNew, int iHeartbeatMaxMissedNew);
     void SendDataToServerRequestedEvent();
     void StopDataSendingRequestedEvent();
+    void PurgeDataFrameQueueRequestedEvent();
 
     /* Signals to Communicate with Upper Layer */
-    void ResponseReceivedFromServerEvent(QString sResponse, QString sServerName, QString sServerIPAddress, quint16 iServerPort);
+    void ResponseReceivedFromServerEvent(QString sResponse, QString sServerName, QString sServerIPAddress, quint16 iServerPort); //Only decoded when connected
+    void ResponseDataReceivedFromServerEvent(QByteArray baResponse, QString sServerName, QString sServerIPAddress, quint16 iServerPort); //Raw bytes of a response
     void ConnectedToServerEvent(QString sServerName, QString sServerIPAddress, quint16 iServerPort);
     void DisconnectedFromServerEvent(QString sServerName, QString sServerIPAddress, quint16 iServerPort);
     void NetworkingErrorOccurredEvent(QAbstractSocket::SocketError errErrorInfo, QString sServerName, QString sServerIPAddress, quint16 iServerPort);
+    void DataQueueHighWatermarkReachedEvent(); //Data queue is filling up, producers should throttle themselves
+    void DataQueueLowWatermarkReachedEvent(); //Data queue has drained after reaching the high watermark, producers may resume
+    void DataQueueDrainedEvent(); //Every data frame queued on every connection has been written to the socket
 
 private:
     /* Threads & Worker Objects */
-    QThread * trdTCPDataSenderThread; //Thread which is used to host and control worker thread
-    TCPClientDataSender * tcpDataSender; //Worker object
+    //One thread, worker object and data queue per connection, indexed by connection ID
+    int iActiveConnectionCount; //Number of connections created, fixed for the lifetime of this object
+    QVector<QThread *> trdTCPDataSenderThreads; //Threads which are used to host and control worker objects
+    QVector<TCPClientDataSender *> tcpDataSenders; //Worker objects
+
+    /* Data Queues */
+    QVector<DataFrameQueue *> queDataFramesPendingSending; //Queues of data frames pending sending, this object is the only producer of each
+
+    /* Connection Health */
+    QVector<bool> arrIsConnectionConnected; //INTERNAL: Connection state reported by each worker object
+    QVector<int> arrConnectionConnectCounts; //INTERNAL: Number of times each connection has been established
+    QVector<int> arrConnectionErrorCounts; //INTERNAL: Number of errors of each connection
+    int iConnectedConnectionCount; //INTERNAL: Number of connections connected
+    int iNextConnection; //INTERNAL: Next connection of round-robin striping
+    int iCongestedQueueCount; //INTERNAL: Number of data queues above their high watermark
+
+    void CreateConnections(); //INTERNAL: Create data queues, worker objects and threads
+    void DestroyConnections(); //INTERNAL: Stop threads and delete worker objects and data queues
+    bool QueueDataFrameToConnection(int iConnectionID, const QByteArray & baData); //INTERNAL: Queue a data frame to the data queue of a connection
+    void ApplyReconnectPolicy(); //INTERNAL: Pass reconnect options and fallback servers to worker objects
+    void GetConnectionServers(int iConnectionID, QString & sConnectionServerIP, quint16 & iConnectionPort, QStringList & lstConnectionFallbackServers) const; //INTERNAL: Server and fallback servers of a connection
+    bool WaitForFramesWritten(int iTimeout, bool bIsFlushRequired); //INTERNAL: Wait until data frames queued so far have been written on every connection
 
     /* Options Var */
     QString sServerIP; //INTERNAL: Remote IP Address
     quint16 iPort; //INTERNAL: Remote port
     bool bIsAutoReconnectEnabled; //INTERNAL: Is auto reconnect function on
     unsigned int iAutoReconnectDelay; //INTERNAL: Auto reconnect retry interval
+    unsigned int iAutoReconnectMaxDelay; //INTERNAL: Upper bound of the doubled retry interval
+    int iAutoReconnectJitter; //INTERNAL: Random deviation of the retry interval, in percent
+    unsigned int iConnectTimeout; //INTERNAL: Max time (in ms) of a connection attempt
+    QStringList lstFallbackServers; //INTERNAL: "IP:Port" fallback servers
+    int iConnectionCount; //INTERNAL: Number of parallel connections saved in ini file
+    bool bIsConnectionSpreadingEnabled; //INTERNAL: Spread parallel connections across servers
+    int iSendBatchSize; //INTERNAL: Byte budget of a batch
+    unsigned int iSendBatchMaxLatency; //INTERNAL: Max time (in microseconds) a data frame may wait for its batch to fill up
+    bool bIsBinaryFramingRequested; //INTERNAL: Is binary framing requested
+    bool bIsCompressionRequested; //INTERNAL: Is compression requested
+    int iCompressionThreshold; //INTERNAL: Smallest batch which is compressed, in bytes
+    int iCompressionLevel; //INTERNAL: zlib compression level
+    unsigned int iHeartbeatInterval; //INTERNAL: Heartbeat ping interval in ms, 0 if disabled
+    int iHeartbeatMaxMissed; //INTERNAL: Unanswered pings before the server is declared dead
+    int iDataQueueMaxBytes; //INTERNAL: Byte budget of data queue
+    DataFrameQueue::OverflowPolicy iDataQueueOverflowPolicy; //INTERNAL: What to do when a data frame does not fit in the budget
+    int iDataQueueBlockTimeout; //INTERNAL: Max time (in ms) QueueDataFrame() may block
+    int iDataQueueDecimationFactor; //INTERNAL: 1 of every N data frames is queued above the high watermark
+    int iDataQueueHighWatermark; //INTERNAL: High watermark, in percent of the byte budget
+    int iDataQueueLowWatermark; //INTERNAL: Low watermark, in percent of the byte budget
+    bool bIsDroppingDataFrames; //INTERNAL: Marks if the last data frame was dropped, to avoid debug message flooding
+
+    void ApplyDataQueueOptions(); //INTERNAL: Pass options to data queues, the byte budget is shared by all connections
 };
 
 /* TCP Client */
@@ -0,0 +1,423 @@
+#include "NetworkingControlInterface.Commands.h"
+#include "NetworkingControlInterface.Metrics.h"
+#include "SettingsProvider.h"
+#include <QMutexLocker>
+#include <QReadLocker>
+#include <QRunnable>
+#include <QThread>
+#include <QWriteLocker>
+#include <climits>
+#include <cstring>
+
+/* Command Arguments */
+NetworkingCommandArguments::NetworkingCommandArguments(const QByteArray & baCommandInit) {
+    baCommand = baCommandInit;
+
+    //Save bounds of tokens separated by spaces or tabs, a trailing '\r' of a "\r\n" line is ignored
+    const char * chrCommand = baCommand.constData();
+    int iCommandLength = baCommand.size();
+    if (iCommandLength > 0 && chrCommand[iCommandLength - 1] == '\r') {
+        --iCommandLength;
+    }
+    int iPosition = 0;
+    while (iPosition < iCommandLength) {
+        while (iPosition < iCommandLength && (chrCommand[iPosition] == ' ' || chrCommand[iPosition] == '\t')) {
+            ++iPosition;
+        }
+        if (iPosition >= iCommandLength) {
+            break;
+        }
+        int iTokenStart = iPosition;
+        while (iPosition < iCommandLength && chrCommand[iPosition] != ' ' && chrCommand[iPosition] != '\t') {
+            ++iPosition;
+        }
+        arrTokenBounds.append(iTokenStart);
+        arrTokenBounds.append(iPosition);
+    }
+}
+
+const QByteArray & NetworkingCommandArguments::GetCommand() const {
+    return baCommand;
+}
+
+QByteArray NetworkingCommandArguments::GetVerb() const {
+    int iTokenStart = 0, iTokenEnd = 0;
+    if (!NetworkingCommandArguments::GetTokenBounds(0, iTokenStart, iTokenEnd)) {
+        return QByteArray();
+    }
+    return baCommand.mid(iTokenStart, iTokenEnd - iTokenStart);
+}
+
+int NetworkingCommandArguments::Count() const {
+    return qMax(arrTokenBounds.size() / 2 - 1, 0);
+}
+
+QByteArray NetworkingCommandArguments::At(int iIndex) const {
+    int iTokenStart = 0, iTokenEnd = 0;
+    if (iIndex < 0 || !NetworkingCommandArguments::GetTokenBounds(iIndex + 1, iTokenStart, iTokenEnd)) {
+        return QByteArray();
+    }
+    return baCommand.mid(iTokenStart, iTokenEnd - iTokenStart);
+}
+
+QByteArray NetworkingCommandArguments::GetRemainder(int iIndex) const {
+    int iTokenStart = 0, iTokenEnd = 0, iLastTokenStart = 0, iLastTokenEnd = 0;
+    if (iIndex < 0 || !NetworkingCommandArguments::GetTokenBounds(iIndex + 1, iTokenStart, iTokenEnd)) {
+        return QByteArray();
+    }
+    NetworkingCommandArguments::GetTokenBounds(arrTokenBounds.size() / 2 - 1, iLastTokenStart, iLastTokenEnd);
+    return baCommand.mid(iTokenStart, iLastTokenEnd - iTokenStart);
+}
+
+bool NetworkingCommandArguments::Equals(int iIndex, const char * chrValue) const {
+    int iTokenStart = 0, iTokenEnd = 0;
+    if (iIndex < 0 || !NetworkingCommandArguments::GetTokenBounds(iIndex + 1, iTokenStart, iTokenEnd)) {
+        return false;
+    }
+    int iValueLength = static_cast<int>(strlen(chrValue));
+    return (iValueLength == iTokenEnd - iTokenStart && memcmp(baCommand.constData() + iTokenStart, chrValue, iValueLength) == 0);
+}
+
+int NetworkingCommandArguments::ToInt(int iIndex, bool * bIsValid) const {
+    int iTokenStart = 0, iTokenEnd = 0;
+    if (iIndex < 0 || !NetworkingCommandArguments::GetTokenBounds(iIndex + 1, iTokenStart, iTokenEnd)) {
+        if (bIsValid) {
+            *bIsValid = false;
+        }
+        return 0;
+    }
+
+    //Decimal digits with an optional sign, parsed in place (QByteArray::toInt() copies even a raw data wrapper to terminate it)
+    const char * chrToken = baCommand.constData() + iTokenStart;
+    int iTokenLength = iTokenEnd - iTokenStart;
+    bool bIsNegative = (iTokenLength > 0 && chrToken[0] == '-');
+    int iDigitStart = (iTokenLength > 0 && (chrToken[0] == '-' || chrToken[0] == '+')) ? 1 : 0;
+    qint64 iValue = 0;
+    bool bIsValidValue = (iDigitStart < iTokenLength);
+    for (int i = iDigitStart; i < iTokenLength && bIsValidValue; ++i) {
+        if (chrToken[i] < '0' || chrToken[i] > '9') {
+            bIsValidValue = false;
+            break;
+        }
+        iValue = iValue * 10 + (chrToken[i] - '0');
+        bIsValidValue = (iValue <= static_cast<qint64>(INT_MAX) + (bIsNegative ? 1 : 0));
+    }
+    if (bIsValid) {
+        *bIsValid = bIsValidValue;
+    }
+    if (!bIsValidValue) {
+        return 0;
+    }
+    return static_cast<int>(bIsNegative ? -iValue : iValue);
+}
+
+double NetworkingCommandArguments::ToDouble(int iIndex, bool * bIsValid) const {
+    int iTokenStart = 0, iTokenEnd = 0;
+    if (iIndex < 0 || !NetworkingCommandArguments::GetTokenBounds(iIndex + 1, iTokenStart, iTokenEnd)) {
+        if (bIsValid) {
+            *bIsValid = false;
+        }
+        return 0;
+    }
+
+    //QByteArray::toDouble() copies the token to terminate it, strtod() would parse in place but depends on the locale
+    return QByteArray::fromRawData(baCommand.constData() + iTokenStart, iTokenEnd - iTokenStart).toDouble(bIsValid);
+}
+
+bool NetworkingCommandArguments::GetTokenBounds(int iToken, int & iTokenStart, int & iTokenEnd) const {
+    if (iToken < 0 || iToken * 2 + 1 >= arrTokenBounds.size()) {
+        return false;
+    }
+    iTokenStart = arrTokenBounds.at(iToken * 2);
+    iTokenEnd = arrTokenBounds.at(iToken * 2 + 1);
+    return true;
+}
+
+/* Command Reply */
+NetworkingCommandReply::NetworkingCommandReply(int iClientIDInit) {
+    iClientID = iClientIDInit;
+}
+
+int NetworkingCommandReply::GetClientID() const {
+    return iClientID;
+}
+
+void NetworkingCommandReply::Append(const QByteArray & baReply) {
+    lstReplies.append(baReply);
+    return;
+}
+
+const QList<QByteArray> & NetworkingCommandReply::GetReplies() const {
+    return lstReplies;
+}
+
+/* Built-In Handlers */
+//Stats command, answered in the command executor so that scraping never waits for the thread owns the server object
+class NetworkingStatsCommandHandler : public NetworkingCommandHandler {
+public:
+    void ExecuteCommand(const NetworkingCommandArguments & argCommand, NetworkingCommandReply & rplCommand) {
+        Q_UNUSED(argCommand);
+        QByteArray baStats = NetworkingMetrics::WriteAll();
+        baStats.append(NET_STATS_REPLY_END);
+        rplCommand.Append(baStats);
+        return;
+    }
+};
+
+static NetworkingStatsCommandHandler hdlStatsCommand;
+
+/* Command Table */
+NetworkingCommandTable::NetworkingCommandTable() {
+    NetworkingCommandTable::RegisterHandler(NET_STATS_REQUEST, &hdlStatsCommand);
+}
+
+bool NetworkingCommandTable::RegisterHandler(const QByteArray & baVerb, NetworkingCommandHandler * hdlCommand) {
+    QWriteLocker lckHandlers(&rwlHandlers);
+    if (baVerb.isEmpty() || !hdlCommand || hshHandlers.contains(baVerb)) {
+        return false;
+    }
+    hshHandlers.insert(baVerb, hdlCommand);
+    return true;
+}
+
+void NetworkingCommandTable::UnregisterHandler(const QByteArray & baVerb) {
+    QWriteLocker lckHandlers(&rwlHandlers);
+    hshHandlers.remove(baVerb);
+    return;
+}
+
+QList<QByteArray> NetworkingCommandTable::GetVerbs() const {
+    QReadLocker lckHandlers(&rwlHandlers);
+    return hshHandlers.keys();
+}
+
+bool NetworkingCommandTable::HasHandler(const QByteArray & baCommand) const {
+    //Most commands (and data frames) are rejected here without being tokenized or copied
+    QByteArray baVerb = NetworkingCommandTable::PeekVerb(baCommand);
+    if (baVerb.isEmpty()) {
+        return false;
+    }
+    QReadLocker lckHandlers(&rwlHandlers);
+    return hshHandlers.contains(baVerb);
+}
+
+bool NetworkingCommandTable::Execute(const QByteArray & baCommand, NetworkingCommandReply & rplCommand) const {
+    QByteArray baVerb = NetworkingCommandTable::PeekVerb(baCommand);
+    if (baVerb.isEmpty()) {
+        return false;
+    }
+
+    //Handlers are kept alive while they are executed
+    QReadLocker lckHandlers(&rwlHandlers);
+    NetworkingCommandHandler * hdlCommand = hshHandlers.value(baVerb, NULL);
+    if (!hdlCommand) {
+        return false;
+    }
+    hdlCommand->ExecuteCommand(NetworkingCommandArguments(baCommand), rplCommand);
+    return true;
+}
+
+QByteArray NetworkingCommandTable::PeekVerb(const QByteArray & baCommand) {
+    const char * chrCommand = baCommand.constData();
+    int iCommandLength = baCommand.size();
+    int iVerbStart = 0;
+    while (iVerbStart < iCommandLength && (chrCommand[iVerbStart] == ' ' || chrCommand[iVerbStart] == '\t')) {
+        ++iVerbStart;
+    }
+    int iVerbEnd = iVerbStart;
+    while (iVerbEnd < iCommandLength && chrCommand[iVerbEnd] != ' ' && chrCommand[iVerbEnd] != '\t' && chrCommand[iVerbEnd] != '\r') {
+        ++iVerbEnd;
+    }
+    if (iVerbEnd == iVerbStart) {
+        return QByteArray();
+    }
+    return QByteArray::fromRawData(chrCommand + iVerbStart, iVerbEnd - iVerbStart);
+}
+
+/* Command Executor */
+//Times of a verb
+struct NetworkingCommandStats {
+    NetworkingLatencyHistogram histWaitTimes; //Time from queuing to start of execution, in microseconds
+    NetworkingLatencyHistogram histExecutionTimes; //Time spent in the handler, in microseconds
+};
+
+//Pool task of a client, deleted by the pool when it returns
+class NetworkingCommandTask : public QRunnable {
+public:
+    NetworkingCommandTask(NetworkingCommandExecutor * excCommandsInit, int iClientIDInit) {
+        excCommands = excCommandsInit;
+        iClientID = iClientIDInit;
+    }
+
+    void run() {
+        excCommands->RunClientCommands(iClientID);
+        return;
+    }
+
+private:
+    NetworkingCommandExecutor * excCommands;
+    int iClientID;
+};
+
+NetworkingCommandExecutor::NetworkingCommandExecutor(const NetworkingCommandTable * tblCommandsInit, NetworkingCommandReplySink * snkRepliesInit) {
+    //Initialize internal variables
+    tblCommands = tblCommandsInit;
+    snkReplies = snkRepliesInit;
+    iClientQueueLimit = ST_DEFVAL_SERVER_COMMAND_CLIENT_QUEUE;
+    iQueueLimit = ST_DEFVAL_SERVER_COMMAND_QUEUE;
+    iQueuedCommandCount = 0;
+    tmrClock.start();
+    trpCommands.setMaxThreadCount(qMax(QThread::idealThreadCount(), 1));
+}
+
+NetworkingCommandExecutor::~NetworkingCommandExecutor() {
+    //Drop commands waiting, pool tasks find their queues empty and finish
+    QMutexLocker lckClientQueues(&mtxClientQueues);
+    for (QHash<int, QQueue<QPair<QByteArray, qint64> > >::iterator itClientQueue = hshClientQueues.begin(); itClientQueue != hshClientQueues.end(); ++itClientQueue) {
+        cntDroppedCommands.Add(itClientQueue.value().size());
+        itClientQueue.value().clear();
+    }
+    iQueuedCommandCount = 0;
+    lckClientQueues.unlock();
+
+    //Wait for running commands, their replies may still be delivered
+    trpCommands.waitForDone();
+    qDeleteAll(hshCommandStats);
+}
+
+void NetworkingCommandExecutor::SetOptions(int iThreadCountNew, int iClientQueueLimitNew, int iQueueLimitNew) {
+    QMutexLocker lckClientQueues(&mtxClientQueues);
+    iClientQueueLimit = qMax(iClientQueueLimitNew, 1);
+    iQueueLimit = qMax(iQueueLimitNew, 1);
+    lckClientQueues.unlock();
+
+    //A smaller pool takes effect as running tasks finish
+    trpCommands.setMaxThreadCount((iThreadCountNew < 1) ? qMax(QThread::idealThreadCount(), 1) : iThreadCountNew);
+    return;
+}
+
+NetworkingCommandExecutor::SubmitResult NetworkingCommandExecutor::Submit(int iClientID, const QByteArray & baCommand) {
+    if (!tblCommands->HasHandler(baCommand)) {
+        return NotHandled;
+    }
+
+    QMutexLocker lckClientQueues(&mtxClientQueues);
+    QHash<int, QQueue<QPair<QByteArray, qint64> > >::iterator itClientQueue = hshClientQueues.find(iClientID);
+    int iClientQueuedCount = (itClientQueue == hshClientQueues.end()) ? 0 : itClientQueue.value().size();
+    if (iClientQueuedCount >= iClientQueueLimit || iQueuedCommandCount >= iQueueLimit) {
+        return Rejected;
+    }
+
+    //The client's pool task is scheduled with its first command, later commands are picked up by the same task
+    if (itClientQueue == hshClientQueues.end()) {
+        itClientQueue = hshClientQueues.insert(iClientID, QQueue<QPair<QByteArray, qint64> >());
+        trpCommands.start(new NetworkingCommandTask(this, iClientID));
+    }
+    itClientQueue.value().enqueue(qMakePair(baCommand, tmrClock.nsecsElapsed()));
+    ++iQueuedCommandCount;
+    cntQueueHighWater.SetMax(iQueuedCommandCount);
+    return Queued;
+}
+
+void NetworkingCommandExecutor::RemoveClient(int iClientID) {
+    //The queue itself is removed by the client's pool task, which is the only one knowing when it has finished
+    QMutexLocker lckClientQueues(&mtxClientQueues);
+    QHash<int, QQueue<QPair<QByteArray, qint64> > >::iterator itClientQueue = hshClientQueues.find(iClientID);
+    if (itClientQueue == hshClientQueues.end()) {
+        return;
+    }
+    cntDroppedCommands.Add(itClientQueue.value().size());
+    iQueuedCommandCount -= itClientQueue.value().size();
+    itClientQueue.value().clear();
+    return;
+}
+
+void NetworkingCommandExecutor::RunClientCommands(int iClientID) {
+    for (int i = 0; i < NET_COMMAND_CLIENT_BATCH; ++i) {
+        QMutexLocker lckClientQueues(&mtxClientQueues);
+        QHash<int, QQueue<QPair<QByteArray, qint64> > >::iterator itClientQueue = hshClientQueues.find(iClientID);
+        if (itClientQueue == hshClientQueues.end()) {
+            return;
+        }
+        if (itClientQueue.value().isEmpty()) {
+            hshClientQueues.erase(itClientQueue);
+            return;
+        }
+        QPair<QByteArray, qint64> pairCommand = itClientQueue.value().dequeue();
+        --iQueuedCommandCount;
+        lckClientQueues.unlock();
+
+        NetworkingCommandExecutor::ExecuteCommand(iClientID, pairCommand.first, pairCommand.second);
+    }
+
+    //Hand the thread to other clients, commands left are run by a new task queued behind theirs
+    QMutexLocker lckClientQueues(&mtxClientQueues);
+    QHash<int, QQueue<QPair<QByteArray, qint64> > >::iterator itClientQueue = hshClientQueues.find(iClientID);
+    if (itClientQueue == hshClientQueues.end()) {
+        return;
+    }
+    if (itClientQueue.value().isEmpty()) {
+        hshClientQueues.erase(itClientQueue);
+        return;
+    }
+    trpCommands.start(new NetworkingCommandTask(this, iClientID));
+    return;
+}
+
+void NetworkingCommandExecutor::ExecuteCommand(int iClientID, const QByteArray & baCommand, qint64 iQueuedTime) {
+    qint64 iStartTime = tmrClock.nsecsElapsed();
+    NetworkingCommandReply rplCommand(iClientID);
+    if (!tblCommands->Execute(baCommand, rplCommand)) {
+        //Handler unregistered while the command was waiting, counted under the queue lock like other drops so that the counter has a single writer at a time
+        QMutexLocker lckClientQueues(&mtxClientQueues);
+        cntDroppedCommands.Add();
+        return;
+    }
+    qint64 iEndTime = tmrClock.nsecsElapsed();
+    if (!rplCommand.GetReplies().isEmpty()) {
+        snkReplies->SendCommandReplies(iClientID, rplCommand.GetReplies());
+    }
+
+    //Times are recorded after the replies are on their way
+    QByteArray baVerb = NetworkingCommandTable::PeekVerb(baCommand);
+    QMutexLocker lckCommandStats(&mtxCommandStats);
+    NetworkingCommandStats * stsCommand = hshCommandStats.value(baVerb, NULL);
+    if (!stsCommand) {
+        stsCommand = new NetworkingCommandStats;
+        hshCommandStats.insert(QByteArray(baVerb.constData(), baVerb.size()), stsCommand); //Deep copy, the key outlives the command
+    }
+    stsCommand->histWaitTimes.Record(static_cast<int>(qMin((iStartTime - iQueuedTime) / 1000, static_cast<qint64>(0x7FFFFFFF))));
+    stsCommand->histExecutionTimes.Record(static_cast<int>(qMin((iEndTime - iStartTime) / 1000, static_cast<qint64>(0x7FFFFFFF))));
+    return;
+}
+
+/* Metrics */
+int NetworkingCommandExecutor::GetThreadCount() const {
+    return trpCommands.maxThreadCount();
+}
+
+int NetworkingCommandExecutor::GetQueuedCommandCount() const {
+    QMutexLocker lckClientQueues(&mtxClientQueues);
+    return iQueuedCommandCount;
+}
+
+quint32 NetworkingCommandExecutor::GetDroppedCommandCount() const {
+    return cntDroppedCommands.Get();
+}
+
+void NetworkingCommandExecutor::WriteMetrics(NetworkingMetricsWriter & wrtMetrics) const {
+    wrtMetrics.WriteValue("net_server_command_threads", NetworkingCommandExecutor::GetThreadCount());
+    wrtMetrics.WriteValue("net_server_command_queue_commands", NetworkingCommandExecutor::GetQueuedCommandCount());
+    wrtMetrics.WriteValue("net_server_command_queue_commands_high_water", cntQueueHighWater.Get());
+    wrtMetrics.WriteValue("net_server_commands_dropped_total", cntDroppedCommands.Get());
+
+    //Verbs are few, they are the ones with a handler
+    QMutexLocker lckCommandStats(&mtxCommandStats);
+    for (QHash<QByteArray, NetworkingCommandStats *>::const_iterator itCommandStats = hshCommandStats.constBegin(); itCommandStats != hshCommandStats.constEnd(); ++itCommandStats) {
+        wrtMetrics.SetLabels(QString("verb=\"%1\"").arg(QString::fromUtf8(itCommandStats.key().constData(), itCommandStats.key().size())));
+        wrtMetrics.WriteHistogram("net_server_command_wait_us", itCommandStats.value()->histWaitTimes);
+        wrtMetrics.WriteHistogram("net_server_command_exec_us", itCommandStats.value()->histExecutionTimes);
+    }
+    wrtMetrics.SetLabels(QString());
+    return;
+}
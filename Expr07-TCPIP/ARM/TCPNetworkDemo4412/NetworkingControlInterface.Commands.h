@@ -0,0 +1,173 @@
+/*
+ * NETWORKING CONTROL INTERFACE :: COMMANDS
+ *
+ * This file defines how the server parses & executes line-based commands received from remote clients.
+ * A command is a verb followed by arguments, separated by spaces or tabs, e.g. "SETRATE 1000". Handlers are registered for verbs in a command table,
+ * each TCP Server Object owns one. A command whose verb has a handler is queued to the server's command executor, which runs handlers on a bounded
+ * thread pool, so that an expensive command neither stalls the worker thread serving the client's socket (and every other client it serves) nor
+ * the thread owning the server object. Commands of the same client are executed one after another and answered in order on the same connection,
+ * commands of different clients run in parallel. Each client and the executor as a whole have a limit of commands waiting for execution, a
+ * command over the limit is not executed and answered with NET_COMMAND_REPLY_BUSY followed by its verb (which may arrive before replies of the
+ * client's earlier commands). Wait and execution times are recorded for each verb, see NetworkingControlInterface.Metrics.h.
+ * Commands without a handler are passed to upper layers as before (TCPServer::CommandReceivedEvent and TCPServer::CommandDataReceivedEvent).
+ * Built-in handlers:
+ *   NET_STATS_REQUEST: Answers metrics of all registered sources, see NetworkingControlInterface.Metrics.h.
+ *
+ * This file is a part of DataSourceProvider, but was separated for easier maintainance.
+ * For DataFrames' definitions and stream operators, please refer to DataSourceProvider.
+ *
+ */
+
+#ifndef NETWORKINGCONTROLINTERFACE_COMMANDS_H
+#define NETWORKINGCONTROLINTERFACE_COMMANDS_H
+
+#include "NetworkingControlInterface.Metrics.h"
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QPair>
+#include <QQueue>
+#include <QReadWriteLock>
+#include <QThreadPool>
+#include <QVarLengthArray>
+
+/* Command Limits */
+#define NET_COMMAND_INLINE_TOKEN_COUNT 8 //Token positions of a command are kept without allocation up to this count
+#define NET_COMMAND_CLIENT_BATCH       16 //Commands of one client executed before its pool thread is handed to other clients
+
+/* Busy Reply */
+#define NET_COMMAND_REPLY_BUSY "#BUSY" //Sent back with the verb of a command rejected because too many commands are waiting for execution
+
+/* Command Arguments */
+//Tokens are kept as positions in the command received, nothing is copied until an argument is read
+class NetworkingCommandArguments {
+public:
+    explicit NetworkingCommandArguments(const QByteArray & baCommandInit);
+
+    const QByteArray & GetCommand() const; //Command as received
+    QByteArray GetVerb() const;
+    int Count() const; //Number of arguments, verb excluded
+    QByteArray At(int iIndex) const; //Argument as a copy, empty if out of range
+    QByteArray GetRemainder(int iIndex) const; //Argument iIndex and everything after it, e.g. free text
+    bool Equals(int iIndex, const char * chrValue) const; //Compare an argument without copying it
+    int ToInt(int iIndex, bool * bIsValid = 0) const;
+    double ToDouble(int iIndex, bool * bIsValid = 0) const;
+
+private:
+    QByteArray baCommand; //INTERNAL: Shares the received buffer
+    QVarLengthArray<int, NET_COMMAND_INLINE_TOKEN_COUNT * 2> arrTokenBounds; //INTERNAL: Start and end of every token, the verb is token 0
+
+    bool GetTokenBounds(int iToken, int & iTokenStart, int & iTokenEnd) const; //INTERNAL: Returns false if the token does not exist
+};
+
+/* Command Reply */
+//Collects replies of a command, they are sent to the client in order once the handler returns
+class NetworkingCommandReply {
+public:
+    NetworkingCommandReply(int iClientIDInit);
+
+    int GetClientID() const; //ID of the client which sent the command, see TCPServer's session registry
+    void Append(const QByteArray & baReply); //Each reply is sent as a line in text mode, or as a frame in binary mode
+    const QList<QByteArray> & GetReplies() const;
+
+private:
+    int iClientID; //INTERNAL: Sender of the command
+    QList<QByteArray> lstReplies; //INTERNAL: Replies in order
+};
+
+/* Command Handler */
+//Implemented by objects executing commands, ExecuteCommand() is called from any thread of the command executor while the handler is registered
+//Commands of different clients are executed concurrently, handlers must protect the state they share
+class NetworkingCommandHandler {
+public:
+    virtual ~NetworkingCommandHandler() {}
+    virtual void ExecuteCommand(const NetworkingCommandArguments & argCommand, NetworkingCommandReply & rplCommand) = 0;
+};
+
+/* Command Table */
+//Thread-safe, handlers must not register or unregister handlers while they are executed
+class NetworkingCommandTable {
+public:
+    NetworkingCommandTable(); //Built-in handlers are registered
+
+    bool RegisterHandler(const QByteArray & baVerb, NetworkingCommandHandler * hdlCommand); //Returns false if the verb already has a handler, handlers are not owned by the table
+    void UnregisterHandler(const QByteArray & baVerb); //Waits until running executions have finished
+    QList<QByteArray> GetVerbs() const;
+    bool HasHandler(const QByteArray & baCommand) const; //Returns true if the command's verb has a handler
+    bool Execute(const QByteArray & baCommand, NetworkingCommandReply & rplCommand) const; //Execute a command if its verb has a handler, returns false otherwise
+    static QByteArray PeekVerb(const QByteArray & baCommand); //Verb wrapping the command's bytes without copying, only valid while baCommand is alive, empty if there is none
+
+private:
+    mutable QReadWriteLock rwlHandlers; //INTERNAL: Protects hshHandlers, held for reading while a handler is executed
+    QHash<QByteArray, NetworkingCommandHandler *> hshHandlers; //INTERNAL: Handlers indexed by verb, looked up with the verb's bytes in place
+
+    /* Disable Copying */
+    NetworkingCommandTable(const NetworkingCommandTable &);
+    NetworkingCommandTable & operator=(const NetworkingCommandTable &);
+};
+
+/* Command Reply Sink */
+//Implemented by objects delivering replies of commands run by a command executor, SendCommandReplies() is called from the executor's pool threads
+class NetworkingCommandReplySink {
+public:
+    virtual ~NetworkingCommandReplySink() {}
+    virtual void SendCommandReplies(int iClientID, const QList<QByteArray> & lstReplies) = 0; //Replies of one command in order, replies of a client's commands are delivered in order
+};
+
+/* Command Executor */
+//Runs commands of a command table on a bounded thread pool, all public functions are thread-safe
+//Each client with commands waiting has one pool task at most, which executes them in order, thus clients are served in parallel but a client's commands never are
+struct NetworkingCommandStats;
+class NetworkingCommandExecutor {
+public:
+    /* Submit Results */
+    enum SubmitResult {
+        NotHandled = 0, //The verb has no handler, the command should be passed to upper layers
+        Queued = 1,
+        Rejected = 2 //Too many commands are waiting, the command is not executed
+    };
+
+    NetworkingCommandExecutor(const NetworkingCommandTable * tblCommandsInit, NetworkingCommandReplySink * snkRepliesInit); //Both must outlive the executor
+    ~NetworkingCommandExecutor(); //Commands waiting are dropped, running ones are waited for
+
+    void SetOptions(int iThreadCountNew, int iClientQueueLimitNew, int iQueueLimitNew); //Number of pool threads (0 for one per CPU core), and commands waiting for execution per client and in total
+    SubmitResult Submit(int iClientID, const QByteArray & baCommand);
+    void RemoveClient(int iClientID); //Drop commands of a closed client which are still waiting, a running one finishes
+
+    /* Metrics */
+    int GetThreadCount() const;
+    int GetQueuedCommandCount() const; //Gauge, commands waiting for execution
+    quint32 GetDroppedCommandCount() const; //Commands dropped because their client was closed or their handler was unregistered while they were waiting
+    void WriteMetrics(NetworkingMetricsWriter & wrtMetrics) const; //Gauges and histograms of wait and execution times for each verb, labels are reset when done
+
+private:
+    const NetworkingCommandTable * tblCommands; //INTERNAL: Handlers of commands
+    NetworkingCommandReplySink * snkReplies; //INTERNAL: Delivers replies
+    QThreadPool trpCommands; //INTERNAL: Runs client tasks, not the global pool so that its size is bounded by the options
+    QElapsedTimer tmrClock; //INTERNAL: Time base of wait and execution times
+
+    /* Client Queues */
+    mutable QMutex mtxClientQueues; //INTERNAL: Protects everything in this section
+    QHash<int, QQueue<QPair<QByteArray, qint64> > > hshClientQueues; //INTERNAL: Commands waiting with their queuing time, a client is listed while its pool task is scheduled or running
+    int iClientQueueLimit; //INTERNAL: Commands waiting per client
+    int iQueueLimit; //INTERNAL: Commands waiting in total
+    int iQueuedCommandCount; //INTERNAL: Commands waiting in total
+    NetworkingCounter cntQueueHighWater; //INTERNAL: Max commands waiting in total
+
+    void RunClientCommands(int iClientID); //INTERNAL: Body of a client's pool task, executes a batch of its commands and then reschedules itself if more are waiting
+    void ExecuteCommand(int iClientID, const QByteArray & baCommand, qint64 iQueuedTime); //INTERNAL: Execute a command, deliver its replies and record its times
+    friend class NetworkingCommandTask;
+
+    /* Metrics */
+    NetworkingCounter cntDroppedCommands; //INTERNAL: Only added to with mtxClientQueues held, which makes its writers one at a time
+    mutable QMutex mtxCommandStats; //INTERNAL: Protects hshCommandStats, and serializes recording since histograms have a single writer
+    QHash<QByteArray, NetworkingCommandStats *> hshCommandStats; //INTERNAL: Times of each verb executed
+
+    /* Disable Copying */
+    NetworkingCommandExecutor(const NetworkingCommandExecutor &);
+    NetworkingCommandExecutor & operator=(const NetworkingCommandExecutor &);
+};
+
+#endif // NETWORKINGCONTROLINTERFACE_COMMANDS_H
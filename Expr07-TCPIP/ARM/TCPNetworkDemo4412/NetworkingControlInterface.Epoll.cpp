@@ -0,0 +1,903 @@
+#include "NetworkingControlInterface.Epoll.h"
+#include "NetworkingControlInterface.Heartbeat.h"
+#include "SettingsProvider.h"
+#include <QDebug>
+#include <QHostAddress>
+#include <QMutexLocker>
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifndef SO_REUSEPORT
+#define SO_REUSEPORT 15 //Missing from old C libraries, the kernel may still support it
+#endif
+
+/* Epoll IO Thread */
+//Runs the engine's loop for one IO thread context
+class EpollIOThread : public QThread {
+public:
+    EpollIOThread(EpollServerEngine * engServerInit, EpollIOContext * ctxIOThreadInit) {
+        engServer = engServerInit;
+        ctxIOThread = ctxIOThreadInit;
+    }
+
+protected:
+    void run() {
+        engServer->RunIOThread(ctxIOThread);
+        return;
+    }
+
+private:
+    EpollServerEngine * engServer;
+    EpollIOContext * ctxIOThread;
+};
+
+/* Epoll Server Engine */
+EpollServerEngine::EpollServerEngine(QObject * objEventReceiverInit, NetworkingCommandExecutor * excCommandsInit, int iIOThreadCount) {
+    //Initialize internal variables
+    objEventReceiver = objEventReceiverInit;
+    excCommands = excCommandsInit;
+    bIsListening = false;
+    bIsReusePortSupported = true;
+    iLastClientID = 0;
+    iOutputQueueMaxBytes = ST_DEFVAL_SERVER_OUTPUT_MAX_BYTES;
+    iSlowClientPolicy = TCPServerSocket::DropOldest;
+    qRegisterMetaType<QAbstractSocket::SocketError>("QAbstractSocket::SocketError"); //Register QAbstractSocket::SocketError type for QueuedConnection
+    qRegisterMetaType<QList<QByteArray> >("QList<QByteArray>"); //Register QList<QByteArray> type for QueuedConnection
+
+    //Create an epoll instance and a wakeup eventfd for each IO thread
+    bIsValid = true;
+    for (int i = 0; i < qMax(iIOThreadCount, 1) && bIsValid; ++i) {
+        EpollIOContext * ctxIOThread = new EpollIOContext;
+        ctxIOThread->iIOThreadIndex = i;
+        ctxIOThread->iEpollDescriptor = epoll_create1(EPOLL_CLOEXEC);
+        ctxIOThread->iWakeupDescriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        ctxIOThread->iListeningDescriptor = -1;
+        ctxIOThread->iReserveDescriptor = open("/dev/null", O_RDONLY | O_CLOEXEC);
+        ctxIOThread->iConnectionCount = 0;
+        ctxIOThread->iNextIOThread = 0;
+        ctxIOThread->baReadBuffer.resize(NET_EPOLL_READ_BUFFER_BYTES);
+        ctxIOThread->trdIOThread = NULL;
+        arrIOContexts.append(ctxIOThread);
+        if (ctxIOThread->iEpollDescriptor < 0 || ctxIOThread->iWakeupDescriptor < 0) {
+            qDebug() << "TCPServer: Couldnot create epoll instance," << strerror(errno);
+            bIsValid = false;
+            break;
+        }
+        epoll_event evtWakeup;
+        evtWakeup.events = EPOLLIN | EPOLLET;
+        evtWakeup.data.ptr = &ctxIOThread->iWakeupDescriptor;
+        if (epoll_ctl(ctxIOThread->iEpollDescriptor, EPOLL_CTL_ADD, ctxIOThread->iWakeupDescriptor, &evtWakeup) != 0) {
+            qDebug() << "TCPServer: Couldnot watch wakeup eventfd," << strerror(errno);
+            bIsValid = false;
+            break;
+        }
+        ctxIOThread->trdIOThread = new EpollIOThread(this, ctxIOThread);
+    }
+
+    //An engine without every IO thread is useless, it is released at once and the owner falls back to another backend
+    if (!bIsValid) {
+        for (int i = 0; i < arrIOContexts.size(); ++i) {
+            delete arrIOContexts[i]->trdIOThread;
+            if (arrIOContexts[i]->iWakeupDescriptor >= 0) {
+                close(arrIOContexts[i]->iWakeupDescriptor);
+            }
+            if (arrIOContexts[i]->iEpollDescriptor >= 0) {
+                close(arrIOContexts[i]->iEpollDescriptor);
+            }
+            if (arrIOContexts[i]->iReserveDescriptor >= 0) {
+                close(arrIOContexts[i]->iReserveDescriptor);
+            }
+        }
+        qDeleteAll(arrIOContexts);
+        arrIOContexts.clear();
+        return;
+    }
+
+    //Start IO threads
+    for (int i = 0; i < arrIOContexts.size(); ++i) {
+        arrIOContexts[i]->trdIOThread->start();
+    }
+    qDebug() << "TCPServer: Started" << arrIOContexts.size() << "epoll IO thread(s)";
+}
+
+EpollServerEngine::~EpollServerEngine() {
+    //IO threads close their connections and listening sockets before they return
+    EpollInboxMessage msgQuit;
+    msgQuit.iKind = EpollInboxMessage::Quit;
+    for (int i = 0; i < arrIOContexts.size(); ++i) {
+        EpollServerEngine::PostMessage(arrIOContexts[i], msgQuit);
+    }
+    for (int i = 0; i < arrIOContexts.size(); ++i) {
+        arrIOContexts[i]->trdIOThread->wait();
+        delete arrIOContexts[i]->trdIOThread;
+    }
+
+    //Connections handed out by another IO thread after this one has quit are still in its inbox
+    for (int i = 0; i < arrIOContexts.size(); ++i) {
+        EpollServerEngine::DiscardInbox(arrIOContexts[i]->lstInbox, 0);
+        close(arrIOContexts[i]->iWakeupDescriptor);
+        close(arrIOContexts[i]->iEpollDescriptor);
+        if (arrIOContexts[i]->iReserveDescriptor >= 0) {
+            close(arrIOContexts[i]->iReserveDescriptor);
+        }
+    }
+    qDeleteAll(arrIOContexts);
+}
+
+bool EpollServerEngine::IsValid() const {
+    return bIsValid;
+}
+
+/* Options */
+void EpollServerEngine::SetOutputQueueOptions(int iOutputQueueMaxBytesNew, TCPServerSocket::SlowClientPolicy iSlowClientPolicyNew) {
+    iOutputQueueMaxBytes.fetchAndStoreRelaxed(qMax(iOutputQueueMaxBytesNew, 0));
+    iSlowClientPolicy.fetchAndStoreRelaxed(iSlowClientPolicyNew);
+    return;
+}
+
+/* Listening Status Management */
+bool EpollServerEngine::StartListening(quint16 iListeningPort) {
+    if (bIsListening) {
+        EpollServerEngine::StopListening();
+    }
+
+    //The first socket tells if SO_REUSEPORT is supported, and which port is used if any port was requested
+    bool bIsReusePortRequired = (arrIOContexts.size() > 1);
+    QList<int> lstListeningDescriptors;
+    int iListeningDescriptor = EpollServerEngine::CreateListeningSocket(iListeningPort, bIsReusePortRequired);
+    if (iListeningDescriptor < 0) {
+        return false;
+    }
+    lstListeningDescriptors.append(iListeningDescriptor);
+    if (iListeningPort == 0) {
+        sockaddr_in addrListening;
+        socklen_t iAddressLength = sizeof(addrListening);
+        getsockname(iListeningDescriptor, reinterpret_cast<sockaddr *>(&addrListening), &iAddressLength);
+        iListeningPort = ntohs(addrListening.sin_port);
+    }
+
+    //Every other IO thread listens on its own socket, the kernel balances connections across them
+    //If one of them cannot listen, e.g. the kernel refuses SO_REUSEPORT, the first socket is kept and hands connections out alone
+    for (int i = 1; i < arrIOContexts.size() && bIsReusePortRequired; ++i) {
+        iListeningDescriptor = EpollServerEngine::CreateListeningSocket(iListeningPort, bIsReusePortRequired);
+        if (iListeningDescriptor < 0) {
+            while (lstListeningDescriptors.size() > 1) {
+                close(lstListeningDescriptors.takeLast());
+            }
+            break;
+        }
+        lstListeningDescriptors.append(iListeningDescriptor);
+    }
+    bIsReusePortSupported = (lstListeningDescriptors.size() == arrIOContexts.size());
+    if (!bIsReusePortSupported) {
+        qDebug() << "TCPServer: SO_REUSEPORT is not supported, connections are accepted by the first IO thread.";
+    }
+
+    //Hand listening sockets out, accepting starts when IO threads take them
+    for (int i = 0; i < lstListeningDescriptors.size(); ++i) {
+        EpollInboxMessage msgListener;
+        msgListener.iKind = EpollInboxMessage::AddListener;
+        msgListener.iSocketDescriptor = lstListeningDescriptors.at(i);
+        EpollServerEngine::PostMessage(arrIOContexts[i], msgListener);
+    }
+    bIsListening = true;
+    return true;
+}
+
+void EpollServerEngine::StopListening() {
+    EpollInboxMessage msgListener;
+    msgListener.iKind = EpollInboxMessage::RemoveListener;
+    for (int i = 0; i < arrIOContexts.size(); ++i) {
+        EpollServerEngine::PostMessage(arrIOContexts[i], msgListener);
+    }
+    bIsListening = false;
+    return;
+}
+
+bool EpollServerEngine::IsListening() const {
+    return bIsListening;
+}
+
+int EpollServerEngine::CreateListeningSocket(quint16 iListeningPort, bool & bIsReusePortRequired) {
+    int iListeningDescriptor = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (iListeningDescriptor < 0) {
+        qDebug() << "TCPServer: Couldnot create listening socket," << strerror(errno);
+        return -1;
+    }
+
+    //Same options as QTcpServer, a port left in TIME_WAIT by a previous run can be reused at once
+    int iOptionValue = 1;
+    setsockopt(iListeningDescriptor, SOL_SOCKET, SO_REUSEADDR, &iOptionValue, sizeof(iOptionValue));
+    if (bIsReusePortRequired && setsockopt(iListeningDescriptor, SOL_SOCKET, SO_REUSEPORT, &iOptionValue, sizeof(iOptionValue)) != 0) {
+        bIsReusePortRequired = false;
+    }
+
+    sockaddr_in addrListening;
+    memset(&addrListening, 0, sizeof(addrListening));
+    addrListening.sin_family = AF_INET;
+    addrListening.sin_addr.s_addr = htonl(INADDR_ANY);
+    addrListening.sin_port = htons(iListeningPort);
+    if (bind(iListeningDescriptor, reinterpret_cast<sockaddr *>(&addrListening), sizeof(addrListening)) != 0 || listen(iListeningDescriptor, NET_EPOLL_LISTEN_BACKLOG) != 0) {
+        qDebug() << "TCPServer: Couldnot listen on port" << iListeningPort << "," << strerror(errno);
+        close(iListeningDescriptor);
+        return -1;
+    }
+    return iListeningDescriptor;
+}
+
+/* Text-Based Communication */
+bool EpollServerEngine::SendDataToClient(int iClientID, const QByteArray & baDataToSend) {
+    QReadLocker lckSessionRegistry(&rwlSessionRegistry);
+    EpollConnection * conClient = hshSessions.value(iClientID, NULL);
+    if (!conClient) {
+        return false;
+    }
+    EpollInboxMessage msgSend;
+    msgSend.iKind = EpollInboxMessage::SendToClient;
+    msgSend.iClientID = iClientID;
+    msgSend.baData = TCPServerSocket::EncodeMessage(baDataToSend, TCPServerEncodedMessage::Text, 0, 0);
+    EpollServerEngine::PostMessage(arrIOContexts[conClient->iIOThreadIndex], msgSend);
+    return true;
+}
+
+void EpollServerEngine::SendDataToClients(const QByteArray & baDataToSend, const QString & sClientName, const QString & sClientIPAddress, quint16 iClientPort) {
+    //Peer names are not looked up by this backend, every client's name is empty (see GetClientInformation()), thus a name matches no client
+    if (!sClientName.isEmpty()) {
+        qDebug() << "TCPServer: No client is named" << sClientName << "in epoll backend, data is not sent.";
+        return;
+    }
+
+    //Encoded once, every receiver shares the buffer
+    EpollInboxMessage msgSend;
+    msgSend.baData = TCPServerSocket::EncodeMessage(baDataToSend, TCPServerEncodedMessage::Text, 0, 0);
+
+    //A broadcast costs one message for each IO thread
+    if (sClientIPAddress.isEmpty() && iClientPort == 0) {
+        msgSend.iKind = EpollInboxMessage::SendToAll;
+        for (int i = 0; i < arrIOContexts.size(); ++i) {
+            EpollServerEngine::PostMessage(arrIOContexts[i], msgSend);
+        }
+        return;
+    }
+
+    //Otherwise send to each client matching the filters, the client is looked up directly if its endpoint is specified
+    quint32 iClientAddress = QHostAddress(sClientIPAddress).toIPv4Address();
+    msgSend.iKind = EpollInboxMessage::SendToClient;
+    QReadLocker lckSessionRegistry(&rwlSessionRegistry);
+    if (!sClientIPAddress.isEmpty() && iClientPort != 0) {
+        EpollConnection * conClient = hshSessions.value(hshSessionIDsByEndpoint.value(qMakePair(iClientAddress, iClientPort), 0), NULL);
+        if (conClient) {
+            msgSend.iClientID = conClient->iClientID;
+            EpollServerEngine::PostMessage(arrIOContexts[conClient->iIOThreadIndex], msgSend);
+        }
+        return;
+    }
+    for (QHash<int, EpollConnection *>::const_iterator itSession = hshSessions.constBegin(); itSession != hshSessions.constEnd(); ++itSession) {
+        EpollConnection * conClient = itSession.value();
+        if ((sClientIPAddress.isEmpty() || iClientAddress == conClient->iPeerAddress) &&
+            (iClientPort == 0 || iClientPort == conClient->iPeerPort)) {
+            msgSend.iClientID = conClient->iClientID;
+            EpollServerEngine::PostMessage(arrIOContexts[conClient->iIOThreadIndex], msgSend);
+        }
+    }
+    return;
+}
+
+/* Session Registry */
+int EpollServerEngine::GetConnectedClientCount() const {
+    QReadLocker lckSessionRegistry(&rwlSessionRegistry);
+    return hshSessions.size();
+}
+
+QList<int> EpollServerEngine::GetConnectedClientIDs() const {
+    QReadLocker lckSessionRegistry(&rwlSessionRegistry);
+    return hshSessions.keys();
+}
+
+int EpollServerEngine::FindClientID(const QString & sClientIPAddress, quint16 iClientPort) const {
+    quint32 iClientAddress = QHostAddress(sClientIPAddress).toIPv4Address();
+    QReadLocker lckSessionRegistry(&rwlSessionRegistry);
+    return hshSessionIDsByEndpoint.value(qMakePair(iClientAddress, iClientPort), 0);
+}
+
+bool EpollServerEngine::GetClientInformation(int iClientID, QString & sClientName, QString & sClientIPAddress, quint16 & iClientPort) const {
+    QReadLocker lckSessionRegistry(&rwlSessionRegistry);
+    EpollConnection * conClient = hshSessions.value(iClientID, NULL);
+    if (!conClient) {
+        return false;
+    }
+    sClientName.clear();
+    sClientIPAddress = QHostAddress(conClient->iPeerAddress).toString();
+    iClientPort = conClient->iPeerPort;
+    return true;
+}
+
+bool EpollServerEngine::GetClientOutputQueueDepth(int iClientID, int & iQueuedFrames, int & iQueuedBytes) const {
+    QReadLocker lckSessionRegistry(&rwlSessionRegistry);
+    EpollConnection * conClient = hshSessions.value(iClientID, NULL);
+    if (!conClient) {
+        return false;
+    }
+    iQueuedBytes = conClient->iOutputQueueBytesMetric.fetchAndAddRelaxed(0);
+    iQueuedFrames = conClient->iOutputQueueFramesMetric.fetchAndAddRelaxed(0);
+    return true;
+}
+
+QVector<int> EpollServerEngine::GetIOThreadLoads() const {
+    QVector<int> arrIOThreadLoads;
+    for (int i = 0; i < arrIOContexts.size(); ++i) {
+        arrIOThreadLoads.append(arrIOContexts[i]->iConnectionCount.fetchAndAddRelaxed(0));
+    }
+    return arrIOThreadLoads;
+}
+
+/* Metrics */
+void EpollServerEngine::GetMetrics(TCPServerMetrics & mtrServer) const {
+    QReadLocker lckSessionRegistry(&rwlSessionRegistry);
+    mtrServer.iConnectedClientCount = hshSessions.size();
+    mtrServer.iSessionsAccepted = cntSessionsAccepted.Get();
+    mtrServer.iSessionsClosed = cntSessionsClosed.Get();
+    mtrServer.iFramesReceived = cntClosedFramesReceived.Get();
+    mtrServer.iBytesReceived = cntClosedBytesReceived.Get();
+    mtrServer.iCommandsExecuted = cntClosedCommandsExecuted.Get();
+    mtrServer.iCommandsRejected = cntClosedCommandsRejected.Get();
+    mtrServer.iFramesSent = cntClosedFramesSent.Get();
+    mtrServer.iBytesSent = cntClosedBytesSent.Get();
+    mtrServer.iDeadClientCount = 0; //Clients are never pinged
+    mtrServer.iOutputFramesDropped = cntClosedOutputFramesDropped.Get();
+    mtrServer.iSlowClientCount = cntSlowClients.Get();
+    mtrServer.arrSessions.reserve(hshSessions.size());
+    for (QHash<int, EpollConnection *>::const_iterator itSession = hshSessions.constBegin(); itSession != hshSessions.constEnd(); ++itSession) {
+        const EpollConnection * conClient = itSession.value();
+        TCPServerSessionMetrics mtrSession;
+        mtrSession.iClientID = conClient->iClientID;
+        mtrSession.sClientIPAddress = QHostAddress(conClient->iPeerAddress).toString();
+        mtrSession.iClientPort = conClient->iPeerPort;
+        mtrSession.iFramesReceived = conClient->cntFramesReceived.Get();
+        mtrSession.iBytesReceived = conClient->cntBytesReceived.Get();
+        mtrSession.iCommandsExecuted = conClient->cntCommandsExecuted.Get();
+        mtrSession.iCommandsRejected = conClient->cntCommandsRejected.Get();
+        mtrSession.iFramesSent = conClient->cntFramesSent.Get();
+        mtrSession.iBytesSent = conClient->cntBytesSent.Get();
+        mtrSession.iRoundTripTimeCount = 0;
+        mtrSession.iRoundTripTimeLast = 0;
+        mtrSession.iRoundTripTimeMax = 0;
+        mtrSession.arrRoundTripTimeBuckets.fill(0, NET_HISTOGRAM_BUCKET_COUNT);
+        mtrSession.iPongsMissed = 0;
+        mtrSession.iOutputQueueBytes = conClient->iOutputQueueBytesMetric.fetchAndAddRelaxed(0);
+        mtrSession.iOutputQueueFrames = conClient->iOutputQueueFramesMetric.fetchAndAddRelaxed(0);
+        mtrSession.iOutputQueueBytesHighWater = conClient->cntOutputQueueHighWater.Get();
+        mtrSession.iOutputFramesDropped = conClient->cntOutputFramesDropped.Get();
+        mtrSession.iSlowClientDisconnects = conClient->cntSlowClientDisconnects.Get();
+        mtrServer.iFramesReceived += mtrSession.iFramesReceived;
+        mtrServer.iBytesReceived += mtrSession.iBytesReceived;
+        mtrServer.iCommandsExecuted += mtrSession.iCommandsExecuted;
+        mtrServer.iCommandsRejected += mtrSession.iCommandsRejected;
+        mtrServer.iFramesSent += mtrSession.iFramesSent;
+        mtrServer.iBytesSent += mtrSession.iBytesSent;
+        mtrServer.iOutputFramesDropped += mtrSession.iOutputFramesDropped;
+        mtrServer.arrSessions.append(mtrSession);
+    }
+    return;
+}
+
+/* IO Threads */
+void EpollServerEngine::RunIOThread(EpollIOContext * ctxIOThread) {
+    epoll_event arrEvents[NET_EPOLL_MAX_EVENTS];
+    bool bIsRunning = true;
+    while (bIsRunning) {
+        //Do not sleep while some connection still has bytes to read
+        int iEventCount = epoll_wait(ctxIOThread->iEpollDescriptor, arrEvents, NET_EPOLL_MAX_EVENTS, ctxIOThread->lstReadyConnections.isEmpty() ? -1 : 0);
+        if (iEventCount < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            qDebug() << "TCPServer: epoll_wait() failed," << strerror(errno) << ", IO thread" << ctxIOThread->iIOThreadIndex << "stopped.";
+            break;
+        }
+
+        for (int i = 0; i < iEventCount && bIsRunning; ++i) {
+            void * ptrEventData = arrEvents[i].data.ptr;
+            if (ptrEventData == &ctxIOThread->iWakeupDescriptor) {
+                bIsRunning = EpollServerEngine::ProcessInbox(ctxIOThread);
+                continue;
+            }
+            if (ptrEventData == &ctxIOThread->iListeningDescriptor) {
+                EpollServerEngine::AcceptConnections(ctxIOThread);
+                continue;
+            }
+
+            //A connection closed by an earlier event of this batch is still allocated, but has no descriptor any more
+            EpollConnection * conClient = static_cast<EpollConnection *>(ptrEventData);
+            if (conClient->iSocketDescriptor < 0) {
+                continue;
+            }
+            if (arrEvents[i].events & EPOLLERR) {
+                int iSocketError = 0;
+                socklen_t iOptionLength = sizeof(iSocketError);
+                getsockopt(conClient->iSocketDescriptor, SOL_SOCKET, SO_ERROR, &iSocketError, &iOptionLength);
+                EpollServerEngine::CloseConnection(ctxIOThread, conClient, EpollServerEngine::GetSocketError(iSocketError), true);
+                continue;
+            }
+            if (arrEvents[i].events & EPOLLOUT) {
+                conClient->bIsWritable = true;
+                EpollServerEngine::FlushOutput(ctxIOThread, conClient);
+            }
+            if ((arrEvents[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) && conClient->iSocketDescriptor >= 0 && !conClient->bIsReadPending) {
+                EpollServerEngine::ReadConnection(ctxIOThread, conClient);
+            }
+        }
+
+        //Serve connections which were not read to EAGAIN, in turn
+        if (bIsRunning && !ctxIOThread->lstReadyConnections.isEmpty()) {
+            QList<EpollConnection *> lstReadyConnections;
+            lstReadyConnections.swap(ctxIOThread->lstReadyConnections);
+            for (int i = 0; i < lstReadyConnections.size(); ++i) {
+                EpollConnection * conClient = lstReadyConnections.at(i);
+                conClient->bIsReadPending = false;
+                if (conClient->iSocketDescriptor >= 0) {
+                    EpollServerEngine::ReadConnection(ctxIOThread, conClient);
+                }
+            }
+        }
+
+        //Everything answered in this turn leaves with one send() per connection
+        EpollServerEngine::FlushPendingOutputs(ctxIOThread);
+        qDeleteAll(ctxIOThread->lstClosedConnections);
+        ctxIOThread->lstClosedConnections.clear();
+    }
+
+    //Close everything without informing the event receiver, it is being destroyed
+    QList<EpollConnection *> lstConnections = ctxIOThread->hshConnections.values();
+    for (int i = 0; i < lstConnections.size(); ++i) {
+        EpollServerEngine::CloseConnection(ctxIOThread, lstConnections.at(i), QAbstractSocket::UnknownSocketError, false);
+    }
+    qDeleteAll(ctxIOThread->lstClosedConnections);
+    ctxIOThread->lstClosedConnections.clear();
+    if (ctxIOThread->iListeningDescriptor >= 0) {
+        close(ctxIOThread->iListeningDescriptor);
+        ctxIOThread->iListeningDescriptor = -1;
+    }
+    return;
+}
+
+void EpollServerEngine::PostMessage(EpollIOContext * ctxIOThread, const EpollInboxMessage & msgInbox) {
+    //Only the first message wakes the IO thread up, it takes all messages at once
+    QMutexLocker lckInbox(&ctxIOThread->mtxInbox);
+    bool bIsWakeupRequired = ctxIOThread->lstInbox.isEmpty();
+    ctxIOThread->lstInbox.append(msgInbox);
+    lckInbox.unlock();
+    if (bIsWakeupRequired) {
+        quint64 iWakeupValue = 1;
+        ssize_t iBytesWritten = write(ctxIOThread->iWakeupDescriptor, &iWakeupValue, sizeof(iWakeupValue));
+        Q_UNUSED(iBytesWritten);
+    }
+    return;
+}
+
+bool EpollServerEngine::ProcessInbox(EpollIOContext * ctxIOThread) {
+    //Reset the eventfd before taking messages, a message posted afterwards wakes the IO thread up again
+    quint64 iWakeupValue = 0;
+    ssize_t iBytesRead = read(ctxIOThread->iWakeupDescriptor, &iWakeupValue, sizeof(iWakeupValue));
+    Q_UNUSED(iBytesRead);
+    QList<EpollInboxMessage> lstInbox;
+    QMutexLocker lckInbox(&ctxIOThread->mtxInbox);
+    lstInbox.swap(ctxIOThread->lstInbox);
+    lckInbox.unlock();
+
+    for (int i = 0; i < lstInbox.size(); ++i) {
+        const EpollInboxMessage & msgInbox = lstInbox.at(i);
+        switch (msgInbox.iKind) {
+        case EpollInboxMessage::SendToClient: {
+            EpollConnection * conClient = ctxIOThread->hshConnections.value(msgInbox.iClientID, NULL);
+            if (conClient) {
+                EpollServerEngine::WriteOutput(ctxIOThread, conClient, msgInbox.baData, true);
+            }
+            break;
+        }
+        case EpollInboxMessage::SendToAll: {
+            //A slow client may be disconnected while sending, thus the connections are copied first
+            QList<EpollConnection *> lstConnections = ctxIOThread->hshConnections.values();
+            for (int j = 0; j < lstConnections.size(); ++j) {
+                EpollServerEngine::WriteOutput(ctxIOThread, lstConnections.at(j), msgInbox.baData, true);
+            }
+            break;
+        }
+        case EpollInboxMessage::AddListener: {
+            ctxIOThread->iListeningDescriptor = msgInbox.iSocketDescriptor;
+            epoll_event evtListening;
+            evtListening.events = EPOLLIN | EPOLLET;
+            evtListening.data.ptr = &ctxIOThread->iListeningDescriptor;
+            epoll_ctl(ctxIOThread->iEpollDescriptor, EPOLL_CTL_ADD, ctxIOThread->iListeningDescriptor, &evtListening);
+            EpollServerEngine::AcceptConnections(ctxIOThread); //Connections may have arrived before the socket was registered
+            break;
+        }
+        case EpollInboxMessage::RemoveListener:
+            if (ctxIOThread->iListeningDescriptor >= 0) {
+                epoll_ctl(ctxIOThread->iEpollDescriptor, EPOLL_CTL_DEL, ctxIOThread->iListeningDescriptor, NULL);
+                close(ctxIOThread->iListeningDescriptor);
+                ctxIOThread->iListeningDescriptor = -1;
+            }
+            break;
+        case EpollInboxMessage::AdoptConnection:
+            EpollServerEngine::AddConnection(ctxIOThread, msgInbox.iSocketDescriptor, msgInbox.iPeerAddress, msgInbox.iPeerPort);
+            break;
+        case EpollInboxMessage::Quit:
+        default:
+            EpollServerEngine::DiscardInbox(lstInbox, i + 1);
+            return false;
+        }
+    }
+    return true;
+}
+
+void EpollServerEngine::DiscardInbox(const QList<EpollInboxMessage> & lstInbox, int iFirstMessage) {
+    for (int i = iFirstMessage; i < lstInbox.size(); ++i) {
+        const EpollInboxMessage & msgInbox = lstInbox.at(i);
+        if (msgInbox.iKind == EpollInboxMessage::AddListener || msgInbox.iKind == EpollInboxMessage::AdoptConnection) {
+            close(msgInbox.iSocketDescriptor);
+        }
+    }
+    return;
+}
+
+void EpollServerEngine::AcceptConnections(EpollIOContext * ctxIOThread) {
+    while (ctxIOThread->iListeningDescriptor >= 0) {
+        sockaddr_in addrPeer;
+        socklen_t iAddressLength = sizeof(addrPeer);
+        int iSocketDescriptor = accept4(ctxIOThread->iListeningDescriptor, reinterpret_cast<sockaddr *>(&addrPeer), &iAddressLength, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (iSocketDescriptor < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if ((errno == EMFILE || errno == ENFILE) && EpollServerEngine::RefuseConnection(ctxIOThread)) {
+                continue; //Keep draining, the listening socket is not reported again until a new connection arrives
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                qDebug() << "TCPServer: Couldnot accept incoming connection," << strerror(errno);
+            }
+            return;
+        }
+        int iOptionValue = 1;
+        setsockopt(iSocketDescriptor, IPPROTO_TCP, TCP_NODELAY, &iOptionValue, sizeof(iOptionValue)); //Set for low delay, avoid packet sticking
+
+        //Without SO_REUSEPORT, this is the only accepting IO thread, it hands connections out in turn
+        quint32 iPeerAddress = ntohl(addrPeer.sin_addr.s_addr);
+        quint16 iPeerPort = ntohs(addrPeer.sin_port);
+        EpollIOContext * ctxTarget = ctxIOThread;
+        if (!bIsReusePortSupported) {
+            ctxTarget = arrIOContexts[ctxIOThread->iNextIOThread];
+            ctxIOThread->iNextIOThread = (ctxIOThread->iNextIOThread + 1) % arrIOContexts.size();
+        }
+        if (ctxTarget == ctxIOThread) {
+            EpollServerEngine::AddConnection(ctxIOThread, iSocketDescriptor, iPeerAddress, iPeerPort);
+        }
+        else {
+            EpollInboxMessage msgAdopt;
+            msgAdopt.iKind = EpollInboxMessage::AdoptConnection;
+            msgAdopt.iSocketDescriptor = iSocketDescriptor;
+            msgAdopt.iPeerAddress = iPeerAddress;
+            msgAdopt.iPeerPort = iPeerPort;
+            EpollServerEngine::PostMessage(ctxTarget, msgAdopt);
+        }
+    }
+    return;
+}
+
+bool EpollServerEngine::RefuseConnection(EpollIOContext * ctxIOThread) {
+    if (ctxIOThread->iReserveDescriptor < 0) {
+        return false;
+    }
+    qDebug() << "TCPServer: Out of file descriptors," << strerror(errno) << ", incoming connection closed.";
+
+    //Release the reserved descriptor for a moment, so that the connection can be taken off the backlog
+    close(ctxIOThread->iReserveDescriptor);
+    int iSocketDescriptor = accept4(ctxIOThread->iListeningDescriptor, NULL, NULL, SOCK_CLOEXEC);
+    if (iSocketDescriptor >= 0) {
+        close(iSocketDescriptor);
+    }
+    ctxIOThread->iReserveDescriptor = open("/dev/null", O_RDONLY | O_CLOEXEC); //Another thread may have taken the descriptor meanwhile
+    return (iSocketDescriptor >= 0);
+}
+
+void EpollServerEngine::AddConnection(EpollIOContext * ctxIOThread, int iSocketDescriptor, quint32 iPeerAddress, quint16 iPeerPort) {
+    //Create the connection with a unique ID
+    EpollConnection * conClient = new EpollConnection;
+    conClient->iSocketDescriptor = iSocketDescriptor;
+    conClient->iClientID = iLastClientID.fetchAndAddRelaxed(1) + 1;
+    conClient->iIOThreadIndex = ctxIOThread->iIOThreadIndex;
+    conClient->iPeerAddress = iPeerAddress;
+    conClient->iPeerPort = iPeerPort;
+    conClient->bIsWritable = true;
+    conClient->bIsReadPending = false;
+    conClient->bIsFlushPending = false;
+    conClient->iOutputQueueBytesMetric = 0;
+    conClient->iOutputQueueFramesMetric = 0;
+
+    //Both directions are edge-triggered, the socket is served until EAGAIN each time it is reported
+    epoll_event evtConnection;
+    evtConnection.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    evtConnection.data.ptr = conClient;
+    if (epoll_ctl(ctxIOThread->iEpollDescriptor, EPOLL_CTL_ADD, iSocketDescriptor, &evtConnection) != 0) {
+        qDebug() << "TCPServer: Couldnot accept incoming connection," << strerror(errno);
+        close(iSocketDescriptor);
+        delete conClient;
+        return;
+    }
+    ctxIOThread->hshConnections.insert(conClient->iClientID, conClient);
+    ctxIOThread->iConnectionCount.fetchAndAddRelaxed(1);
+
+    //Register the session
+    QWriteLocker lckSessionRegistry(&rwlSessionRegistry);
+    hshSessions.insert(conClient->iClientID, conClient);
+    hshSessionIDsByEndpoint.insert(qMakePair(iPeerAddress, iPeerPort), conClient->iClientID);
+    cntSessionsAccepted.Add();
+    lckSessionRegistry.unlock();
+
+    //Inform the event receiver of a newly connected client
+    QString sClientIPAddress = QHostAddress(iPeerAddress).toString();
+    qDebug() << "TCPServer: Connection established with remote client" << sClientIPAddress << ":" << iPeerPort << ", assigned ID" << conClient->iClientID << ".";
+    QMetaObject::invokeMethod(objEventReceiver, "EpollSessionOpenedEventHandler", Qt::QueuedConnection, Q_ARG(int, conClient->iClientID), Q_ARG(QString, sClientIPAddress), Q_ARG(quint16, iPeerPort));
+    return;
+}
+
+void EpollServerEngine::CloseConnection(EpollIOContext * ctxIOThread, EpollConnection * conClient, QAbstractSocket::SocketError errErrorInfo, bool bIsReported) {
+    if (conClient->iSocketDescriptor < 0) {
+        return;
+    }
+
+    //Closing the descriptor removes it from the epoll instance
+    close(conClient->iSocketDescriptor);
+    conClient->iSocketDescriptor = -1;
+    ctxIOThread->hshConnections.remove(conClient->iClientID);
+    ctxIOThread->lstReadyConnections.removeAll(conClient);
+    ctxIOThread->lstFlushConnections.removeAll(conClient);
+    ctxIOThread->lstClosedConnections.append(conClient);
+    ctxIOThread->iConnectionCount.fetchAndAddRelaxed(-1);
+
+    //Keep counters of the session in engine's sums, before the lock is released so that scrapes never see them dip
+    QWriteLocker lckSessionRegistry(&rwlSessionRegistry);
+    hshSessions.remove(conClient->iClientID);
+    hshSessionIDsByEndpoint.remove(qMakePair(conClient->iPeerAddress, conClient->iPeerPort));
+    cntClosedFramesReceived.Add(conClient->cntFramesReceived.Get());
+    cntClosedBytesReceived.Add(conClient->cntBytesReceived.Get());
+    cntClosedCommandsExecuted.Add(conClient->cntCommandsExecuted.Get());
+    cntClosedCommandsRejected.Add(conClient->cntCommandsRejected.Get());
+    cntClosedFramesSent.Add(conClient->cntFramesSent.Get());
+    cntClosedBytesSent.Add(conClient->cntBytesSent.Get());
+    cntClosedOutputFramesDropped.Add(conClient->cntOutputFramesDropped.Get());
+    cntSlowClients.Add(conClient->cntSlowClientDisconnects.Get());
+    cntSessionsClosed.Add();
+    lckSessionRegistry.unlock();
+
+    //Commands still waiting would be answered to nobody
+    excCommands->RemoveClient(conClient->iClientID);
+
+    //Inform the event receiver of a disconnected client
+    if (bIsReported) {
+        QString sClientIPAddress = QHostAddress(conClient->iPeerAddress).toString();
+        qDebug() << "TCPServer: Remote client" << sClientIPAddress << "disconnected.";
+        QMetaObject::invokeMethod(objEventReceiver, "EpollSessionClosedEventHandler", Qt::QueuedConnection, Q_ARG(int, conClient->iClientID), Q_ARG(QAbstractSocket::SocketError, errErrorInfo), Q_ARG(QString, sClientIPAddress), Q_ARG(quint16, conClient->iPeerPort));
+    }
+    return;
+}
+
+void EpollServerEngine::ReadConnection(EpollIOContext * ctxIOThread, EpollConnection * conClient) {
+    //Read until EAGAIN, or until other connections deserve a turn
+    char * chrReadBuffer = ctxIOThread->baReadBuffer.data();
+    bool bIsDrained = false;
+    for (int iReadCount = 0; iReadCount < NET_EPOLL_READS_PER_EVENT && !bIsDrained; ) {
+        ssize_t iBytesRead = read(conClient->iSocketDescriptor, chrReadBuffer, NET_EPOLL_READ_BUFFER_BYTES);
+        if (iBytesRead > 0) {
+            //The decoder keeps the bytes, a copy is required as the read buffer is reused
+            conClient->cntBytesReceived.Add(iBytesRead);
+            conClient->decLineDecoder.Append(QByteArray(chrReadBuffer, iBytesRead));
+            ++iReadCount;
+        }
+        else if (iBytesRead == 0) {
+            EpollServerEngine::ProcessLines(ctxIOThread, conClient);
+            EpollServerEngine::CloseConnection(ctxIOThread, conClient, QAbstractSocket::RemoteHostClosedError, true);
+            return;
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            bIsDrained = true;
+        }
+        else if (errno != EINTR) {
+            EpollServerEngine::CloseConnection(ctxIOThread, conClient, EpollServerEngine::GetSocketError(errno), true);
+            return;
+        }
+    }
+
+    //Edge-triggered events are not reported again for bytes left in the socket, they are read in the next turn
+    if (!bIsDrained) {
+        conClient->bIsReadPending = true;
+        ctxIOThread->lstReadyConnections.append(conClient);
+    }
+    EpollServerEngine::ProcessLines(ctxIOThread, conClient);
+    return;
+}
+
+void EpollServerEngine::ProcessLines(EpollIOContext * ctxIOThread, EpollConnection * conClient) {
+    //Take complete command lines out, a partial line is kept until the rest of it is received
+    QList<QByteArray> lstCommands;
+    QByteArray baData;
+    while (conClient->iSocketDescriptor >= 0 && conClient->decLineDecoder.NextLine(baData)) {
+        //Binary framing is not served by this backend, the client keeps using text mode
+        if (baData == NET_FRAMING_REQUEST_BINARY || baData == NET_FRAMING_REQUEST_COMPRESSED) {
+            EpollServerEngine::WriteOutput(ctxIOThread, conClient, NET_FRAMING_REPLY_TEXT "\n", false);
+            continue;
+        }
+
+        //Pings are answered at once, pongs are never expected
+        QByteArray baHeartbeatPayload;
+        HeartbeatMonitor::MessageKind iHeartbeatKind = HeartbeatMonitor::ParseLine(baData, baHeartbeatPayload);
+        if (iHeartbeatKind == HeartbeatMonitor::Ping) {
+            QByteArray baPong;
+            HeartbeatMonitor::AppendPong(baPong, NetworkingFramingText, baHeartbeatPayload);
+            EpollServerEngine::WriteOutput(ctxIOThread, conClient, baPong, false);
+            continue;
+        }
+        if (iHeartbeatKind == HeartbeatMonitor::Pong) {
+            continue;
+        }
+        lstCommands.append(baData);
+    }
+    if (conClient->iSocketDescriptor >= 0 && conClient->decLineDecoder.IsCorrupted()) {
+        qDebug() << "TCPServer: Too long command line received from remote client" << conClient->iClientID << ", connection aborted.";
+        EpollServerEngine::CloseConnection(ctxIOThread, conClient, QAbstractSocket::UnknownSocketError, true);
+    }
+    if (conClient->iSocketDescriptor < 0) {
+        return; //Commands of a closed connection would be answered to nobody
+    }
+
+    //Commands with a handler are queued to the command executor, other commands are passed to the event receiver, exactly like the Qt backend
+    conClient->cntFramesReceived.Add(lstCommands.size());
+    QList<QByteArray> lstUnhandledCommands;
+    for (int i = 0; i < lstCommands.size(); ++i) {
+        NetworkingCommandExecutor::SubmitResult iSubmitResult = excCommands->Submit(conClient->iClientID, lstCommands.at(i));
+        if (iSubmitResult == NetworkingCommandExecutor::Queued) {
+            conClient->cntCommandsExecuted.Add();
+        }
+        else if (iSubmitResult == NetworkingCommandExecutor::Rejected) {
+            conClient->cntCommandsRejected.Add();
+            EpollServerEngine::WriteOutput(ctxIOThread, conClient, QByteArray(NET_COMMAND_REPLY_BUSY " ") + NetworkingCommandTable::PeekVerb(lstCommands.at(i)) + '\n', true);
+        }
+        else {
+            lstUnhandledCommands.append(lstCommands.at(i));
+        }
+    }
+    if (!lstUnhandledCommands.isEmpty()) {
+        QMetaObject::invokeMethod(objEventReceiver, "EpollCommandsReceivedEventHandler", Qt::QueuedConnection, Q_ARG(int, conClient->iClientID), Q_ARG(QList<QByteArray>, lstUnhandledCommands), Q_ARG(QString, QHostAddress(conClient->iPeerAddress).toString()), Q_ARG(quint16, conClient->iPeerPort));
+    }
+    return;
+}
+
+void EpollServerEngine::WriteOutput(EpollIOContext * ctxIOThread, EpollConnection * conClient, const QByteArray & baMessage, bool bIsResponse) {
+    if (conClient->iSocketDescriptor < 0) {
+        return;
+    }
+
+    //A response which does not fit in the budget is dropped, or costs the client its connection
+    //Corked bytes count as well as bytes refused by the socket, otherwise a loop turn appending to a writable connection would have no bound
+    if (bIsResponse && conClient->baOutput.size() + baMessage.size() > static_cast<int>(iOutputQueueMaxBytes)) {
+        conClient->cntOutputFramesDropped.Add();
+        if (static_cast<int>(iSlowClientPolicy) == TCPServerSocket::Disconnect) {
+            qDebug() << "TCPServer: Remote client" << conClient->iClientID << "is too slow to read responses, connection aborted.";
+            conClient->cntSlowClientDisconnects.Add();
+            EpollServerEngine::CloseConnection(ctxIOThread, conClient, QAbstractSocket::SocketResourceError, true);
+        }
+        return;
+    }
+
+    //Cork the message, a single message is shared without copying, following ones are appended
+    conClient->baOutput.append(baMessage);
+    conClient->lstOutputMessageSizes.append(baMessage.size());
+    if (bIsResponse) {
+        conClient->cntFramesSent.Add();
+    }
+    if (conClient->bIsWritable) {
+        if (!conClient->bIsFlushPending) {
+            conClient->bIsFlushPending = true;
+            ctxIOThread->lstFlushConnections.append(conClient);
+        }
+        return;
+    }
+    conClient->iOutputQueueBytesMetric.fetchAndStoreRelaxed(conClient->baOutput.size());
+    conClient->iOutputQueueFramesMetric.fetchAndStoreRelaxed(conClient->lstOutputMessageSizes.size());
+    conClient->cntOutputQueueHighWater.SetMax(conClient->baOutput.size());
+    return;
+}
+
+void EpollServerEngine::FlushPendingOutputs(EpollIOContext * ctxIOThread) {
+    QList<EpollConnection *> lstFlushConnections;
+    lstFlushConnections.swap(ctxIOThread->lstFlushConnections);
+    for (int i = 0; i < lstFlushConnections.size(); ++i) {
+        EpollConnection * conClient = lstFlushConnections.at(i);
+        conClient->bIsFlushPending = false;
+        if (conClient->iSocketDescriptor >= 0) {
+            EpollServerEngine::FlushOutput(ctxIOThread, conClient);
+        }
+    }
+    return;
+}
+
+void EpollServerEngine::FlushOutput(EpollIOContext * ctxIOThread, EpollConnection * conClient) {
+    int iOutputOffset = 0;
+    while (conClient->bIsWritable && iOutputOffset < conClient->baOutput.size()) {
+        int iBytesWritten = EpollServerEngine::WriteSocket(ctxIOThread, conClient, conClient->baOutput.constData() + iOutputOffset, conClient->baOutput.size() - iOutputOffset);
+        if (iBytesWritten < 0) {
+            return;
+        }
+        iOutputOffset += iBytesWritten;
+    }
+    if (iOutputOffset >= conClient->baOutput.size()) {
+        conClient->baOutput.clear();
+        conClient->lstOutputMessageSizes.clear();
+    }
+    else if (iOutputOffset > 0) {
+        conClient->baOutput.remove(0, iOutputOffset);
+
+        //Messages written completely leave the queue, the first one left may have been written partly
+        while (iOutputOffset > 0 && !conClient->lstOutputMessageSizes.isEmpty()) {
+            if (iOutputOffset < conClient->lstOutputMessageSizes.first()) {
+                conClient->lstOutputMessageSizes.first() -= iOutputOffset;
+                break;
+            }
+            iOutputOffset -= conClient->lstOutputMessageSizes.takeFirst();
+        }
+    }
+    conClient->iOutputQueueBytesMetric.fetchAndStoreRelaxed(conClient->baOutput.size());
+    conClient->iOutputQueueFramesMetric.fetchAndStoreRelaxed(conClient->lstOutputMessageSizes.size());
+    conClient->cntOutputQueueHighWater.SetMax(conClient->baOutput.size());
+    return;
+}
+
+int EpollServerEngine::WriteSocket(EpollIOContext * ctxIOThread, EpollConnection * conClient, const char * chrData, int iDataLength) {
+    forever {
+        ssize_t iBytesWritten = send(conClient->iSocketDescriptor, chrData, iDataLength, MSG_NOSIGNAL);
+        if (iBytesWritten >= 0) {
+            //A short write means the socket's buffer is full, EPOLLOUT is reported once it has room
+            if (iBytesWritten < iDataLength) {
+                conClient->bIsWritable = false;
+            }
+            conClient->cntBytesSent.Add(iBytesWritten);
+            return static_cast<int>(iBytesWritten);
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            conClient->bIsWritable = false;
+            return 0;
+        }
+        if (errno != EINTR) {
+            EpollServerEngine::CloseConnection(ctxIOThread, conClient, EpollServerEngine::GetSocketError(errno), true);
+            return -1;
+        }
+    }
+    return -1;
+}
+
+QAbstractSocket::SocketError EpollServerEngine::GetSocketError(int iErrorNumber) {
+    switch (iErrorNumber) {
+    case ECONNRESET:
+    case EPIPE:
+        return QAbstractSocket::RemoteHostClosedError;
+    case ETIMEDOUT:
+        return QAbstractSocket::SocketTimeoutError;
+    case ENETUNREACH:
+    case EHOSTUNREACH:
+        return QAbstractSocket::NetworkError;
+    case ENOMEM:
+    case ENOBUFS:
+        return QAbstractSocket::SocketResourceError;
+    default:
+        return QAbstractSocket::UnknownSocketError;
+    }
+}
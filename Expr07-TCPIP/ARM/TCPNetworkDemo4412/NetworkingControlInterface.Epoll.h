@@ -0,0 +1,215 @@
+/*
+ * NETWORKING CONTROL INTERFACE :: EPOLL
+ *
+ * This file is an alternative backend of TCP Server Object, built directly on Linux epoll for thousands of command connections.
+ * The Qt backend creates a QTcpSocket-based object for each client, with its own socket notifiers, timer, buffers and signal connections.
+ * This backend keeps a compact connection struct for each client instead, served by one of several IO threads:
+ *   Every IO thread has its own epoll instance and its own listening socket bound to the same port with SO_REUSEPORT, so that the kernel spreads
+ *   accepted connections across IO threads without a shared accept lock. On kernels without SO_REUSEPORT (before 3.9), the first IO thread
+ *   accepts all connections and hands them out to IO threads in turn.
+ *   Sockets are non-blocking and registered edge-triggered, they are read and written until EAGAIN whenever epoll reports them. A connection which
+ *   keeps sending is read NET_EPOLL_READS_PER_EVENT times at most, then other connections of the IO thread are served before it is read again.
+ *   Data sent from other threads is posted to the IO thread's inbox, which wakes its epoll_wait() up with an eventfd.
+ *   Output is corked: responses, replies and broadcasts of a loop turn are appended to the connection's output, and written with a single
+ *   send() per connection when the turn ends, so that a batch of replies or broadcasts costs one syscall per client instead of one per message.
+ * TCPServer keeps its public API on top of either backend, the backend is chosen with ServerBackend in ini file when the server object is created.
+ * Commands are parsed, executed and passed to upper layers exactly like the Qt backend does. Differences from the Qt backend:
+ *   Connections always use text framing, binary framing requests are answered with NET_FRAMING_REPLY_TEXT.
+ *   Client's pings are answered, but the server never pings clients.
+ *   Output is kept as one byte stream whose messages are only counted, thus a response which does not fit in a client's output budget (bytes
+ *   corked in the current loop turn included) is dropped itself (DropOldest and Coalesce policies), or the client is disconnected (Disconnect policy).
+ *   When the process runs out of file descriptors, pending connections are accepted and closed at once with a reserved descriptor, since the
+ *   edge-triggered listening socket would not be reported again while they wait.
+ * Linux only, like the board this project runs on.
+ *
+ * This file is a part of DataSourceProvider, but was separated for easier maintainance.
+ * For DataFrames' definitions and stream operators, please refer to DataSourceProvider.
+ *
+ */
+
+#ifndef NETWORKINGCONTROLINTERFACE_EPOLL_H
+#define NETWORKINGCONTROLINTERFACE_EPOLL_H
+
+#include "NetworkingControlInterface.Commands.h"
+#include "NetworkingControlInterface.Framing.h"
+#include "NetworkingControlInterface.Metrics.h"
+#include "NetworkingControlInterface.Server.h"
+#include <QAbstractSocket>
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QPair>
+#include <QReadWriteLock>
+#include <QString>
+#include <QThread>
+#include <QVector>
+
+/* IO Thread Options */
+#define NET_EPOLL_MAX_EVENTS        256 //Events taken by one epoll_wait() call
+#define NET_EPOLL_READ_BUFFER_BYTES 65536 //Bytes read by one read() call
+#define NET_EPOLL_READS_PER_EVENT   16 //Reads of a connection before other connections are served
+#define NET_EPOLL_LISTEN_BACKLOG    1024 //Pending connections of each listening socket
+
+/* Epoll Connection */
+//Compact state of a connection, used by its IO thread only, except the immutable fields and the counters which are read by any thread holding the registry lock
+struct EpollConnection {
+    int iSocketDescriptor; //-1 once closed
+    int iClientID;
+    int iIOThreadIndex; //IO thread serving the connection
+    quint32 iPeerAddress; //IPv4 address, in host byte order
+    quint16 iPeerPort;
+    bool bIsWritable; //Cleared when the socket refuses bytes, set again by EPOLLOUT
+    bool bIsReadPending; //Marks if the connection is in its IO thread's ready list
+    bool bIsFlushPending; //Marks if the connection is in its IO thread's flush list
+    TextLineDecoder decLineDecoder; //Reassembles command lines
+    QByteArray baOutput; //Bytes not written yet, written at the end of the loop turn, or when the socket is writable again
+    QList<int> lstOutputMessageSizes; //Bytes of each message in baOutput, the first one is reduced as it is written partly
+
+    /* Metrics */
+    NetworkingCounter cntFramesReceived;
+    NetworkingCounter cntBytesReceived;
+    NetworkingCounter cntCommandsExecuted; //Commands handed to registered handlers
+    NetworkingCounter cntCommandsRejected;
+    NetworkingCounter cntFramesSent;
+    NetworkingCounter cntBytesSent;
+    NetworkingCounter cntOutputFramesDropped;
+    NetworkingCounter cntOutputQueueHighWater;
+    NetworkingCounter cntSlowClientDisconnects;
+    QAtomicInt iOutputQueueBytesMetric; //Copy of the output's size for metrics
+    QAtomicInt iOutputQueueFramesMetric; //Copy of the number of messages in the output for metrics
+};
+
+/* Epoll Inbox Message */
+//Posted to an IO thread by other threads
+struct EpollInboxMessage {
+    enum Kind {
+        SendToClient = 0, //Queue baData to iClientID
+        SendToAll = 1, //Queue baData to every client of the IO thread
+        AddListener = 2, //Take over the listening socket iSocketDescriptor
+        RemoveListener = 3, //Close the listening socket
+        AdoptConnection = 4, //Take over the accepted socket iSocketDescriptor, from iPeerAddress:iPeerPort
+        Quit = 5 //Close all connections and return
+    };
+
+    Kind iKind;
+    int iClientID;
+    int iSocketDescriptor;
+    quint32 iPeerAddress;
+    quint16 iPeerPort;
+    QByteArray baData; //Encoded already, shared by all receivers
+};
+
+/* Epoll IO Thread Context */
+struct EpollIOContext {
+    int iIOThreadIndex;
+    int iEpollDescriptor;
+    int iWakeupDescriptor; //eventfd, written when the inbox becomes non-empty
+    int iListeningDescriptor; //-1 when not listening, used by the IO thread only
+    int iReserveDescriptor; //Spare descriptor on /dev/null, released to accept and close a connection when the process is out of descriptors, -1 if unavailable
+    QThread * trdIOThread;
+    QMutex mtxInbox; //Protects lstInbox
+    QList<EpollInboxMessage> lstInbox;
+    QAtomicInt iConnectionCount; //Load of the IO thread
+
+    /* Used by the IO thread only */
+    QHash<int, EpollConnection *> hshConnections; //Connections served, indexed by client ID
+    QList<EpollConnection *> lstReadyConnections; //Connections with bytes left to read after NET_EPOLL_READS_PER_EVENT reads
+    QList<EpollConnection *> lstFlushConnections; //Writable connections with output appended in the current loop turn
+    QList<EpollConnection *> lstClosedConnections; //Deleted once the current epoll events have been handled, since later events may still point to them
+    QByteArray baReadBuffer; //NET_EPOLL_READ_BUFFER_BYTES bytes, reused by every read
+    int iNextIOThread; //Next IO thread an accepted connection is handed to, without SO_REUSEPORT
+};
+
+/* Epoll Server Engine */
+//Owned by TCP Server Object, all public functions are thread-safe
+//Session events are posted to the event receiver's thread by invoking its slots:
+//  EpollSessionOpenedEventHandler(int iClientID, QString sClientIPAddress, quint16 iClientPort)
+//  EpollSessionClosedEventHandler(int iClientID, QAbstractSocket::SocketError errErrorInfo, QString sClientIPAddress, quint16 iClientPort), UnknownSocketError if closed by the server without an error
+//  EpollCommandsReceivedEventHandler(int iClientID, QList<QByteArray> lstCommands, QString sClientIPAddress, quint16 iClientPort), commands without a handler
+class EpollServerEngine {
+public:
+    EpollServerEngine(QObject * objEventReceiverInit, NetworkingCommandExecutor * excCommandsInit, int iIOThreadCount); //Start IO threads, both objects must outlive the engine
+    ~EpollServerEngine(); //Close all connections without informing the event receiver, and stop IO threads
+    bool IsValid() const; //Returns false if an epoll instance or an eventfd could not be created, such an engine has no IO thread and must be deleted
+
+    /* Options */
+    void SetOutputQueueOptions(int iOutputQueueMaxBytesNew, TCPServerSocket::SlowClientPolicy iSlowClientPolicyNew); //Takes effect immediately
+
+    /* Listening Status Management */
+    bool StartListening(quint16 iListeningPort); //Returns false if the first listening socket could not be created, the first IO thread accepts alone if others cannot listen
+    void StopListening(); //Connections stay open
+    bool IsListening() const;
+
+    /* Text-Based Communication */
+    bool SendDataToClient(int iClientID, const QByteArray & baDataToSend); //Returns false if the client is not connected
+    void SendDataToClients(const QByteArray & baDataToSend, const QString & sClientName, const QString & sClientIPAddress, quint16 iClientPort); //Filters like TCPServer::SendDataToClient(), clients have no name
+
+    /* Session Registry */
+    int GetConnectedClientCount() const;
+    QList<int> GetConnectedClientIDs() const;
+    int FindClientID(const QString & sClientIPAddress, quint16 iClientPort) const;
+    bool GetClientInformation(int iClientID, QString & sClientName, QString & sClientIPAddress, quint16 & iClientPort) const;
+    bool GetClientOutputQueueDepth(int iClientID, int & iQueuedFrames, int & iQueuedBytes) const; //Frames are messages corked or waiting, a partly written one included
+    QVector<int> GetIOThreadLoads() const;
+
+    /* Metrics */
+    void GetMetrics(TCPServerMetrics & mtrServer) const; //Fills everything but command executor's gauges
+
+private:
+    QObject * objEventReceiver; //INTERNAL: Receives session events, usually TCP Server Object
+    NetworkingCommandExecutor * excCommands; //INTERNAL: Runs commands with a handler
+    QVector<EpollIOContext *> arrIOContexts; //INTERNAL: One for each IO thread, empty if the engine is not valid
+    bool bIsValid; //INTERNAL: Marks if every IO thread has been started
+    bool bIsListening; //INTERNAL: Used by the thread owns the engine only
+    bool bIsReusePortSupported; //INTERNAL: Set before listening sockets are handed to IO threads, read by them afterwards
+    QAtomicInt iLastClientID; //INTERNAL: Last assigned client ID
+    QAtomicInt iOutputQueueMaxBytes; //INTERNAL: Output budget of each client
+    QAtomicInt iSlowClientPolicy; //INTERNAL: What to do with a client whose output does not fit in its budget
+
+    /* Session Registry */
+    //Modified by IO threads, read by any thread calling public functions, connections are deleted only after being removed
+    mutable QReadWriteLock rwlSessionRegistry; //INTERNAL: Protects everything in this section
+    QHash<int, EpollConnection *> hshSessions; //INTERNAL: Connected clients, indexed by ID
+    QHash<QPair<quint32, quint16>, int> hshSessionIDsByEndpoint; //INTERNAL: IDs of connected clients, indexed by IPv4 address and port
+
+    /* Metrics */
+    //Added to by any IO thread, while holding the registry lock for writing
+    NetworkingCounter cntSessionsAccepted;
+    NetworkingCounter cntSessionsClosed;
+    NetworkingCounter cntClosedFramesReceived; //INTERNAL: Counters of closed sessions
+    NetworkingCounter cntClosedBytesReceived;
+    NetworkingCounter cntClosedCommandsExecuted;
+    NetworkingCounter cntClosedCommandsRejected;
+    NetworkingCounter cntClosedFramesSent;
+    NetworkingCounter cntClosedBytesSent;
+    NetworkingCounter cntClosedOutputFramesDropped;
+    NetworkingCounter cntSlowClients;
+
+    /* IO Threads */
+    void RunIOThread(EpollIOContext * ctxIOThread); //INTERNAL: Body of an IO thread
+    void PostMessage(EpollIOContext * ctxIOThread, const EpollInboxMessage & msgInbox); //INTERNAL: Append to an IO thread's inbox, and wake it up if the inbox was empty
+    bool ProcessInbox(EpollIOContext * ctxIOThread); //INTERNAL: Handle posted messages, returns false on Quit
+    void DiscardInbox(const QList<EpollInboxMessage> & lstInbox, int iFirstMessage); //INTERNAL: Close sockets handed over by messages which will not be handled
+    bool RefuseConnection(EpollIOContext * ctxIOThread); //INTERNAL: Accept and close a pending connection with the reserved descriptor, returns false if there is none
+    void AcceptConnections(EpollIOContext * ctxIOThread); //INTERNAL: Accept until EAGAIN
+    void AddConnection(EpollIOContext * ctxIOThread, int iSocketDescriptor, quint32 iPeerAddress, quint16 iPeerPort); //INTERNAL: Register an accepted socket
+    void CloseConnection(EpollIOContext * ctxIOThread, EpollConnection * conClient, QAbstractSocket::SocketError errErrorInfo, bool bIsReported); //INTERNAL: Close and unregister, the struct is deleted later
+    void ReadConnection(EpollIOContext * ctxIOThread, EpollConnection * conClient); //INTERNAL: Read and handle received lines
+    void ProcessLines(EpollIOContext * ctxIOThread, EpollConnection * conClient); //INTERNAL: Answer framing requests and pings, dispatch commands
+    void WriteOutput(EpollIOContext * ctxIOThread, EpollConnection * conClient, const QByteArray & baMessage, bool bIsResponse); //INTERNAL: Append a message to the output, it is written when the loop turn ends
+    void FlushOutput(EpollIOContext * ctxIOThread, EpollConnection * conClient); //INTERNAL: Write kept bytes until the socket refuses them
+    void FlushPendingOutputs(EpollIOContext * ctxIOThread); //INTERNAL: Flush every connection in the flush list, at the end of a loop turn
+    int WriteSocket(EpollIOContext * ctxIOThread, EpollConnection * conClient, const char * chrData, int iDataLength); //INTERNAL: Returns bytes written, -1 if the connection has been closed
+    static int CreateListeningSocket(quint16 iListeningPort, bool & bIsReusePortRequired); //INTERNAL: Returns -1 on failure, bIsReusePortRequired is cleared if SO_REUSEPORT is not supported
+    static QAbstractSocket::SocketError GetSocketError(int iErrorNumber); //INTERNAL: Map errno like QAbstractSocket does
+    friend class EpollIOThread;
+
+    /* Disable Copying */
+    EpollServerEngine(const EpollServerEngine &);
+    EpollServerEngine & operator=(const EpollServerEngine &);
+};
+
+#endif // NETWORKINGCONTROLINTERFACE_EPOLL_H
@@ -0,0 +1,348 @@
+#include "NetworkingControlInterface.FrameQueue.h"
+#include <QElapsedTimer>
+#include <QMutexLocker>
+
+/* Lock-Free SPSC Data Frame Ring Buffer */
+DataFrameQueue::DataFrameQueue(int iCapacityInit) {
+    //Round the number of slots up to a power of 2, one slot is always kept empty to tell a full ring from an empty one
+    int iSlotCount = 2;
+    while (iSlotCount < iCapacityInit + 1) {
+        iSlotCount <<= 1;
+    }
+    iSlotIndexMask = iSlotCount - 1;
+
+    //Preallocate slots, QByteArray's default constructor shares the null data and does not allocate
+    arrSlots = new QByteArray[iSlotCount];
+
+    iHead = 0;
+    iTail = 0;
+    iIsWakeUpPending = 0;
+
+    //Initialize byte budget, no budget is applied until options are set
+    iBytesQueued = 0;
+    iMaxBytes = 0x7FFFFFFF;
+    iOverflowPolicy = DropOldest;
+    iBlockTimeout = 0;
+    iDecimationFactor = 1;
+    iDecimationCounter = 0;
+    iHighWatermark = 0x7FFFFFFF;
+    iLowWatermark = 0;
+    iIsAboveHighWatermark = 0;
+    iDroppedCount = 0;
+    iBytesQueuedHighWater = 0;
+    iIsProducerBlocked = 0;
+    iEnqueuedCount = 0;
+    iDequeuedCount = 0;
+    iWrittenCount = 0;
+    iLossCount = 0;
+    iDrainWaiterCount = 0;
+}
+
+DataFrameQueue::~DataFrameQueue() {
+    delete[] arrSlots;
+    arrSlots = NULL;
+}
+
+/* Producer Side */
+bool DataFrameQueue::Enqueue(const QByteArray & baData) {
+    //Apply overflow policy
+    int iFrameBytes = DataFrameQueue::GetFrameBytes(baData);
+    int iBytesQueuedCurrent = iBytesQueued.fetchAndAddAcquire(0);
+    if (iBytesQueuedCurrent + iFrameBytes > iMaxBytes) {
+        switch (iOverflowPolicy) {
+        case DropOldest: //Queued anyway, the consumer will drop the oldest data frames
+            break;
+        case BlockProducer:
+            if (!DataFrameQueue::WaitForBytesFreed(iFrameBytes)) {
+                iDroppedCount.ref();
+                return false;
+            }
+            break;
+        case DropNewest:
+        case Decimate:
+        default:
+            iDroppedCount.ref();
+            return false;
+        }
+    }
+    else if (iOverflowPolicy == Decimate && iBytesQueuedCurrent >= iHighWatermark) {
+        if (++iDecimationCounter < iDecimationFactor) {
+            iDroppedCount.ref();
+            return false;
+        }
+        iDecimationCounter = 0;
+    }
+
+    int iTailCurrent = iTail;
+    int iTailNext = (iTailCurrent + 1) & iSlotIndexMask;
+    if (iTailNext == iHead.fetchAndAddAcquire(0)) { //Ring is full
+        iDroppedCount.ref();
+        return false;
+    }
+
+    //Fill the slot, QByteArray is implicitly shared thus only a reference is taken here
+    arrSlots[iTailCurrent] = baData;
+    int iBytesQueuedNew = iBytesQueued.fetchAndAddOrdered(iFrameBytes) + iFrameBytes; //Charged before publishing, so that the consumer never sees a negative number
+    if (iBytesQueuedNew > static_cast<int>(iBytesQueuedHighWater)) {
+        iBytesQueuedHighWater.fetchAndStoreRelaxed(iBytesQueuedNew);
+    }
+
+    //Publish the slot to the consumer
+    iEnqueuedCount.fetchAndAddRelaxed(1); //Counted before publishing, so that the consumer never takes out more than queued
+    iTail.fetchAndStoreRelease(iTailNext);
+    return true;
+}
+
+bool DataFrameQueue::TryMarkWakeUpPending() {
+    return iIsWakeUpPending.testAndSetOrdered(0, 1);
+}
+
+bool DataFrameQueue::TryMarkHighWatermarkReached() {
+    if (iBytesQueued.fetchAndAddAcquire(0) < iHighWatermark) {
+        return false;
+    }
+    return iIsAboveHighWatermark.testAndSetOrdered(0, 1);
+}
+
+void DataFrameQueue::SetOverflowOptions(int iMaxBytesNew, OverflowPolicy iOverflowPolicyNew, int iBlockTimeoutNew, int iDecimationFactorNew,
+                                        int iHighWatermarkNew, int iLowWatermarkNew) {
+    //Validate options
+    if (iMaxBytesNew < 1) {
+        iMaxBytesNew = 1;
+    }
+    if (iBlockTimeoutNew < 0) {
+        iBlockTimeoutNew = 0;
+    }
+    if (iDecimationFactorNew < 1) {
+        iDecimationFactorNew = 1;
+    }
+    if (iHighWatermarkNew > iMaxBytesNew) {
+        iHighWatermarkNew = iMaxBytesNew;
+    }
+    if (iLowWatermarkNew > iHighWatermarkNew) {
+        iLowWatermarkNew = iHighWatermarkNew;
+    }
+
+    iMaxBytes.fetchAndStoreOrdered(iMaxBytesNew);
+    iOverflowPolicy.fetchAndStoreOrdered(iOverflowPolicyNew);
+    iBlockTimeout = iBlockTimeoutNew;
+    iDecimationFactor = iDecimationFactorNew;
+    iDecimationCounter = 0;
+    iHighWatermark = iHighWatermarkNew;
+    iLowWatermark.fetchAndStoreOrdered(iLowWatermarkNew);
+    return;
+}
+
+/* Consumer Side */
+bool DataFrameQueue::Dequeue(QByteArray & baData) {
+    int iHeadCurrent = iHead;
+    if (iHeadCurrent == iTail.fetchAndAddAcquire(0)) { //Ring is empty
+        return false;
+    }
+
+    //Move data out of the slot, leaving a null string in it
+    baData.clear();
+    baData.swap(arrSlots[iHeadCurrent]);
+
+    //Return the slot and its bytes to the producer
+    ++iDequeuedCount;
+    iHead.fetchAndStoreRelease((iHeadCurrent + 1) & iSlotIndexMask);
+    iBytesQueued.fetchAndAddOrdered(-DataFrameQueue::GetFrameBytes(baData));
+    DataFrameQueue::NotifyBytesFreed();
+    return true;
+}
+
+int DataFrameQueue::Clear() {
+    int iFramesDropped = 0;
+    QByteArray baDiscardedData;
+    while (DataFrameQueue::Dequeue(baDiscardedData)) {
+        ++iFramesDropped;
+    }
+    return iFramesDropped;
+}
+
+int DataFrameQueue::TrimToByteBudget() {
+    if (iOverflowPolicy != DropOldest) {
+        return 0;
+    }
+
+    int iFramesDropped = 0;
+    QByteArray baDiscardedData;
+    while (iBytesQueued.fetchAndAddAcquire(0) > iMaxBytes && DataFrameQueue::Dequeue(baDiscardedData)) {
+        ++iFramesDropped;
+    }
+    iDroppedCount.fetchAndAddOrdered(iFramesDropped);
+    return iFramesDropped;
+}
+
+void DataFrameQueue::ClearWakeUpPending() {
+    iIsWakeUpPending.fetchAndStoreOrdered(0);
+    return;
+}
+
+bool DataFrameQueue::TryMarkLowWatermarkReached() {
+    if (iBytesQueued.fetchAndAddAcquire(0) > iLowWatermark) {
+        return false;
+    }
+    return iIsAboveHighWatermark.testAndSetOrdered(1, 0);
+}
+
+/* Drain Tracking */
+quint32 DataFrameQueue::EnqueuedCount() const {
+    return static_cast<quint32>(iEnqueuedCount.fetchAndAddAcquire(0));
+}
+
+void DataFrameQueue::MarkDequeuedFramesWritten() {
+    if (iWrittenCount == iDequeuedCount) {
+        return;
+    }
+    DataFrameQueue::PublishWrittenCount(iDequeuedCount);
+    return;
+}
+
+int DataFrameQueue::MarkDequeuedFramesLost(int iFramesKept) {
+    int iFramesLost = iDequeuedCount - iFramesKept - iWrittenCount;
+    if (iFramesLost <= 0) {
+        return 0;
+    }
+
+    //Counted before the data frames leave the queue, so that a waiter woken up by them sees the loss
+    iLossCount.fetchAndAddOrdered(1);
+    DataFrameQueue::PublishWrittenCount(iDequeuedCount - iFramesKept);
+    return iFramesLost;
+}
+
+void DataFrameQueue::PublishWrittenCount(int iWrittenCountNew) {
+    //Publish first, then check for waiters, a waiter registers itself before checking, so that one of us always sees the other
+    iWrittenCount.fetchAndStoreOrdered(iWrittenCountNew);
+    if (iDrainWaiterCount.fetchAndAddOrdered(0)) {
+        QMutexLocker lckDrainLock(&mtxDrainLock);
+        wcdFramesWritten.wakeAll();
+    }
+    return;
+}
+
+bool DataFrameQueue::IsDrained() const {
+    return (iWrittenCount.fetchAndAddAcquire(0) == iEnqueuedCount.fetchAndAddAcquire(0));
+}
+
+bool DataFrameQueue::WaitForFramesWritten(quint32 iEnqueuedCountTarget, int iTimeout) {
+    QElapsedTimer tmrWaiting;
+    tmrWaiting.start();
+
+    QMutexLocker lckDrainLock(&mtxDrainLock);
+    iDrainWaiterCount.fetchAndAddOrdered(1);
+    int iLossCountStart = iLossCount.fetchAndAddOrdered(0);
+    bool bIsWritten = false;
+    while (true) {
+        //Counters wrap around, compare their distance
+        bIsWritten = (static_cast<int>(static_cast<quint32>(iWrittenCount.fetchAndAddOrdered(0)) - iEnqueuedCountTarget) >= 0);
+        if (bIsWritten) {
+            break;
+        }
+        if (iTimeout < 0) {
+            wcdFramesWritten.wait(&mtxDrainLock);
+            continue;
+        }
+        qint64 iTimeRemaining = iTimeout - tmrWaiting.elapsed();
+        if (iTimeRemaining <= 0) {
+            break;
+        }
+        wcdFramesWritten.wait(&mtxDrainLock, iTimeRemaining);
+    }
+    iDrainWaiterCount.fetchAndAddOrdered(-1);
+
+    //Lost data frames have left the queue without being written
+    if (bIsWritten && iLossCount.fetchAndAddOrdered(0) != iLossCountStart) {
+        bIsWritten = false;
+    }
+    return bIsWritten;
+}
+
+/* Status */
+int DataFrameQueue::Size() const {
+    return (iTail.fetchAndAddAcquire(0) - iHead.fetchAndAddAcquire(0)) & iSlotIndexMask;
+}
+
+bool DataFrameQueue::IsEmpty() const {
+    return (DataFrameQueue::Size() == 0);
+}
+
+int DataFrameQueue::Capacity() const {
+    return iSlotIndexMask;
+}
+
+int DataFrameQueue::BytesQueued() const {
+    return iBytesQueued.fetchAndAddAcquire(0);
+}
+
+int DataFrameQueue::DroppedCount() const {
+    return iDroppedCount.fetchAndAddAcquire(0);
+}
+
+int DataFrameQueue::BytesQueuedHighWater() const {
+    return iBytesQueuedHighWater.fetchAndAddAcquire(0);
+}
+
+int DataFrameQueue::GetFrameBytes(const QByteArray & baData) {
+    return baData.size();
+}
+
+/* Overflow Policy Names */
+QString DataFrameQueue::GetOverflowPolicyName(OverflowPolicy iOverflowPolicy) {
+    switch (iOverflowPolicy) {
+    case DropNewest:
+        return "DropNewest";
+    case BlockProducer:
+        return "Block";
+    case Decimate:
+        return "Decimate";
+    case DropOldest:
+    default:
+        return "DropOldest";
+    }
+}
+
+DataFrameQueue::OverflowPolicy DataFrameQueue::GetOverflowPolicyByName(const QString & sOverflowPolicyName) {
+    if (sOverflowPolicyName.compare("DropNewest", Qt::CaseInsensitive) == 0) {
+        return DropNewest;
+    }
+    else if (sOverflowPolicyName.compare("Block", Qt::CaseInsensitive) == 0) {
+        return BlockProducer;
+    }
+    else if (sOverflowPolicyName.compare("Decimate", Qt::CaseInsensitive) == 0) {
+        return Decimate;
+    }
+    return DropOldest;
+}
+
+/* Producer Blocking */
+bool DataFrameQueue::WaitForBytesFreed(int iBytesRequired) {
+    QElapsedTimer tmrBlocked;
+    tmrBlocked.start();
+
+    QMutexLocker lckProducerBlockingLock(&mtxProducerBlockingLock);
+    iIsProducerBlocked.fetchAndStoreOrdered(1); //Set before checking, so that the consumer can not miss us
+    bool bIsSpaceAvailable = false;
+    while (true) {
+        bIsSpaceAvailable = (iBytesQueued.fetchAndAddAcquire(0) + iBytesRequired <= iMaxBytes);
+        if (bIsSpaceAvailable) {
+            break;
+        }
+        qint64 iTimeRemaining = iBlockTimeout - tmrBlocked.elapsed();
+        if (iTimeRemaining <= 0) {
+            break;
+        }
+        wcdBytesFreed.wait(&mtxProducerBlockingLock, iTimeRemaining);
+    }
+    iIsProducerBlocked.fetchAndStoreOrdered(0);
+    return bIsSpaceAvailable;
+}
+
+void DataFrameQueue::NotifyBytesFreed() {
+    if (iIsProducerBlocked.fetchAndAddAcquire(0)) {
+        QMutexLocker lckProducerBlockingLock(&mtxProducerBlockingLock);
+        wcdBytesFreed.wakeAll();
+    }
+    return;
+}
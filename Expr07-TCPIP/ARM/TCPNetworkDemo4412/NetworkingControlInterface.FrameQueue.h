@@ -0,0 +1,128 @@
+/*
+ * NETWORKING CONTROL INTERFACE :: FRAME QUEUE
+ *
+ * This file is the outbound data frame queue of networking interface (client side).
+ * It is a bounded lock-free single-producer/single-consumer ring buffer with preallocated slots.
+ * The producer is the thread calling TCPClient::QueueDataFrame(), the consumer is the TCPClientDataSender thread.
+ *
+ * Besides the number of slots, the queue is bounded by a byte budget. When a data frame does not fit in the budget, the overflow policy decides what happens:
+ *   Drop oldest: The data frame is queued, and the consumer drops the oldest data frames until the queue fits in the budget again.
+ *   Drop newest: The data frame is dropped.
+ *   Block: The producer waits (with a timeout) until the consumer has freed enough bytes, and drops the data frame on timeout.
+ *   Decimate: Above the high watermark, only 1 of every N data frames is queued. Data frames which do not fit in the budget are dropped.
+ * High/low watermarks with hysteresis let producers throttle themselves before data frames are dropped.
+ * Every data frame queued is counted, and the consumer reports when data frames taken out have been written (or dropped), so that other threads
+ * can wait with a timeout until everything queued up to some point has left the queue. Data frames taken out and lost with the connection
+ * also leave the queue, but a thread waiting meanwhile is told that the wait failed.
+ *
+ * This file is a part of DataSourceProvider, but was separated for easier maintainance.
+ * For DataFrames' definitions and stream operators, please refer to DataSourceProvider.
+ *
+ */
+
+#ifndef NETWORKINGCONTROLINTERFACE_FRAMEQUEUE_H
+#define NETWORKINGCONTROLINTERFACE_FRAMEQUEUE_H
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QByteArray>
+#include <QString>
+#include <QWaitCondition>
+
+/* Data Queue */
+#define NET_DATA_QUEUE_MAX_ITEM_COUNT 40960 //Max number of data frames, to avoid huge memory consumption
+
+/* Lock-Free SPSC Data Frame Ring Buffer */
+//Only ONE thread may call producer side functions, and only ONE (other) thread may call consumer side functions
+class DataFrameQueue {
+public:
+    /* Overflow Policies */
+    enum OverflowPolicy {
+        DropOldest = 0,
+        DropNewest = 1,
+        BlockProducer = 2,
+        Decimate = 3
+    };
+
+    explicit DataFrameQueue(int iCapacityInit = NET_DATA_QUEUE_MAX_ITEM_COUNT);
+    ~DataFrameQueue();
+
+    /* Producer Side */
+    bool Enqueue(const QByteArray & baData); //Queue a data frame according to the overflow policy, returns false if the data frame is dropped
+    bool TryMarkWakeUpPending(); //Returns true if the caller is responsible for waking up the consumer
+    bool TryMarkHighWatermarkReached(); //Returns true if queued bytes have just reached the high watermark
+    void SetOverflowOptions(int iMaxBytesNew, OverflowPolicy iOverflowPolicyNew, int iBlockTimeoutNew, int iDecimationFactorNew,
+                            int iHighWatermarkNew, int iLowWatermarkNew); //Byte budget, policy, block timeout (in ms), decimation factor N, and watermarks (in bytes)
+
+    /* Consumer Side */
+    bool Dequeue(QByteArray & baData); //Take the oldest data frame, returns false if the ring is empty
+    int Clear(); //Drop all queued data frames, returns the number of data frames dropped
+    int TrimToByteBudget(); //Drop oldest data frames until the queue fits in the budget (drop oldest policy only), returns the number of data frames dropped
+    void ClearWakeUpPending(); //Must be called before the consumer checks the ring for the last time
+    bool TryMarkLowWatermarkReached(); //Returns true if queued bytes have just fallen to the low watermark after reaching the high watermark
+
+    /* Drain Tracking */
+    quint32 EnqueuedCount() const; //Number of data frames queued since created, wraps around
+    void MarkDequeuedFramesWritten(); //Consumer side, every data frame taken out so far has been written to the socket or dropped
+    int MarkDequeuedFramesLost(int iFramesKept); //Consumer side, data frames taken out and not marked written yet have been lost with the connection, except the newest iFramesKept ones the consumer still holds. Returns the number of data frames lost
+    bool IsDrained() const; //Returns true if every data frame queued has been written, dropped or lost
+    bool WaitForFramesWritten(quint32 iEnqueuedCountTarget, int iTimeout); //Block until the first iEnqueuedCountTarget data frames have been written, dropped or lost, or timeout (in ms, -1 for none). Returns false on timeout, or if data frames were lost meanwhile. Must not be called by the consumer
+
+    /* Status */
+    int Size() const; //Number of queued data frames, a snapshot when called from the other side
+    bool IsEmpty() const;
+    int Capacity() const; //Max number of data frames can be queued
+    int BytesQueued() const; //Number of bytes of queued data frames
+    int DroppedCount() const; //Number of data frames dropped since created
+    int BytesQueuedHighWater() const; //Max number of bytes queued since created
+    static int GetFrameBytes(const QByteArray & baData); //Number of bytes a data frame is charged for
+
+    /* Overflow Policy Names */
+    static QString GetOverflowPolicyName(OverflowPolicy iOverflowPolicy); //Name used in ini file
+    static OverflowPolicy GetOverflowPolicyByName(const QString & sOverflowPolicyName); //Returns DropOldest for unknown names
+
+private:
+    QByteArray * arrSlots; //INTERNAL: Preallocated slots, the number of slots is a power of 2 and one slot is always kept empty
+    int iSlotIndexMask; //INTERNAL: Number of slots - 1
+    mutable QAtomicInt iHead; //INTERNAL: Next slot to read, only written by the consumer
+    mutable QAtomicInt iTail; //INTERNAL: Next slot to write, only written by the producer
+    QAtomicInt iIsWakeUpPending; //INTERNAL: Marks if a wake-up has been posted to the consumer and not yet handled
+
+    /* Byte Budget */
+    mutable QAtomicInt iBytesQueued; //INTERNAL: Added by the producer, subtracted by the consumer
+    QAtomicInt iMaxBytes; //INTERNAL: Byte budget, read by both sides
+    QAtomicInt iOverflowPolicy; //INTERNAL: Overflow policy, read by both sides
+    int iBlockTimeout; //INTERNAL: Max time (in ms) the producer is blocked
+    int iDecimationFactor; //INTERNAL: 1 of every iDecimationFactor data frames is queued above the high watermark
+    int iDecimationCounter; //INTERNAL: Counts data frames offered above the high watermark
+    int iHighWatermark; //INTERNAL: High watermark in bytes
+    QAtomicInt iLowWatermark; //INTERNAL: Low watermark in bytes, read by the consumer
+    QAtomicInt iIsAboveHighWatermark; //INTERNAL: Set by the producer at the high watermark, cleared by the consumer at the low watermark
+    mutable QAtomicInt iDroppedCount; //INTERNAL: Number of dropped data frames
+    mutable QAtomicInt iBytesQueuedHighWater; //INTERNAL: Max of iBytesQueued, only written by the producer
+
+    /* Producer Blocking */
+    QMutex mtxProducerBlockingLock; //INTERNAL: Protects wcdBytesFreed
+    QWaitCondition wcdBytesFreed; //INTERNAL: Signalled by the consumer when bytes are freed while the producer is blocked
+    QAtomicInt iIsProducerBlocked; //INTERNAL: Marks if the producer is waiting, the consumer only takes the lock when it is set
+
+    bool WaitForBytesFreed(int iBytesRequired); //INTERNAL: Block the producer until iBytesRequired bytes fit in the budget, or timeout
+    void NotifyBytesFreed(); //INTERNAL: Wake up the blocked producer, if any
+
+    /* Drain Tracking */
+    QAtomicInt iEnqueuedCount; //INTERNAL: Data frames queued, only written by the producer
+    int iDequeuedCount; //INTERNAL: Data frames taken out, only used by the consumer
+    QAtomicInt iWrittenCount; //INTERNAL: Data frames taken out and written, dropped or lost, only written by the consumer
+    QAtomicInt iLossCount; //INTERNAL: Number of times data frames have been lost, only written by the consumer
+    QMutex mtxDrainLock; //INTERNAL: Protects wcdFramesWritten
+    QWaitCondition wcdFramesWritten; //INTERNAL: Signalled by the consumer when iWrittenCount advances while someone is waiting
+    QAtomicInt iDrainWaiterCount; //INTERNAL: Number of threads waiting, the consumer only takes the lock when it is not zero
+
+    void PublishWrittenCount(int iWrittenCountNew); //INTERNAL: Consumer side, advance iWrittenCount and wake up waiters
+
+    /* Disable Copying */
+    DataFrameQueue(const DataFrameQueue &);
+    DataFrameQueue & operator=(const DataFrameQueue &);
+};
+
+#endif // NETWORKINGCONTROLINTERFACE_FRAMEQUEUE_H
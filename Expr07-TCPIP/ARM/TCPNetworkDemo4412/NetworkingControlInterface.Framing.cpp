@@ -0,0 +1,262 @@
+#include "NetworkingControlInterface.Framing.h"
+#include <cstring>
+
+/* Binary Frame Encoder */
+int BinaryFrameEncoder::GetHeaderLength(int iPayloadLength) {
+    int iHeaderLength = 2; //At least 1 byte of varint and 1 byte of message type
+    quint32 iRemainingLength = static_cast<quint32>(iPayloadLength) >> 7;
+    while (iRemainingLength) {
+        ++iHeaderLength;
+        iRemainingLength >>= 7;
+    }
+    return iHeaderLength;
+}
+
+int BinaryFrameEncoder::WriteHeader(char * chrDestination, quint8 iMessageType, int iPayloadLength) {
+    //Payload length, as an unsigned LEB128 varint
+    int iBytesWritten = 0;
+    quint32 iRemainingLength = static_cast<quint32>(iPayloadLength);
+    while (iRemainingLength >= 0x80) {
+        chrDestination[iBytesWritten++] = static_cast<char>((iRemainingLength & 0x7F) | 0x80);
+        iRemainingLength >>= 7;
+    }
+    chrDestination[iBytesWritten++] = static_cast<char>(iRemainingLength);
+
+    //Message type
+    chrDestination[iBytesWritten++] = static_cast<char>(iMessageType);
+    return iBytesWritten;
+}
+
+void BinaryFrameEncoder::AppendFrame(QByteArray & baDestination, quint8 iMessageType, const QByteArray & baPayload) {
+    char chrHeader[NET_FRAME_MAX_HEADER_LENGTH];
+    int iHeaderLength = BinaryFrameEncoder::WriteHeader(chrHeader, iMessageType, baPayload.size());
+    baDestination.reserve(baDestination.size() + iHeaderLength + baPayload.size());
+    baDestination.append(chrHeader, iHeaderLength);
+    baDestination.append(baPayload);
+    return;
+}
+
+bool BinaryFrameEncoder::AppendCompressedBatch(QByteArray & baDestination, const char * chrFrames, int iFramesLength, int iCompressionLevel) {
+    QByteArray baCompressedBatch = qCompress(reinterpret_cast<const uchar *>(chrFrames), iFramesLength, iCompressionLevel);
+    if (baCompressedBatch.isEmpty() || BinaryFrameEncoder::GetHeaderLength(baCompressedBatch.size()) + baCompressedBatch.size() >= iFramesLength) {
+        return false;
+    }
+    BinaryFrameEncoder::AppendFrame(baDestination, NET_FRAME_TYPE_COMPRESSED_BATCH, baCompressedBatch);
+    return true;
+}
+
+/* Binary Frame Decoder */
+BinaryFrameDecoder::BinaryFrameDecoder() {
+    iReadOffset = 0;
+    bIsCorrupted = false;
+    bIsCompressionEnabled = false;
+    iBatchReadOffset = 0;
+}
+
+void BinaryFrameDecoder::Append(const QByteArray & baReceivedData) {
+    //Drop decoded bytes before appending, so that the buffer does not grow endlessly
+    //Only the rest is copied, the buffer may still be shared with received data and remove() would detach it first
+    if (iReadOffset > 0 && iReadOffset >= baBuffer.size() / 2) {
+        baBuffer = baBuffer.mid(iReadOffset);
+        iReadOffset = 0;
+    }
+    if (baBuffer.isEmpty()) {
+        baBuffer = baReceivedData; //Implicitly shared, no copy
+    }
+    else {
+        baBuffer.append(baReceivedData);
+    }
+    return;
+}
+
+bool BinaryFrameDecoder::NextFrame(quint8 & iMessageType, QByteArray & baPayload) {
+    if (bIsCorrupted) {
+        return false;
+    }
+
+    while (true) {
+        //Frames of a compressed batch are taken out first, they were sent before the bytes following the batch
+        if (iBatchReadOffset < baBatchBuffer.size()) {
+            ParseResult iParseResult = BinaryFrameDecoder::ParseFrame(baBatchBuffer, iBatchReadOffset, iMessageType, baPayload);
+            if (iParseResult != FrameComplete || iMessageType == NET_FRAME_TYPE_COMPRESSED_BATCH) { //A batch holds whole frames only, and batches are not nested
+                bIsCorrupted = true;
+                return false;
+            }
+            if (iBatchReadOffset == baBatchBuffer.size()) {
+                baBatchBuffer.clear();
+                iBatchReadOffset = 0;
+            }
+            return true;
+        }
+
+        //Take the next frame out of received bytes
+        ParseResult iParseResult = BinaryFrameDecoder::ParseFrame(baBuffer, iReadOffset, iMessageType, baPayload);
+        if (iParseResult == FrameCorrupted) {
+            bIsCorrupted = true;
+            return false;
+        }
+        if (iParseResult == FrameIncomplete) {
+            return false;
+        }
+        if (iReadOffset == baBuffer.size()) {
+            baBuffer.clear();
+            iReadOffset = 0;
+        }
+
+        //Unpack compressed batches, unknown message types are left to the caller
+        if (iMessageType != NET_FRAME_TYPE_COMPRESSED_BATCH || !bIsCompressionEnabled) {
+            return true;
+        }
+        if (!BinaryFrameDecoder::UnpackBatch(baPayload)) {
+            bIsCorrupted = true;
+            return false;
+        }
+    }
+}
+
+bool BinaryFrameDecoder::IsCorrupted() const {
+    return bIsCorrupted;
+}
+
+void BinaryFrameDecoder::Clear() {
+    baBuffer.clear();
+    iReadOffset = 0;
+    bIsCorrupted = false;
+    baBatchBuffer.clear();
+    iBatchReadOffset = 0;
+    return;
+}
+
+void BinaryFrameDecoder::SetCompressionEnabled(bool bIsCompressionEnabledNew) {
+    bIsCompressionEnabled = bIsCompressionEnabledNew;
+    return;
+}
+
+BinaryFrameDecoder::ParseResult BinaryFrameDecoder::ParseFrame(const QByteArray & baData, int & iOffset, quint8 & iMessageType, QByteArray & baPayload) {
+    //Decode payload length
+    const uchar * chrData = reinterpret_cast<const uchar *>(baData.constData()) + iOffset;
+    int iBytesAvailable = baData.size() - iOffset;
+    quint32 iPayloadLength = 0;
+    int iHeaderLength = 0;
+    while (true) {
+        if (iHeaderLength >= iBytesAvailable) { //Header is not complete yet
+            return FrameIncomplete;
+        }
+        if (iHeaderLength >= NET_FRAME_MAX_HEADER_LENGTH - 1) { //Varint is too long
+            return FrameCorrupted;
+        }
+        uchar chrCurrentByte = chrData[iHeaderLength];
+        iPayloadLength |= static_cast<quint32>(chrCurrentByte & 0x7F) << (7 * iHeaderLength);
+        ++iHeaderLength;
+        if (!(chrCurrentByte & 0x80)) {
+            break;
+        }
+    }
+    if (iPayloadLength > NET_FRAME_MAX_PAYLOAD_LENGTH) {
+        return FrameCorrupted;
+    }
+
+    //Check if the whole frame has been received
+    if (iBytesAvailable < iHeaderLength + 1 + static_cast<int>(iPayloadLength)) {
+        return FrameIncomplete;
+    }
+
+    //Take the frame out
+    iMessageType = chrData[iHeaderLength];
+    baPayload = baData.mid(iOffset + iHeaderLength + 1, iPayloadLength);
+    iOffset += iHeaderLength + 1 + iPayloadLength;
+    return FrameComplete;
+}
+
+bool BinaryFrameDecoder::UnpackBatch(const QByteArray & baPayload) {
+    //qCompress() puts the uncompressed length in front as a 32-bit big-endian integer, check it before allocating anything
+    if (baPayload.size() < 4) {
+        return false;
+    }
+    const uchar * chrData = reinterpret_cast<const uchar *>(baPayload.constData());
+    quint32 iBatchLength = (static_cast<quint32>(chrData[0]) << 24) | (static_cast<quint32>(chrData[1]) << 16) |
+                           (static_cast<quint32>(chrData[2]) << 8) | static_cast<quint32>(chrData[3]);
+    if (iBatchLength == 0 || iBatchLength > NET_FRAME_MAX_PAYLOAD_LENGTH) {
+        return false;
+    }
+    baBatchBuffer = qUncompress(baPayload);
+    iBatchReadOffset = 0;
+    return (baBatchBuffer.size() == static_cast<int>(iBatchLength));
+}
+
+/* Text Line Decoder */
+TextLineDecoder::TextLineDecoder() {
+    iReadOffset = 0;
+    iScanOffset = 0;
+    bIsCorrupted = false;
+}
+
+void TextLineDecoder::Append(const QByteArray & baReceivedData) {
+    //Drop decoded bytes before appending, so that the buffer does not grow endlessly
+    //Only the rest is copied, the buffer may still be shared with received data and remove() would detach it first
+    if (iReadOffset > 0 && iReadOffset >= baBuffer.size() / 2) {
+        baBuffer = baBuffer.mid(iReadOffset);
+        iScanOffset -= iReadOffset;
+        iReadOffset = 0;
+    }
+    if (baBuffer.isEmpty()) {
+        baBuffer = baReceivedData; //Implicitly shared, no copy
+    }
+    else {
+        baBuffer.append(baReceivedData);
+    }
+    return;
+}
+
+bool TextLineDecoder::NextLine(QByteArray & baLine) {
+    if (bIsCorrupted) {
+        return false;
+    }
+
+    //Search for the next line break
+    const char * chrLineBreak = NULL;
+    if (iScanOffset < baBuffer.size()) {
+        chrLineBreak = static_cast<const char *>(memchr(baBuffer.constData() + iScanOffset, '\n', baBuffer.size() - iScanOffset));
+    }
+    if (!chrLineBreak) { //Line is not complete yet
+        iScanOffset = baBuffer.size();
+        if (iScanOffset - iReadOffset > NET_LINE_MAX_LENGTH) {
+            bIsCorrupted = true;
+        }
+        return false;
+    }
+
+    //Take the line out, without "\n" or "\r\n"
+    int iLineBreakOffset = chrLineBreak - baBuffer.constData();
+    int iLineLength = iLineBreakOffset - iReadOffset;
+    if (iLineLength > 0 && baBuffer.at(iLineBreakOffset - 1) == '\r') {
+        --iLineLength;
+    }
+    baLine = baBuffer.mid(iReadOffset, iLineLength);
+    iReadOffset = iLineBreakOffset + 1;
+    iScanOffset = iReadOffset;
+    if (iReadOffset == baBuffer.size()) {
+        baBuffer.clear();
+        iReadOffset = 0;
+        iScanOffset = 0;
+    }
+    return true;
+}
+
+QByteArray TextLineDecoder::TakeRemainingData() {
+    QByteArray baRemainingData = baBuffer.mid(iReadOffset);
+    TextLineDecoder::Clear();
+    return baRemainingData;
+}
+
+bool TextLineDecoder::IsCorrupted() const {
+    return bIsCorrupted;
+}
+
+void TextLineDecoder::Clear() {
+    baBuffer.clear();
+    iReadOffset = 0;
+    iScanOffset = 0;
+    bIsCorrupted = false;
+    return;
+}
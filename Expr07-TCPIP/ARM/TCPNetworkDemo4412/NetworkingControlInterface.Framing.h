@@ -0,0 +1,109 @@
+/*
+ * NETWORKING CONTROL INTERFACE :: FRAMING
+ *
+ * This file defines how messages are framed on the wire by networking interface.
+ * Two framing modes are supported:
+ *   Text mode (default): Messages are separated by line breaks ("\n" or "\r\n"), which is compatible with common network debugging tools.
+ *   Binary mode (opt-in): Each frame is [varint payload length][1-byte message type][raw payload], payload may contain any byte.
+ * Binary mode is negotiated per connection: the client sends NET_FRAMING_REQUEST_BINARY as a text line, and both sides switch to binary mode once the server answers NET_FRAMING_REPLY_BINARY.
+ * Compression (opt-in) is negotiated the same way with NET_FRAMING_REQUEST_COMPRESSED, and implies binary mode.
+ * Once compression is accepted, either side may send a batch of binary frames as a single NET_FRAME_TYPE_COMPRESSED_BATCH frame, whose payload is the batch compressed by qCompress().
+ * Batches smaller than the compression threshold, or which do not shrink, are sent uncompressed.
+ *
+ * This file is a part of DataSourceProvider, but was separated for easier maintainance.
+ * For DataFrames' definitions and stream operators, please refer to DataSourceProvider.
+ *
+ */
+
+#ifndef NETWORKINGCONTROLINTERFACE_FRAMING_H
+#define NETWORKINGCONTROLINTERFACE_FRAMING_H
+
+#include <QByteArray>
+
+/* Framing Negotiation */
+#define NET_FRAMING_REQUEST_BINARY         "#FRAMING BINARY" //Sent by client to request binary mode
+#define NET_FRAMING_REPLY_BINARY           "#FRAMING BINARY OK" //Sent by server to accept binary mode, server's following data is binary framed
+#define NET_FRAMING_REPLY_TEXT             "#FRAMING TEXT" //Sent by server to reject binary mode
+#define NET_FRAMING_REQUEST_COMPRESSED     "#FRAMING BINARY COMPRESSED" //Sent by client to request binary mode with compression
+#define NET_FRAMING_REPLY_COMPRESSED       "#FRAMING BINARY COMPRESSED OK" //Sent by server to accept binary mode with compression, server may answer NET_FRAMING_REPLY_BINARY to accept binary mode only
+#define NET_FRAMING_NEGOTIATION_TIMEOUT_MS 3000 //Client falls back to text mode if the server does not answer in time (e.g. a network debugging tool), and aborts the connection if binary mode is accepted later
+
+/* Binary Frame Message Types */
+#define NET_FRAME_TYPE_DATA             0x01 //Payload is a data frame or a command
+#define NET_FRAME_TYPE_COMPRESSED_BATCH 0x02 //Payload is a batch of binary frames compressed by qCompress(), only sent when compression is negotiated
+#define NET_FRAME_TYPE_PING             0x03 //Heartbeat ping, see NetworkingControlInterface.Heartbeat.h
+#define NET_FRAME_TYPE_PONG             0x04 //Heartbeat pong, echoes the ping's payload
+
+/* Binary Frame Limits */
+#define NET_FRAME_MAX_HEADER_LENGTH  6 //5 bytes of varint payload length and 1 byte of message type
+#define NET_FRAME_MAX_PAYLOAD_LENGTH (16 * 1024 * 1024) //Larger frames are treated as corrupted stream
+
+/* Text Line Limits */
+#define NET_LINE_MAX_LENGTH (1024 * 1024) //Longer lines are treated as corrupted stream
+
+/* Framing Modes */
+enum NetworkingFramingMode {
+    NetworkingFramingText = 0,
+    NetworkingFramingBinary = 1
+};
+
+/* Binary Frame Encoder */
+class BinaryFrameEncoder {
+public:
+    static int GetHeaderLength(int iPayloadLength); //Number of bytes of the header of a frame with given payload length
+    static int WriteHeader(char * chrDestination, quint8 iMessageType, int iPayloadLength); //Write frame header into a buffer of at least NET_FRAME_MAX_HEADER_LENGTH bytes, returns bytes written
+    static void AppendFrame(QByteArray & baDestination, quint8 iMessageType, const QByteArray & baPayload); //Append a whole frame to a buffer
+    static bool AppendCompressedBatch(QByteArray & baDestination, const char * chrFrames, int iFramesLength, int iCompressionLevel); //Append binary frames as a compressed batch frame, returns false and appends nothing if it does not shrink
+};
+
+/* Binary Frame Decoder */
+//Received bytes are appended to an internal buffer, and whole frames are taken out of it without scanning payloads
+class BinaryFrameDecoder {
+public:
+    BinaryFrameDecoder();
+
+    void Append(const QByteArray & baReceivedData); //Append bytes received from the remote
+    bool NextFrame(quint8 & iMessageType, QByteArray & baPayload); //Take the next whole frame, returns false if no whole frame is available
+    bool IsCorrupted() const; //Returns true if the stream can not be decoded any more, connection should be closed
+    void Clear();
+    void SetCompressionEnabled(bool bIsCompressionEnabledNew); //Set if compressed batches are accepted, they are unpacked transparently by NextFrame()
+
+private:
+    QByteArray baBuffer; //INTERNAL: Received bytes
+    int iReadOffset; //INTERNAL: Offset of the first byte not decoded yet
+    bool bIsCorrupted; //INTERNAL: Marks if an invalid header has been found
+    bool bIsCompressionEnabled; //INTERNAL: Marks if compressed batches are accepted
+    QByteArray baBatchBuffer; //INTERNAL: Frames of the compressed batch being unpacked
+    int iBatchReadOffset; //INTERNAL: Offset of the first byte of baBatchBuffer not decoded yet
+
+    /* Frame Parsing Results */
+    enum ParseResult {
+        FrameComplete,
+        FrameIncomplete,
+        FrameCorrupted
+    };
+    static ParseResult ParseFrame(const QByteArray & baData, int & iOffset, quint8 & iMessageType, QByteArray & baPayload); //INTERNAL: Take the frame at iOffset out, iOffset is advanced if complete
+    bool UnpackBatch(const QByteArray & baPayload); //INTERNAL: Decompress a batch into baBatchBuffer, returns false if it is invalid
+};
+
+/* Text Line Decoder */
+//Received bytes are appended to an internal buffer, and only complete lines are taken out of it
+//Line breaks are searched with memchr(), bytes already searched are not searched again when more bytes arrive
+class TextLineDecoder {
+public:
+    TextLineDecoder();
+
+    void Append(const QByteArray & baReceivedData); //Append bytes received from the remote
+    bool NextLine(QByteArray & baLine); //Take the next complete line without line break, returns false if no complete line is available
+    QByteArray TakeRemainingData(); //Take all bytes not decoded yet, used when the stream switches to binary mode
+    bool IsCorrupted() const; //Returns true if a line is longer than NET_LINE_MAX_LENGTH, connection should be closed
+    void Clear();
+
+private:
+    QByteArray baBuffer; //INTERNAL: Received bytes
+    int iReadOffset; //INTERNAL: Offset of the first byte of current line
+    int iScanOffset; //INTERNAL: Offset of the first byte not searched yet
+    bool bIsCorrupted; //INTERNAL: Marks if a line is too long
+};
+
+#endif // NETWORKINGCONTROLINTERFACE_FRAMING_H
@@ -0,0 +1,145 @@
+#include "NetworkingControlInterface.Heartbeat.h"
+#include "SettingsProvider.h"
+#include <QList>
+
+/* Heartbeat Monitor */
+HeartbeatMonitor::HeartbeatMonitor() {
+    //Initialize internal variables, sequence numbers start from 1
+    iHeartbeatInterval = ST_DEFVAL_HEARTBEAT_INTERVAL_MS;
+    iHeartbeatMaxMissed = ST_DEFVAL_HEARTBEAT_MAX_MISSED;
+    bIsPeerCapable = false;
+    iNextSequence = 1;
+    iLastAnsweredSequence = 0;
+    iPingsInFlight = 0;
+    tmrClock.start();
+}
+
+void HeartbeatMonitor::Reset() {
+    bIsPeerCapable = false;
+    iLastAnsweredSequence = iNextSequence - 1;
+    iPingsInFlight = 0;
+    return;
+}
+
+void HeartbeatMonitor::SetOptions(unsigned int iHeartbeatIntervalNew, int iHeartbeatMaxMissedNew) {
+    iHeartbeatInterval = iHeartbeatIntervalNew;
+    iHeartbeatMaxMissed = qMax(iHeartbeatMaxMissedNew, 1);
+    return;
+}
+
+unsigned int HeartbeatMonitor::GetInterval() const {
+    return iHeartbeatInterval;
+}
+
+/* Sending */
+void HeartbeatMonitor::AppendPing(QByteArray & baDestination, NetworkingFramingMode iFramingMode) {
+    //The payload is opaque to the peer, it is echoed back as is
+    QByteArray baPayload = QByteArray::number(iNextSequence++) + ' ' + QByteArray::number(tmrClock.nsecsElapsed() / 1000);
+    ++iPingsInFlight;
+    if (iFramingMode == NetworkingFramingBinary) {
+        BinaryFrameEncoder::AppendFrame(baDestination, NET_FRAME_TYPE_PING, baPayload);
+    }
+    else {
+        baDestination.append(NET_HEARTBEAT_PING_PREFIX);
+        baDestination.append(baPayload);
+        baDestination.append('\n');
+    }
+    return;
+}
+
+void HeartbeatMonitor::AppendPong(QByteArray & baDestination, NetworkingFramingMode iFramingMode, const QByteArray & baPayload) {
+    if (iFramingMode == NetworkingFramingBinary) {
+        BinaryFrameEncoder::AppendFrame(baDestination, NET_FRAME_TYPE_PONG, baPayload);
+    }
+    else {
+        baDestination.append(NET_HEARTBEAT_PONG_PREFIX);
+        baDestination.append(baPayload);
+        baDestination.append('\n');
+    }
+    return;
+}
+
+/* Receiving */
+HeartbeatMonitor::MessageKind HeartbeatMonitor::ParseLine(const QByteArray & baLine, QByteArray & baPayload) {
+    //Both prefixes start with '#', which is rare in commands and data frames, so that most lines are rejected by the first byte
+    if (baLine.isEmpty() || baLine.at(0) != '#') {
+        return NotHeartbeat;
+    }
+    if (baLine.startsWith(NET_HEARTBEAT_PING_PREFIX)) {
+        baPayload = baLine.mid(sizeof(NET_HEARTBEAT_PING_PREFIX) - 1);
+        return Ping;
+    }
+    if (baLine.startsWith(NET_HEARTBEAT_PONG_PREFIX)) {
+        baPayload = baLine.mid(sizeof(NET_HEARTBEAT_PONG_PREFIX) - 1);
+        return Pong;
+    }
+    return NotHeartbeat;
+}
+
+HeartbeatMonitor::MessageKind HeartbeatMonitor::GetFrameKind(quint8 iMessageType) {
+    switch (iMessageType) {
+    case NET_FRAME_TYPE_PING:
+        return Ping;
+    case NET_FRAME_TYPE_PONG:
+        return Pong;
+    default:
+        return NotHeartbeat;
+    }
+}
+
+void HeartbeatMonitor::HandlePing() {
+    bIsPeerCapable = true;
+    return;
+}
+
+void HeartbeatMonitor::HandlePong(const QByteArray & baPayload) {
+    //Parse "<Sequence> <Timestamp>", pongs which were not sent by us on this connection are ignored
+    QList<QByteArray> lstFields = baPayload.split(' ');
+    if (lstFields.size() != 2) {
+        return;
+    }
+    bool bIsSequenceValid = false, bIsTimestampValid = false;
+    quint32 iSequence = lstFields.at(0).toUInt(&bIsSequenceValid);
+    qint64 iTimestamp = lstFields.at(1).toLongLong(&bIsTimestampValid);
+    qint64 iCurrentTime = tmrClock.nsecsElapsed() / 1000;
+    if (!bIsSequenceValid || !bIsTimestampValid || iSequence <= iLastAnsweredSequence || iSequence >= iNextSequence || iTimestamp > iCurrentTime) {
+        return;
+    }
+
+    //Pings sent before this one will never be answered, pings sent after it are still in flight
+    cntMissedPongs.Add(static_cast<int>(iSequence - iLastAnsweredSequence - 1));
+    iLastAnsweredSequence = iSequence;
+    iPingsInFlight = static_cast<int>(iNextSequence - 1 - iSequence);
+    bIsPeerCapable = true;
+    histRoundTripTimes.Record(static_cast<int>(qMin(iCurrentTime - iTimestamp, static_cast<qint64>(0x7FFFFFFF))));
+    return;
+}
+
+bool HeartbeatMonitor::IsPeerDead() const {
+    return (bIsPeerCapable && iHeartbeatInterval > 0 && iPingsInFlight >= iHeartbeatMaxMissed);
+}
+
+bool HeartbeatMonitor::IsPeerCapable() const {
+    return bIsPeerCapable;
+}
+
+/* Metrics */
+const NetworkingLatencyHistogram & HeartbeatMonitor::GetRoundTripTimes() const {
+    return histRoundTripTimes;
+}
+
+quint32 HeartbeatMonitor::GetMissedPongCount() const {
+    return cntMissedPongs.Get();
+}
+
+quint32 HeartbeatMonitor::GetDeadPeerCount() const {
+    return cntDeadPeers.Get();
+}
+
+void HeartbeatMonitor::MarkPeerDead() {
+    cntMissedPongs.Add(iPingsInFlight);
+    cntDeadPeers.Add();
+    iLastAnsweredSequence = iNextSequence - 1;
+    iPingsInFlight = 0;
+    return;
+}
@@ -0,0 +1,79 @@
+/*
+ * NETWORKING CONTROL INTERFACE :: HEARTBEAT
+ *
+ * This file defines the heartbeat (ping/pong) protocol of networking interface.
+ * Every connection sends a ping every heartbeat interval, the peer echoes the ping's payload back as a pong at once, and the round-trip time is
+ * recorded into a latency histogram. Heartbeats are written directly to the socket by the connection's own thread, they never wait in data queues.
+ *   Text mode: "#PING <Sequence> <Timestamp>" and "#PONG <Sequence> <Timestamp>" lines.
+ *   Binary mode: NET_FRAME_TYPE_PING and NET_FRAME_TYPE_PONG frames, carrying "<Sequence> <Timestamp>" as payload.
+ * A peer is declared dead when more than the max number of pongs is missing, the connection is then closed (and reconnected by the client).
+ * A peer which has never answered a ping (e.g. an older version, or a network debugging tool) is never declared dead, its pings are simply not answered.
+ * The server only pings clients which have pinged it.
+ *
+ * This file is a part of DataSourceProvider, but was separated for easier maintainance.
+ * For DataFrames' definitions and stream operators, please refer to DataSourceProvider.
+ *
+ */
+
+#ifndef NETWORKINGCONTROLINTERFACE_HEARTBEAT_H
+#define NETWORKINGCONTROLINTERFACE_HEARTBEAT_H
+
+#include "NetworkingControlInterface.Framing.h"
+#include "NetworkingControlInterface.Metrics.h"
+#include <QByteArray>
+#include <QElapsedTimer>
+
+/* Heartbeat Messages */
+#define NET_HEARTBEAT_PING_PREFIX "#PING " //Text mode ping line, followed by the payload
+#define NET_HEARTBEAT_PONG_PREFIX "#PONG " //Text mode pong line, followed by the payload echoed
+
+/* Heartbeat Monitor */
+//Keeps heartbeat state of a connection, all functions must be called from the thread owns the connection, except histogram readers
+class HeartbeatMonitor {
+public:
+    /* Received Message Kinds */
+    enum MessageKind {
+        NotHeartbeat = 0,
+        Ping = 1,
+        Pong = 2
+    };
+
+    HeartbeatMonitor();
+
+    void Reset(); //Forget pings in flight and the peer's capability, called for every new connection
+    void SetOptions(unsigned int iHeartbeatIntervalNew, int iHeartbeatMaxMissedNew); //Interval (in ms, 0 to disable) and max number of pongs missing before the peer is dead
+    unsigned int GetInterval() const;
+
+    /* Sending */
+    void AppendPing(QByteArray & baDestination, NetworkingFramingMode iFramingMode); //Append a ping message, counts it as in flight
+    static void AppendPong(QByteArray & baDestination, NetworkingFramingMode iFramingMode, const QByteArray & baPayload); //Append a pong echoing a ping's payload
+
+    /* Receiving */
+    static MessageKind ParseLine(const QByteArray & baLine, QByteArray & baPayload); //Check a text mode line, baPayload is set for heartbeats
+    static MessageKind GetFrameKind(quint8 iMessageType); //Check a binary frame type
+    void HandlePing(); //A ping from the peer proves it supports heartbeats
+    void HandlePong(const QByteArray & baPayload); //Record round-trip time of an answered ping
+    bool IsPeerDead() const; //Returns true if the peer supports heartbeats and has missed too many pongs
+    bool IsPeerCapable() const; //Returns true if the peer has sent a ping or answered one on this connection
+
+    /* Metrics */
+    const NetworkingLatencyHistogram & GetRoundTripTimes() const; //Round-trip times in microseconds
+    quint32 GetMissedPongCount() const; //Pings never answered, counted when a later pong arrives or the peer is declared dead
+    quint32 GetDeadPeerCount() const; //Number of times the peer has been declared dead
+
+    void MarkPeerDead(); //Account a dead peer, the caller closes the connection
+
+private:
+    unsigned int iHeartbeatInterval; //INTERNAL: Ping interval in ms, 0 if disabled
+    int iHeartbeatMaxMissed; //INTERNAL: Max number of pings in flight before the peer is dead
+    bool bIsPeerCapable; //INTERNAL: Marks if the peer has sent a ping or answered one on current connection
+    quint32 iNextSequence; //INTERNAL: Sequence number of next ping
+    quint32 iLastAnsweredSequence; //INTERNAL: Sequence number of the latest ping answered
+    int iPingsInFlight; //INTERNAL: Pings sent and not answered yet
+    QElapsedTimer tmrClock; //INTERNAL: Monotonic clock of ping timestamps, timestamps are only compared with this clock
+    NetworkingLatencyHistogram histRoundTripTimes; //INTERNAL: Round-trip times in microseconds
+    NetworkingCounter cntMissedPongs; //INTERNAL: Pings never answered
+    NetworkingCounter cntDeadPeers; //INTERNAL: Peers declared dead
+};
+
+#endif // NETWORKINGCONTROLINTERFACE_HEARTBEAT_H
@@ -0,0 +1,237 @@
+#include "NetworkingControlInterface.Local.h"
+#include <QByteArray>
+#include <QDebug>
+#include <QFile>
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* Address */
+//Fill a socket address from an endpoint, abstract names start with a null byte and are not null-terminated, returns false if the endpoint is invalid
+static bool GetSocketAddress(const QString & sEndpoint, sockaddr_un & addrEndpoint, socklen_t & iAddressLength) {
+    if (!LocalSocketEndpoint::IsLocalEndpoint(sEndpoint)) {
+        return false;
+    }
+    QByteArray baName = QFile::encodeName(sEndpoint.mid(sizeof(NET_LOCAL_ENDPOINT_PREFIX) - 1));
+    bool bIsAbstract = baName.startsWith(NET_LOCAL_ABSTRACT_PREFIX);
+    if (baName.isEmpty() || (bIsAbstract && baName.size() == 1) || baName.size() >= static_cast<int>(sizeof(addrEndpoint.sun_path))) {
+        return false;
+    }
+
+    memset(&addrEndpoint, 0, sizeof(addrEndpoint));
+    addrEndpoint.sun_family = AF_UNIX;
+    memcpy(addrEndpoint.sun_path, baName.constData(), baName.size());
+    if (bIsAbstract) {
+        addrEndpoint.sun_path[0] = '\0';
+        iAddressLength = offsetof(sockaddr_un, sun_path) + baName.size();
+    }
+    else {
+        iAddressLength = sizeof(addrEndpoint);
+    }
+    return true;
+}
+
+/* Stale Socket Files */
+//Remove a socket file left by a crashed run, returns false if something else is at the path or a server still accepts on it
+static bool RemoveStaleSocketFile(const sockaddr_un & addrEndpoint, socklen_t iAddressLength) {
+    struct stat stsFile;
+    if (lstat(addrEndpoint.sun_path, &stsFile) != 0) {
+        return (errno == ENOENT);
+    }
+    if (!S_ISSOCK(stsFile.st_mode)) {
+        qDebug() << "LocalSocket: Couldnot listen on" << addrEndpoint.sun_path << ", it is not a socket";
+        return false;
+    }
+
+    //Only a refused connection proves that nobody listens, a full backlog (EAGAIN) or missing permissions do not
+    int iProbeDescriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (iProbeDescriptor < 0) {
+        qDebug() << "LocalSocket: Couldnot create probing socket," << strerror(errno);
+        return false;
+    }
+    int iResult = 0;
+    do {
+        iResult = ::connect(iProbeDescriptor, reinterpret_cast<const sockaddr *>(&addrEndpoint), iAddressLength);
+    } while (iResult != 0 && errno == EINTR);
+    int iProbeError = (iResult == 0) ? 0 : errno;
+    ::close(iProbeDescriptor);
+    if (iProbeError != ECONNREFUSED) {
+        qDebug() << "LocalSocket: Couldnot listen on" << addrEndpoint.sun_path << ", endpoint is in use";
+        return false;
+    }
+    if (unlink(addrEndpoint.sun_path) != 0 && errno != ENOENT) {
+        qDebug() << "LocalSocket: Couldnot remove stale socket file" << addrEndpoint.sun_path << "," << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+/* Local Socket Endpoint */
+bool LocalSocketEndpoint::IsLocalEndpoint(const QString & sEndpoint) {
+    return sEndpoint.startsWith(NET_LOCAL_ENDPOINT_PREFIX);
+}
+
+int LocalSocketEndpoint::Listen(const QString & sEndpoint, LocalSocketFile & filBound) {
+    filBound.iDevice = 0;
+    filBound.iInode = 0;
+    sockaddr_un addrEndpoint;
+    socklen_t iAddressLength = 0;
+    if (!GetSocketAddress(sEndpoint, addrEndpoint, iAddressLength)) {
+        qDebug() << "LocalSocket: Invalid endpoint" << sEndpoint;
+        return -1;
+    }
+    int iListeningDescriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (iListeningDescriptor < 0) {
+        qDebug() << "LocalSocket: Couldnot create listening socket," << strerror(errno);
+        return -1;
+    }
+
+    //A socket file left by a crashed run would make bind() fail, abstract names are released with their sockets and never stale
+    bool bIsPath = (addrEndpoint.sun_path[0] != '\0');
+    if (bIsPath && !RemoveStaleSocketFile(addrEndpoint, iAddressLength)) {
+        ::close(iListeningDescriptor);
+        return -1;
+    }
+    if (bind(iListeningDescriptor, reinterpret_cast<sockaddr *>(&addrEndpoint), iAddressLength) != 0) {
+        qDebug() << "LocalSocket: Couldnot listen on" << sEndpoint << "," << strerror(errno);
+        ::close(iListeningDescriptor);
+        return -1;
+    }
+
+    //Remember which file was created, so that a file created at the same path by somebody else is never removed
+    struct stat stsFile;
+    if (bIsPath && lstat(addrEndpoint.sun_path, &stsFile) == 0) {
+        filBound.iDevice = stsFile.st_dev;
+        filBound.iInode = stsFile.st_ino;
+    }
+    if (listen(iListeningDescriptor, NET_LOCAL_LISTEN_BACKLOG) != 0) {
+        qDebug() << "LocalSocket: Couldnot listen on" << sEndpoint << "," << strerror(errno);
+        ::close(iListeningDescriptor);
+        LocalSocketEndpoint::Release(sEndpoint, filBound);
+        filBound.iDevice = 0;
+        filBound.iInode = 0;
+        return -1;
+    }
+    return iListeningDescriptor;
+}
+
+int LocalSocketEndpoint::Connect(const QString & sEndpoint, QAbstractSocket::SocketError & errErrorInfo) {
+    sockaddr_un addrEndpoint;
+    socklen_t iAddressLength = 0;
+    if (!GetSocketAddress(sEndpoint, addrEndpoint, iAddressLength)) {
+        errErrorInfo = QAbstractSocket::HostNotFoundError;
+        return -1;
+    }
+    int iSocketDescriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (iSocketDescriptor < 0) {
+        errErrorInfo = QAbstractSocket::SocketResourceError;
+        return -1;
+    }
+
+    //Local connections complete at once or fail at once, EAGAIN means the server's backlog is full and is handled as a refused connection
+    int iResult = 0;
+    do {
+        iResult = ::connect(iSocketDescriptor, reinterpret_cast<sockaddr *>(&addrEndpoint), iAddressLength);
+    } while (iResult != 0 && errno == EINTR);
+    if (iResult != 0) {
+        switch (errno) {
+        case ENOENT:
+            errErrorInfo = QAbstractSocket::HostNotFoundError;
+            break;
+        case EACCES:
+        case EPERM:
+            errErrorInfo = QAbstractSocket::SocketAccessError;
+            break;
+        default:
+            errErrorInfo = QAbstractSocket::ConnectionRefusedError;
+            break;
+        }
+        ::close(iSocketDescriptor);
+        return -1;
+    }
+    return iSocketDescriptor;
+}
+
+void LocalSocketEndpoint::Release(const QString & sEndpoint, const LocalSocketFile & filBound) {
+    sockaddr_un addrEndpoint;
+    socklen_t iAddressLength = 0;
+    if (filBound.iInode == 0 || !GetSocketAddress(sEndpoint, addrEndpoint, iAddressLength) || addrEndpoint.sun_path[0] == '\0') {
+        return;
+    }
+
+    //Another server may have replaced the file after this one stopped accepting, its file is left alone
+    struct stat stsFile;
+    if (lstat(addrEndpoint.sun_path, &stsFile) == 0 && S_ISSOCK(stsFile.st_mode) &&
+        static_cast<quint64>(stsFile.st_dev) == filBound.iDevice && static_cast<quint64>(stsFile.st_ino) == filBound.iInode) {
+        unlink(addrEndpoint.sun_path);
+    }
+    return;
+}
+
+/* Local Socket Listener */
+LocalSocketListener::LocalSocketListener(QObject * parent) : QObject(parent) {
+    iListeningDescriptor = -1;
+    ntfListening = NULL;
+    filBound.iDevice = 0;
+    filBound.iInode = 0;
+}
+
+LocalSocketListener::~LocalSocketListener() {
+    LocalSocketListener::Close();
+}
+
+bool LocalSocketListener::Listen(const QString & sEndpointNew) {
+    LocalSocketListener::Close();
+    iListeningDescriptor = LocalSocketEndpoint::Listen(sEndpointNew, filBound);
+    if (iListeningDescriptor < 0) {
+        return false;
+    }
+    sEndpoint = sEndpointNew;
+    ntfListening = new QSocketNotifier(iListeningDescriptor, QSocketNotifier::Read, this);
+    connect(ntfListening, SIGNAL(activated(int)), this, SLOT(ListeningSocketReadyEventHandler()));
+    return true;
+}
+
+void LocalSocketListener::Close() {
+    if (iListeningDescriptor < 0) {
+        return;
+    }
+    delete ntfListening;
+    ntfListening = NULL;
+    ::close(iListeningDescriptor);
+    iListeningDescriptor = -1;
+    LocalSocketEndpoint::Release(sEndpoint, filBound);
+    filBound.iDevice = 0;
+    filBound.iInode = 0;
+    return;
+}
+
+bool LocalSocketListener::IsListening() const {
+    return (iListeningDescriptor >= 0);
+}
+
+const QString & LocalSocketListener::GetEndpoint() const {
+    return sEndpoint;
+}
+
+void LocalSocketListener::ListeningSocketReadyEventHandler() {
+    //Accepted sockets are blocking like the ones QTcpServer hands out, QAbstractSocket makes them non-blocking itself
+    for (int i = 0; i < NET_LOCAL_ACCEPTS_PER_EVENT && iListeningDescriptor >= 0; ++i) {
+        int iSocketID = accept4(iListeningDescriptor, NULL, NULL, SOCK_CLOEXEC);
+        if (iSocketID < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                qDebug() << "LocalSocket: Couldnot accept incoming connection," << strerror(errno);
+            }
+            break;
+        }
+        emit IncomingConnectionEvent(iSocketID);
+    }
+    return;
+}
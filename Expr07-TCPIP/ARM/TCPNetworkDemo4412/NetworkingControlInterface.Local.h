@@ -0,0 +1,74 @@
+/*
+ * NETWORKING CONTROL INTERFACE :: LOCAL
+ *
+ * This file implements Unix domain socket endpoints, for processes on the same board talking to each other without the TCP/IP stack.
+ * A local endpoint is written where a server IP would be, and is told apart by its prefix:
+ *   "unix:/path/to/socket": Socket file in the file system, a stale socket file left by a previous run is removed before listening.
+ *                           Only a socket file refusing connections is stale, anything else at the path makes listening fail.
+ *   "unix:@name": Socket name in Linux abstract namespace, nothing is created in the file system and the name is released with the socket.
+ * Accepted and connected sockets are handed to QTcpSocket-based objects with setSocketDescriptor(), like QLocalSocket does on Unix,
+ * thus framing, heartbeats, compression and output queues work on local connections exactly as on TCP connections.
+ * Local peers have no address and no port: sessions report the endpoint as client IP address and 0 as client port.
+ * Linux only, like the board this project runs on.
+ *
+ * This file is a part of DataSourceProvider, but was separated for easier maintainance.
+ * For DataFrames' definitions and stream operators, please refer to DataSourceProvider.
+ *
+ */
+
+#ifndef NETWORKINGCONTROLINTERFACE_LOCAL_H
+#define NETWORKINGCONTROLINTERFACE_LOCAL_H
+
+#include <QAbstractSocket>
+#include <QObject>
+#include <QSocketNotifier>
+#include <QString>
+
+/* Endpoint Syntax */
+#define NET_LOCAL_ENDPOINT_PREFIX   "unix:" //Prefix of local endpoints
+#define NET_LOCAL_ABSTRACT_PREFIX   '@' //First character of names in abstract namespace
+#define NET_LOCAL_LISTEN_BACKLOG    128 //Pending connections of a listening socket
+#define NET_LOCAL_ACCEPTS_PER_EVENT 64 //Connections accepted before returning to event loop
+
+/* Local Socket Endpoint */
+struct LocalSocketFile {
+    quint64 iDevice; //Device of the socket file
+    quint64 iInode; //Inode of the socket file, 0 if there is no file (abstract names)
+};
+
+class LocalSocketEndpoint {
+public:
+    static bool IsLocalEndpoint(const QString & sEndpoint); //Returns true if sEndpoint has the local endpoint prefix
+    static int Listen(const QString & sEndpoint, LocalSocketFile & filBound); //Create a non-blocking listening socket, returns -1 on failure, filBound identifies the socket file created
+    static int Connect(const QString & sEndpoint, QAbstractSocket::SocketError & errErrorInfo); //Connect a socket without blocking, returns -1 on failure with the reason in errErrorInfo
+    static void Release(const QString & sEndpoint, const LocalSocketFile & filBound); //Remove the socket file of a path endpoint if it is still filBound, nothing to do for abstract names
+};
+
+/* Local Socket Listener */
+//Accepts connections on a local endpoint in the thread owns this object, every accepted socket descriptor is passed on with IncomingConnectionEvent()
+class LocalSocketListener : public QObject {
+    Q_OBJECT
+
+public:
+    explicit LocalSocketListener(QObject * parent = NULL);
+    ~LocalSocketListener();
+
+    bool Listen(const QString & sEndpointNew); //Returns false on failure, or if sEndpointNew is not a local endpoint
+    void Close(); //Stop listening, pending connections are refused
+    bool IsListening() const;
+    const QString & GetEndpoint() const;
+
+signals:
+    void IncomingConnectionEvent(int iSocketID); //Receiver owns the descriptor, which must be closed if it is not used
+
+private slots:
+    void ListeningSocketReadyEventHandler(); //Accept pending connections
+
+private:
+    QString sEndpoint; //INTERNAL: Endpoint listened on
+    LocalSocketFile filBound; //INTERNAL: Socket file created by listening, which is only removed if nobody has replaced it
+    int iListeningDescriptor; //INTERNAL: -1 if not listening
+    QSocketNotifier * ntfListening; //INTERNAL: Reports pending connections, NULL if not listening
+};
+
+#endif // NETWORKINGCONTROLINTERFACE_LOCAL_H
@@ -0,0 +1,151 @@
+#include "NetworkingControlInterface.Metrics.h"
+#include <QMutexLocker>
+
+/* Counter */
+NetworkingCounter::NetworkingCounter() {
+    iCounterValue = 0;
+}
+
+void NetworkingCounter::Add(int iDelta) {
+    iCounterValue.fetchAndAddRelaxed(iDelta);
+    return;
+}
+
+void NetworkingCounter::SetMax(int iValue) {
+    //Only one thread writes the counter, thus no compare-and-swap loop is required
+    if (iValue > static_cast<int>(iCounterValue)) {
+        iCounterValue.fetchAndStoreRelaxed(iValue);
+    }
+    return;
+}
+
+quint32 NetworkingCounter::Get() const {
+    return static_cast<quint32>(static_cast<int>(iCounterValue));
+}
+
+/* Latency Histogram */
+NetworkingLatencyHistogram::NetworkingLatencyHistogram() {
+    iLastLatency = 0;
+}
+
+void NetworkingLatencyHistogram::Record(int iLatency) {
+    if (iLatency < 0) {
+        iLatency = 0;
+    }
+    int iBucket = 0;
+    while (iBucket < NET_HISTOGRAM_BUCKET_COUNT - 1 && iLatency > NetworkingLatencyHistogram::GetBucketUpperBound(iBucket)) {
+        ++iBucket;
+    }
+    cntBuckets[iBucket].Add();
+    cntCount.Add();
+    cntSum.Add(iLatency);
+    cntMax.SetMax(iLatency);
+    iLastLatency.fetchAndStoreRelaxed(iLatency);
+    return;
+}
+
+quint32 NetworkingLatencyHistogram::GetCount() const {
+    return cntCount.Get();
+}
+
+quint32 NetworkingLatencyHistogram::GetSum() const {
+    return cntSum.Get();
+}
+
+quint32 NetworkingLatencyHistogram::GetMax() const {
+    return cntMax.Get();
+}
+
+quint32 NetworkingLatencyHistogram::GetLast() const {
+    return static_cast<quint32>(static_cast<int>(iLastLatency));
+}
+
+quint32 NetworkingLatencyHistogram::GetBucketCount(int iBucket) const {
+    if (iBucket < 0 || iBucket >= NET_HISTOGRAM_BUCKET_COUNT) {
+        return 0;
+    }
+    return cntBuckets[iBucket].Get();
+}
+
+qint64 NetworkingLatencyHistogram::GetBucketUpperBound(int iBucket) {
+    if (iBucket >= NET_HISTOGRAM_BUCKET_COUNT - 1) {
+        return -1;
+    }
+    return (Q_INT64_C(1) << (iBucket + NET_HISTOGRAM_FIRST_BOUND_SHIFT));
+}
+
+/* Metrics Text Writer */
+NetworkingMetricsWriter::NetworkingMetricsWriter() {
+}
+
+void NetworkingMetricsWriter::SetLabels(const QString & sLabelsNew) {
+    sLabels = sLabelsNew;
+    baLabels.clear();
+    if (!sLabelsNew.isEmpty()) {
+        baLabels.append('{');
+        baLabels.append(sLabelsNew.toUtf8());
+        baLabels.append('}');
+    }
+    return;
+}
+
+void NetworkingMetricsWriter::WriteValue(const char * chrName, qint64 iValue) {
+    baText.append(chrName);
+    baText.append(baLabels);
+    baText.append(' ');
+    baText.append(QByteArray::number(iValue));
+    baText.append('\n');
+    return;
+}
+
+void NetworkingMetricsWriter::WriteHistogram(const char * chrName, const NetworkingLatencyHistogram & histLatency) {
+    QString sLabelsSaved = sLabels;
+    QString sLabelSeparator = sLabelsSaved.isEmpty() ? "" : ",";
+    QByteArray baBucketName = QByteArray(chrName) + "_bucket";
+
+    //Buckets are written cumulatively, each one counts all latencies up to its upper bound
+    quint32 iCumulativeCount = 0;
+    for (int i = 0; i < NET_HISTOGRAM_BUCKET_COUNT; ++i) {
+        iCumulativeCount += histLatency.GetBucketCount(i);
+        qint64 iUpperBound = NetworkingLatencyHistogram::GetBucketUpperBound(i);
+        NetworkingMetricsWriter::SetLabels(sLabelsSaved + sLabelSeparator + QString("le=\"%1\"").arg(iUpperBound < 0 ? QString("+Inf") : QString::number(iUpperBound)));
+        NetworkingMetricsWriter::WriteValue(baBucketName.constData(), iCumulativeCount);
+    }
+    NetworkingMetricsWriter::SetLabels(sLabelsSaved);
+    NetworkingMetricsWriter::WriteValue((QByteArray(chrName) + "_count").constData(), histLatency.GetCount());
+    NetworkingMetricsWriter::WriteValue((QByteArray(chrName) + "_sum").constData(), histLatency.GetSum());
+    NetworkingMetricsWriter::WriteValue((QByteArray(chrName) + "_max").constData(), histLatency.GetMax());
+    return;
+}
+
+const QByteArray & NetworkingMetricsWriter::GetText() const {
+    return baText;
+}
+
+/* Metrics Registry */
+QMutex NetworkingMetrics::mtxSources;
+QList<const NetworkingMetricsSource *> NetworkingMetrics::lstSources;
+
+void NetworkingMetrics::RegisterSource(const NetworkingMetricsSource * srcMetrics) {
+    QMutexLocker lckSources(&mtxSources);
+    if (!lstSources.contains(srcMetrics)) {
+        lstSources.append(srcMetrics);
+    }
+    return;
+}
+
+void NetworkingMetrics::UnregisterSource(const NetworkingMetricsSource * srcMetrics) {
+    QMutexLocker lckSources(&mtxSources);
+    lstSources.removeAll(srcMetrics);
+    return;
+}
+
+QByteArray NetworkingMetrics::WriteAll() {
+    NetworkingMetricsWriter wrtMetrics;
+    QMutexLocker lckSources(&mtxSources);
+    for (int i = 0; i < lstSources.size(); ++i) {
+        wrtMetrics.SetLabels(QString());
+        lstSources.at(i)->WriteMetrics(wrtMetrics);
+    }
+    return wrtMetrics.GetText();
+}
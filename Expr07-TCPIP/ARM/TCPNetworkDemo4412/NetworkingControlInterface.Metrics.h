@@ -0,0 +1,116 @@
+/*
+ * NETWORKING CONTROL INTERFACE :: METRICS
+ *
+ * This file defines runtime metrics of networking interface: counters and gauges of data queues, connections and throughput.
+ * Counters are updated with atomic operations on hot paths, each counter is written by a single thread and may be read by any thread.
+ * Counters are unsigned 32-bit and wrap around, scrapers should take differences between two scrapes modulo 2^32.
+ *
+ * Objects owning metrics (TCPClient, TCPServer) register themselves as metrics sources. All registered sources can be scraped as text:
+ *   From the command port: Send NET_STATS_REQUEST as a command (a text line, or a data frame in binary mode), the server answers a single response
+ *                          of "name{labels} value" lines, terminated by a NET_STATS_REPLY_END line.
+ *   From the code: Call NetworkingMetrics::WriteAll(), or use the snapshot functions of TCPClient and TCPServer.
+ *
+ * This file is a part of DataSourceProvider, but was separated for easier maintainance.
+ * For DataFrames' definitions and stream operators, please refer to DataSourceProvider.
+ *
+ */
+
+#ifndef NETWORKINGCONTROLINTERFACE_METRICS_H
+#define NETWORKINGCONTROLINTERFACE_METRICS_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <QString>
+
+/* Stats Command */
+#define NET_STATS_REQUEST   "#STATS" //Sent by client as a command to scrape metrics
+#define NET_STATS_REPLY_END "#STATS END" //Last line of server's answer
+
+/* Latency Histogram */
+#define NET_HISTOGRAM_BUCKET_COUNT      20 //Last bucket has no upper bound
+#define NET_HISTOGRAM_FIRST_BOUND_SHIFT 7 //Upper bound of bucket i is 2^(i+7) us, from 128 us to about 33.5 s (bucket 18)
+
+/* Counter */
+//Only ONE thread at a time may call Add() and SetMax(), writers in several threads must be serialized by a lock, any thread may call Get()
+class NetworkingCounter {
+public:
+    NetworkingCounter();
+
+    void Add(int iDelta = 1); //Relaxed, the counter carries no other data
+    void SetMax(int iValue); //Raise the counter to iValue, for high-water marks and max values
+    quint32 Get() const;
+
+private:
+    QAtomicInt iCounterValue; //INTERNAL: Wraps around at 2^32
+
+    /* Disable Copying */
+    NetworkingCounter(const NetworkingCounter &);
+    NetworkingCounter & operator=(const NetworkingCounter &);
+};
+
+/* Latency Histogram */
+//Log2 buckets of latencies in microseconds, only ONE thread may call Record(), any thread may read
+class NetworkingLatencyHistogram {
+public:
+    NetworkingLatencyHistogram();
+
+    void Record(int iLatency); //Latency in microseconds
+    quint32 GetCount() const;
+    quint32 GetSum() const; //Sum of latencies in microseconds, wraps around like other counters
+    quint32 GetMax() const;
+    quint32 GetLast() const;
+    quint32 GetBucketCount(int iBucket) const; //Number of latencies in a bucket, not cumulative
+    static qint64 GetBucketUpperBound(int iBucket); //Inclusive upper bound in microseconds, -1 for the last bucket
+
+private:
+    NetworkingCounter cntBuckets[NET_HISTOGRAM_BUCKET_COUNT]; //INTERNAL: Counts of each bucket
+    NetworkingCounter cntCount; //INTERNAL: Number of latencies recorded
+    NetworkingCounter cntSum; //INTERNAL: Sum of latencies recorded
+    NetworkingCounter cntMax; //INTERNAL: Max latency recorded
+    QAtomicInt iLastLatency; //INTERNAL: Latest latency recorded
+
+    /* Disable Copying */
+    NetworkingLatencyHistogram(const NetworkingLatencyHistogram &);
+    NetworkingLatencyHistogram & operator=(const NetworkingLatencyHistogram &);
+};
+
+/* Metrics Text Writer */
+//Writes metrics in "name{label="value",...} value" lines
+class NetworkingMetricsWriter {
+public:
+    NetworkingMetricsWriter();
+
+    void SetLabels(const QString & sLabelsNew); //Labels of following lines, e.g. "connection=\"0\"", empty for none
+    void WriteValue(const char * chrName, qint64 iValue);
+    void WriteHistogram(const char * chrName, const NetworkingLatencyHistogram & histLatency); //Writes cumulative "_bucket" lines with "le" labels, "_count", "_sum" and "_max"
+    const QByteArray & GetText() const;
+
+private:
+    QByteArray baLabels; //INTERNAL: Encoded labels with braces
+    QString sLabels; //INTERNAL: Labels as given
+    QByteArray baText; //INTERNAL: Lines written
+};
+
+/* Metrics Source */
+//Implemented by objects owning metrics, WriteMetrics() is called from any thread while the source is registered
+class NetworkingMetricsSource {
+public:
+    virtual ~NetworkingMetricsSource() {}
+    virtual void WriteMetrics(NetworkingMetricsWriter & wrtMetrics) const = 0;
+};
+
+/* Metrics Registry */
+class NetworkingMetrics {
+public:
+    static void RegisterSource(const NetworkingMetricsSource * srcMetrics); //Sources must unregister themselves before they are destroyed
+    static void UnregisterSource(const NetworkingMetricsSource * srcMetrics); //Waits until a running WriteAll() has finished
+    static QByteArray WriteAll(); //Metrics of all sources as text, without NET_STATS_REPLY_END
+
+private:
+    static QMutex mtxSources; //INTERNAL: Protects lstSources, held while sources are written
+    static QList<const NetworkingMetricsSource *> lstSources; //INTERNAL: Registered sources, in registration order
+};
+
+#endif // NETWORKINGCONTROLINTERFACE_METRICS_H
@@ -1,58 +1,388 @@
 #include "NetworkingControlInterface.Server.h"
+#include "NetworkingControlInterface.Epoll.h"
 #include "SettingsProvider.h"
+#include <unistd.h>
 
 /* TCP Server */
 TCPServer * tcpCommandServer;
 
 /* TCP Server Socket Object */
-TCPServerSocket::TCPServerSocket() {
+TCPServerSocket::TCPServerSocket(int iClientIDInit, bool bIsBinaryFramingAllowedInit) {
+    //Initialize internal variables, every connection starts in text mode
+    iClientID = iClientIDInit;
+    iClientPort = 0;
+    bIsBinaryFramingAllowed = bIsBinaryFramingAllowedInit;
+    iFramingMode = NetworkingFramingText;
+    bIsCompressionAllowed = false;
+    bIsCompressionEnabled = false;
+    iCompressionThreshold = ST_DEFVAL_COMPRESSION_THRESHOLD;
+    iCompressionLevel = ST_DEFVAL_COMPRESSION_LEVEL;
+    iOutputQueueMaxBytes = ST_DEFVAL_SERVER_OUTPUT_MAX_BYTES;
+    iSlowClientPolicy = DropOldest;
+    iOutputQueueBytesUsed = 0;
+    iOutputQueueFramesMetric = 0;
+    iOutputQueueBytesMetric = 0;
+    iOutputEncoding = TCPServerEncodedMessage::Text;
+    excCommands = NULL;
+
+    //Create heartbeat timer, as a child object it is moved to worker thread together with this object
+    tmrHeartbeat = new QTimer(this);
+    connect(tmrHeartbeat, SIGNAL(timeout()), this, SLOT(HeartbeatTimerEventHandler()));
+
     //Connect events and handlers
     connect(this, SIGNAL(readyRead()), this, SLOT(CommandReceivedFromClientEventHandler()));
-    connect(this, SIGNAL(connected()), this, SLOT(TCPServerSocket_Connected()));
     connect(this, SIGNAL(disconnected()), this, SLOT(TCPServerSocket_Disconnected()));
     qRegisterMetaType<QAbstractSocket::SocketError>("QAbstractSocket::SocketError"); //Register QAbstractSocket::SocketError type for QueuedConnection
+    qRegisterMetaType<QList<QByteArray> >("QList<QByteArray>"); //Register QList<QByteArray> type for QueuedConnection
+    qRegisterMetaType<TCPServerEncodedMessage>("TCPServerEncodedMessage"); //Register TCPServerEncodedMessage type for QueuedConnection
     connect(this, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(TCPServerSocket_Error(QAbstractSocket::SocketError)));
+    connect(this, SIGNAL(bytesWritten(qint64)), this, SLOT(TCPServerSocket_BytesWritten(qint64)));
 }
 
 TCPServerSocket::~TCPServerSocket() {
 }
 
+/* Session Information */
+bool TCPServerSocket::OpenSession(int iSocketID, const QString & sLocalEndpoint) {
+    if (!setSocketDescriptor(iSocketID)) {
+        qDebug() << "TCPServer: Couldnot accept incoming connection," << errorString();
+        return false;
+    }
+
+    //Local peers have neither address nor port, nor Nagle's algorithm
+    if (!sLocalEndpoint.isEmpty()) {
+        sClientIPAddress = sLocalEndpoint;
+        iClientPort = 0;
+        qDebug() << "TCPServer: Connection established with local client on" << sClientIPAddress << ", assigned ID" << iClientID << ".";
+        return true;
+    }
+    setSocketOption(QAbstractSocket::LowDelayOption, 1); //Set for low delay, avoid packet sticking
+
+    //Save peer information, so that it is not queried (and allocated) again for every message
+    sClientName = peerName();
+    sClientIPAddress = peerAddress().toString();
+    iClientPort = peerPort();
+    qDebug() << "TCPServer: Connection established with remote client" << sClientIPAddress << ":" << iClientPort << ", assigned ID" << iClientID << ".";
+    return true;
+}
+
+int TCPServerSocket::GetClientID() const {
+    return iClientID;
+}
+
+const QString & TCPServerSocket::GetClientName() const {
+    return sClientName;
+}
+
+const QString & TCPServerSocket::GetClientIPAddress() const {
+    return sClientIPAddress;
+}
+
+quint16 TCPServerSocket::GetClientPort() const {
+    return iClientPort;
+}
+
+/* Compression */
+void TCPServerSocket::SetCompressionOptions(bool bIsCompressionAllowedNew, int iCompressionThresholdNew, int iCompressionLevelNew) {
+    bIsCompressionAllowed = bIsCompressionAllowedNew;
+    iCompressionThreshold = iCompressionThresholdNew;
+    iCompressionLevel = iCompressionLevelNew;
+    return;
+}
+
+/* Heartbeat */
+void TCPServerSocket::SetHeartbeatOptions(unsigned int iHeartbeatIntervalNew, int iHeartbeatMaxMissedNew) {
+    hbmHeartbeat.SetOptions(iHeartbeatIntervalNew, iHeartbeatMaxMissedNew);
+    return;
+}
+
+void TCPServerSocket::HandleHeartbeat(HeartbeatMonitor::MessageKind iMessageKind, const QByteArray & baPayload) {
+    if (iMessageKind == HeartbeatMonitor::Ping) {
+        //Answer at once from this worker thread
+        QByteArray baPong;
+        HeartbeatMonitor::AppendPong(baPong, iFramingMode, baPayload);
+        TCPServerSocket::WriteOutput(baPong, false);
+
+        //A client which pings us answers pings too, start pinging it
+        hbmHeartbeat.HandlePing();
+        if (!tmrHeartbeat->isActive() && hbmHeartbeat.GetInterval() > 0) {
+            tmrHeartbeat->start(hbmHeartbeat.GetInterval());
+        }
+    }
+    else if (iMessageKind == HeartbeatMonitor::Pong) {
+        hbmHeartbeat.HandlePong(baPayload);
+    }
+    return;
+}
+
+void TCPServerSocket::HeartbeatTimerEventHandler() {
+    if (state() != QAbstractSocket::ConnectedState) {
+        tmrHeartbeat->stop();
+        return;
+    }
+
+    //Close the session if the client has stopped answering, this object is deleted by TCP Server Object
+    if (hbmHeartbeat.IsPeerDead()) {
+        qDebug() << "TCPServer: Remote client" << sClientIPAddress << ":" << iClientPort << "did not answer heartbeats, connection aborted.";
+        hbmHeartbeat.MarkPeerDead();
+        tmrHeartbeat->stop();
+        emit SocketErrorOccurredEvent(QAbstractSocket::SocketTimeoutError, iClientID);
+        abort();
+        return;
+    }
+
+    QByteArray baPing;
+    hbmHeartbeat.AppendPing(baPing, iFramingMode);
+    TCPServerSocket::WriteOutput(baPing, false);
+    return;
+}
+
+/* Commands */
+void TCPServerSocket::SetCommandExecutor(NetworkingCommandExecutor * excCommandsNew) {
+    excCommands = excCommandsNew;
+    return;
+}
+
+/* Output Queue */
+void TCPServerSocket::SetOutputQueueOptions(int iOutputQueueMaxBytesNew, SlowClientPolicy iSlowClientPolicyNew) {
+    iOutputQueueMaxBytes = iOutputQueueMaxBytesNew;
+    iSlowClientPolicy = iSlowClientPolicyNew;
+    return;
+}
+
+QString TCPServerSocket::GetSlowClientPolicyName(SlowClientPolicy iSlowClientPolicy) {
+    switch (iSlowClientPolicy) {
+    case Coalesce:
+        return "Coalesce";
+    case Disconnect:
+        return "Disconnect";
+    case DropOldest:
+    default:
+        return "DropOldest";
+    }
+}
+
+TCPServerSocket::SlowClientPolicy TCPServerSocket::GetSlowClientPolicyByName(const QString & sSlowClientPolicyName) {
+    if (sSlowClientPolicyName.compare("Coalesce", Qt::CaseInsensitive) == 0) {
+        return Coalesce;
+    }
+    else if (sSlowClientPolicyName.compare("Disconnect", Qt::CaseInsensitive) == 0) {
+        return Disconnect;
+    }
+    return DropOldest;
+}
+
+/* Encoding */
+quint64 TCPServerEncodedMessage::GetEncodingKey(Encoding iEncoding, int iCompressionThreshold, int iCompressionLevel) {
+    //"<threshold (32 bits)><level (8 bits)><encoding (8 bits)>"
+    if (iEncoding != Compressed) {
+        return static_cast<quint64>(iEncoding);
+    }
+    return (static_cast<quint64>(static_cast<quint32>(iCompressionThreshold)) << 32) | (static_cast<quint64>(iCompressionLevel & 0xFF) << 8) | static_cast<quint64>(iEncoding);
+}
+
+TCPServerEncodedMessage::Encoding TCPServerSocket::GetOutputEncoding() const {
+    return static_cast<TCPServerEncodedMessage::Encoding>(iOutputEncoding.fetchAndAddAcquire(0));
+}
+
+quint64 TCPServerSocket::GetOutputEncodingKey() const {
+    //Compression options do not change once the socket object has been moved to a worker thread
+    return TCPServerEncodedMessage::GetEncodingKey(TCPServerSocket::GetOutputEncoding(), iCompressionThreshold, iCompressionLevel);
+}
+
+QByteArray TCPServerSocket::EncodeMessage(const QByteArray & baData, quint64 iEncodingKey) {
+    return TCPServerSocket::EncodeMessage(baData, static_cast<TCPServerEncodedMessage::Encoding>(iEncodingKey & 0xFF),
+                                          static_cast<int>(static_cast<quint32>(iEncodingKey >> 32)), static_cast<int>((iEncodingKey >> 8) & 0xFF));
+}
+
+QByteArray TCPServerSocket::EncodeMessage(const QByteArray & baData, TCPServerEncodedMessage::Encoding iEncoding, int iCompressionThreshold, int iCompressionLevel) {
+    if (iEncoding == TCPServerEncodedMessage::Text) {
+        //Add line separator, using Linux mode ("\n"), the buffer is shared as is if it is already terminated
+        if (!baData.endsWith('\n')) {
+            return baData + '\n';
+        }
+        else if (baData.endsWith("\r\n")) {
+            //Built in one copy, removing '\r' from the shared buffer would detach it and move the tail again
+            QByteArray baLine(baData.constData(), baData.size() - 1);
+            baLine[baLine.size() - 1] = '\n';
+            return baLine;
+        }
+        return baData;
+    }
+
+    //Binary frames carry the text as is, no line separator is required
+    QByteArray baFrame;
+    BinaryFrameEncoder::AppendFrame(baFrame, NET_FRAME_TYPE_DATA, baData);
+
+    //A large response is sent as a compressed batch of one frame, if it shrinks
+    if (iEncoding == TCPServerEncodedMessage::Compressed && baFrame.size() >= iCompressionThreshold) {
+        QByteArray baCompressedBatch;
+        if (BinaryFrameEncoder::AppendCompressedBatch(baCompressedBatch, baFrame.constData(), baFrame.size(), iCompressionLevel)) {
+            return baCompressedBatch;
+        }
+    }
+    return baFrame;
+}
+
+bool TCPServerSocket::IsOutputWritable() const {
+    //Messages are never reordered, nothing is written past queued ones
+    return (queOutputMessages.isEmpty() && bytesToWrite() < NET_SERVER_SOCKET_WRITE_BUFFER_BYTES);
+}
+
+void TCPServerSocket::WriteOutput(const QByteArray & baMessage, bool bIsResponse) {
+    //Write at once while the client keeps up, the shared buffer is handed to the socket without copying
+    if (TCPServerSocket::IsOutputWritable()) {
+        write(baMessage);
+        cntBytesSent.Add(baMessage.size());
+        if (bIsResponse) {
+            cntFramesSent.Add();
+        }
+        return;
+    }
+
+    //The client reads slower than we send, apply slow client policy to a response which does not fit in the budget
+    if (bIsResponse && iOutputQueueBytesUsed + baMessage.size() > iOutputQueueMaxBytes) {
+        switch (iSlowClientPolicy) {
+        case Disconnect:
+            qDebug() << "TCPServer: Remote client" << sClientIPAddress << ":" << iClientPort << "is too slow to read responses, connection aborted.";
+            TCPServerSocket::DropQueuedResponses(iOutputQueueBytesUsed);
+            cntOutputFramesDropped.Add();
+            cntSlowClientDisconnects.Add();
+            emit SocketErrorOccurredEvent(QAbstractSocket::SocketResourceError, iClientID);
+            abort();
+            return;
+        case Coalesce:
+            TCPServerSocket::DropQueuedResponses(iOutputQueueBytesUsed);
+            break;
+        case DropOldest:
+        default:
+            TCPServerSocket::DropQueuedResponses(iOutputQueueBytesUsed + baMessage.size() - iOutputQueueMaxBytes);
+            break;
+        }
+
+        //Still does not fit, the response is larger than the budget or control messages have taken it
+        if (iOutputQueueBytesUsed + baMessage.size() > iOutputQueueMaxBytes) {
+            cntOutputFramesDropped.Add();
+            TCPServerSocket::UpdateOutputQueueMetrics();
+            return;
+        }
+    }
+
+    //Queue the message until the socket's write buffer has room
+    queOutputMessages.enqueue(qMakePair(baMessage, bIsResponse));
+    iOutputQueueBytesUsed += baMessage.size();
+    TCPServerSocket::UpdateOutputQueueMetrics();
+    return;
+}
+
+void TCPServerSocket::FlushOutputQueue() {
+    while (!queOutputMessages.isEmpty() && bytesToWrite() < NET_SERVER_SOCKET_WRITE_BUFFER_BYTES && state() == QAbstractSocket::ConnectedState) {
+        QPair<QByteArray, bool> pairMessage = queOutputMessages.dequeue();
+        iOutputQueueBytesUsed -= pairMessage.first.size();
+        write(pairMessage.first);
+        cntBytesSent.Add(pairMessage.first.size());
+        if (pairMessage.second) {
+            cntFramesSent.Add();
+        }
+    }
+    TCPServerSocket::UpdateOutputQueueMetrics();
+    return;
+}
+
+void TCPServerSocket::DropQueuedResponses(int iBytesToFree) {
+    //Framing replies and heartbeats are kept, in order
+    QQueue<QPair<QByteArray, bool> > queKeptMessages;
+    int iFramesDropped = 0;
+    while (!queOutputMessages.isEmpty()) {
+        QPair<QByteArray, bool> pairMessage = queOutputMessages.dequeue();
+        if (pairMessage.second && iBytesToFree > 0) {
+            iBytesToFree -= pairMessage.first.size();
+            iOutputQueueBytesUsed -= pairMessage.first.size();
+            ++iFramesDropped;
+            continue;
+        }
+        queKeptMessages.enqueue(pairMessage);
+    }
+    queOutputMessages = queKeptMessages;
+    cntOutputFramesDropped.Add(iFramesDropped);
+    return;
+}
+
+void TCPServerSocket::UpdateOutputQueueMetrics() {
+    iOutputQueueFramesMetric.fetchAndStoreRelaxed(queOutputMessages.size());
+    iOutputQueueBytesMetric.fetchAndStoreRelaxed(iOutputQueueBytesUsed);
+    cntOutputQueueHighWater.SetMax(iOutputQueueBytesUsed);
+    return;
+}
+
+/* Metrics */
+void TCPServerSocket::GetMetrics(TCPServerSessionMetrics & mtrSession) const {
+    mtrSession.iClientID = iClientID;
+    mtrSession.sClientIPAddress = sClientIPAddress;
+    mtrSession.iClientPort = iClientPort;
+    mtrSession.iFramesReceived = cntFramesReceived.Get();
+    mtrSession.iBytesReceived = cntBytesReceived.Get();
+    mtrSession.iCommandsExecuted = cntCommandsExecuted.Get();
+    mtrSession.iCommandsRejected = cntCommandsRejected.Get();
+    mtrSession.iFramesSent = cntFramesSent.Get();
+    mtrSession.iBytesSent = cntBytesSent.Get();
+    const NetworkingLatencyHistogram & histRoundTripTimes = hbmHeartbeat.GetRoundTripTimes();
+    mtrSession.iRoundTripTimeCount = histRoundTripTimes.GetCount();
+    mtrSession.iRoundTripTimeLast = histRoundTripTimes.GetLast();
+    mtrSession.iRoundTripTimeMax = histRoundTripTimes.GetMax();
+    mtrSession.arrRoundTripTimeBuckets.resize(NET_HISTOGRAM_BUCKET_COUNT);
+    for (int i = 0; i < NET_HISTOGRAM_BUCKET_COUNT; ++i) {
+        mtrSession.arrRoundTripTimeBuckets[i] = histRoundTripTimes.GetBucketCount(i);
+    }
+    mtrSession.iPongsMissed = hbmHeartbeat.GetMissedPongCount();
+    mtrSession.iOutputQueueFrames = iOutputQueueFramesMetric.fetchAndAddRelaxed(0);
+    mtrSession.iOutputQueueBytes = iOutputQueueBytesMetric.fetchAndAddRelaxed(0);
+    mtrSession.iOutputQueueBytesHighWater = cntOutputQueueHighWater.Get();
+    mtrSession.iOutputFramesDropped = cntOutputFramesDropped.Get();
+    mtrSession.iSlowClientDisconnects = cntSlowClientDisconnects.Get();
+    return;
+}
+
+const HeartbeatMonitor & TCPServerSocket::GetHeartbeatMonitor() const {
+    return hbmHeartbeat;
+}
+
 /* Text-Based Communication */
-void TCPServerSocket::SendDataToClientRequestedEventHandler(QString sDataToSend, QString sClientName, QString sClientIPAddress, quint16 iClientPort) {
+void TCPServerSocket::SendDataToClientRequestedEventHandler(QByteArray baDataToSend) {
+    //Binary frames carry the text as is, no line separator is required
+    if (iFramingMode == NetworkingFramingBinary) {
+        TCPServerSocket::WriteOutput(TCPServerSocket::EncodeMessage(baDataToSend, TCPServerSocket::GetOutputEncoding(), iCompressionThreshold, iCompressionLevel), true);
+        return;
+    }
+
     /*
     //Add line separator, using Windows mode ("\r\n")
-    if (!sDataToSend.endsWith("\r\n")){
-        if (sDataToSend.endsWith('\r')){
-            sDataToSend+='\n';
+    if (!baDataToSend.endsWith("\r\n")){
+        if (baDataToSend.endsWith('\r')){
+            baDataToSend+='\n';
         }
-        else if (sDataToSend.endsWith('\n')){
-            sDataToSend.insert(sDataToSend.length()-1, '\r');
+        else if (baDataToSend.endsWith('\n')){
+            baDataToSend.insert(baDataToSend.length()-1, '\r');
         }
         else{
-            sDataToSend+="\r\n";
+            baDataToSend+="\r\n";
         }
     }
     */
-    //Add line separator, using Linux mode ("\n")
-    if (!sDataToSend.endsWith("\n")){
-        sDataToSend+='\n';
-    }
-    else if (sDataToSend.endsWith("\r\n")) {
-        sDataToSend.remove(sDataToSend.length()-2, 1);
-    }
-    
-    //Judge if we need to handle the request
-    if ((sClientName == "" && sClientIPAddress == "" && iClientPort == 0) ||
-        (sClientName == peerName() && sClientIPAddress == "" && iClientPort == 0) ||
-        (sClientName == "" && sClientIPAddress == peerAddress().toString() && iClientPort == 0) ||
-        (sClientName == "" && sClientIPAddress == "" && iClientPort == peerPort()) ||
-        (sClientName == peerName() && sClientIPAddress == peerAddress().toString() && iClientPort == 0) ||
-        (sClientName == peerName() && sClientIPAddress == "" && iClientPort == peerPort()) ||
-        (sClientName == "" && sClientIPAddress == peerAddress().toString() && iClientPort == peerPort()) ||
-        (sClientName == peerName() && sClientIPAddress == peerAddress().toString() && iClientPort == peerPort()) ) {
-        //Send text to remote, using UTF-8
-        write(sDataToSend.toUtf8());
+    //Add line separator, using Linux mode ("\n"), the shared buffer is written as is if it is already terminated
+    //Otherwise the line is written with a single write() call, and a queued line is dropped as a whole
+    TCPServerSocket::WriteOutput(TCPServerSocket::EncodeMessage(baDataToSend, TCPServerEncodedMessage::Text, iCompressionThreshold, iCompressionLevel), true);
+    return;
+}
+
+void TCPServerSocket::SendEncodedDataToClientRequestedEventHandler(TCPServerEncodedMessage msgEncoded) {
+    //Framing may have been negotiated since the broadcast was prepared, the message is then encoded here
+    const QByteArray baEncodedData = msgEncoded.hshEncodedData.value(TCPServerSocket::GetOutputEncodingKey());
+    if (baEncodedData.isNull()) {
+        TCPServerSocket::SendDataToClientRequestedEventHandler(msgEncoded.baData);
+        return;
     }
+    TCPServerSocket::WriteOutput(baEncodedData, true);
     return;
 }
 
@@ -64,96 +394,229 @@ void TCPServerSocket::CloseAllConnectionsRequestedEventHandler() {
 
 /* Command Incoming Event Handler Slot */
 void TCPServerSocket::CommandReceivedFromClientEventHandler() {
-    while (bytesAvailable()) {
-        //Read a command line and emit a signal
-        QString sData = readLine();
-        if (sData.endsWith('\n')) {
-            sData.remove(sData.length() - 1, 1);
+    //All commands received in this call are delivered with a single signal
+    QList<QByteArray> lstCommands;
+    QByteArray baReceivedData = readAll();
+    cntBytesReceived.Add(baReceivedData.size());
+
+    if (iFramingMode == NetworkingFramingText) {
+        //Take complete command lines out, a partial line is kept until the rest of it is received
+        QByteArray baData;
+        decLineDecoder.Append(baReceivedData);
+        while (iFramingMode == NetworkingFramingText && decLineDecoder.NextLine(baData)) {
+            //Answer client's framing request, bytes following the request are binary framed if accepted
+            //A compression request is accepted as a binary framing request only, if compression is not allowed
+            if (baData == NET_FRAMING_REQUEST_BINARY || baData == NET_FRAMING_REQUEST_COMPRESSED) {
+                if (bIsBinaryFramingAllowed) {
+                    bIsCompressionEnabled = (bIsCompressionAllowed && baData == NET_FRAMING_REQUEST_COMPRESSED);
+                    if (bIsCompressionEnabled) {
+                        TCPServerSocket::WriteOutput(NET_FRAMING_REPLY_COMPRESSED "\n", false);
+                    }
+                    else {
+                        TCPServerSocket::WriteOutput(NET_FRAMING_REPLY_BINARY "\n", false);
+                    }
+                    iFramingMode = NetworkingFramingBinary;
+                    iOutputEncoding.fetchAndStoreRelease(bIsCompressionEnabled ? TCPServerEncodedMessage::Compressed : TCPServerEncodedMessage::Binary);
+                    decCommandDecoder.Clear();
+                    decCommandDecoder.SetCompressionEnabled(bIsCompressionEnabled);
+                    baReceivedData = decLineDecoder.TakeRemainingData();
+                    qDebug() << "TCPServer: Using binary framing" << (bIsCompressionEnabled ? "with compression" : "") << "with remote client" << sClientIPAddress << ":" << iClientPort << ".";
+                }
+                else {
+                    TCPServerSocket::WriteOutput(NET_FRAMING_REPLY_TEXT "\n", false);
+                }
+                continue;
+            }
+
+            //Heartbeats are handled here, they are not commands
+            QByteArray baHeartbeatPayload;
+            HeartbeatMonitor::MessageKind iHeartbeatKind = HeartbeatMonitor::ParseLine(baData, baHeartbeatPayload);
+            if (iHeartbeatKind != HeartbeatMonitor::NotHeartbeat) {
+                TCPServerSocket::HandleHeartbeat(iHeartbeatKind, baHeartbeatPayload);
+                continue;
+            }
+            lstCommands.append(baData);
         }
-        if (sData.endsWith('\r')) {
-            sData.remove(sData.length() - 1, 1);
+        if (decLineDecoder.IsCorrupted()) {
+            qDebug() << "TCPServer: Too long command line received from remote client" << sClientIPAddress << ":" << iClientPort << ", connection aborted.";
+            abort();
         }
-        emit SocketCommandReceivedFromClientEvent(sData, peerName(), peerAddress().toString(), peerPort());
+    }
 
-        //Process events
-        //QApplication::processEvents();
+    if (iFramingMode == NetworkingFramingBinary) {
+        //Take whole frames out
+        quint8 iMessageType = 0;
+        QByteArray baPayload;
+        decCommandDecoder.Append(baReceivedData);
+        while (decCommandDecoder.NextFrame(iMessageType, baPayload)) {
+            if (iMessageType == NET_FRAME_TYPE_DATA) {
+                lstCommands.append(baPayload);
+            }
+            else if (HeartbeatMonitor::GetFrameKind(iMessageType) != HeartbeatMonitor::NotHeartbeat) {
+                TCPServerSocket::HandleHeartbeat(HeartbeatMonitor::GetFrameKind(iMessageType), baPayload);
+            }
+        }
+        if (decCommandDecoder.IsCorrupted()) {
+            qDebug() << "TCPServer: Corrupted binary frame received from remote client" << sClientIPAddress << ":" << iClientPort << ", connection aborted.";
+            abort();
+        }
     }
-    return;
-}
 
-/* TCP Socket Event Handler Slots */
-void TCPServerSocket::TCPServerSocket_Connected() {
-    qDebug() << "TCPServer: Connection established with remote client" << peerAddress() << ":" << peerPort() << ".";
-    emit SocketConnectedToClientEvent(peerName(), peerAddress().toString(), peerPort());
+    //Commands with a handler are queued to the command executor, which runs them in order and answers on this connection, other commands are passed to upper layers
+    cntFramesReceived.Add(lstCommands.size());
+    QList<QByteArray> lstUnhandledCommands;
+    for (int i = 0; i < lstCommands.size(); ++i) {
+        NetworkingCommandExecutor::SubmitResult iSubmitResult = excCommands ? excCommands->Submit(iClientID, lstCommands.at(i)) : NetworkingCommandExecutor::NotHandled;
+        if (iSubmitResult == NetworkingCommandExecutor::Queued) {
+            cntCommandsExecuted.Add();
+        }
+        else if (iSubmitResult == NetworkingCommandExecutor::Rejected) {
+            //The client may retry later, the verb tells which command was not executed
+            cntCommandsRejected.Add();
+            TCPServerSocket::SendDataToClientRequestedEventHandler(QByteArray(NET_COMMAND_REPLY_BUSY " ") + NetworkingCommandTable::PeekVerb(lstCommands.at(i)));
+        }
+        else {
+            lstUnhandledCommands.append(lstCommands.at(i));
+        }
+    }
+    if (!lstUnhandledCommands.isEmpty()) {
+        emit SocketCommandsReceivedFromClientEvent(iClientID, lstUnhandledCommands);
+    }
     return;
 }
 
+/* TCP Socket Event Handler Slots */
 void TCPServerSocket::TCPServerSocket_Disconnected() {
-    qDebug() << "TCPServer: Remote client" << peerAddress() << "disconnected.";
-    emit SocketDisconnectedFromClientEvent(peerName(), peerAddress().toString(), peerPort());
-    this->deleteLater(); //Delete this object safely
+    qDebug() << "TCPServer: Remote client" << sClientIPAddress << "disconnected.";
+    emit SocketDisconnectedFromClientEvent(iClientID); //This object is deleted by TCP Server Object
     return;
 }
 
 void TCPServerSocket::TCPServerSocket_Error(QAbstractSocket::SocketError errErrorInfo) {
     qDebug() << "TCPServer: Error" << errErrorInfo << "occurred, connection aborted.";
-    emit SocketErrorOccurredEvent(errErrorInfo, peerName(), peerAddress().toString(), peerPort());
-    this->deleteLater(); //Delete this object safely
+    emit SocketErrorOccurredEvent(errErrorInfo, iClientID); //This object is deleted by TCP Server Object
+    return;
+}
+
+void TCPServerSocket::TCPServerSocket_BytesWritten(qint64 iBytesWritten) {
+    Q_UNUSED(iBytesWritten);
+
+    //The client has read some data, hand it queued messages
+    TCPServerSocket::FlushOutputQueue();
     return;
 }
 
 /* TCP Server Object */
 TCPServer::TCPServer() {
+    //Initialize internal variables
+    iLastClientID = 0;
+    iNextWorkerThread = 0;
+    engEpoll = NULL;
+
+    //Create local endpoint listener, connections are accepted in this thread like QTcpServer does
+    lsnLocal = new LocalSocketListener(this);
+    connect(lsnLocal, SIGNAL(IncomingConnectionEvent(int)), this, SLOT(LocalConnectionEventHandler(int)));
+
     //Load settings
     TCPServer::LoadSettings();
+
+    //Create command executor and worker threads
+    excCommands = new NetworkingCommandExecutor(&tblCommands, this);
+    excCommands->SetOptions(iCommandThreadCount, iCommandClientQueueLimit, iCommandQueueLimit);
+    TCPServer::StartWorkerThreads();
+    NetworkingMetrics::RegisterSource(this);
 }
 
 TCPServer::TCPServer(quint16 iListeningPortInit) {
+    //Initialize internal variables
+    iLastClientID = 0;
+    iNextWorkerThread = 0;
+    engEpoll = NULL;
+
+    //Create local endpoint listener, connections are accepted in this thread like QTcpServer does
+    lsnLocal = new LocalSocketListener(this);
+    connect(lsnLocal, SIGNAL(IncomingConnectionEvent(int)), this, SLOT(LocalConnectionEventHandler(int)));
+
+    //Load settings which are not given
+    TCPServer::LoadSettings();
+
     //Save settings
     iListeningPort = iListeningPortInit;
     TCPServer::SaveSettings();
+
+    //Create command executor and worker threads
+    excCommands = new NetworkingCommandExecutor(&tblCommands, this);
+    excCommands->SetOptions(iCommandThreadCount, iCommandClientQueueLimit, iCommandQueueLimit);
+    TCPServer::StartWorkerThreads();
+    NetworkingMetrics::RegisterSource(this);
 }
 
 TCPServer::~TCPServer() {
+    //Wait until running scrapes have finished
+    NetworkingMetrics::UnregisterSource(this);
+
     //Save settings
     TCPServer::SaveSettings();
 
     //Close server
-    if (isListening()) {
+    if (isListening() || lsnLocal->IsListening() || (engEpoll && engEpoll->IsListening())) {
         TCPServer::StopListening();
     }
 
-    //Abort all connected clients
-    emit CloseAllConnectionsRequestedEvent();
+    //Abort all connected clients, and quit worker threads
+    TCPServer::StopWorkerThreads();
+
+    //Wait for running commands, their replies find no session anymore
+    delete excCommands;
 }
 
 /* Options Management */
 void TCPServer::LoadSettings() {
-    SettingsContainer.beginGroup(ST_KEY_NETWORKING_PREFIX);
-    iListeningPort = SettingsContainer.value(ST_KEY_LISTENING_PORT, ST_DEFVAL_LISTENING_PORT).toUInt();
-    SettingsContainer.endGroup();
+    iListeningPort = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_LISTENING_PORT, ST_DEFVAL_LISTENING_PORT).toUInt();
+    bIsBinaryFramingEnabled = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_SERVER_BINARY_FRAMING, ST_DEFVAL_SERVER_BINARY_FRAMING).toBool();
+    bIsCompressionEnabled = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_SERVER_COMPRESSION, ST_DEFVAL_SERVER_COMPRESSION).toBool();
+    iCompressionThreshold = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_COMPRESSION_THRESHOLD, ST_DEFVAL_COMPRESSION_THRESHOLD).toInt();
+    iCompressionLevel = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_COMPRESSION_LEVEL, ST_DEFVAL_COMPRESSION_LEVEL).toInt();
+    iHeartbeatInterval = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_HEARTBEAT_INTERVAL_MS, ST_DEFVAL_HEARTBEAT_INTERVAL_MS).toUInt();
+    iHeartbeatMaxMissed = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_HEARTBEAT_MAX_MISSED, ST_DEFVAL_HEARTBEAT_MAX_MISSED).toInt();
+    iWorkerThreadCount = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_SERVER_WORKER_THREADS, ST_DEFVAL_SERVER_WORKER_THREADS).toInt();
+    iConnectionDistributionPolicy = TCPServer::GetConnectionDistributionPolicyByName(SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_SERVER_DISTRIBUTION, ST_DEFVAL_SERVER_DISTRIBUTION).toString());
+    iOutputQueueMaxBytes = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_SERVER_OUTPUT_MAX_BYTES, ST_DEFVAL_SERVER_OUTPUT_MAX_BYTES).toInt();
+    iSlowClientPolicy = TCPServerSocket::GetSlowClientPolicyByName(SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_SERVER_SLOW_CLIENT_POLICY, ST_DEFVAL_SERVER_SLOW_CLIENT_POLICY).toString());
+    iCommandThreadCount = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_SERVER_COMMAND_THREADS, ST_DEFVAL_SERVER_COMMAND_THREADS).toInt();
+    iCommandClientQueueLimit = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_SERVER_COMMAND_CLIENT_QUEUE, ST_DEFVAL_SERVER_COMMAND_CLIENT_QUEUE).toInt();
+    iCommandQueueLimit = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_SERVER_COMMAND_QUEUE, ST_DEFVAL_SERVER_COMMAND_QUEUE).toInt();
+    iServerBackend = TCPServer::GetServerBackendByName(SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_SERVER_BACKEND, ST_DEFVAL_SERVER_BACKEND).toString());
+    sLocalEndpoint = SettingsContainer.GetValue(ST_KEY_NETWORKING_PREFIX, ST_KEY_SERVER_LOCAL_ENDPOINT, ST_DEFVAL_SERVER_LOCAL_ENDPOINT).toString().trimmed();
     return;
 }
 
 void TCPServer::SaveSettings() const {
-    SettingsContainer.beginGroup(ST_KEY_NETWORKING_PREFIX);
-    SettingsContainer.setValue(ST_KEY_LISTENING_PORT, iListeningPort);
-    SettingsContainer.endGroup();
+    QMap<QString, QVariant> mapSettings;
+    mapSettings.insert(ST_KEY_LISTENING_PORT, iListeningPort);
+    mapSettings.insert(ST_KEY_SERVER_BINARY_FRAMING, bIsBinaryFramingEnabled);
+    mapSettings.insert(ST_KEY_SERVER_COMPRESSION, bIsCompressionEnabled);
+    mapSettings.insert(ST_KEY_COMPRESSION_THRESHOLD, iCompressionThreshold);
+    mapSettings.insert(ST_KEY_COMPRESSION_LEVEL, iCompressionLevel);
+    mapSettings.insert(ST_KEY_HEARTBEAT_INTERVAL_MS, iHeartbeatInterval);
+    mapSettings.insert(ST_KEY_HEARTBEAT_MAX_MISSED, iHeartbeatMaxMissed);
+    mapSettings.insert(ST_KEY_SERVER_WORKER_THREADS, iWorkerThreadCount);
+    mapSettings.insert(ST_KEY_SERVER_DISTRIBUTION, TCPServer::GetConnectionDistributionPolicyName(iConnectionDistributionPolicy));
+    mapSettings.insert(ST_KEY_SERVER_OUTPUT_MAX_BYTES, iOutputQueueMaxBytes);
+    mapSettings.insert(ST_KEY_SERVER_SLOW_CLIENT_POLICY, TCPServerSocket::GetSlowClientPolicyName(iSlowClientPolicy));
+    mapSettings.insert(ST_KEY_SERVER_COMMAND_THREADS, iCommandThreadCount);
+    mapSettings.insert(ST_KEY_SERVER_COMMAND_CLIENT_QUEUE, iCommandClientQueueLimit);
+    mapSettings.insert(ST_KEY_SERVER_COMMAND_QUEUE, iCommandQueueLimit);
+    mapSettings.insert(ST_KEY_SERVER_BACKEND, TCPServer::GetServerBackendName(iServerBackend));
+    mapSettings.insert(ST_KEY_SERVER_LOCAL_ENDPOINT, sLocalEndpoint);
+    SettingsContainer.SetValues(ST_KEY_NETWORKING_PREFIX, mapSettings);
     return;
 }
 
 
 /* Listening Status Management */
 bool TCPServer::StartListening() {
-    if (listen(QHostAddress::Any, iListeningPort)) {
-        qDebug() << "TCPServer: Started listening on port" << iListeningPort;
-        return true;
-    }
-    else {
-        qDebug() << "TCPServer: Couldnot start listening on port" << iListeningPort;
-        return false;
-    }
-    return false;
+    return TCPServer::ListenOnPort();
 }
 
 bool TCPServer::StartListening(quint16 iListeningPortNew) {
@@ -162,52 +625,718 @@ bool TCPServer::StartListening(quint16 iListeningPortNew) {
     TCPServer::SaveSettings();
 
     //Try starting listening
-    if (listen(QHostAddress::Any, iListeningPort)) {
-        qDebug() << "TCPServer: Started listening on port" << iListeningPort;
-        return true;
-    }
-    else {
-        qDebug() << "TCPServer: Couldnot start listening on port" << iListeningPort;
-        return false;
-    }
-    return false;
+    return TCPServer::ListenOnPort();
 }
 
 void TCPServer::StopListening() {
     qDebug() << "TCPServer: Server closed";
+    lsnLocal->Close();
+    if (engEpoll) {
+        engEpoll->StopListening();
+        return;
+    }
     close(); //Close the sever and stop listening
     return;
 }
 
+bool TCPServer::ListenOnPort() {
+    bool bIsListening = engEpoll ? engEpoll->StartListening(iListeningPort) : listen(QHostAddress::Any, iListeningPort);
+    if (!bIsListening) {
+        qDebug() << "TCPServer: Couldnot start listening on port" << iListeningPort;
+        return false;
+    }
+    qDebug() << "TCPServer: Started listening on port" << iListeningPort;
+
+    //A local endpoint which could not be listened on does not stop the TCP port, see IsLocalEndpointListening()
+    if (sLocalEndpoint.isEmpty()) {
+        return true;
+    }
+    if (engEpoll) {
+        qDebug() << "TCPServer: Local endpoint" << sLocalEndpoint << "is not served by Epoll backend";
+    }
+    else if (lsnLocal->Listen(sLocalEndpoint)) {
+        qDebug() << "TCPServer: Started listening on" << sLocalEndpoint;
+    }
+    else {
+        qDebug() << "TCPServer: Couldnot start listening on" << sLocalEndpoint;
+    }
+    return true;
+}
+
 /* Text-Based Communication */
 void TCPServer::SendDataToClient(QString sDataToSend, QString sClientName, QString sClientIPAddress, quint16 iClientPort) {
-    emit SendDataToClientRequestedEvent(sDataToSend, sClientName, sClientIPAddress, iClientPort);
+    //Encode once using UTF-8, the bytes are then shared by all sockets
+    TCPServer::SendDataToClient(sDataToSend.toUtf8(), sClientName, sClientIPAddress, iClientPort);
+    return;
+}
+
+void TCPServer::SendDataToClient(const QByteArray & baDataToSend, QString sClientName, QString sClientIPAddress, quint16 iClientPort) {
+    if (engEpoll) {
+        engEpoll->SendDataToClients(baDataToSend, sClientName, sClientIPAddress, iClientPort);
+        return;
+    }
+    QReadLocker lckSessionRegistry(&rwlSessionRegistry);
+
+    //Look up the client directly if its endpoint is specified
+    if (!sClientIPAddress.isEmpty() && iClientPort != 0) {
+        TCPServerSocket * tcpSocket = hshSessions.value(hshSessionIDsByEndpoint.value(qMakePair(sClientIPAddress, iClientPort), 0), NULL);
+        if (tcpSocket && (sClientName.isEmpty() || sClientName == tcpSocket->GetClientName())) {
+            QMetaObject::invokeMethod(tcpSocket, "SendDataToClientRequestedEventHandler", Q_ARG(QByteArray, baDataToSend));
+        }
+        return;
+    }
+
+    //Otherwise check every client, empty name/IP address and zero port match any client
+    QVector<TCPServerSocket *> arrReceivers;
+    QList<quint64> lstEncodingKeys; //Encodings in use, with the compression options of their sessions
+    for (QHash<int, TCPServerSocket *>::const_iterator itSession = hshSessions.constBegin(); itSession != hshSessions.constEnd(); ++itSession) {
+        TCPServerSocket * tcpSocket = itSession.value();
+        if ((sClientName.isEmpty() || sClientName == tcpSocket->GetClientName()) &&
+            (sClientIPAddress.isEmpty() || sClientIPAddress == tcpSocket->GetClientIPAddress()) &&
+            (iClientPort == 0 || iClientPort == tcpSocket->GetClientPort())) {
+            arrReceivers.append(tcpSocket);
+            quint64 iEncodingKey = tcpSocket->GetOutputEncodingKey();
+            if (!lstEncodingKeys.contains(iEncodingKey)) {
+                lstEncodingKeys.append(iEncodingKey);
+            }
+        }
+    }
+    if (arrReceivers.size() == 1) {
+        QMetaObject::invokeMethod(arrReceivers.first(), "SendDataToClientRequestedEventHandler", Q_ARG(QByteArray, baDataToSend)); //Queued to socket's worker thread
+        return;
+    }
+
+    //Encode once for each encoding in use, every receiver then only takes a reference to the encoded buffer
+    TCPServerEncodedMessage msgEncoded;
+    msgEncoded.baData = baDataToSend;
+    for (int i = 0; i < lstEncodingKeys.size(); ++i) {
+        msgEncoded.hshEncodedData.insert(lstEncodingKeys.at(i), TCPServerSocket::EncodeMessage(baDataToSend, lstEncodingKeys.at(i)));
+    }
+    for (int i = 0; i < arrReceivers.size(); ++i) {
+        QMetaObject::invokeMethod(arrReceivers.at(i), "SendEncodedDataToClientRequestedEventHandler", Q_ARG(TCPServerEncodedMessage, msgEncoded)); //Queued to socket's worker thread
+    }
+    return;
+}
+
+void TCPServer::SendDataToClient(const char * chrDataToSend, QString sClientName, QString sClientIPAddress, quint16 iClientPort) {
+    TCPServer::SendDataToClient(QByteArray(chrDataToSend), sClientName, sClientIPAddress, iClientPort);
+    return;
+}
+
+bool TCPServer::SendDataToClient(int iClientID, const QByteArray & baDataToSend) {
+    if (engEpoll) {
+        return engEpoll->SendDataToClient(iClientID, baDataToSend);
+    }
+    QReadLocker lckSessionRegistry(&rwlSessionRegistry);
+    TCPServerSocket * tcpSocket = hshSessions.value(iClientID, NULL);
+    if (!tcpSocket) {
+        return false;
+    }
+    QMetaObject::invokeMethod(tcpSocket, "SendDataToClientRequestedEventHandler", Q_ARG(QByteArray, baDataToSend));
+    return true;
+}
+
+/* Session Registry */
+int TCPServer::GetConnectedClientCount() const {
+    if (engEpoll) {
+        return engEpoll->GetConnectedClientCount();
+    }
+    QReadLocker lckSessionRegistry(&rwlSessionRegistry);
+    return hshSessions.size();
+}
+
+QList<int> TCPServer::GetConnectedClientIDs() const {
+    if (engEpoll) {
+        return engEpoll->GetConnectedClientIDs();
+    }
+    QReadLocker lckSessionRegistry(&rwlSessionRegistry);
+    return hshSessions.keys();
+}
+
+int TCPServer::FindClientID(const QString & sClientIPAddress, quint16 iClientPort) const {
+    if (engEpoll) {
+        return engEpoll->FindClientID(sClientIPAddress, iClientPort);
+    }
+    QReadLocker lckSessionRegistry(&rwlSessionRegistry);
+    return hshSessionIDsByEndpoint.value(qMakePair(sClientIPAddress, iClientPort), 0);
+}
+
+bool TCPServer::GetClientInformation(int iClientID, QString & sClientName, QString & sClientIPAddress, quint16 & iClientPort) const {
+    if (engEpoll) {
+        return engEpoll->GetClientInformation(iClientID, sClientName, sClientIPAddress, iClientPort);
+    }
+    QReadLocker lckSessionRegistry(&rwlSessionRegistry);
+    TCPServerSocket * tcpSocket = hshSessions.value(iClientID, NULL);
+    if (!tcpSocket) {
+        return false;
+    }
+    sClientName = tcpSocket->GetClientName();
+    sClientIPAddress = tcpSocket->GetClientIPAddress();
+    iClientPort = tcpSocket->GetClientPort();
+    return true;
+}
+
+/* Command Handlers */
+bool TCPServer::RegisterCommandHandler(const QByteArray & baVerb, NetworkingCommandHandler * hdlCommand) {
+    return tblCommands.RegisterHandler(baVerb, hdlCommand);
+}
+
+void TCPServer::UnregisterCommandHandler(const QByteArray & baVerb) {
+    tblCommands.UnregisterHandler(baVerb);
+    return;
+}
+
+QList<QByteArray> TCPServer::GetCommandVerbs() const {
+    return tblCommands.GetVerbs();
+}
+
+void TCPServer::SendCommandReplies(int iClientID, const QList<QByteArray> & lstReplies) {
+    //Called from command threads, replies are queued to the socket's worker thread in order
+    //The engine is only deleted while the registry is locked for writing, thus it is alive while the registry is locked for reading
+    QReadLocker lckSessionRegistry(&rwlSessionRegistry);
+    if (engEpoll) {
+        for (int i = 0; i < lstReplies.size(); ++i) {
+            engEpoll->SendDataToClient(iClientID, lstReplies.at(i));
+        }
+        return;
+    }
+    TCPServerSocket * tcpSocket = hshSessions.value(iClientID, NULL);
+    if (!tcpSocket) {
+        return;
+    }
+    for (int i = 0; i < lstReplies.size(); ++i) {
+        QMetaObject::invokeMethod(tcpSocket, "SendDataToClientRequestedEventHandler", Q_ARG(QByteArray, lstReplies.at(i)));
+    }
+    return;
+}
+
+bool TCPServer::GetClientOutputQueueDepth(int iClientID, int & iQueuedFrames, int & iQueuedBytes) const {
+    if (engEpoll) {
+        return engEpoll->GetClientOutputQueueDepth(iClientID, iQueuedFrames, iQueuedBytes);
+    }
+    QReadLocker lckSessionRegistry(&rwlSessionRegistry);
+    TCPServerSocket * tcpSocket = hshSessions.value(iClientID, NULL);
+    if (!tcpSocket) {
+        return false;
+    }
+    TCPServerSessionMetrics mtrSession;
+    tcpSocket->GetMetrics(mtrSession);
+    iQueuedFrames = mtrSession.iOutputQueueFrames;
+    iQueuedBytes = mtrSession.iOutputQueueBytes;
+    return true;
+}
+
+void TCPServer::CloseSession(int iClientID) {
+    //A failed connection may be reported by both error and disconnection events, only the first one is handled
+    QWriteLocker lckSessionRegistry(&rwlSessionRegistry);
+    TCPServerSocket * tcpSocket = hshSessions.take(iClientID);
+    if (!tcpSocket) {
+        return;
+    }
+    if (tcpSocket->GetClientPort() != 0) {
+        hshSessionIDsByEndpoint.remove(qMakePair(tcpSocket->GetClientIPAddress(), tcpSocket->GetClientPort()));
+    }
+
+    //Keep counters of the session in server's sums, before the lock is released so that scrapes never see them dip
+    TCPServerSessionMetrics mtrSession;
+    tcpSocket->GetMetrics(mtrSession);
+    cntClosedFramesReceived.Add(mtrSession.iFramesReceived);
+    cntClosedBytesReceived.Add(mtrSession.iBytesReceived);
+    cntClosedCommandsExecuted.Add(mtrSession.iCommandsExecuted);
+    cntClosedCommandsRejected.Add(mtrSession.iCommandsRejected);
+    cntClosedFramesSent.Add(mtrSession.iFramesSent);
+    cntClosedBytesSent.Add(mtrSession.iBytesSent);
+    cntDeadClients.Add(tcpSocket->GetHeartbeatMonitor().GetDeadPeerCount());
+    cntClosedOutputFramesDropped.Add(mtrSession.iOutputFramesDropped);
+    cntSlowClients.Add(mtrSession.iSlowClientDisconnects);
+    cntSessionsClosed.Add();
+    int iWorkerThreadIndex = trdWorkerThreads.indexOf(tcpSocket->thread());
+    if (iWorkerThreadIndex >= 0) {
+        --arrWorkerThreadLoads[iWorkerThreadIndex];
+    }
+    lckSessionRegistry.unlock();
+
+    //Commands still waiting would be answered to nobody
+    excCommands->RemoveClient(iClientID);
+
+    //Once removed from the registry, no other thread can reach the socket object, delete it in its own thread
+    //Its worker thread may delete it at once, thus client's information is copied first
+    QString sClientName = tcpSocket->GetClientName();
+    QString sClientIPAddress = tcpSocket->GetClientIPAddress();
+    quint16 iClientPort = tcpSocket->GetClientPort();
+    tcpSocket->deleteLater();
+
+    //Inform upper layer(s) of a disconnected client
+    emit ClientDisconnectedEvent(sClientName, sClientIPAddress, iClientPort);
+    emit ClientSessionClosedEvent(iClientID);
+    return;
+}
+
+/* Metrics */
+TCPServerMetrics TCPServer::GetMetricsSnapshot() const {
+    TCPServerMetrics mtrServer;
+    if (engEpoll) {
+        engEpoll->GetMetrics(mtrServer);
+        mtrServer.iCommandsQueued = excCommands->GetQueuedCommandCount();
+        mtrServer.iCommandsDropped = excCommands->GetDroppedCommandCount();
+        return mtrServer;
+    }
+    QReadLocker lckSessionRegistry(&rwlSessionRegistry);
+    mtrServer.iConnectedClientCount = hshSessions.size();
+    mtrServer.iSessionsAccepted = cntSessionsAccepted.Get();
+    mtrServer.iSessionsClosed = cntSessionsClosed.Get();
+    mtrServer.iFramesReceived = cntClosedFramesReceived.Get();
+    mtrServer.iBytesReceived = cntClosedBytesReceived.Get();
+    mtrServer.iCommandsExecuted = cntClosedCommandsExecuted.Get();
+    mtrServer.iCommandsRejected = cntClosedCommandsRejected.Get();
+    mtrServer.iFramesSent = cntClosedFramesSent.Get();
+    mtrServer.iBytesSent = cntClosedBytesSent.Get();
+    mtrServer.iDeadClientCount = cntDeadClients.Get();
+    mtrServer.iOutputFramesDropped = cntClosedOutputFramesDropped.Get();
+    mtrServer.iSlowClientCount = cntSlowClients.Get();
+    mtrServer.iCommandsQueued = excCommands->GetQueuedCommandCount();
+    mtrServer.iCommandsDropped = excCommands->GetDroppedCommandCount();
+    mtrServer.arrSessions.reserve(hshSessions.size());
+    for (QHash<int, TCPServerSocket *>::const_iterator itSession = hshSessions.constBegin(); itSession != hshSessions.constEnd(); ++itSession) {
+        TCPServerSessionMetrics mtrSession;
+        itSession.value()->GetMetrics(mtrSession);
+        mtrServer.iFramesReceived += mtrSession.iFramesReceived;
+        mtrServer.iBytesReceived += mtrSession.iBytesReceived;
+        mtrServer.iCommandsExecuted += mtrSession.iCommandsExecuted;
+        mtrServer.iCommandsRejected += mtrSession.iCommandsRejected;
+        mtrServer.iFramesSent += mtrSession.iFramesSent;
+        mtrServer.iBytesSent += mtrSession.iBytesSent;
+        mtrServer.iOutputFramesDropped += mtrSession.iOutputFramesDropped;
+        mtrServer.arrSessions.append(mtrSession);
+    }
+    return mtrServer;
+}
+
+void TCPServer::WriteMetrics(NetworkingMetricsWriter & wrtMetrics) const {
+    TCPServerMetrics mtrServer = TCPServer::GetMetricsSnapshot();
+    wrtMetrics.WriteValue("net_server_clients_connected", mtrServer.iConnectedClientCount);
+    wrtMetrics.WriteValue("net_server_sessions_accepted_total", mtrServer.iSessionsAccepted);
+    wrtMetrics.WriteValue("net_server_sessions_closed_total", mtrServer.iSessionsClosed);
+    wrtMetrics.WriteValue("net_server_frames_received_total", mtrServer.iFramesReceived);
+    wrtMetrics.WriteValue("net_server_bytes_received_total", mtrServer.iBytesReceived);
+    wrtMetrics.WriteValue("net_server_commands_executed_total", mtrServer.iCommandsExecuted);
+    wrtMetrics.WriteValue("net_server_frames_sent_total", mtrServer.iFramesSent);
+    wrtMetrics.WriteValue("net_server_bytes_sent_total", mtrServer.iBytesSent);
+    wrtMetrics.WriteValue("net_server_dead_clients_total", mtrServer.iDeadClientCount);
+    wrtMetrics.WriteValue("net_server_output_frames_dropped_total", mtrServer.iOutputFramesDropped);
+    wrtMetrics.WriteValue("net_server_slow_clients_total", mtrServer.iSlowClientCount);
+    wrtMetrics.WriteValue("net_server_commands_rejected_total", mtrServer.iCommandsRejected);
+    excCommands->WriteMetrics(wrtMetrics);
+
+    //Sessions are kept alive while their histograms are written, a session closed since the snapshot is written without histogram
+    QReadLocker lckSessionRegistry(&rwlSessionRegistry);
+    for (int i = 0; i < mtrServer.arrSessions.size(); ++i) {
+        const TCPServerSessionMetrics & mtrSession = mtrServer.arrSessions.at(i);
+        wrtMetrics.SetLabels(QString("client=\"%1\",address=\"%2:%3\"").arg(mtrSession.iClientID).arg(mtrSession.sClientIPAddress).arg(mtrSession.iClientPort));
+        wrtMetrics.WriteValue("net_server_client_frames_received_total", mtrSession.iFramesReceived);
+        wrtMetrics.WriteValue("net_server_client_bytes_received_total", mtrSession.iBytesReceived);
+        wrtMetrics.WriteValue("net_server_client_commands_executed_total", mtrSession.iCommandsExecuted);
+        wrtMetrics.WriteValue("net_server_client_commands_rejected_total", mtrSession.iCommandsRejected);
+        wrtMetrics.WriteValue("net_server_client_frames_sent_total", mtrSession.iFramesSent);
+        wrtMetrics.WriteValue("net_server_client_bytes_sent_total", mtrSession.iBytesSent);
+        wrtMetrics.WriteValue("net_server_client_rtt_us_last", mtrSession.iRoundTripTimeLast);
+        TCPServerSocket * tcpSocket = hshSessions.value(mtrSession.iClientID, NULL);
+        if (tcpSocket) {
+            wrtMetrics.WriteHistogram("net_server_client_rtt_us", tcpSocket->GetHeartbeatMonitor().GetRoundTripTimes());
+        }
+        wrtMetrics.WriteValue("net_server_client_pongs_missed_total", mtrSession.iPongsMissed);
+        wrtMetrics.WriteValue("net_server_client_output_queue_frames", mtrSession.iOutputQueueFrames);
+        wrtMetrics.WriteValue("net_server_client_output_queue_bytes", mtrSession.iOutputQueueBytes);
+        wrtMetrics.WriteValue("net_server_client_output_queue_bytes_high_water", mtrSession.iOutputQueueBytesHighWater);
+        wrtMetrics.WriteValue("net_server_client_output_frames_dropped_total", mtrSession.iOutputFramesDropped);
+    }
+    wrtMetrics.SetLabels(QString());
+    return;
+}
+
+/* Options */
+void TCPServer::SetBinaryFramingEnabled(bool bIsBinaryFramingEnabledNew) {
+    bIsBinaryFramingEnabled = bIsBinaryFramingEnabledNew;
+    TCPServer::SaveSettings();
+    return;
+}
+
+bool TCPServer::GetIsBinaryFramingEnabled() const {
+    return bIsBinaryFramingEnabled;
+}
+
+void TCPServer::SetCompressionEnabled(bool bIsCompressionEnabledNew) {
+    bIsCompressionEnabled = bIsCompressionEnabledNew;
+    TCPServer::SaveSettings();
+    return;
+}
+
+bool TCPServer::GetIsCompressionEnabled() const {
+    return bIsCompressionEnabled;
+}
+
+void TCPServer::SetCompressionOptions(int iCompressionThresholdNew, int iCompressionLevelNew) {
+    iCompressionThreshold = qMax(iCompressionThresholdNew, 0);
+    iCompressionLevel = qBound(1, iCompressionLevelNew, 9);
+    TCPServer::SaveSettings();
+    return;
+}
+
+int TCPServer::GetCompressionThreshold() const {
+    return iCompressionThreshold;
+}
+
+int TCPServer::GetCompressionLevel() const {
+    return iCompressionLevel;
+}
+
+void TCPServer::SetHeartbeatOptions(unsigned int iHeartbeatIntervalNew, int iHeartbeatMaxMissedNew) {
+    iHeartbeatInterval = iHeartbeatIntervalNew;
+    iHeartbeatMaxMissed = qMax(iHeartbeatMaxMissedNew, 1);
+    TCPServer::SaveSettings();
+    return;
+}
+
+unsigned int TCPServer::GetHeartbeatInterval() const {
+    return iHeartbeatInterval;
+}
+
+int TCPServer::GetHeartbeatMaxMissed() const {
+    return iHeartbeatMaxMissed;
+}
+
+void TCPServer::SetOutputQueueOptions(int iOutputQueueMaxBytesNew, TCPServerSocket::SlowClientPolicy iSlowClientPolicyNew) {
+    iOutputQueueMaxBytes = qMax(iOutputQueueMaxBytesNew, 0);
+    iSlowClientPolicy = iSlowClientPolicyNew;
+    if (engEpoll) {
+        engEpoll->SetOutputQueueOptions(iOutputQueueMaxBytes, iSlowClientPolicy); //Connections of the engine share the options
+    }
+    TCPServer::SaveSettings();
+    return;
+}
+
+int TCPServer::GetOutputQueueMaxBytes() const {
+    return iOutputQueueMaxBytes;
+}
+
+TCPServerSocket::SlowClientPolicy TCPServer::GetSlowClientPolicy() const {
+    return iSlowClientPolicy;
+}
+
+void TCPServer::SetCommandExecutionOptions(int iCommandThreadCountNew, int iCommandClientQueueLimitNew, int iCommandQueueLimitNew) {
+    iCommandThreadCount = qMax(iCommandThreadCountNew, 0);
+    iCommandClientQueueLimit = qMax(iCommandClientQueueLimitNew, 1);
+    iCommandQueueLimit = qMax(iCommandQueueLimitNew, 1);
+    excCommands->SetOptions(iCommandThreadCount, iCommandClientQueueLimit, iCommandQueueLimit);
+    TCPServer::SaveSettings();
+    return;
+}
+
+int TCPServer::GetCommandThreadCount() const {
+    return iCommandThreadCount;
+}
+
+int TCPServer::GetCommandClientQueueLimit() const {
+    return iCommandClientQueueLimit;
+}
+
+int TCPServer::GetCommandQueueLimit() const {
+    return iCommandQueueLimit;
+}
+
+void TCPServer::SetWorkerThreadCount(int iWorkerThreadCountNew) {
+    iWorkerThreadCount = iWorkerThreadCountNew;
+    TCPServer::SaveSettings();
+    return;
+}
+
+int TCPServer::GetWorkerThreadCount() const {
+    return iWorkerThreadCount;
+}
+
+void TCPServer::SetConnectionDistributionPolicy(ConnectionDistributionPolicy iConnectionDistributionPolicyNew) {
+    QWriteLocker lckSessionRegistry(&rwlSessionRegistry);
+    iConnectionDistributionPolicy = iConnectionDistributionPolicyNew;
+    lckSessionRegistry.unlock();
+    TCPServer::SaveSettings();
+    return;
+}
+
+TCPServer::ConnectionDistributionPolicy TCPServer::GetConnectionDistributionPolicy() const {
+    return iConnectionDistributionPolicy;
+}
+
+QVector<int> TCPServer::GetWorkerThreadLoads() const {
+    if (engEpoll) {
+        return engEpoll->GetIOThreadLoads();
+    }
+    QReadLocker lckSessionRegistry(&rwlSessionRegistry);
+    return arrWorkerThreadLoads;
+}
+
+void TCPServer::SetServerBackend(ServerBackend iServerBackendNew) {
+    iServerBackend = iServerBackendNew;
+    TCPServer::SaveSettings();
+    return;
+}
+
+TCPServer::ServerBackend TCPServer::GetServerBackend() const {
+    return iServerBackend;
+}
+
+void TCPServer::SetLocalEndpoint(const QString & sLocalEndpointNew) {
+    sLocalEndpoint = sLocalEndpointNew.trimmed();
+    TCPServer::SaveSettings();
+    return;
+}
+
+const QString & TCPServer::GetLocalEndpoint() const {
+    return sLocalEndpoint;
+}
+
+bool TCPServer::IsLocalEndpointListening() const {
+    return lsnLocal->IsListening();
+}
+
+/* Connection Distribution Policy Names */
+QString TCPServer::GetConnectionDistributionPolicyName(ConnectionDistributionPolicy iConnectionDistributionPolicy) {
+    switch (iConnectionDistributionPolicy) {
+    case LeastLoaded:
+        return "LeastLoaded";
+    case RoundRobin:
+    default:
+        return "RoundRobin";
+    }
+}
+
+TCPServer::ConnectionDistributionPolicy TCPServer::GetConnectionDistributionPolicyByName(const QString & sConnectionDistributionPolicyName) {
+    if (sConnectionDistributionPolicyName.compare("LeastLoaded", Qt::CaseInsensitive) == 0) {
+        return LeastLoaded;
+    }
+    return RoundRobin;
+}
+
+/* Server Backend Names */
+QString TCPServer::GetServerBackendName(ServerBackend iServerBackend) {
+    switch (iServerBackend) {
+    case EpollBackend:
+        return "Epoll";
+    case QtBackend:
+    default:
+        return "Qt";
+    }
+}
+
+TCPServer::ServerBackend TCPServer::GetServerBackendByName(const QString & sServerBackendName) {
+    if (sServerBackendName.compare("Epoll", Qt::CaseInsensitive) == 0) {
+        return EpollBackend;
+    }
+    return QtBackend;
+}
+
+/* Worker Threads */
+void TCPServer::StartWorkerThreads() {
+    int iWorkerThreadCountActual = iWorkerThreadCount;
+    if (iWorkerThreadCountActual < 1) {
+        iWorkerThreadCountActual = qMax(QThread::idealThreadCount(), 1);
+    }
+
+    //In Epoll backend, the engine's IO threads serve all sessions
+    if (iServerBackend == EpollBackend) {
+        engEpoll = new EpollServerEngine(this, excCommands, iWorkerThreadCountActual);
+        if (engEpoll->IsValid()) {
+            engEpoll->SetOutputQueueOptions(iOutputQueueMaxBytes, iSlowClientPolicy);
+            return;
+        }
+
+        //Out of descriptors, or a kernel without epoll_create1/eventfd: serve sessions with Qt backend instead, the option is kept as it is
+        qDebug() << "TCPServer: Epoll backend is not available, falling back to Qt backend.";
+        delete engEpoll;
+        engEpoll = NULL;
+    }
+    for (int i = 0; i < iWorkerThreadCountActual; ++i) {
+        QThread * trdWorkerThread = new QThread;
+        trdWorkerThread->start();
+        trdWorkerThreads.append(trdWorkerThread);
+        arrWorkerThreadLoads.append(0);
+    }
+    qDebug() << "TCPServer: Started" << iWorkerThreadCountActual << "worker thread(s)";
+    return;
+}
+
+void TCPServer::StopWorkerThreads() {
+    //The engine closes its connections itself, without session events
+    if (engEpoll) {
+        QWriteLocker lckSessionRegistry(&rwlSessionRegistry);
+        EpollServerEngine * engEpollDeleted = engEpoll;
+        engEpoll = NULL;
+        lckSessionRegistry.unlock();
+        delete engEpollDeleted;
+        return;
+    }
+
+    //Take over all socket objects, sessions closed meanwhile are not found in the registry and their sockets are not deleted twice
+    QWriteLocker lckSessionRegistry(&rwlSessionRegistry);
+    QList<TCPServerSocket *> lstSockets = hshSessions.values();
+    hshSessions.clear();
+    hshSessionIDsByEndpoint.clear();
+    lckSessionRegistry.unlock();
+
+    //Abort all connected clients, and wait until every worker thread has done it
+    //A socket served by the calling thread is aborted directly, a blocking queued call to the calling thread would never return
+    for (int i = 0; i < lstSockets.size(); ++i) {
+        TCPServerSocket * tcpSocket = lstSockets.at(i);
+        if (tcpSocket->thread() == QThread::currentThread()) {
+            tcpSocket->CloseAllConnectionsRequestedEventHandler();
+        }
+        else {
+            QMetaObject::invokeMethod(tcpSocket, "CloseAllConnectionsRequestedEventHandler", Qt::BlockingQueuedConnection);
+        }
+    }
+    emit CloseAllConnectionsRequestedEvent();
+
+    //Quit worker threads, socket objects deleted by closed sessions are deleted when their threads finish
+    //Threads are never terminated, a thread killed while holding a lock would leave it locked forever
+    for (int i = 0; i < trdWorkerThreads.size(); ++i) {
+        trdWorkerThreads[i]->quit();
+        trdWorkerThreads[i]->wait();
+    }
+
+    //Delete remaining socket objects, their threads are not running anymore
+    qDeleteAll(lstSockets);
+
+    //Delete worker threads
+    qDeleteAll(trdWorkerThreads);
+    trdWorkerThreads.clear();
+    arrWorkerThreadLoads.clear();
+    return;
+}
+
+int TCPServer::SelectWorkerThread() {
+    int iWorkerThreadIndex = 0;
+    if (iConnectionDistributionPolicy == LeastLoaded) {
+        for (int i = 1; i < arrWorkerThreadLoads.size(); ++i) {
+            if (arrWorkerThreadLoads[i] < arrWorkerThreadLoads[iWorkerThreadIndex]) {
+                iWorkerThreadIndex = i;
+            }
+        }
+    }
+    else {
+        iWorkerThreadIndex = iNextWorkerThread;
+        iNextWorkerThread = (iNextWorkerThread + 1) % trdWorkerThreads.size();
+    }
+    return iWorkerThreadIndex;
 }
 
 /* Command Incoming Event Handler Slot */
-void TCPServer::SocketCommandReceivedFromClientEventHandler(QString sCommand, QString sClientName, QString sClientIPAddress, quint16 iClientPort) {
-    qDebug() << "TCPServer: Command" << sCommand << "received from the remote";
-    emit CommandReceivedEvent(sCommand, sClientName, sClientIPAddress, iClientPort);
+//Slots below run in the thread owns this object, which is the only thread modifying the registry, thus the registry is read without locking
+void TCPServer::SocketCommandsReceivedFromClientEventHandler(int iClientID, QList<QByteArray> lstCommands) {
+    TCPServerSocket * tcpSocket = hshSessions.value(iClientID, NULL);
+    if (!tcpSocket) {
+        return;
+    }
+    TCPServer::EmitCommandEvents(iClientID, lstCommands, tcpSocket->GetClientName(), tcpSocket->GetClientIPAddress(), tcpSocket->GetClientPort());
+    return;
+}
+
+void TCPServer::EmitCommandEvents(int iClientID, const QList<QByteArray> & lstCommands, const QString & sClientName, const QString & sClientIPAddress, quint16 iClientPort) {
+    //Inform upper layers of each command, the QString signal is only decoded if someone is listening to it
+    bool bIsStringCommandRequired = (receivers(SIGNAL(CommandReceivedEvent(QString, QString, QString, quint16))) > 0);
+    for (int i = 0; i < lstCommands.size(); ++i) {
+        const QByteArray & baCommand = lstCommands.at(i);
+        qDebug() << "TCPServer: Command" << baCommand << "received from the remote client" << iClientID;
+        emit CommandDataReceivedEvent(iClientID, baCommand);
+        if (bIsStringCommandRequired) {
+            emit CommandReceivedEvent(QString::fromUtf8(baCommand.constData(), baCommand.size()), sClientName, sClientIPAddress, iClientPort);
+        }
+    }
+    return;
+}
+
+/* Session Registry */
+void TCPServer::SocketDisconnectedFromClientEventHandler(int iClientID) {
+    TCPServer::CloseSession(iClientID);
+    return;
+}
+
+void TCPServer::SocketErrorOccurredEventHandler(QAbstractSocket::SocketError errErrorInfo, int iClientID) {
+    TCPServerSocket * tcpSocket = hshSessions.value(iClientID, NULL);
+    if (tcpSocket) {
+        emit ClientNetworkingErrorOccurredEvent(errErrorInfo, tcpSocket->GetClientName(), tcpSocket->GetClientIPAddress(), tcpSocket->GetClientPort());
+    }
+    TCPServer::CloseSession(iClientID); //Socket object is deleted after an error
+    return;
+}
+
+/* Epoll Backend Event Handler Slots */
+//Events of a session are queued in order by its IO thread, and carry the client's information as the session may be closed already
+void TCPServer::EpollSessionOpenedEventHandler(int iClientID, QString sClientIPAddress, quint16 iClientPort) {
+    emit ClientConnectedEvent(QString(), sClientIPAddress, iClientPort);
+    emit ClientSessionOpenedEvent(iClientID);
+    return;
+}
+
+void TCPServer::EpollSessionClosedEventHandler(int iClientID, QAbstractSocket::SocketError errErrorInfo, QString sClientIPAddress, quint16 iClientPort) {
+    if (errErrorInfo != QAbstractSocket::UnknownSocketError) {
+        emit ClientNetworkingErrorOccurredEvent(errErrorInfo, QString(), sClientIPAddress, iClientPort);
+    }
+    emit ClientDisconnectedEvent(QString(), sClientIPAddress, iClientPort);
+    emit ClientSessionClosedEvent(iClientID);
+    return;
+}
+
+void TCPServer::EpollCommandsReceivedEventHandler(int iClientID, QList<QByteArray> lstCommands, QString sClientIPAddress, quint16 iClientPort) {
+    TCPServer::EmitCommandEvents(iClientID, lstCommands, QString(), sClientIPAddress, iClientPort);
+    return;
+}
+
+/* Local Endpoint Event Handler Slot */
+void TCPServer::LocalConnectionEventHandler(int iSocketID) {
+    TCPServer::OpenSession(iSocketID, lsnLocal->GetEndpoint());
     return;
 }
 
 /* Incoming Connection Management */
 void TCPServer::incomingConnection(int iSocketID) {
-    //Create a new socket object
-    TCPServerSocket * tcpSocket = new TCPServerSocket;
-    tcpSocket->setSocketDescriptor(iSocketID);
-    tcpSocket->setSocketOption(QAbstractSocket::LowDelayOption, 1); //Set for low delay, avoid packet sticking
+    TCPServer::OpenSession(iSocketID, QString());
+    return;
+}
 
-    //Connect events and handlers
-    connect(tcpSocket, SIGNAL(SocketConnectedToClientEvent(QString, QString, quint16)), this, SIGNAL(ClientConnectedEvent(QString, QString, quint16)));
-    connect(tcpSocket, SIGNAL(SocketDisconnectedFromClientEvent(QString, QString, quint16)), this, SIGNAL(ClientDisconnectedEvent(QString, QString, quint16)));
-    connect(tcpSocket, SIGNAL(SocketErrorOccurredEvent(QAbstractSocket::SocketError, QString, QString, quint16)), this, SIGNAL(ClientNetworkingErrorOccurredEvent(QAbstractSocket::SocketError, QString, QString, quint16)));
-    connect(tcpSocket, SIGNAL(SocketCommandReceivedFromClientEvent(QString, QString, QString, quint16)), this, SLOT(SocketCommandReceivedFromClientEventHandler(QString, QString, QString, quint16)));
-    connect(this, SIGNAL(SendDataToClientRequestedEvent(QString, QString, QString, quint16)), tcpSocket, SLOT(SendDataToClientRequestedEventHandler(QString, QString, QString, quint16)));
-    connect(this, SIGNAL(CloseAllConnectionsRequestedEvent()), tcpSocket, SLOT(CloseAllConnectionsRequestedEventHandler()));
+void TCPServer::OpenSession(int iSocketID, const QString & sLocalEndpointAccepted) {
+    //Create a new socket object with a unique ID
+    TCPServerSocket * tcpSocket = new TCPServerSocket(++iLastClientID, bIsBinaryFramingEnabled);
+    tcpSocket->SetCompressionOptions(bIsCompressionEnabled, iCompressionThreshold, iCompressionLevel);
+    tcpSocket->SetHeartbeatOptions(iHeartbeatInterval, iHeartbeatMaxMissed);
+    tcpSocket->SetOutputQueueOptions(iOutputQueueMaxBytes, iSlowClientPolicy);
+    tcpSocket->SetCommandExecutor(excCommands);
+    if (!tcpSocket->OpenSession(iSocketID, sLocalEndpointAccepted)) {
+        delete tcpSocket;
+        if (!sLocalEndpointAccepted.isEmpty()) {
+            ::close(iSocketID);
+        }
+        return;
+    }
+
+    //Connect events and handlers, signals from worker threads are queued to this thread
+    connect(tcpSocket, SIGNAL(SocketDisconnectedFromClientEvent(int)), this, SLOT(SocketDisconnectedFromClientEventHandler(int)));
+    connect(tcpSocket, SIGNAL(SocketErrorOccurredEvent(QAbstractSocket::SocketError, int)), this, SLOT(SocketErrorOccurredEventHandler(QAbstractSocket::SocketError, int)));
+    connect(tcpSocket, SIGNAL(SocketCommandsReceivedFromClientEvent(int, QList<QByteArray>)), this, SLOT(SocketCommandsReceivedFromClientEventHandler(int, QList<QByteArray>)));
+
+    //Hand the socket object (and all it's child objects) out to a worker thread, and register the session
+    QWriteLocker lckSessionRegistry(&rwlSessionRegistry);
+    int iWorkerThreadIndex = TCPServer::SelectWorkerThread();
+    tcpSocket->moveToThread(trdWorkerThreads[iWorkerThreadIndex]);
+    ++arrWorkerThreadLoads[iWorkerThreadIndex];
+    hshSessions.insert(tcpSocket->GetClientID(), tcpSocket);
+    if (sLocalEndpointAccepted.isEmpty()) {
+        hshSessionIDsByEndpoint.insert(qMakePair(tcpSocket->GetClientIPAddress(), tcpSocket->GetClientPort()), tcpSocket->GetClientID());
+    }
+    cntSessionsAccepted.Add();
+    lckSessionRegistry.unlock();
 
     //Inform upper layer(s) of a newly connected client
-    emit ClientConnectedEvent(tcpSocket->peerName(), tcpSocket->peerAddress().toString(), tcpSocket->peerPort());
+    emit ClientConnectedEvent(tcpSocket->GetClientName(), tcpSocket->GetClientIPAddress(), tcpSocket->GetClientPort());
+    emit ClientSessionOpenedEvent(tcpSocket->GetClientID());
 
     return;
 }
@@ -3,7 +3,22 @@
  *
  * This file is the interface of networking interface (server side).
  * Working as a TCP server, receive commands (mostly line-based string commands) from the remote and then parse & execute them.
+ * Commands are executed by handlers registered in the server's command table, on the server's command thread pool, see NetworkingControlInterface.Commands.h.
  * NOTE: This interface should only be used to receive commands from remote controller. If you want to implement an interface that receives wave data from the remote device, please consider implementing a new DeviceControlInterface.
+ * Every session has its own bounded output queue. Messages are written to the socket while the client keeps up, and queued once the socket's
+ * write buffer is full. Responses which do not fit in the queue's byte budget are handled by the slow client policy, so that a client which
+ * reads slowly never costs other clients latency or memory:
+ *   DropOldest: Oldest queued responses are dropped until the new one fits.
+ *   Coalesce: All queued responses are dropped, only the newest one is kept (e.g. for broadcasts of latest states).
+ *   Disconnect: The session is closed with a SocketResourceError.
+ * With DropOldest and Coalesce, a response which still does not fit (larger than the budget itself) is dropped, the budget is never exceeded.
+ * Framing replies and heartbeats are queued in order too, but are never dropped.
+ * A broadcast is framed (and compressed) once for each encoding used by its receivers, and the encoded buffers are shared by every receiver's
+ * output queue, so that its cost per client does not depend on the message.
+ * Sessions are served by QTcpSocket objects on worker threads (Qt backend), or by the epoll server engine on Linux (Epoll backend), which is
+ * chosen with ServerBackend in ini file, see NetworkingControlInterface.Epoll.h. If the epoll engine cannot be created, Qt backend is used.
+ * Besides the TCP port, the Qt backend also listens on a Unix domain socket if ServerLocalSocket is set in ini file, for processes on the
+ * same board, see NetworkingControlInterface.Local.h. Local sessions are served like TCP ones.
  *
  * This file is a part of DataSourceProvider, but was separated for easier maintainance.
  * For DataFrames' definitions and stream operators, please refer to DataSourceProvider.
@@ -12,58 +27,247 @@
 #ifndef NETWORKINGCONTROLINTERFACE_SERVER_H
 #define NETWORKINGCONTROLINTERFACE_SERVER_H
 
-#include <QApplication>
+#include "NetworkingControlInterface.Commands.h"
+#include "NetworkingControlInterface.Framing.h"
+#include "NetworkingControlInterface.Heartbeat.h"
+#include "NetworkingControlInterface.Local.h"
+#include "NetworkingControlInterface.Metrics.h"
+#include <QCoreApplication>
+#include <QHash>
 #include <QHostAddress>
+#include <QList>
 #include <QMap>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QPair>
 #include <QQueue>
 #include <QReadWriteLock>
+#include <QReadLocker>
 #include <QString>
 #include <QTcpServer>
 #include <QTcpSocket>
 #include <QThread>
 #include <QTimer>
 #include <QVector>
+#include <QWriteLocker>
+
+/* Epoll Backend */
+class EpollServerEngine;
+
+/* Output Queue */
+#define NET_SERVER_SOCKET_WRITE_BUFFER_BYTES 65536 //Bytes handed to a socket's write buffer at most, messages beyond this wait in the output queue where they can be dropped
+
+/* Metrics Snapshots */
+//Counters wrap around at 2^32, see NetworkingControlInterface.Metrics.h
+struct TCPServerSessionMetrics {
+    int iClientID;
+    QString sClientIPAddress;
+    quint16 iClientPort;
+    quint32 iFramesReceived; //Commands received
+    quint32 iBytesReceived; //Bytes read from the socket
+    quint32 iCommandsExecuted; //Commands handed to registered handlers, not passed to upper layers
+    quint32 iCommandsRejected; //Commands answered with NET_COMMAND_REPLY_BUSY
+    quint32 iFramesSent; //Responses sent
+    quint32 iBytesSent; //Bytes written to the socket, after framing and compression
+    quint32 iRoundTripTimeCount; //Heartbeats answered, only clients which ping the server are pinged
+    quint32 iRoundTripTimeLast; //Heartbeat round-trip times, in microseconds
+    quint32 iRoundTripTimeMax;
+    QVector<quint32> arrRoundTripTimeBuckets; //Heartbeat round-trip time histogram, not cumulative, see NetworkingLatencyHistogram
+    quint32 iPongsMissed; //Heartbeats never answered
+    int iOutputQueueFrames; //Gauge, messages waiting in the output queue
+    int iOutputQueueBytes; //Gauge, bytes waiting in the output queue, not counting the socket's write buffer
+    quint32 iOutputQueueBytesHighWater; //Max bytes waiting in the output queue
+    quint32 iOutputFramesDropped; //Responses dropped by the slow client policy
+    quint32 iSlowClientDisconnects; //1 if the session is being closed by the slow client policy
+};
+
+struct TCPServerMetrics {
+    int iConnectedClientCount; //Gauge
+    quint32 iSessionsAccepted;
+    quint32 iSessionsClosed;
+    quint32 iFramesReceived; //Sums of all sessions, closed ones included
+    quint32 iBytesReceived;
+    quint32 iCommandsExecuted;
+    quint32 iCommandsRejected;
+    quint32 iFramesSent;
+    quint32 iBytesSent;
+    int iCommandsQueued; //Gauge, commands waiting for a command thread
+    quint32 iCommandsDropped; //Commands waiting when their client was closed or their handler was unregistered
+    quint32 iDeadClientCount; //Sessions closed because the client stopped answering heartbeats
+    quint32 iOutputFramesDropped; //Responses dropped by the slow client policy
+    quint32 iSlowClientCount; //Sessions closed by the slow client policy
+    QVector<TCPServerSessionMetrics> arrSessions; //Connected clients
+};
+
+/* Encoded Broadcast */
+//A response encoded once for each encoding its receivers use, QByteArray's implicit sharing lets all sessions queue the same buffers without copying
+//Sessions may have negotiated different compression options (they are taken when the session is opened), compressed encodings are told apart by them
+struct TCPServerEncodedMessage {
+    /* Encodings */
+    enum Encoding {
+        Text = 0, //Line terminated by "\n"
+        Binary = 1, //Binary frame
+        Compressed = 2, //Compressed batch of one binary frame, or the binary frame itself if it is below the threshold or does not shrink
+        EncodingCount = 3
+    };
+    static quint64 GetEncodingKey(Encoding iEncoding, int iCompressionThreshold, int iCompressionLevel); //Compression options are only part of the key of Compressed
+
+    QByteArray baData; //Message as given, encoded by the session itself if its encoding was not prepared
+    QHash<quint64, QByteArray> hshEncodedData; //Encoded messages, indexed by encoding key
+};
+Q_DECLARE_METATYPE(TCPServerEncodedMessage)
 
 /* TCP Server Socket Object */
 //This object maintains a connection from a local TCP server to a remote TCP client
+//It is moved to one of the TCP Server Object's worker threads after the session is opened, and deleted by the TCP Server Object when the session is closed
 class TCPServerSocket : public QTcpSocket {
     Q_OBJECT
 
 public:
-    TCPServerSocket();
+    /* Slow Client Policies */
+    enum SlowClientPolicy {
+        DropOldest = 0,
+        Coalesce = 1,
+        Disconnect = 2
+    };
+
+    TCPServerSocket(int iClientIDInit, bool bIsBinaryFramingAllowedInit = false);
     ~TCPServerSocket();
 
+    /* Session Information */
+    //Peer information is saved when the session is opened, it is still available after the connection is closed
+    bool OpenSession(int iSocketID, const QString & sLocalEndpoint = QString()); //Take over an accepted socket descriptor, returns false on failure. Sockets accepted on a local endpoint report the endpoint as IP address and 0 as port
+    int GetClientID() const;
+    const QString & GetClientName() const;
+    const QString & GetClientIPAddress() const;
+    quint16 GetClientPort() const;
+
+    /* Compression */
+    void SetCompressionOptions(bool bIsCompressionAllowedNew, int iCompressionThresholdNew, int iCompressionLevelNew); //Must be called before the socket object is moved to a worker thread
+
+    /* Heartbeat */
+    void SetHeartbeatOptions(unsigned int iHeartbeatIntervalNew, int iHeartbeatMaxMissedNew); //Must be called before the socket object is moved to a worker thread
+
+    /* Commands */
+    void SetCommandExecutor(NetworkingCommandExecutor * excCommandsNew); //Must be called before the socket object is moved to a worker thread, the executor must outlive the socket object
+
+    /* Output Queue */
+    void SetOutputQueueOptions(int iOutputQueueMaxBytesNew, SlowClientPolicy iSlowClientPolicyNew); //Must be called before the socket object is moved to a worker thread
+    static QString GetSlowClientPolicyName(SlowClientPolicy iSlowClientPolicy); //Name used in ini file
+    static SlowClientPolicy GetSlowClientPolicyByName(const QString & sSlowClientPolicyName); //Returns DropOldest for unknown names
+
+    /* Encoding */
+    TCPServerEncodedMessage::Encoding GetOutputEncoding() const; //Thread-safe, changes when framing is negotiated
+    quint64 GetOutputEncodingKey() const; //Thread-safe, encoding and compression options of this session
+    static QByteArray EncodeMessage(const QByteArray & baData, TCPServerEncodedMessage::Encoding iEncoding, int iCompressionThreshold, int iCompressionLevel); //Frame a response for an encoding
+    static QByteArray EncodeMessage(const QByteArray & baData, quint64 iEncodingKey); //Frame a response for an encoding key
+
+    /* Metrics */
+    void GetMetrics(TCPServerSessionMetrics & mtrSession) const; //Thread-safe
+    const HeartbeatMonitor & GetHeartbeatMonitor() const; //Only histogram and counters may be read from other threads
+
 public slots:
     /* Text-Based Communication */
-    void SendDataToClientRequestedEventHandler(QString sDataToSend, QString sClientName, QString sClientIPAddress, quint16 iClientPort); //Send data to client
+    void SendDataToClientRequestedEventHandler(QByteArray baDataToSend); //Send data to client
+    void SendEncodedDataToClientRequestedEventHandler(TCPServerEncodedMessage msgEncoded); //Send a broadcast encoded by TCP Server Object
 
     /* Connection Management */
     void CloseAllConnectionsRequestedEventHandler();
 
 signals:
     /* Signals to Communicate with Upper Layer */
-    void SocketConnectedToClientEvent(QString sClientName, QString sClientIPAddress, quint16 iClientPort);
-    void SocketDisconnectedFromClientEvent(QString sClientName, QString sClientIPAddress, quint16 iClientPort);
-    void SocketErrorOccurredEvent(QAbstractSocket::SocketError errErrorInfo, QString sClientName, QString sClientIPAddress, quint16 iClientPort);
-    void SocketCommandReceivedFromClientEvent(QString sCommand, QString sClientName, QString sClientIPAddress, quint16 iClientPort); //Signal that informs the TCP Server Object a command received from the remote client
+    void SocketDisconnectedFromClientEvent(int iClientID);
+    void SocketErrorOccurredEvent(QAbstractSocket::SocketError errErrorInfo, int iClientID); //SocketTimeoutError if the client stopped answering heartbeats
+    void SocketCommandsReceivedFromClientEvent(int iClientID, QList<QByteArray> lstCommands); //Signal that informs the TCP Server Object all complete commands received from the remote client in one read
 
 private slots:
     /* Command Incoming Event Handler Slot */
     void CommandReceivedFromClientEventHandler(); //Process incoming commands
 
     /* TCP Socket Event Handler Slots */
-    void TCPServerSocket_Connected();
     void TCPServerSocket_Disconnected();
     void TCPServerSocket_Error(QAbstractSocket::SocketError errErrorInfo);
+    void TCPServerSocket_BytesWritten(qint64 iBytesWritten);
+
+    /* Heartbeat Timer Slot */
+    void HeartbeatTimerEventHandler();
+
+private:
+    /* Session Information */
+    int iClientID; //INTERNAL: Unique ID assigned by TCP Server Object
+    QString sClientName; //INTERNAL: Saved peerName()
+    QString sClientIPAddress; //INTERNAL: Saved peerAddress(), or the endpoint of a local session
+    quint16 iClientPort; //INTERNAL: Saved peerPort()
+
+    /* Framing */
+    bool bIsBinaryFramingAllowed; //INTERNAL: Marks if client's binary framing request should be accepted
+    NetworkingFramingMode iFramingMode; //INTERNAL: Framing mode of this connection
+    TextLineDecoder decLineDecoder; //INTERNAL: Reassembles client's command lines in text mode
+    BinaryFrameDecoder decCommandDecoder; //INTERNAL: Decodes client's commands in binary mode
+
+    /* Compression */
+    bool bIsCompressionAllowed; //INTERNAL: Marks if client's compression request should be accepted, binary framing must be allowed too
+    bool bIsCompressionEnabled; //INTERNAL: Marks if compression has been negotiated for this connection
+    int iCompressionThreshold; //INTERNAL: Frames smaller than this (in bytes) are sent uncompressed
+    int iCompressionLevel; //INTERNAL: zlib compression level
+    QAtomicInt iOutputEncoding; //INTERNAL: Encoding of responses, read by TCP Server Object to prepare broadcasts
+
+    /* Metrics */
+    //Written by the worker thread only, read by any thread
+    NetworkingCounter cntFramesReceived; //INTERNAL: Commands received
+    NetworkingCounter cntBytesReceived; //INTERNAL: Bytes read
+    NetworkingCounter cntCommandsExecuted; //INTERNAL: Commands handed to handlers
+    NetworkingCounter cntCommandsRejected; //INTERNAL: Commands over the execution queue limits
+    NetworkingCounter cntFramesSent; //INTERNAL: Responses sent
+    NetworkingCounter cntBytesSent; //INTERNAL: Bytes written
+
+    /* Commands */
+    NetworkingCommandExecutor * excCommands; //INTERNAL: Runs commands with a handler, owned by TCP Server Object
+
+    /* Heartbeat */
+    HeartbeatMonitor hbmHeartbeat; //INTERNAL: Pings in flight and round-trip times
+    QTimer * tmrHeartbeat; //INTERNAL: Sends pings, started when the client has pinged us
+
+    void HandleHeartbeat(HeartbeatMonitor::MessageKind iMessageKind, const QByteArray & baPayload); //INTERNAL: Answer a ping or record a pong
+
+    /* Output Queue */
+    //Used by the worker thread only, except metrics
+    int iOutputQueueMaxBytes; //INTERNAL: Byte budget of responses waiting in the output queue
+    SlowClientPolicy iSlowClientPolicy; //INTERNAL: What to do when a response does not fit in the budget
+    QQueue<QPair<QByteArray, bool> > queOutputMessages; //INTERNAL: Encoded messages waiting for the socket, in order, each marked if it is a response (which may be dropped)
+    int iOutputQueueBytesUsed; //INTERNAL: Bytes of messages in queOutputMessages
+    QAtomicInt iOutputQueueFramesMetric; //INTERNAL: Copies of the output queue's size for metrics
+    QAtomicInt iOutputQueueBytesMetric;
+    NetworkingCounter cntOutputQueueHighWater; //INTERNAL: Max bytes waiting in the output queue
+    NetworkingCounter cntOutputFramesDropped; //INTERNAL: Responses dropped by the slow client policy
+    NetworkingCounter cntSlowClientDisconnects; //INTERNAL: Set when the session is closed by the slow client policy
+
+    bool IsOutputWritable() const; //INTERNAL: Returns true if a message can be written to the socket without queuing
+    void WriteOutput(const QByteArray & baMessage, bool bIsResponse); //INTERNAL: Write a message to the socket, or queue it according to the slow client policy
+    void FlushOutputQueue(); //INTERNAL: Hand queued messages to the socket while its write buffer has room
+    void DropQueuedResponses(int iBytesToFree); //INTERNAL: Drop oldest queued responses until at least iBytesToFree bytes are freed, control messages are kept
+    void UpdateOutputQueueMetrics(); //INTERNAL: Publish output queue's size
 };
 
 /* TCP Server Object */
-class TCPServer : public QTcpServer {
+//Sockets are served by a pool of worker threads, each runs its own event loop
+//Signals to upper layers are emitted from the thread owns this object, and all public functions are thread-safe
+class TCPServer : public QTcpServer, public NetworkingMetricsSource, private NetworkingCommandReplySink {
     Q_OBJECT
 
 public:
+    /* Connection Distribution Policies */
+    enum ConnectionDistributionPolicy {
+        RoundRobin = 0,
+        LeastLoaded = 1
+    };
+
+    /* Server Backends */
+    enum ServerBackend {
+        QtBackend = 0,
+        EpollBackend = 1
+    };
+
     TCPServer();
     TCPServer(quint16 iListeningPortInit); //Construct the object with a given listening port
     ~TCPServer();
@@ -75,34 +279,173 @@ public:
     /* Listening Status Management */
     bool StartListening(); //Start listening on saved port
     bool StartListening(quint16 iListeningPortNew); //Start listening on a given port
-    void StopListening(); //Stop listening
+    void StopListening(); //Stop listening, the local endpoint is closed too
 
     /* Text-Based Communication */
-    //SendDataToClientRequestedEvent will be broadcasted to ALL connected clients
+    //Data will be broadcasted to ALL connected clients
     //If you want to specify a specific to receive data, please specify sClientName and/or sClientIPAddress and/or iClientPort
-    void SendDataToClient(QString sDataToSend, QString sClientName="", QString sClientIPAddress = "", quint16 iClientPort = 0);
+    //If both sClientIPAddress and iClientPort are specified, the client is looked up directly instead of checking every client
+    //Clients connected to the local endpoint are matched by the endpoint as sClientIPAddress
+    void SendDataToClient(QString sDataToSend, QString sClientName="", QString sClientIPAddress = "", quint16 iClientPort = 0); //Text is sent using UTF-8
+    void SendDataToClient(const QByteArray & baDataToSend, QString sClientName="", QString sClientIPAddress = "", quint16 iClientPort = 0); //Bytes are shared by all sockets without copying
+    void SendDataToClient(const char * chrDataToSend, QString sClientName="", QString sClientIPAddress = "", quint16 iClientPort = 0); //String literals are sent as bytes
+    bool SendDataToClient(int iClientID, const QByteArray & baDataToSend); //Send data to the client with a given ID, returns false if the client is not connected
+
+    /* Session Registry */
+    //Every connection is assigned a unique ID when accepted, IDs are not reused while the server object exists
+    int GetConnectedClientCount() const;
+    QList<int> GetConnectedClientIDs() const;
+    int FindClientID(const QString & sClientIPAddress, quint16 iClientPort) const; //Returns 0 if no such client is connected
+    bool GetClientInformation(int iClientID, QString & sClientName, QString & sClientIPAddress, quint16 & iClientPort) const; //Returns false if the client is not connected
+    bool GetClientOutputQueueDepth(int iClientID, int & iQueuedFrames, int & iQueuedBytes) const; //Messages waiting for a slow client, returns false if the client is not connected
+
+    /* Command Handlers */
+    //Commands whose verb has a handler are executed on the command thread pool, in order for each client, replies are sent back to the same client
+    //Other commands are passed to upper layers with CommandReceivedEvent() and CommandDataReceivedEvent()
+    bool RegisterCommandHandler(const QByteArray & baVerb, NetworkingCommandHandler * hdlCommand); //Returns false if the verb already has a handler, the handler is not owned by the server object
+    void UnregisterCommandHandler(const QByteArray & baVerb); //Waits until running executions of the handler have finished
+    QList<QByteArray> GetCommandVerbs() const; //Verbs with a handler, built-in ones included
+
+    /* Metrics */
+    //Snapshots may be taken from any thread, clients may also scrape them with the stats command (NET_STATS_REQUEST)
+    TCPServerMetrics GetMetricsSnapshot() const;
+    void WriteMetrics(NetworkingMetricsWriter & wrtMetrics) const; //Reimplemented from NetworkingMetricsSource
+
+    /* Options */
+    void SetBinaryFramingEnabled(bool bIsBinaryFramingEnabledNew); //Set & Get if clients' binary framing requests are accepted, affects new connections only
+    bool GetIsBinaryFramingEnabled() const;
+    void SetCompressionEnabled(bool bIsCompressionEnabledNew); //Set & Get if clients' compression requests are accepted (binary framing must be enabled too), affects new connections only
+    bool GetIsCompressionEnabled() const;
+    void SetCompressionOptions(int iCompressionThresholdNew, int iCompressionLevelNew); //Set & Get smallest response (in bytes) which is compressed, and zlib level (1-9), affects new connections only
+    int GetCompressionThreshold() const;
+    int GetCompressionLevel() const;
+    void SetHeartbeatOptions(unsigned int iHeartbeatIntervalNew, int iHeartbeatMaxMissedNew); //Set & Get heartbeat ping interval (in ms, 0 to disable) and number of unanswered pings after which a client is declared dead and its session is closed, affects new connections only
+    unsigned int GetHeartbeatInterval() const;
+    int GetHeartbeatMaxMissed() const;
+    void SetOutputQueueOptions(int iOutputQueueMaxBytesNew, TCPServerSocket::SlowClientPolicy iSlowClientPolicyNew); //Set & Get byte budget of each client's output queue, and what to do with a client which reads slower than responses are sent, affects new connections only
+    int GetOutputQueueMaxBytes() const;
+    TCPServerSocket::SlowClientPolicy GetSlowClientPolicy() const;
+    void SetCommandExecutionOptions(int iCommandThreadCountNew, int iCommandClientQueueLimitNew, int iCommandQueueLimitNew); //Set & Get number of command threads (0 for one per CPU core), and commands waiting for execution per client and in total, takes effect immediately
+    int GetCommandThreadCount() const;
+    int GetCommandClientQueueLimit() const;
+    int GetCommandQueueLimit() const;
+    void SetWorkerThreadCount(int iWorkerThreadCountNew); //Set & Get number of worker threads, or IO threads in Epoll backend (0 for one per CPU core), takes effect when the server object is created next time
+    int GetWorkerThreadCount() const;
+    void SetConnectionDistributionPolicy(ConnectionDistributionPolicy iConnectionDistributionPolicyNew); //Set & Get how accepted connections are handed out to worker threads
+    ConnectionDistributionPolicy GetConnectionDistributionPolicy() const;
+    QVector<int> GetWorkerThreadLoads() const; //Number of clients served by each worker thread
+    void SetServerBackend(ServerBackend iServerBackendNew); //Set & Get how sessions are served, takes effect when the server object is created next time
+    ServerBackend GetServerBackend() const;
+    void SetLocalEndpoint(const QString & sLocalEndpointNew); //Set & Get Unix domain socket endpoint listened on besides the TCP port ("unix:/path" or "unix:@name", empty to disable), Qt backend only, takes effect when listening is started next time
+    const QString & GetLocalEndpoint() const;
+    bool IsLocalEndpointListening() const;
+
+    /* Connection Distribution Policy Names */
+    static QString GetConnectionDistributionPolicyName(ConnectionDistributionPolicy iConnectionDistributionPolicy); //Name used in ini file
+    static ConnectionDistributionPolicy GetConnectionDistributionPolicyByName(const QString & sConnectionDistributionPolicyName); //Returns RoundRobin for unknown names
+
+    /* Server Backend Names */
+    static QString GetServerBackendName(ServerBackend iServerBackend); //Name used in ini file
+    static ServerBackend GetServerBackendByName(const QString & sServerBackendName); //Returns QtBackend for unknown names
 
 signals:
     /* Signals to Communicate with Upper Layer */
     void ClientConnectedEvent(QString sClientName, QString sClientIPAddress, quint16 iClientPort); //Signal of a connected client
     void ClientDisconnectedEvent(QString sClientName, QString sClientIPAddress, quint16 iClientPort); //Signal of a disconnected client
     void ClientNetworkingErrorOccurredEvent(QAbstractSocket::SocketError errErrorInfo, QString sClientName, QString sClientIPAddress, quint16 iClientPort); //Signal of an error
-    void CommandReceivedEvent(QString sCommand, QString sClientName, QString sClientIPAddress, quint16 iClientPort); //Signal of a received command
+    void CommandReceivedEvent(QString sCommand, QString sClientName, QString sClientIPAddress, quint16 iClientPort); //Signal of a received command, only decoded when connected
+    void CommandDataReceivedEvent(int iClientID, QByteArray baCommand); //Signal of a received command, raw bytes
+    void ClientSessionOpenedEvent(int iClientID); //Signal of a connected client, use GetClientInformation() to query client's information
+    void ClientSessionClosedEvent(int iClientID); //Signal of a disconnected client, the ID is no longer valid
 
     /* Signals to Communicate with Client */
-    void SendDataToClientRequestedEvent(QString sDataToSend, QString sClientName, QString sClientIPAddress, quint16 iClientPort); //Signal of requesting sending data to client
-    void CloseAllConnectionsRequestedEvent(); //Signal of closing all connected clients' connections, emitted when server is closed
+    void CloseAllConnectionsRequestedEvent(); //Signal of closing all connected clients' connections, emitted when server is closed, after every socket has been aborted
 
 private slots:
     /* Command Incoming Event Handler Slot */
-    void SocketCommandReceivedFromClientEventHandler(QString sCommand, QString sClientName, QString sClientIPAddress, quint16 iClientPort); //Receive a command from a socket, and then post a new event to infrom upper layers
+    void SocketCommandsReceivedFromClientEventHandler(int iClientID, QList<QByteArray> lstCommands); //Receive commands from a socket, and then post new events to infrom upper layers
+
+    /* Session Registry */
+    void SocketDisconnectedFromClientEventHandler(int iClientID);
+    void SocketErrorOccurredEventHandler(QAbstractSocket::SocketError errErrorInfo, int iClientID);
+
+    /* Epoll Backend Event Handler Slots */
+    //Invoked by the epoll server engine from its IO threads, queued to this thread
+    void EpollSessionOpenedEventHandler(int iClientID, QString sClientIPAddress, quint16 iClientPort);
+    void EpollSessionClosedEventHandler(int iClientID, QAbstractSocket::SocketError errErrorInfo, QString sClientIPAddress, quint16 iClientPort); //UnknownSocketError if closed by the server
+    void EpollCommandsReceivedEventHandler(int iClientID, QList<QByteArray> lstCommands, QString sClientIPAddress, quint16 iClientPort);
+
+    /* Local Endpoint Event Handler Slot */
+    void LocalConnectionEventHandler(int iSocketID); //Accept a connection of the local endpoint
 
 private:
     /* Options Var */
     quint16 iListeningPort; //INTERNAL: Listening port
+    bool bIsBinaryFramingEnabled; //INTERNAL: Are binary framing requests accepted
+    bool bIsCompressionEnabled; //INTERNAL: Are compression requests accepted
+    int iCompressionThreshold; //INTERNAL: Smallest response which is compressed, in bytes
+    int iCompressionLevel; //INTERNAL: zlib compression level
+    unsigned int iHeartbeatInterval; //INTERNAL: Heartbeat ping interval in ms, 0 if disabled
+    int iHeartbeatMaxMissed; //INTERNAL: Unanswered pings before a client is declared dead
+    int iOutputQueueMaxBytes; //INTERNAL: Byte budget of each client's output queue
+    TCPServerSocket::SlowClientPolicy iSlowClientPolicy; //INTERNAL: What to do with a client whose output queue is full
+    int iCommandThreadCount; //INTERNAL: Number of command threads, 0 for one per CPU core
+    int iCommandClientQueueLimit; //INTERNAL: Commands waiting for execution per client
+    int iCommandQueueLimit; //INTERNAL: Commands waiting for execution in total
+    int iWorkerThreadCount; //INTERNAL: Number of worker threads, 0 for one per CPU core
+    ConnectionDistributionPolicy iConnectionDistributionPolicy; //INTERNAL: How accepted connections are handed out
+    ServerBackend iServerBackend; //INTERNAL: How sessions are served
+    QString sLocalEndpoint; //INTERNAL: Unix domain socket endpoint, empty if disabled
+
+    /* Worker Threads */
+    QVector<QThread *> trdWorkerThreads; //INTERNAL: Worker threads, created with the server object
+    QVector<int> arrWorkerThreadLoads; //INTERNAL: Number of clients served by each worker thread
+    int iNextWorkerThread; //INTERNAL: Next worker thread in round-robin mode
+
+    void StartWorkerThreads(); //INTERNAL: Create and start worker threads
+    void StopWorkerThreads(); //INTERNAL: Close all connections, then quit and delete worker threads
+    int SelectWorkerThread(); //INTERNAL: Choose a worker thread for a new connection according to the distribution policy
+
+    /* Epoll Backend */
+    EpollServerEngine * engEpoll; //INTERNAL: Serves all sessions instead of worker threads in Epoll backend, NULL in Qt backend
+
+    /* Local Endpoint */
+    LocalSocketListener * lsnLocal; //INTERNAL: Accepts connections of the local endpoint, child object
+
+    /* Session Registry */
+    //Modified only by the thread owns this object, read by any thread calling public functions
+    mutable QReadWriteLock rwlSessionRegistry; //INTERNAL: Protects session registry and worker thread loads
+    int iLastClientID; //INTERNAL: Last assigned client ID
+    QHash<int, TCPServerSocket *> hshSessions; //INTERNAL: Connected clients, indexed by ID
+    QHash<QPair<QString, quint16>, int> hshSessionIDsByEndpoint; //INTERNAL: IDs of connected TCP clients, indexed by IP address and port, local clients share their endpoint and are not indexed
+
+    void CloseSession(int iClientID); //INTERNAL: Remove a client from the registry, and inform upper layers
+    bool ListenOnPort(); //INTERNAL: Start listening on iListeningPort with the backend in use, and on sLocalEndpoint if set
+    void EmitCommandEvents(int iClientID, const QList<QByteArray> & lstCommands, const QString & sClientName, const QString & sClientIPAddress, quint16 iClientPort); //INTERNAL: Inform upper layers of commands without a handler
+
+    /* Command Handlers */
+    NetworkingCommandTable tblCommands; //INTERNAL: Shared by all socket objects, destroyed after them
+    NetworkingCommandExecutor * excCommands; //INTERNAL: Shared by all socket objects, deleted after them
+
+    void SendCommandReplies(int iClientID, const QList<QByteArray> & lstReplies); //INTERNAL: Reimplemented from NetworkingCommandReplySink, queue replies to the client's socket
+
+    /* Metrics */
+    //Written by the thread owns this object only
+    NetworkingCounter cntSessionsAccepted; //INTERNAL: Sessions opened
+    NetworkingCounter cntSessionsClosed; //INTERNAL: Sessions closed
+    NetworkingCounter cntClosedFramesReceived; //INTERNAL: Counters of closed sessions, added when they are removed from the registry
+    NetworkingCounter cntClosedBytesReceived;
+    NetworkingCounter cntClosedCommandsExecuted;
+    NetworkingCounter cntClosedCommandsRejected;
+    NetworkingCounter cntClosedFramesSent;
+    NetworkingCounter cntClosedBytesSent;
+    NetworkingCounter cntDeadClients; //INTERNAL: Sessions closed on missed heartbeats
+    NetworkingCounter cntClosedOutputFramesDropped; //INTERNAL: Responses dropped by closed sessions
+    NetworkingCounter cntSlowClients; //INTERNAL: Sessions closed by the slow client policy
 
     /* Incoming Connection Management */
     void incomingConnection(int iSocketID); //Reimplement incomingConnecting() function, create a new socket object
+    void OpenSession(int iSocketID, const QString & sLocalEndpointAccepted); //INTERNAL: Create a socket object for an accepted connection and register the session, sLocalEndpointAccepted is empty for TCP connections
 };
 
 /* TCP Server */
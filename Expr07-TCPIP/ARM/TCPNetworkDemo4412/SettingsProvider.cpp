@@ -1,3 +1,284 @@
 #include "SettingsProvider.h"
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+#include <QThread>
+#include <cstdio>
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
-QSettings SettingsContainer(ST_MAIN_DATABASE_PATH, QSettings::IniFormat); //Initialize settings container using INI format, for capability with embedded platforms.
+SettingsStore SettingsContainer(ST_MAIN_DATABASE_PATH); //Initialize settings container using INI format, for capability with embedded platforms.
+
+/* Writer Thread */
+class SettingsStoreWriter : public QThread {
+public:
+    explicit SettingsStoreWriter(SettingsStore * stoSettingsInit) {
+        stoSettings = stoSettingsInit;
+    }
+
+protected:
+    void run() {
+        stoSettings->RunWriter();
+        return;
+    }
+
+private:
+    SettingsStore * stoSettings;
+};
+
+/* Setting Container */
+SettingsStore::SettingsStore(const QString & sFilePathInit) {
+    //Initialize internal variables
+    sFilePath = sFilePathInit;
+    bIsWritePending = false;
+    iFirstPendingWriteTime = 0;
+    iLastPendingWriteTime = 0;
+    bIsWriterStopRequested = false;
+    trdWriter = NULL;
+    tmrClock.start();
+
+    //Load all settings, this is the only time the ini file is read
+    QSettings setFile(sFilePath, QSettings::IniFormat);
+    QStringList lstKeys = setFile.allKeys();
+    for (int i = 0; i < lstKeys.size(); ++i) {
+        hshValues.insert(lstKeys.at(i), setFile.value(lstKeys.at(i)));
+    }
+}
+
+SettingsStore::~SettingsStore() {
+    //Stop writer thread, and write what it has not written yet
+    mtxWriteLock.lock();
+    bIsWriterStopRequested = true;
+    wcdWritePending.wakeAll();
+    mtxWriteLock.unlock();
+    if (trdWriter) {
+        trdWriter->wait();
+        delete trdWriter;
+        trdWriter = NULL;
+    }
+    SettingsStore::Flush();
+}
+
+/* Reading */
+QVariant SettingsStore::GetValue(const QString & sGroup, const QString & sKey, const QVariant & varDefaultValue) const {
+    QString sFullKey = sGroup + "/" + sKey;
+    QReadLocker lckValues(&rwlValues);
+    return hshValues.value(sFullKey, varDefaultValue);
+}
+
+QStringList SettingsStore::GetChildKeys(const QString & sGroup) const {
+    //Iterate over a copy, so that writers are not blocked meanwhile
+    const QHash<QString, QVariant> hshValuesRead = SettingsStore::GetValues();
+    QString sGroupPrefix = sGroup + "/";
+    QStringList lstChildKeys;
+    for (QHash<QString, QVariant>::const_iterator itValue = hshValuesRead.constBegin(); itValue != hshValuesRead.constEnd(); ++itValue) {
+        if (itValue.key().startsWith(sGroupPrefix) && itValue.key().indexOf('/', sGroupPrefix.size()) < 0) {
+            lstChildKeys.append(itValue.key().mid(sGroupPrefix.size()));
+        }
+    }
+    lstChildKeys.sort();
+    return lstChildKeys;
+}
+
+QHash<QString, QVariant> SettingsStore::GetValues() const {
+    //Only the reference count is increased under the lock, the hash is never modified in place thus the copy stays valid
+    QReadLocker lckValues(&rwlValues);
+    return hshValues;
+}
+
+/* Writing */
+void SettingsStore::SetValue(const QString & sGroup, const QString & sKey, const QVariant & varValue) {
+    QMap<QString, QVariant> mapValues;
+    mapValues.insert(sKey, varValue);
+    SettingsStore::SetValues(sGroup, mapValues);
+    return;
+}
+
+void SettingsStore::SetValues(const QString & sGroup, const QMap<QString, QVariant> & mapValues) {
+    //Values are only replaced with mtxWriteLock held, thus they can be read here without rwlValues
+    QMutexLocker lckWriteLock(&mtxWriteLock);
+
+    //Nothing is published or written if no value has changed, e.g. when options are saved again unchanged
+    bool bIsChanged = false;
+    for (QMap<QString, QVariant>::const_iterator itValue = mapValues.constBegin(); itValue != mapValues.constEnd(); ++itValue) {
+        QHash<QString, QVariant>::const_iterator itCurrentValue = hshValues.constFind(sGroup + "/" + itValue.key());
+        if (itCurrentValue == hshValues.constEnd() || itCurrentValue.value() != itValue.value()) {
+            bIsChanged = true;
+            break;
+        }
+    }
+    if (!bIsChanged) {
+        return;
+    }
+
+    //Publish a modified copy, readers keep reading the current values while it is made
+    QHash<QString, QVariant> hshValuesNew = hshValues;
+    for (QMap<QString, QVariant>::const_iterator itValue = mapValues.constBegin(); itValue != mapValues.constEnd(); ++itValue) {
+        hshValuesNew.insert(sGroup + "/" + itValue.key(), itValue.value());
+    }
+    SettingsStore::PublishValues(hshValuesNew);
+    SettingsStore::MarkWritePending();
+    return;
+}
+
+void SettingsStore::Remove(const QString & sGroup, const QString & sKey) {
+    QMutexLocker lckWriteLock(&mtxWriteLock);
+
+    //Remove the key, or every key of the group
+    QHash<QString, QVariant> hshValuesNew = hshValues;
+    int iKeysRemoved = 0;
+    if (sKey.isEmpty()) {
+        QString sGroupPrefix = sGroup + "/";
+        QHash<QString, QVariant>::iterator itValue = hshValuesNew.begin();
+        while (itValue != hshValuesNew.end()) {
+            if (itValue.key().startsWith(sGroupPrefix)) {
+                itValue = hshValuesNew.erase(itValue);
+                ++iKeysRemoved;
+            }
+            else {
+                ++itValue;
+            }
+        }
+    }
+    else {
+        iKeysRemoved = hshValuesNew.remove(sGroup + "/" + sKey);
+    }
+    if (iKeysRemoved == 0) {
+        return;
+    }
+    SettingsStore::PublishValues(hshValuesNew);
+    SettingsStore::MarkWritePending();
+    return;
+}
+
+bool SettingsStore::Flush() {
+    return SettingsStore::WritePendingChanges();
+}
+
+void SettingsStore::PublishValues(const QHash<QString, QVariant> & hshValuesNew) {
+    //Old values are freed by whoever drops the last reference to them, which may be a reader holding a copy
+    QWriteLocker lckValues(&rwlValues);
+    hshValues = hshValuesNew;
+    return;
+}
+
+/* Write-Behind */
+void SettingsStore::MarkWritePending() {
+    qint64 iCurrentTime = tmrClock.elapsed();
+    if (!bIsWritePending) {
+        bIsWritePending = true;
+        iFirstPendingWriteTime = iCurrentTime;
+    }
+    iLastPendingWriteTime = iCurrentTime;
+
+    //Start writer thread on first change, after destruction has begun changes are written by the destructor
+    if (!trdWriter && !bIsWriterStopRequested) {
+        trdWriter = new SettingsStoreWriter(this);
+        trdWriter->start(QThread::LowPriority);
+    }
+    wcdWritePending.wakeAll();
+    return;
+}
+
+bool SettingsStore::WritePendingChanges() {
+    //Take a copy of current values, and write it out of the write lock so that writers are never blocked by the file system
+    QMutexLocker lckFileLock(&mtxFileLock);
+    QHash<QString, QVariant> hshValuesWritten;
+    {
+        QMutexLocker lckWriteLock(&mtxWriteLock);
+        if (!bIsWritePending) {
+            return true;
+        }
+        hshValuesWritten = hshValues; //Implicitly shared, no copy
+        bIsWritePending = false;
+    }
+    if (!SettingsStore::WriteFile(hshValuesWritten)) {
+        //Retry later, unless a newer change comes first
+        qDebug() << "SettingsStore: Couldnot write" << sFilePath << ", retrying in" << ST_STORE_MAX_WRITE_DELAY_MS << "ms.";
+        QMutexLocker lckWriteLock(&mtxWriteLock);
+        if (!bIsWritePending) {
+            bIsWritePending = true;
+            iFirstPendingWriteTime = tmrClock.elapsed();
+            iLastPendingWriteTime = iFirstPendingWriteTime + ST_STORE_MAX_WRITE_DELAY_MS - ST_STORE_WRITE_DELAY_MS;
+        }
+        return false;
+    }
+    return true;
+}
+
+bool SettingsStore::WriteFile(const QHash<QString, QVariant> & hshValuesWritten) {
+    //Write a complete temporary file next to the ini file
+    QString sTemporaryFilePath = sFilePath + ".tmp";
+    QFile::remove(sTemporaryFilePath);
+    {
+        QSettings setTemporaryFile(sTemporaryFilePath, QSettings::IniFormat);
+        for (QHash<QString, QVariant>::const_iterator itValue = hshValuesWritten.constBegin(); itValue != hshValuesWritten.constEnd(); ++itValue) {
+            setTemporaryFile.setValue(itValue.key(), itValue.value());
+        }
+        setTemporaryFile.sync();
+        if (setTemporaryFile.status() != QSettings::NoError) {
+            return false;
+        }
+    }
+
+#ifdef Q_OS_UNIX
+    //Make sure the data is on flash before the rename, then replace the ini file in one step
+    QFile fileTemporary(sTemporaryFilePath);
+    if (fileTemporary.open(QIODevice::ReadOnly)) {
+        fsync(fileTemporary.handle());
+        fileTemporary.close();
+    }
+    if (rename(QFile::encodeName(sTemporaryFilePath).constData(), QFile::encodeName(sFilePath).constData()) != 0) {
+        return false;
+    }
+
+    //The rename itself is only on flash once the directory is synced
+    int iDirectoryDescriptor = open(QFile::encodeName(QFileInfo(sFilePath).absolutePath()).constData(), O_RDONLY);
+    if (iDirectoryDescriptor >= 0) {
+        fsync(iDirectoryDescriptor);
+        close(iDirectoryDescriptor);
+    }
+    return true;
+#else
+    //QFile::rename() does not overwrite, and Qt has no replacing rename, thus this is not atomic: see the header
+    QFile::remove(sFilePath);
+    return QFile::rename(sTemporaryFilePath, sFilePath);
+#endif
+}
+
+void SettingsStore::RunWriter() {
+    mtxWriteLock.lock();
+    while (true) {
+        //Wait for a change
+        while (!bIsWritePending && !bIsWriterStopRequested) {
+            wcdWritePending.wait(&mtxWriteLock);
+        }
+        if (bIsWriterStopRequested) {
+            break; //Pending changes are written by the destructor
+        }
+
+        //Coalesce changes until none is made for a while, or the oldest one has waited long enough
+        while (!bIsWriterStopRequested) {
+            qint64 iCurrentTime = tmrClock.elapsed();
+            qint64 iQuietTimeLeft = iLastPendingWriteTime + ST_STORE_WRITE_DELAY_MS - iCurrentTime;
+            qint64 iMaxDelayLeft = iFirstPendingWriteTime + ST_STORE_MAX_WRITE_DELAY_MS - iCurrentTime;
+            if (iQuietTimeLeft <= 0 || iMaxDelayLeft <= 0) {
+                break;
+            }
+            wcdWritePending.wait(&mtxWriteLock, static_cast<unsigned long>(qMin(iQuietTimeLeft, iMaxDelayLeft)));
+        }
+        if (bIsWriterStopRequested) {
+            break;
+        }
+
+        //Write without holding the write lock
+        mtxWriteLock.unlock();
+        SettingsStore::WritePendingChanges();
+        mtxWriteLock.lock();
+    }
+    mtxWriteLock.unlock();
+    return;
+}
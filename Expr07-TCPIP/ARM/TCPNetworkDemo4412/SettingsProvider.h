@@ -4,18 +4,37 @@
  * This file defines default strings, setting keys, deafult values, etc.
  * This file also defines a global-wide setting container.
  *
+ * The setting container keeps all settings in memory, readers only take a read lock for a single lookup and never touch the file.
+ * Changes are made on an implicitly shared copy which replaces the settings as a whole, and written to the ini file behind the caller's back by a writer thread:
+ * writes are coalesced until no change has been made for ST_STORE_WRITE_DELAY_MS (or ST_STORE_MAX_WRITE_DELAY_MS has passed),
+ * and the file is replaced by writing a temporary file and renaming it, so that a power loss never leaves a truncated file.
+ * On Unix the rename is atomic and the directory is synced after it. Elsewhere the ini file is removed before the rename,
+ * a power loss between both steps leaves the settings in the temporary file only (".tmp" appended to the file name).
+ *
  */
 
 #ifndef SETTINGSPROVIDER_H
 #define SETTINGSPROVIDER_H
 
-#include <QSettings>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QWaitCondition>
 
 /* Main Strings */
 #define ST_MAIN_ORGANIZATION  "SEU-BME"
 #define ST_MAIN_APPLICATION   "TCPNetworkDemo4412"
 #define ST_MAIN_DATABASE_PATH "./Network.ini"
 
+/* Setting Container Options */
+#define ST_STORE_WRITE_DELAY_MS     500 //Changes are written once no change has been made for this long
+#define ST_STORE_MAX_WRITE_DELAY_MS 5000 //Upper bound of the delay of a change, under a steady stream of changes
+
 /* Setting Key Names */
 //Networking
 #define ST_KEY_NETWORKING_PREFIX   "Networking"
@@ -24,15 +43,137 @@
 #define ST_KEY_IS_AUTORECONN_ON    "IsAutoReconnectEnabled"
 #define ST_KEY_AUTORECONN_DELAY_MS "AutoReconnectDelay"
 #define ST_KEY_LISTENING_PORT      "ListeningPort"
+//Networking: Client Connections
+#define ST_KEY_AUTORECONN_MAX_DELAY_MS   "AutoReconnectMaxDelay"
+#define ST_KEY_AUTORECONN_JITTER         "AutoReconnectJitter"
+#define ST_KEY_CONNECT_TIMEOUT_MS        "ConnectTimeout"
+#define ST_KEY_FALLBACK_SERVERS          "FallbackServers"
+#define ST_KEY_CLIENT_CONNECTIONS        "ClientConnections"
+#define ST_KEY_CLIENT_SPREAD_CONNECTIONS "ClientSpreadConnections"
+//Networking: Client Sending
+#define ST_KEY_SEND_BATCH_SIZE        "SendBatchSize"
+#define ST_KEY_SEND_BATCH_LATENCY_US  "SendBatchMaxLatency"
+#define ST_KEY_CLIENT_BINARY_FRAMING  "ClientBinaryFraming"
+#define ST_KEY_CLIENT_COMPRESSION     "ClientCompression"
+#define ST_KEY_COMPRESSION_THRESHOLD  "CompressionThreshold"
+#define ST_KEY_COMPRESSION_LEVEL      "CompressionLevel"
+#define ST_KEY_QUEUE_MAX_BYTES        "DataQueueMaxBytes"
+#define ST_KEY_QUEUE_OVERFLOW_POLICY  "DataQueueOverflowPolicy"
+#define ST_KEY_QUEUE_BLOCK_TIMEOUT_MS "DataQueueBlockTimeout"
+#define ST_KEY_QUEUE_DECIMATION       "DataQueueDecimation"
+#define ST_KEY_QUEUE_HIGH_WATERMARK   "DataQueueHighWatermark"
+#define ST_KEY_QUEUE_LOW_WATERMARK    "DataQueueLowWatermark"
+//Networking: Heartbeats
+#define ST_KEY_HEARTBEAT_INTERVAL_MS "HeartbeatInterval"
+#define ST_KEY_HEARTBEAT_MAX_MISSED  "HeartbeatMaxMissed"
+//Networking: Server
+#define ST_KEY_SERVER_BINARY_FRAMING     "ServerBinaryFraming"
+#define ST_KEY_SERVER_COMPRESSION        "ServerCompression"
+#define ST_KEY_SERVER_WORKER_THREADS     "ServerWorkerThreads"
+#define ST_KEY_SERVER_DISTRIBUTION       "ServerConnectionDistribution"
+#define ST_KEY_SERVER_OUTPUT_MAX_BYTES   "ServerOutputQueueMaxBytes"
+#define ST_KEY_SERVER_SLOW_CLIENT_POLICY "ServerSlowClientPolicy"
+#define ST_KEY_SERVER_BACKEND            "ServerBackend"
+#define ST_KEY_SERVER_LOCAL_ENDPOINT     "ServerLocalSocket"
+//Networking: Server Commands
+#define ST_KEY_SERVER_COMMAND_THREADS      "ServerCommandThreads"
+#define ST_KEY_SERVER_COMMAND_CLIENT_QUEUE "ServerCommandClientQueueLimit"
+#define ST_KEY_SERVER_COMMAND_QUEUE        "ServerCommandQueueLimit"
 
 /* Default Values */
 //Networking
-#define ST_DEFVAL_SERVER_IP           "127.0.0.1"
+#define ST_DEFVAL_SERVER_IP           "127.0.0.1" //IP address, or a local endpoint ("unix:/path" or "unix:@name") for servers on the same board
 #define ST_DEFVAL_SERVER_PORT         "5245"
 #define ST_DEFVAL_IS_AUTORECONN_ON    false
-#define ST_DEFVAL_AUTORECONN_DELAY_MS 1000
+#define ST_DEFVAL_AUTORECONN_DELAY_MS 1000 //Delay before first retry, doubled after each round of failed attempts
 #define ST_DEFVAL_LISTENING_PORT      "6245"
+//Networking: Client Connections
+#define ST_DEFVAL_AUTORECONN_MAX_DELAY_MS   30000
+#define ST_DEFVAL_AUTORECONN_JITTER         20 //In percent of the delay
+#define ST_DEFVAL_CONNECT_TIMEOUT_MS        3000
+#define ST_DEFVAL_FALLBACK_SERVERS          "" //Comma separated "IP:Port" list, tried in order when the server is unreachable
+#define ST_DEFVAL_CLIENT_CONNECTIONS        1 //Parallel connections data frames are striped across
+#define ST_DEFVAL_CLIENT_SPREAD_CONNECTIONS false //Spread parallel connections across server and fallback servers
+//Networking: Client Sending
+#define ST_DEFVAL_SEND_BATCH_SIZE        4096
+#define ST_DEFVAL_SEND_BATCH_LATENCY_US  0
+#define ST_DEFVAL_CLIENT_BINARY_FRAMING  false
+#define ST_DEFVAL_CLIENT_COMPRESSION     false //Request compression when connected, implies binary framing
+#define ST_DEFVAL_COMPRESSION_THRESHOLD  512 //Batches smaller than this (in bytes) are sent uncompressed
+#define ST_DEFVAL_COMPRESSION_LEVEL      1 //zlib level, fastest compression suits ARM boards best
+#define ST_DEFVAL_QUEUE_MAX_BYTES        4194304
+#define ST_DEFVAL_QUEUE_OVERFLOW_POLICY  "DropOldest"
+#define ST_DEFVAL_QUEUE_BLOCK_TIMEOUT_MS 100
+#define ST_DEFVAL_QUEUE_DECIMATION       4
+#define ST_DEFVAL_QUEUE_HIGH_WATERMARK   75
+#define ST_DEFVAL_QUEUE_LOW_WATERMARK    25
+//Networking: Heartbeats
+#define ST_DEFVAL_HEARTBEAT_INTERVAL_MS 5000 //Ping interval of every connection, 0 to disable heartbeats
+#define ST_DEFVAL_HEARTBEAT_MAX_MISSED  3 //Peer is declared dead when this many pings are not answered
+//Networking: Server
+#define ST_DEFVAL_SERVER_BINARY_FRAMING     false
+#define ST_DEFVAL_SERVER_COMPRESSION        false
+#define ST_DEFVAL_SERVER_WORKER_THREADS     0 //0 for one worker thread per CPU core
+#define ST_DEFVAL_SERVER_DISTRIBUTION       "RoundRobin"
+#define ST_DEFVAL_SERVER_OUTPUT_MAX_BYTES   1048576 //Responses waiting for each slow client, in bytes
+#define ST_DEFVAL_SERVER_SLOW_CLIENT_POLICY "DropOldest"
+#define ST_DEFVAL_SERVER_BACKEND            "Qt" //"Qt" or "Epoll", see NetworkingControlInterface.Epoll.h
+#define ST_DEFVAL_SERVER_LOCAL_ENDPOINT     "" //"unix:/path" or "unix:@name" listened on besides ListeningPort, empty to disable, see NetworkingControlInterface.Local.h
+//Networking: Server Commands
+#define ST_DEFVAL_SERVER_COMMAND_THREADS      0 //0 for one command thread per CPU core
+#define ST_DEFVAL_SERVER_COMMAND_CLIENT_QUEUE 64 //Commands waiting for execution per client, more are answered with NET_COMMAND_REPLY_BUSY
+#define ST_DEFVAL_SERVER_COMMAND_QUEUE        4096 //Commands waiting for execution of all clients
+
+/* Setting Container */
+class SettingsStoreWriter;
+
+class SettingsStore {
+public:
+    explicit SettingsStore(const QString & sFilePathInit); //Load all settings from the ini file
+    ~SettingsStore(); //Stop the writer thread and write pending changes
+
+    /* Reading, never blocked by the file system */
+    QVariant GetValue(const QString & sGroup, const QString & sKey, const QVariant & varDefaultValue = QVariant()) const;
+    QStringList GetChildKeys(const QString & sGroup) const;
+
+    /* Writing, the ini file is written later by the writer thread */
+    void SetValue(const QString & sGroup, const QString & sKey, const QVariant & varValue);
+    void SetValues(const QString & sGroup, const QMap<QString, QVariant> & mapValues); //Several changes are seen by readers at once
+    void Remove(const QString & sGroup, const QString & sKey = QString()); //Remove a key, or the whole group if sKey is empty
+    bool Flush(); //Write pending changes now, returns false if the ini file could not be written
+
+private:
+    /* Values */
+    QString sFilePath; //INTERNAL: Path of the ini file
+    QHash<QString, QVariant> hshValues; //INTERNAL: Full keys ("Group/Key") and values, only replaced as a whole, read under rwlValues or mtxWriteLock
+    mutable QReadWriteLock rwlValues; //INTERNAL: Held for reading during a single lookup or copy, for writing only while hshValues is replaced
+    QElapsedTimer tmrClock; //INTERNAL: Clock of write coalescing
+
+    QHash<QString, QVariant> GetValues() const; //INTERNAL: Implicitly shared copy of all values, which stays valid while they are replaced
+    void PublishValues(const QHash<QString, QVariant> & hshValuesNew); //INTERNAL: Replace all values, called with mtxWriteLock held
+
+    /* Write-Behind */
+    QMutex mtxWriteLock; //INTERNAL: Serializes writers, protects everything below
+    QWaitCondition wcdWritePending; //INTERNAL: Wakes up the writer thread on changes and on stop
+    bool bIsWritePending; //INTERNAL: Marks if the values have changes not written yet
+    qint64 iFirstPendingWriteTime; //INTERNAL: Time of the oldest change not written yet
+    qint64 iLastPendingWriteTime; //INTERNAL: Time of the latest change not written yet
+    bool bIsWriterStopRequested; //INTERNAL: Marks if the writer thread should quit
+    SettingsStoreWriter * trdWriter; //INTERNAL: Writer thread, started on first change
+    QMutex mtxFileLock; //INTERNAL: Serializes file writes, so that older values never overwrite newer ones. Taken before mtxWriteLock
+
+    void MarkWritePending(); //INTERNAL: Schedule a write, called with mtxWriteLock held
+    bool WritePendingChanges(); //INTERNAL: Write current values if they have pending changes
+    bool WriteFile(const QHash<QString, QVariant> & hshValuesWritten); //INTERNAL: Write a temporary file and rename it over the ini file
+    void RunWriter(); //INTERNAL: Body of the writer thread
+
+    friend class SettingsStoreWriter;
+
+    /* Disable Copying */
+    SettingsStore(const SettingsStore &);
+    SettingsStore & operator=(const SettingsStore &);
+};
 
-extern QSettings SettingsContainer;
+extern SettingsStore SettingsContainer;
 
 #endif // SETTINGSPROVIDER_H
@@ -12,16 +12,60 @@ TARGET = TCPNetworkDemo4412
 TEMPLATE = app
 
 
-SOURCES += main.cpp\
-        MainWindow.cpp \
-    NetworkingControlInterface.Client.cpp \
+SOURCES += NetworkingControlInterface.Client.cpp \
+    NetworkingControlInterface.Commands.cpp \
+    NetworkingControlInterface.Epoll.cpp \
+    NetworkingControlInterface.FrameQueue.cpp \
+    NetworkingControlInterface.Framing.cpp \
+    NetworkingControlInterface.Heartbeat.cpp \
+    NetworkingControlInterface.Local.cpp \
+    NetworkingControlInterface.Metrics.cpp \
     NetworkingControlInterface.Server.cpp \
     SettingsProvider.cpp
 
-HEADERS  += MainWindow.h \
-    NetworkingControlInterface.Client.h \
+HEADERS  += NetworkingControlInterface.Client.h \
+    NetworkingControlInterface.Commands.h \
+    NetworkingControlInterface.Epoll.h \
+    NetworkingControlInterface.FrameQueue.h \
+    NetworkingControlInterface.Framing.h \
     NetworkingControlInterface.h \
+    NetworkingControlInterface.Heartbeat.h \
+    NetworkingControlInterface.Local.h \
+    NetworkingControlInterface.Metrics.h \
     NetworkingControlInterface.Server.h \
     SettingsProvider.h
 
-FORMS    += MainWindow.ui
+# Headless network daemon without QApplication and MainWindow, for boards without a display
+# Build with: qmake CONFIG+=headless
+headless {
+    QT       -= gui widgets
+    CONFIG   += console
+    TARGET = TCPNetworkDaemon4412
+
+    SOURCES += DaemonMain.cpp \
+        NetworkDaemon.cpp
+
+    HEADERS += NetworkDaemon.h
+} else:benchmark {
+    # Loopback throughput and latency benchmark, results are written as JSON lines
+    # Widgets are only used by the log history run ("--log-view"), other runs need no display
+    # Build with: qmake CONFIG+=benchmark
+    CONFIG   += console
+    TARGET = TCPNetworkBenchmark4412
+
+    SOURCES += BenchmarkMain.cpp \
+        LogHistory.cpp \
+        NetworkBenchmark.cpp
+
+    HEADERS += LogHistory.h \
+        NetworkBenchmark.h
+} else {
+    SOURCES += main.cpp \
+        LogHistory.cpp \
+        MainWindow.cpp
+
+    HEADERS += LogHistory.h \
+        MainWindow.h
+
+    FORMS    += MainWindow.ui
+}